@@ -14,6 +14,10 @@
 
 #pragma once
 #include <cstdint>
+#include <cstring>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 
 namespace baikaldb {
 
@@ -37,7 +41,7 @@ public:
         if (is_big) {
             return in;
         }
-        return ((in & 0x00FF) << 8) | ((in & 0xFF00) >> 8);
+        return __builtin_bswap16(in);
     }
 
     static uint32_t to_endian_u32(uint32_t in) {
@@ -45,10 +49,7 @@ public:
         if (is_big) {
             return in;
         }
-        return ((in & 0x000000FF) << 24) |
-               ((in & 0x0000FF00) << 8) |
-               ((in & 0x00FF0000) >> 8) |
-               ((in & 0xFF000000) >> 24);
+        return __builtin_bswap32(in);
     }
 
     static uint64_t to_endian_u64(uint64_t in) {
@@ -56,14 +57,7 @@ public:
         if (is_big) {
             return in;
         }
-        return ((in & 0x00000000000000FF) << 56) |
-               ((in & 0x000000000000FF00) << 40) |
-               ((in & 0x0000000000FF0000) << 24) |
-               ((in & 0x00000000FF000000) << 8) |
-               ((in & 0x000000FF00000000) >> 8) |
-               ((in & 0x0000FF0000000000) >> 24) |
-               ((in & 0x00FF000000000000) >> 40) |
-               ((in & 0xFF00000000000000) >> 56);
+        return __builtin_bswap64(in);
     }
 
     static uint16_t to_little_endian_u16(uint16_t in) {
@@ -172,7 +166,78 @@ public:
         return *reinterpret_cast<double*>(&in);
     }
 
+    // 批量编解码n个定长值，out/in为连续的n个mem-comparable大端编码
+    // 结果与逐个append_i64/extract_i64等一致，用于一批key的同一列
+    static void encode_i64_batch(const int64_t* in, size_t n, char* out) {
+        swap_xor_batch<uint64_t>((const char*)in, n, to_endian_u64(SIGN_MASK_64), out);
+    }
+
+    static void decode_i64_batch(const char* in, size_t n, int64_t* out) {
+        swap_xor_batch<uint64_t>(in, n, SIGN_MASK_64, (char*)out);
+    }
+
+    static void encode_u64_batch(const uint64_t* in, size_t n, char* out) {
+        swap_xor_batch<uint64_t>((const char*)in, n, 0, out);
+    }
+
+    static void decode_u64_batch(const char* in, size_t n, uint64_t* out) {
+        swap_xor_batch<uint64_t>(in, n, 0, (char*)out);
+    }
+
+    static void encode_i32_batch(const int32_t* in, size_t n, char* out) {
+        swap_xor_batch<uint32_t>((const char*)in, n, to_endian_u32(SIGN_MASK_32), out);
+    }
+
+    static void decode_i32_batch(const char* in, size_t n, int32_t* out) {
+        swap_xor_batch<uint32_t>(in, n, SIGN_MASK_32, (char*)out);
+    }
+
+    static void encode_u32_batch(const uint32_t* in, size_t n, char* out) {
+        swap_xor_batch<uint32_t>((const char*)in, n, 0, out);
+    }
+
+    static void decode_u32_batch(const char* in, size_t n, uint32_t* out) {
+        swap_xor_batch<uint32_t>(in, n, 0, (char*)out);
+    }
+
 private:
+    static uint32_t to_endian(uint32_t in) {
+        return to_endian_u32(in);
+    }
+
+    static uint64_t to_endian(uint64_t in) {
+        return to_endian_u64(in);
+    }
+
+    // out[i] = to_endian(in[i]) ^ mask
+    // 编码时mask为转换后的符号位，解码时为原符号位，in/out不要求对齐
+    template <typename T>
+    static void swap_xor_batch(const char* in, size_t n, T mask, char* out) {
+        size_t i = 0;
+#ifdef __SSSE3__
+        if (!is_big_endian()) {
+            // 每16字节一次shuffle完成多个值的字节反转
+            const __m128i shuffle = sizeof(T) == 8 ?
+                _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8) :
+                _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            const __m128i xor_mask = sizeof(T) == 8 ?
+                _mm_set1_epi64x((int64_t)mask) : _mm_set1_epi32((int32_t)mask);
+            const size_t step = 16 / sizeof(T);
+            for (; i + step <= n; i += step) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(in + i * sizeof(T)));
+                v = _mm_xor_si128(_mm_shuffle_epi8(v, shuffle), xor_mask);
+                _mm_storeu_si128((__m128i*)(out + i * sizeof(T)), v);
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            T v;
+            memcpy(&v, in + i * sizeof(T), sizeof(T));
+            v = to_endian(v) ^ mask;
+            memcpy(out + i * sizeof(T), &v, sizeof(T));
+        }
+    }
+
     KeyEncoder();
 };
 }
@@ -55,6 +55,7 @@ static const std::string VIRTUAL_DATABASE_NAME = "__virtual_db";              //
 static const std::string TABLE_IN_FAST_IMPORTER= "in_fast_import";
 static const std::string TABLE_TAIL_SPLIT_NUM  = "tail_split_num";            //尾分裂数量
 static const std::string TABLE_TAIL_SPLIT_STEP = "tail_split_step";           //尾分裂步长
+static const std::string TABLE_RESULT_CACHE_TTL = "result_cache_ttl_s";       //查询结果缓存时间
 struct UserInfo;
 class TableRecord;
 typedef std::shared_ptr<TableRecord> SmartRecord;
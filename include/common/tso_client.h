@@ -0,0 +1,52 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <bthread/mutex.h>
+#include "common.h"
+#include "meta_server_interact.hpp"
+
+namespace baikaldb {
+DECLARE_int32(tso_max_inflight_batch);
+
+// 批量、流水线的TSO客户端，baikaldb和store共用
+// 并发的get_tso调用排队，由一个tso_service请求申请总数，返回后按到达顺序分给各调用方
+// 最多tso_max_inflight_batch个请求同时在途，在途期间到达的调用方组成下一批
+// 只合并请求发出前到达的调用方，保证分到的ts晚于调用开始时刻
+class TsoClient {
+public:
+    explicit TsoClient(MetaServerInteract* interact) : _interact(interact) {}
+
+    // 返回连续count个ts的起始值，失败返回-1
+    int64_t get_tso(int64_t count);
+
+private:
+    struct TsoWaiter {
+        int64_t     count = 0;
+        int64_t     timestamp = -1;
+        BthreadCond cond;
+    };
+    void send_batch(std::vector<TsoWaiter*> batch);
+    int64_t fetch_tso(int64_t count);
+
+    MetaServerInteract*     _interact = nullptr;
+    bthread::Mutex          _mutex;
+    std::vector<TsoWaiter*> _pending;
+    int                     _inflight = 0;
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
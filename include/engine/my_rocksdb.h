@@ -133,6 +133,8 @@ public:
 
     rocksdb::Status RollbackToSavePoint() { return _txn->RollbackToSavePoint(); }
 
+    rocksdb::Status PopSavePoint() { return _txn->PopSavePoint(); }
+
     std::vector<rocksdb::TransactionID> GetWaitingTxns(uint32_t* column_family_id, 
                                                         std::string* key) const {
           return _txn->GetWaitingTxns(column_family_id, key);
@@ -0,0 +1,87 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <bthread/mutex.h>
+#include "rocksdb/slice.h"
+#include "common.h"
+#include "proto/meta.interface.pb.h"
+
+namespace baikaldb {
+DECLARE_int64(region_load_key_sample_rate);
+DECLARE_int64(region_load_max_sample_keys);
+DECLARE_int64(region_load_min_sample_keys);
+DECLARE_int64(region_load_bytes_sample_rate);
+
+// region级别的读写负载采样，leader心跳时滚动窗口上报meta
+// meta据此把leader/peer从热点store迁走，store据此按访问分布选择分裂点
+// 执行耗时只统计leader上select和dml的执行时间，raft写入与apply不计入
+class RegionLoadStat {
+public:
+    RegionLoadStat() : _window_start_us(butil::gettimeofday_us()) {}
+
+    void add_read(const google::protobuf::Message& response, int64_t time_us) {
+        _read_count.fetch_add(1, std::memory_order_relaxed);
+        _read_bytes.fetch_add(sample_bytes(response), std::memory_order_relaxed);
+        _exec_time_us.fetch_add(time_us, std::memory_order_relaxed);
+    }
+    void add_write(const google::protobuf::Message& request, int64_t time_us) {
+        _write_count.fetch_add(1, std::memory_order_relaxed);
+        _write_bytes.fetch_add(sample_bytes(request), std::memory_order_relaxed);
+        _exec_time_us.fetch_add(time_us, std::memory_order_relaxed);
+    }
+    // key为去掉region_id和index_id前缀的主键
+    void sample_key(const rocksdb::Slice& key);
+
+    // 结束当前窗口，按秒折算后填充load，同时作为上一窗口保存
+    void roll_window(pb::RegionLoad* load);
+    void get_last_load(pb::RegionLoad* load);
+    // 用上一窗口的采样key在[start_key, end_key)内选择分裂点，使两侧访问量接近
+    // 热点集中在单个key上时分裂无意义，返回false
+    bool get_load_split_key(const std::string& start_key, const std::string& end_key,
+                            std::string& split_key);
+
+    static int64_t load_score(const pb::RegionLoad& load) {
+        return load.exec_time_us();
+    }
+    static bool select_split_key(std::vector<std::string>& keys, const std::string& start_key,
+                                 const std::string& end_key, std::string& split_key);
+
+private:
+    static int64_t sample_bytes(const google::protobuf::Message& message);
+
+    std::atomic<int64_t> _read_count {0};
+    std::atomic<int64_t> _write_count {0};
+    std::atomic<int64_t> _read_bytes {0};
+    std::atomic<int64_t> _write_bytes {0};
+    std::atomic<int64_t> _exec_time_us {0};
+
+    bthread::Mutex _mutex;
+    int64_t _window_start_us = 0;
+    // 蓄水池采样
+    std::vector<std::string> _sample_keys;
+    int64_t _sample_seen = 0;
+    std::vector<std::string> _last_sample_keys;
+    pb::RegionLoad _last_load;
+};
+typedef std::shared_ptr<RegionLoadStat> SmartRegionLoadStat;
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
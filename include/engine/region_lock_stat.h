@@ -0,0 +1,79 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include "rocksdb/status.h"
+#include "common.h"
+
+namespace baikaldb {
+DECLARE_int64(txn_lock_wait_record_us);
+
+// region级别的行锁等待统计
+// 只有出现过锁等待/超时/死锁的region才expose bvar，前缀为region_lock_<region_id>
+// 避免store上大量region各自注册bvar
+class RegionLockStat {
+public:
+    explicit RegionLockStat(int64_t region_id) : _region_id(region_id) {}
+
+    // 加锁调用(Put/Delete/GetForUpdate)结束后统计，cost_us包含等锁时间
+    void add_lock_result(const rocksdb::Status& res, int64_t cost_us) {
+        static bvar::LatencyRecorder txn_lock_wait_time("txn_lock_wait_time");
+        static bvar::Adder<int64_t> txn_lock_timeout_count("txn_lock_timeout_count");
+        static bvar::Adder<int64_t> txn_deadlock_count("txn_deadlock_count");
+        if (res.IsTimedOut()) {
+            txn_lock_timeout_count << 1;
+            expose();
+            _lock_timeout_count << 1;
+        } else if (res.IsDeadlock()) {
+            txn_deadlock_count << 1;
+            expose();
+            _deadlock_count << 1;
+        } else if (cost_us < FLAGS_txn_lock_wait_record_us) {
+            return;
+        }
+        txn_lock_wait_time << cost_us;
+        expose();
+        _lock_wait_time << cost_us;
+    }
+
+private:
+    void expose() {
+        if (_exposed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        bool expected = false;
+        if (!_exposed.compare_exchange_strong(expected, true)) {
+            return;
+        }
+        std::string prefix = "region_lock_" + std::to_string(_region_id);
+        _lock_wait_time.expose(prefix + "_wait_time");
+        _lock_timeout_count.expose(prefix + "_timeout_count");
+        _deadlock_count.expose(prefix + "_deadlock_count");
+    }
+
+    int64_t _region_id = 0;
+    std::atomic<bool> _exposed {false};
+    bvar::LatencyRecorder _lock_wait_time;
+    bvar::Adder<int64_t> _lock_timeout_count;
+    bvar::Adder<int64_t> _deadlock_count;
+};
+typedef std::shared_ptr<RegionLockStat> SmartRegionLockStat;
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
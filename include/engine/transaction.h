@@ -27,6 +27,8 @@
 #include "trace_state.h"
 #include "my_rocksdb.h"
 #include "tuple_record.h"
+#include "region_load_stat.h"
+#include "region_lock_stat.h"
 
 namespace baikaldb {
 DECLARE_bool(disable_wal);
@@ -57,6 +59,8 @@ class TransactionPool;
 // 不同region资源隔离，不需要每次从SchemaFactory加锁获取
 struct RegionResource {
     pb::RegionInfo region_info;
+    SmartRegionLoadStat load_stat;
+    SmartRegionLockStat lock_stat;
 };
 class Transaction {
 public:
@@ -106,6 +110,8 @@ public:
 
     // rollback the txn to a specific sequence id
     void rollback_to_point(int seq_id);
+    // 拆分提交的kv batch只apply了一部分，回滚该seq_id等待重新执行，不记入need_rollback_seq
+    void rollback_incomplete_kv_batch(int seq_id);
 
     // Key format: region_id(8 bytes) + table_id(8 bytes) + primary_key_fields;
     // Value format: protobuf of all non-primary key fields;
@@ -305,6 +311,11 @@ public:
         return _is_finished;
     }
 
+    // 当前语句加锁时被rocksdb死锁检测选为牺牲者，set_save_point时清理
+    bool is_deadlock() const {
+        return _is_deadlock;
+    }
+
     bool in_process() const {
         return _in_process;
     }
@@ -393,6 +404,12 @@ public:
         txn_info.set_num_rows(num_increase_rows);
         txn_info.set_primary_region_id(_primary_region_id);
         txn_info.set_txn_timeout(_txn_timeout);
+        if (_async_commit) {
+            txn_info.set_async_commit(true);
+            for (auto region_id : _secondary_region_ids) {
+                txn_info.add_secondary_region_ids(region_id);
+            }
+        }
         return 0;
     }
 
@@ -496,6 +513,37 @@ public:
         return _primary_region_id;
     }
 
+    void set_async_commit(const pb::TransactionInfo& txn_info) {
+        BAIDU_SCOPED_LOCK(_txn_mutex);
+        _async_commit = txn_info.async_commit();
+        _secondary_region_ids.assign(txn_info.secondary_region_ids().begin(),
+                txn_info.secondary_region_ids().end());
+    }
+
+    bool is_async_commit() const {
+        return _async_commit;
+    }
+
+    // async commit的primary决议回滚时，在还未prepare的secondary上设置，之后prepare失败
+    // 已prepare或已结束返回false
+    bool rollback_fence() {
+        BAIDU_SCOPED_LOCK(_txn_mutex);
+        if (_is_prepared || _is_finished) {
+            return false;
+        }
+        _is_rollback_fenced = true;
+        return true;
+    }
+
+    bool is_rollback_fenced() const {
+        return _is_rollback_fenced;
+    }
+
+    std::vector<int64_t> secondary_region_ids() {
+        BAIDU_SCOPED_LOCK(_txn_mutex);
+        return _secondary_region_ids;
+    }
+
     void set_txn_timeout(int64_t timeout) {
         _txn_timeout = timeout;
     }
@@ -512,6 +560,24 @@ public:
         _store_req.Clear();
     }
 
+    // follower上拆分提交的kv batch只apply了一部分的seq_id，0表示没有
+    int kv_batch_incomplete_seq() const {
+        return _kv_batch_incomplete_seq;
+    }
+    void set_kv_batch_incomplete_seq(int seq_id) {
+        _kv_batch_incomplete_seq = seq_id;
+    }
+    void append_kv_ops_to_cache(int seq_id, const pb::StoreReq& request) {
+        BAIDU_SCOPED_LOCK(_cache_map_mutex);
+        auto iter = _cache_plan_map.find(seq_id);
+        if (iter == _cache_plan_map.end()) {
+            return;
+        }
+        for (auto& kv_op : request.kv_ops()) {
+            iter->second.add_kv_ops()->CopyFrom(kv_op);
+        }
+    }
+
     int64_t txn_timeout() const {
         return _txn_timeout;
     }
@@ -563,6 +629,21 @@ public:
     std::string remote_side = ""; // 便于定位超时事务来源
 
 private:
+    // 采样访问的主键，用于按负载分裂
+    void sample_load_key(const rocksdb::Slice& key) {
+        if (_resource != nullptr && _resource->load_stat != nullptr) {
+            _resource->load_stat->sample_key(key);
+        }
+    }
+    // 统计加锁等待，死锁时标记事务，便于上层返回ER_LOCK_DEADLOCK
+    void add_lock_result(const rocksdb::Status& res, const TimeCost& cost) {
+        if (res.IsDeadlock()) {
+            _is_deadlock = true;
+        }
+        if (_resource != nullptr && _resource->lock_stat != nullptr) {
+            _resource->lock_stat->add_lock_result(res, cost.get_time());
+        }
+    }
     int get_update_primary(
             int64_t         region, 
             IndexInfo&      pk_index, 
@@ -611,6 +692,7 @@ private:
     bool                            _is_prepared = false;
     bool                            _is_finished = false;
     bool                            _is_rolledback = false;
+    bool                            _is_deadlock = false;
     std::atomic<bool>               _in_process {false};
     bool                            _write_begin_index = true;
     bool                            _has_dml_executed = false;
@@ -620,6 +702,9 @@ private:
     pb::StoreReq                    _store_req;
     pb::StoreRes                    _store_res;
     int64_t                         _primary_region_id = -1;
+    bool                            _async_commit = false;
+    bool                            _is_rollback_fenced = false;
+    std::vector<int64_t>            _secondary_region_ids;
     std::set<int>                   _current_req_point_seq;
     std::set<int>                   _need_rollback_seq;
     // store the query cmd from BEGIN to PREPARE
@@ -635,6 +720,7 @@ private:
     const rocksdb::Snapshot*        _snapshot = nullptr;
     pb::RegionInfo*                 _region_info = nullptr;
     std::shared_ptr<RegionResource> _resource;
+    int                             _kv_batch_incomplete_seq = 0;
     RocksWrapper*                   _db = nullptr;
     TransactionPool*                _pool = nullptr;
     SmartTable                      _table_info; // for cstore
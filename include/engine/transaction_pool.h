@@ -15,6 +15,7 @@
 #pragma once
  
 #include <unordered_map>
+#include <unordered_set>
 #include "common.h"
 #include "transaction.h"
 
@@ -118,8 +119,12 @@ public:
 
     void txn_query_primary_region(uint64_t txn_id, Region* region, pb::RegionInfo& region_info);
     void txn_commit_through_raft(uint64_t txn_id, pb::RegionInfo& region_info, pb::OpType op_type);
+    // async commit事务在primary上决议: secondary全部prepare则提交，否则回滚，状态未知时等下次
+    void resolve_async_commit(uint64_t txn_id, Region* region);
+    void resolve_async_commit_in_background(uint64_t txn_id, Region* region);
     void get_txn_state(const pb::StoreReq* request, pb::StoreRes* response);
-    void read_only_txn_process(int64_t region_id, SmartTransaction txn, pb::OpType op_type, bool optimize_1pc);
+    // -1 prepare失败(事务已被fence回滚)
+    int read_only_txn_process(int64_t region_id, SmartTransaction txn, pb::OpType op_type, bool optimize_1pc);
     int get_region_info_from_meta(int64_t region_id, pb::RegionInfo& region_info);
     //清空所有的状态
     void clear();
@@ -133,6 +138,9 @@ private:
         int64_t primary_region_id = -1;
     };
     bool process_out_of_order_txn(Region* region, uint64_t txn_id, TxnParams& txn_params);
+    // 查询secondary上的事务状态，失败返回-1
+    int secondary_txn_state(uint64_t txn_id, int64_t secondary_region_id,
+            pb::OpType op_type, pb::TxnState& txn_state);
 
 private:
     int64_t _region_id = 0;
@@ -147,6 +155,9 @@ private:
     TimeCost _clean_finished_txn_cost;
 
     BthreadCond  _num_prepared_txn;  // total number of prepared transactions
+    // 正在决议的async commit事务，防止重复决议
+    bthread::Mutex               _resolving_mutex;
+    std::unordered_set<uint64_t> _resolving_txns;
     std::atomic<int32_t> _txn_count;
     MetaWriter*          _meta_writer = nullptr;
 };
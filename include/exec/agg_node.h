@@ -26,6 +26,7 @@
 #include "exec_node.h"
 #include "agg_fn_call.h"
 #include "mut_table_key.h"
+#include "arrow_column_batch.h"
 
 namespace baikaldb {
 class AggNode : public ExecNode {
@@ -48,7 +49,16 @@ public:
     virtual void close(RuntimeState* state);
     virtual void transfer_pb(int64_t region_id, pb::PlanNode* pb_node);
     void encode_agg_key(MemRow* row, MutTableKey& key);
+    // group by全部为定长整数列时，按列批量编码整个batch的key
+    bool can_encode_agg_key_by_column();
+    void encode_agg_keys_by_column(RowBatch& batch, std::vector<std::string>& keys);
     void process_row_batch(RuntimeState* state, RowBatch& batch, int64_t& used_size, int64_t& release_size);
+    bool can_bypass_partial_agg();
+    bool need_bypass_partial_agg();
+    int get_next_bypass(RuntimeState* state, RowBatch* batch, bool* eos);
+    // store上无group by的数值列预聚合，按arrow列批量计算
+    bool can_agg_by_column();
+    int process_row_batch_by_column(RowBatch& batch, int64_t& used_size, int64_t& release_size);
     std::vector<ExprNode*>* mutable_group_exprs() {
         return &_group_exprs;
     }
@@ -72,7 +82,7 @@ private:
     //需要推导_agg_tuple_id内部slot的类型
     std::vector<ExprNode*> _group_exprs;
     int32_t _agg_tuple_id;
-    int     _row_cnt = 0;
+    int64_t _row_cnt = 0;
     pb::TupleDescriptor* _group_tuple_desc;
     std::vector<AggFnCall*> _agg_fn_calls;
     std::set<int> _agg_slot_set;
@@ -81,6 +91,17 @@ private:
     //用于分组和get_next的定位,用map可与mysql保持一致
     butil::FlatMap<std::string, MemRow*> _hash_map;
     butil::FlatMap<std::string, MemRow*>::iterator _iter;
+    // store预聚合效果差时(分组接近唯一)，剩余行直接透传给merger
+    bool _adaptive_partial_agg = false;
+    bool _bypass = false;
+    size_t _bypass_child_idx = 0;
+    bool _agg_by_column = false;
+    bool _encode_key_by_column = false;
+    // 批量编码key的每列字节缓冲
+    std::vector<std::vector<char>> _key_columns;
+    ArrowColumnBatch _column_batch;
+    // 与_agg_fn_calls对应的参数列下标，count(*)为-1
+    std::vector<int> _agg_column_idx;
 };
 }
 /* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -0,0 +1,62 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "common.h"
+#include "row_batch.h"
+#include "type_utils.h"
+
+namespace arrow {
+class Array;
+class RecordBatch;
+class Schema;
+}
+
+namespace baikaldb {
+// 把RowBatch中指定slot按列转成arrow RecordBatch，供store预聚合等按列计算
+// 有符号整数列转为int64，无符号整数列转为uint64，浮点列转为double
+class ArrowColumnBatch {
+public:
+    static bool support_type(pb::PrimitiveType type) {
+        return is_int(type) || is_double(type);
+    }
+    // 返回列下标，相同slot只转换一次
+    int add_column(int32_t tuple_id, int32_t slot_id, pb::PrimitiveType type);
+    int build(RowBatch& batch);
+    const arrow::Array* column(int idx) const;
+    int64_t num_rows() const {
+        return _num_rows;
+    }
+    size_t column_size() const {
+        return _columns.size();
+    }
+
+private:
+    struct Column {
+        int32_t tuple_id;
+        int32_t slot_id;
+        pb::PrimitiveType type;
+    };
+    std::vector<Column> _columns;
+    std::shared_ptr<arrow::Schema> _schema;
+    std::shared_ptr<arrow::RecordBatch> _record_batch;
+    int64_t _num_rows = 0;
+};
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -343,6 +343,11 @@ public:
         no_copy_cache_plan_set.clear();
         dynamic_timeout_ms = -1;
         callids.clear();
+        wave_limit = -1;
+        limit_reached = false;
+        plan_fragment.clear();
+        plan_fragment_sign = 0;
+        plan_fragment_scan.Clear();
     }
 
     void cancel_rpc() {
@@ -353,6 +358,18 @@ public:
         is_cancelled = true;
     }
 
+    // limit已满足，取消剩余的rpc；被取消的请求不算失败
+    void cancel_rpc_for_limit() {
+        BAIDU_SCOPED_LOCK(region_lock);
+        if (limit_reached) {
+            return;
+        }
+        limit_reached = true;
+        for (auto& callid : callids) {
+            brpc::StartCancel(callid);
+        }
+    }
+
     void insert_callid(const brpc::CallId& callid) {
         BAIDU_SCOPED_LOCK(region_lock);
         callids.insert(callid);
@@ -370,6 +387,14 @@ public:
         send_request(state, store_request, infos, start_seq_id, current_seq_id, op_type);
     }
 
+    // 无序limit查询按start_key顺序分批发送region请求，批次逐步扩大，满足limit后不再发送
+    void send_request_in_waves(RuntimeState* state,
+                           ExecNode* store_request,
+                           std::vector<pb::RegionInfo*>& infos,
+                           int start_seq_id,
+                           int current_seq_id,
+                           pb::OpType op_type);
+
     void send_request(RuntimeState* state,
                            ExecNode* store_request, 
                            std::vector<pb::RegionInfo*> infos, 
@@ -414,6 +439,7 @@ public:
                     GlobalBackupType backup_type = GBT_INIT) {
         int ret = run_not_set_state(state, region_infos, store_request, start_seq_id, current_seq_id, op_type, backup_type);
         update_state_info(state);
+        update_result_cache(region_infos, op_type);
         if (ret < 0) {
             state->error_code = error_code;
             state->error_msg.clear();
@@ -424,6 +450,13 @@ public:
         return affected_rows.load();
     }
 
+    // region数较多的select，将与region无关的plan和tuples只序列化一次
+    void build_plan_fragment(RuntimeState* state, ExecNode* store_request,
+            pb::OpType op_type, size_t region_num);
+
+    // 写操作完成后使涉及表的结果缓存失效
+    void update_result_cache(std::map<int64_t, pb::RegionInfo>& region_infos, pb::OpType op_type);
+
     void update_state_info(RuntimeState* state) {
         state->region_count += region_count;
         state->set_num_scan_rows(state->num_scan_rows() + scan_rows.load());
@@ -586,6 +619,13 @@ public:
     std::set<brpc::CallId> callids;
     WriteBinlogParam write_binlog_param;
     GlobalBackupType global_backup_type = GBT_INIT;
+    // >0 表示无序limit查询，按批次fan-out，达到wave_limit行后取消剩余请求
+    int64_t wave_limit = -1;
+    std::atomic<bool> limit_reached = {false};
+    // 非空时各region请求以attachment共享发送，只携带region相关的覆盖信息
+    butil::IOBuf plan_fragment;
+    uint64_t plan_fragment_sign = 0;
+    pb::ScanNode plan_fragment_scan;
 };
 
 template<typename Repeated>
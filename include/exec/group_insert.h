@@ -0,0 +1,75 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <bthread/mutex.h>
+#include "common.h"
+#include "mysql_err_code.h"
+
+namespace baikaldb {
+DECLARE_int64(group_insert_window_us);
+
+class InsertManagerNode;
+// autocommit insert合并写入
+// 窗口内写同一region的并发insert由第一个到达的语句(leader)合并成一个多行请求发送
+// 合并请求失败时所有语句退回单独执行，由各自的执行返回准确的错误和affected rows
+class GroupInsert {
+public:
+    enum Result {
+        NONE,       // 未合并，单独执行
+        DONE,       // 已由合并请求写入
+        FALLBACK,   // 合并请求确定未写入，单独执行以返回准确的错误
+        FAILED      // 合并请求失败且可能已写入，直接返回leader的错误
+    };
+    struct Request {
+        InsertManagerNode* node = nullptr;
+        // 以下由leader在finish时设置
+        Result result = NONE;
+        MysqlErrCode error_code = ER_ERROR_FIRST;
+        std::string error_msg;
+        BthreadCond cond {1};
+    };
+
+    static GroupInsert* get_instance() {
+        static GroupInsert instance;
+        return &instance;
+    }
+    // leader等待窗口结束后取回本组所有请求(包括自身)
+    // follower阻塞到leader通知后返回，group为空
+    // 等待数已达上限时返回-1，由调用方单独执行
+    int join(int64_t region_id, Request* request, std::vector<Request*>& group);
+    // 通知follower，调用后follower的Request可能已经析构
+    void finish(const std::vector<Request*>& group, Request* leader, Result result,
+            MysqlErrCode error_code = ER_ERROR_FIRST, const std::string& error_msg = "");
+    // 合并请求失败后的处理: 只有store明确拒绝(未写入)时才能各自重试，
+    // 超时、切主等情况合并请求可能已经写入，重试会误报主键冲突
+    static Result fail_result(MysqlErrCode error_code) {
+        return error_code == ER_DUP_ENTRY ? FALLBACK : FAILED;
+    }
+
+private:
+    GroupInsert() {}
+
+    bthread::Mutex _mutex;
+    // region_id -> 等待合并的请求
+    std::map<int64_t, std::vector<Request*>> _pending;
+};
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
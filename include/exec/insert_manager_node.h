@@ -85,6 +85,9 @@ public:
     }
 
     int basic_insert(RuntimeState* state);
+    // 并发autocommit insert按region合并发送
+    bool can_group_insert(RuntimeState* state);
+    int group_insert(RuntimeState* state);
     int insert_ignore(RuntimeState* state);
 
     int get_record_from_store(RuntimeState* state);
@@ -94,7 +94,8 @@ public:
             std::map<int32_t, ExecNode*>& tuple_join_child_map,
             std::map<int32_t, std::set<int32_t>>& tuple_equals_map, 
             std::vector<int32_t>& tuple_order,
-            std::vector<ExprNode*>& conditions);
+            std::vector<ExprNode*>& conditions,
+            std::vector<std::pair<SlotRef*, SlotRef*>>& equal_slots);
 };
 }
 
@@ -80,12 +80,20 @@ private:
     int pack_text_row(MemRow* row);
     int pack_binary_row(MemRow* row);
     int pack_eof();
+    // 流式发送已打包的结果，socket写满时挂起当前bthread
+    int stream_flush(RuntimeState* state);
     int fatch_expr_subquery_results(RuntimeState* state);
+    // 相同的投影表达式每行只计算一次
+    void find_same_projections();
+    ExprValue projection_value(size_t idx, MemRow* row);
 
 private:
     bool _binary_protocol = false;
     pb::OpType _op_type;
     std::vector<ExprNode*> _projections;
+    // 与前面某个投影相同时为其下标，否则为-1；没有相同投影时为空
+    std::vector<int> _same_projection_idx;
+    std::vector<ExprValue> _projection_values;
     std::vector<ResultField> _fields;
     NetworkSocket* _client = nullptr;
     MysqlWrapper* _wrapper = nullptr;
@@ -160,6 +160,8 @@ private:
 
     int64_t select_index_common();
     int64_t select_index_by_cost();
+    // 根据统计信息估算使用该索引并过滤后的行数，没有统计信息返回-1
+    int64_t estimate_rows(int64_t index_id);
 private:
     std::set<int64_t> _possible_indexs; // reset时，重置possible的index
     std::map<int64_t, SmartPath> _paths;
@@ -235,6 +237,10 @@ public:
         return _has_index;
     }
 
+    int64_t estimate_rows() {
+        return _main_path.estimate_rows(_select_idx);
+    }
+
     std::vector<ScanIndexInfo>& scan_indexs() {
         return _scan_indexs;
     }
@@ -75,6 +75,7 @@ public:
     void multi_fetcher_store_open(FetcherInfo* self_fetcher, FetcherInfo* other_fetcher,
         RuntimeState* state, ExecNode* exec_node);
     int fetcher_store_run(RuntimeState* state, ExecNode* exec_node);
+    bool can_use_limit_wave(RuntimeState* state);
     int open_global_index(FetcherInfo* fetcher, RuntimeState* state,
                           ExecNode* exec_node,
                           int64_t global_index_id,
@@ -17,6 +17,10 @@
 #include "sorter.h"
 #include "mem_row_descriptor.h"
 
+namespace arrow {
+class Array;
+}
+
 namespace baikaldb {
 class AggFnCall : public ExprNode {
 public:
@@ -72,6 +76,27 @@ public:
     int merge(const std::string& key, MemRow* src, MemRow* dst, int64_t& used_size);
     // 对于avg这种，需要最终计算结果
     int finalize(const std::string& key, MemRow* dst);
+    // 按列更新一批行，column为参数列(count(*)为nullptr)，只支持can_update_by_column的聚合
+    int update_by_column(const arrow::Array* column, int64_t num_rows, MemRow* dst);
+    bool can_update_by_column() const {
+        if (_is_distinct) {
+            return false;
+        }
+        switch (_agg_type) {
+            case COUNT_STAR:
+                return true;
+            case COUNT:
+            case SUM:
+            case MIN:
+            case MAX:
+                return _children.size() == 1 && _children[0]->is_slot_ref();
+            default:
+                return false;
+        }
+    }
+    AggType agg_type() const {
+        return _agg_type;
+    }
 
     static bool all_is_initialize(std::vector<AggFnCall*>& agg_calls,
             const std::string& key,
@@ -131,6 +156,23 @@ public:
                 return false;
         }
     }
+    // 中间结果只存在行内，不依赖按key保存的状态，可以逐行输出给merger
+    bool is_row_local_agg() const {
+        if (_is_distinct) {
+            return false;
+        }
+        switch(_agg_type) {
+            case COUNT_STAR:
+            case COUNT:
+            case SUM:
+            case AVG:
+            case MIN:
+            case MAX:
+                return true;
+            default:
+                return false;
+        }
+    }
     bool is_hll_agg() const {
         switch(_agg_type) {
             case HLL_ADD_AGG:
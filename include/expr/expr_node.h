@@ -74,6 +74,18 @@ public:
         }
         return false;
     }
+    // now()/rand()等无参函数每次执行结果不同，不能提前计算或复用
+    bool has_no_arg_function() {
+        if (_node_type == pb::FUNCTION_CALL && _children.empty()) {
+            return true;
+        }
+        for (auto c : _children) {
+            if (c->has_no_arg_function()) {
+                return true;
+            }
+        }
+        return false;
+    }
     bool has_agg() {
         if (_node_type == pb::AGG_EXPR) {
             return true;
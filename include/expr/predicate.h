@@ -15,6 +15,7 @@
 #pragma once
 
 #include <set>
+#include <unordered_set>
 #include "expr_value.h"
 #include "scalar_fn_call.h"
 #include "re2/re2.h"
@@ -110,12 +111,16 @@ private:
     int row_expr_open();
     ExprValue make_key(ExprNode* e, MemRow* row);
 
+    bool find_int(int64_t value);
+
     pb::PrimitiveType _map_type;
     std::vector<pb::PrimitiveType> _row_expr_types;
     size_t _col_size;
-    std::set<int64_t> _int_set;
-    std::set<double> _double_set;
-    std::set<std::string> _str_set;
+    // 值较少时用有序数组二分查找，否则用hash
+    std::vector<int64_t> _sorted_ints;
+    std::unordered_set<int64_t> _int_set;
+    std::unordered_set<double> _double_set;
+    std::unordered_set<std::string> _str_set;
 };
 
 class LikePredicate : public ScalarFnCall {
@@ -141,6 +146,22 @@ public:
         rocksdb::Slice next_code_point(size_t idx);
         const std::string& str;
     };
+    // 只包含普通字符和%的常量pattern，open时按%切分后直接按字节匹配
+    // utf8是自同步编码，按字节匹配与逐字符匹配结果一致；gbk第二字节可能落在ascii范围，不能使用
+    struct LiteralMatcher {
+        enum MatchType {
+            EXACT,      // abc
+            PREFIX,     // abc%
+            SUFFIX,     // %abc
+            INFIX,      // %abc%
+            SEGMENTS    // a%b%c，首尾segment为空表示不锚定
+        };
+        bool compile(const std::string& pattern, char escape_char);
+        bool match(const char* data, size_t size) const;
+
+        MatchType type = EXACT;
+        std::vector<std::string> segments;
+    };
 
     //todo liguoqiang
     virtual int open();
@@ -158,8 +179,11 @@ private:
     ExprValue get_value_by_re2(MemRow* row);
     ExprValue get_value_by_pattern(MemRow* row);
     void reset_pattern(MemRow* row);
+    void compile_literal_matchers();
+    bool literal_match(const std::string& target);
     std::string _pattern;
     std::vector<std::string> _patterns;
+    std::vector<LiteralMatcher> _literal_matchers;
     char _escape_char = '\\';
     bool _const_pattern = true;
 
@@ -41,6 +41,8 @@ public:
         return ExprNode::get_last_insert_id();
     }
 private:
+    // 参数类型静态已知的数值二元运算和比较，直接计算，不构造参数数组和调用函数指针
+    ExprValue typed_binary_value(MemRow* row);
     ExprValue multi_eq_value(MemRow* row) {
         for (size_t i = 0; i < children(0)->children_size(); i++) {
             auto left = children(0)->children(i)->get_value(row);
@@ -118,6 +120,8 @@ protected:
     pb::Function _fn;
     bool _is_row_expr = false;
     std::function<ExprValue(const std::vector<ExprValue>&)> _fn_call;
+    // 非INVALID_TYPE时走typed_binary_value
+    pb::PrimitiveType _typed_arg_type = pb::INVALID_TYPE;
 };
 }
 
@@ -21,11 +21,28 @@
 #include "base.h"
 #include "expr.h"
 #include "range.h"
+#include "result_cache.h"
 
 namespace baikaldb {
 DECLARE_bool(default_2pc);
 
 class ExecNode;
+class FilterNode;
+class RocksdbScanNode;
+class SelectManagerNode;
+
+// prepare的主键点查计划，首次执行完整规划后生成
+// 之后执行只重新编码主键并路由，跳过索引选择、路由分析和计划分离
+struct PointQueryPlan {
+    bool                    checked = false;    // 已判断过是否可以走点查
+    bool                    valid = false;
+    int64_t                 table_id = 0;
+    FilterNode*             filter_node = nullptr;
+    RocksdbScanNode*        scan_node = nullptr;
+    SelectManagerNode*      manager_node = nullptr;
+    std::vector<int>        placeholder_ids;    // 主键各列对应的placeholder
+    pb::PossibleIndex       primary;            // 主键等值range模板
+};
 
 // notice日志信息统计结构
 struct QueryStat {
@@ -229,6 +246,8 @@ public:
     parser::NodeType    stmt_type;
     bool                is_explain = false;
     bool                is_full_export = false;
+    // 结果集超过阈值时边执行边发送给客户端，结果缓存等需要完整结果的场景关闭
+    bool                stream_result = false;
     bool                is_straight_join = false;
     ExplainType         explain_type = EXPLAIN_NULL;
     int                 single_store_concurrency = -1;
@@ -242,6 +261,7 @@ public:
     pb::Plan            plan;
     ExecNode*           root = nullptr;
     std::map<int, ExprNode*> placeholders;
+    std::shared_ptr<PointQueryPlan> point_query; // prepare select共享
     std::string         prepare_stmt_name;
     std::vector<pb::ExprNode> param_values;
 
@@ -286,6 +306,20 @@ public:
     // /*{"peer_index":$peer_index}*/ preceding a Select statement
     int64_t             peer_index = -1;
 
+    // bounded staleness read on any replica by comments
+    // /*{"max_staleness":$ms}*/ preceding a Select statement
+    int64_t             max_staleness_ms = 0;
+
+    // user can cache select result in baikaldb by comments
+    // /*{"result_cache":$ttl_s}*/ preceding a Select statement
+    int64_t             result_cache_ttl_s = 0;
+    // 含now()/rand()/user()/用户变量等结果随时间或session变化的表达式，结果不能缓存
+    bool                has_non_deterministic_expr = false;
+    // 结果缓存开启时记录select读到的region数据版本
+    bool                record_region_versions = false;
+    RegionVersionMap    region_versions;
+    bthread::Mutex      region_versions_lock;
+
     // in autocommit mode, two phase commit is disabled by default (for better formance)
     // user can enable 2pc by comments /*{"enable_2pc":1}*/ preceding a DML statement
     bool                enable_2pc = false;
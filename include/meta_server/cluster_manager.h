@@ -63,6 +63,7 @@ struct Instance {
     int64_t raft_total_qps = 0;
     int64_t select_latency = 0;
     int64_t select_qps = 0;
+    int64_t leader_load = 0; // leader region负载之和，调度后按迁移的region负载预估更新
     InstanceStateInfo instance_status;
 
     Instance() {
@@ -164,6 +165,10 @@ public:
                             const int64_t& table_id,
                             std::string& selected_instance,
                             const int64_t& average_count = 0);
+    // 按leader负载选择最空闲的实例，用于热点peer迁移
+    int select_instance_min_load(const IdcInfo& idc,
+                                 const std::set<std::string>& exclude_stores,
+                                 std::string& selected_instance);
     int select_instance_min_on_pk_prefix(const IdcInfo& idc_str,
                                       const std::set<std::string>& exclude_stores,
                                       const int64_t& table_id,
@@ -452,6 +457,40 @@ public:
         return _instance_info[instance].instance_status.state;
     }
 
+    int64_t get_leader_load(const std::string& instance) {
+        BAIDU_SCOPED_LOCK(_instance_mutex);
+        auto iter = _instance_info.find(instance);
+        if (iter == _instance_info.end()) {
+            return 0;
+        }
+        return iter->second.leader_load;
+    }
+
+    // 热点调度后更新预估负载，避免同一心跳周期内都迁往同一实例
+    void add_leader_load(const std::string& instance, int64_t load) {
+        BAIDU_SCOPED_LOCK(_instance_mutex);
+        auto iter = _instance_info.find(instance);
+        if (iter != _instance_info.end()) {
+            iter->second.leader_load = std::max(iter->second.leader_load + load, (int64_t)0);
+        }
+    }
+
+    // resource_tag下正常实例的平均leader负载
+    int64_t get_average_leader_load(const std::string& resource_tag) {
+        BAIDU_SCOPED_LOCK(_instance_mutex);
+        int64_t total_load = 0;
+        int64_t instance_count = 0;
+        for (auto& pair : _instance_info) {
+            if (pair.second.resource_tag != resource_tag
+                    || pair.second.instance_status.state != pb::NORMAL) {
+                continue;
+            }
+            total_load += pair.second.leader_load;
+            ++instance_count;
+        }
+        return instance_count == 0 ? 0 : total_load / instance_count;
+    }
+
     Instance get_instance(std::string instance) {
         BAIDU_SCOPED_LOCK(_instance_mutex);
         if (_instance_info.find(instance) == _instance_info.end()) {
@@ -146,6 +146,13 @@ public:
                     std::unordered_map<int64_t, IdcInfo>& table_main_idc,
                     std::set<int64_t>& trans_leader_region_ids);
     
+    // 按region负载把leader/peer从热点store迁走
+    void hot_region_load_balance(const std::string& instance,
+                                 const pb::StoreHeartBeatRequest* request,
+                                 const IdcInfo& leader_idc,
+                                 std::set<int64_t>& trans_leader_region_ids,
+                                 pb::StoreHeartBeatResponse* response);
+
     void leader_load_balance_on_pk_prefix(const std::string& instance,
                                           const pb::StoreHeartBeatRequest* request,
                                           std::unordered_map<int64_t, int64_t>& table_total_instance_counts,
@@ -194,6 +201,7 @@ public:
         _instance_leader_count.clear();
         _instance_pk_prefix_leader_count.clear();
         _remove_region_peer_on_pk_prefix.clear();
+        _remove_region_peer_on_hot.clear();
         _incremental_region_info.clear();
         _region_learner_peer_state_map.clear();
     }
@@ -453,6 +461,33 @@ public:
         BAIDU_SCOPED_LOCK(_count_mutex);
         _remove_region_peer_on_pk_prefix.erase(region_id);
     }
+    void add_remove_peer_on_hot(const int64_t& region_id, const std::string& instance) {
+        BAIDU_SCOPED_LOCK(_count_mutex);
+        _remove_region_peer_on_hot[region_id] = std::make_pair(instance, butil::gettimeofday_us());
+    }
+    bool need_remove_peer_on_hot(const int64_t& region_id, std::string& instance) {
+        BAIDU_SCOPED_LOCK(_count_mutex);
+        if (_remove_region_peer_on_hot.count(region_id) <= 0) {
+            return false;
+        }
+        instance = _remove_region_peer_on_hot[region_id].first;
+        return true;
+    }
+    void clear_remove_peer_on_hot(const int64_t region_id) {
+        BAIDU_SCOPED_LOCK(_count_mutex);
+        _remove_region_peer_on_hot.erase(region_id);
+    }
+    // 标记后超时仍没有多出的peer，认为add peer失败，清理标记
+    void clear_remove_peer_on_hot_if_expired(const int64_t region_id, int64_t timeout_us) {
+        BAIDU_SCOPED_LOCK(_count_mutex);
+        auto iter = _remove_region_peer_on_hot.find(region_id);
+        if (iter != _remove_region_peer_on_hot.end()
+                && butil::gettimeofday_us() - iter->second.second > timeout_us) {
+            DB_WARNING("region_id: %ld add peer for hot region balance timeout, hot instance: %s",
+                        region_id, iter->second.first.c_str());
+            _remove_region_peer_on_hot.erase(iter);
+        }
+    }
     int64_t get_leader_count(const std::string& instance, int64_t table_id) {
         BAIDU_SCOPED_LOCK(_count_mutex);
         if (_instance_leader_count.find(instance) == _instance_leader_count.end()
@@ -567,6 +602,8 @@ private:
     // region_id -> logical_room，处理store心跳发现大户不均，标记需要迁移的region_id及其候选store需要在的logical room
     // check_peer_count发现region_id在map里，直接按照大户的维度删除peer数最多的candidate，否则按照table维度删除peer
     std::unordered_map<int64_t, IdcInfo>            _remove_region_peer_on_pk_prefix;
+    // region_id -> (热点实例, 标记时间)，热点迁移add peer后，check_peer_count优先删除热点实例上的peer
+    std::unordered_map<int64_t, std::pair<std::string, int64_t>> _remove_region_peer_on_hot;
 
     bthread_mutex_t                                     _doing_mutex;
     std::set<std::string>                               _doing_migrate; 
@@ -15,11 +15,24 @@
 #pragma once
 
 #include "query_context.h"
+#include "slot_ref.h"
 
 namespace baikaldb {
 class JoinReorder {
 public:
     int analyze(QueryContext* ctx);
+private:
+    // 基于规则的重排：有索引的表优先驱动，按等值条件配对；返回false表示不重排
+    bool reorder_by_rule(std::map<int32_t, ExecNode*>& tuple_join_child_map,
+            std::map<int32_t, std::set<int32_t>>& tuple_equals_map,
+            std::vector<int32_t>& tuple_order,
+            std::vector<int32_t>& tuple_reorder);
+    // 基于统计信息的代价重排：表数不超过join_reorder_dp_max_tables时动态规划，否则贪心
+    // 有表缺少统计信息时返回false，退化为规则重排
+    bool reorder_by_cost(std::map<int32_t, ExecNode*>& tuple_join_child_map,
+            std::vector<std::pair<SlotRef*, SlotRef*>>& equal_slots,
+            std::vector<int32_t>& tuple_order,
+            std::vector<int32_t>& tuple_reorder);
 };
 }
 
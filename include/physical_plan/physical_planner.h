@@ -37,6 +37,9 @@ public:
     // insert user variables to record for prepared stmt
     static int insert_values_to_record(QueryContext* ctx);
 private:
+    // prepare主键点查，返回1表示需要走完整规划
+    static int analyze_point_query(QueryContext* ctx);
+    static void build_point_query(QueryContext* ctx);
 };
 }
 
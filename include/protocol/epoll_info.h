@@ -30,8 +30,12 @@ public:
     EpollInfo();
     ~EpollInfo();
 
-    bool init();    
+    // reactor_idx用于区分各reactor的bvar
+    bool init(int reactor_idx = 0);
     int wait(uint32_t timeout);
+    void add_event_count(int64_t count) {
+        _event_count << count;
+    }
 
     bool set_fd_mapping(int fd, SmartSocket sock);
     SmartSocket get_fd_mapping(int fd);
@@ -51,6 +55,12 @@ private:
     int                 _epfd;
     struct epoll_event  _events[CONFIG_MPL_EPOLL_MAX_SIZE];
     size_t              _event_size;
+
+    bvar::Adder<int64_t> _conn_count;
+    bvar::Adder<int64_t> _event_count;
+    bvar::PerSecond<bvar::Adder<int64_t>> _event_qps {&_event_count};
+    bvar::LatencyRecorder _handle_time;
+    TimeCost             _handle_cost;
 };
 
 } // namespace baikal
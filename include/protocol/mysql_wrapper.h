@@ -57,6 +57,10 @@ const uint32_t PACKET_LEN_MAX                    = 0x00ffffff;
 const uint32_t PACKET_HEADER_LEN                 = 4;
 const uint32_t MAX_ERR_MSG_LEN                   = 2048;
 const uint32_t MAX_WRITE_QUERY_RESULT_PACKET_LEN = 1048576;
+// 压缩协议帧头: 3字节压缩后长度 + 1字节序号 + 3字节压缩前长度(0表示未压缩)
+const uint32_t COMPRESS_HEADER_LEN               = 7;
+// 每次压缩的原始数据长度，压缩后不超过DataBuffer默认容量
+const uint32_t COMPRESS_CHUNK_LEN                = 524288;
 
 class MysqlWrapper {
 public:
@@ -87,6 +91,10 @@ public:
     int real_read_header(SmartSocket sock, int want_len, int* real_read_len);
     int real_read(SmartSocket sock, int we_want, int* ret_read_len);
     int real_write(SmartSocket sock);
+    // 执行过程中把send_buf全部写出，socket不可写时bthread等待，不阻塞worker
+    int stream_write(NetworkSocket* sock, int64_t timeout_us);
+    // 认证完成后切换到压缩协议
+    void enable_compress(NetworkSocket* sock);
 
     bool is_shutdown_command(uint8_t command);
     bool is_prepare_command(uint8_t command);
@@ -127,6 +135,13 @@ public:
             pb::ExprNode& node);
 
 private:
+    // 语义与read()相同，压缩协议下返回解压后的数据
+    int socket_read(NetworkSocket* sock, uint8_t* buf, int want_len);
+    // 读取并解压一个完整的压缩帧，返回1成功，0对端关闭，-1失败(errno)
+    int read_compress_frame(NetworkSocket* sock);
+    // 把send_buf中未发送的数据(最多max_len)打包成压缩帧追加到compress_send_buf
+    int compress_send_buf(NetworkSocket* sock, uint32_t max_len);
+
     MysqlWrapper();
     MysqlWrapper& operator=(const MysqlWrapper& other);
     MysqlErrHandler* _err_handler;
@@ -15,6 +15,9 @@
 // Brief:  The defination of Network Server.
 #pragma once
 
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "network_socket.h"
 #include "state_machine.h"
 #include "epoll_info.h"
@@ -81,9 +84,12 @@ public:
 
     bool get_shutdown() { return _shutdown; }
 
-    EpollInfo* get_epoll_info() {
-        return _epoll_info;
+    bool is_epoll_inited() const {
+        return !_epoll_infos.empty();
     }
+    // 在所有reactor中查找fd对应的连接，epoll_info返回其所属reactor
+    SmartSocket get_fd_mapping(int fd, EpollInfo** epoll_info = nullptr);
+    bool all_txn_time_large_then(int64_t query_time, int64_t table_id);
 
     uint64_t get_instance_id() {
         return _instance_id;
@@ -94,7 +100,7 @@ private:
     NetworkServer();
     NetworkServer& operator=(const NetworkServer& other);
     bool set_fd_flags(int fd);
-    SmartSocket create_listen_socket();
+    SmartSocket create_listen_socket(bool reuseport);
     void construct_other_heart_beat_request(pb::BaikalOtherHeartBeatRequest& request);
     void process_other_heart_beat_response(const pb::BaikalOtherHeartBeatResponse& response);
 
@@ -104,6 +110,7 @@ private:
 
     int fetch_instance_info();
     int make_worker_process();
+    int reactor_loop(int reactor_idx);
     void connection_timeout_check();
     void report_heart_beat();
     void report_other_heart_beat();
@@ -134,8 +141,11 @@ private:
     bool            _is_init = false;   // Flag of initialization status.
     bool            _shutdown = false;  // Flag of graceful shutdown.
     // Socket info.
-    SmartSocket     _service = nullptr;  // Server socket.
-    EpollInfo*      _epoll_info = nullptr;      // Epoll info and fd mapping.
+    // 每个reactor独立的epoll和fd mapping，不使用SO_REUSEPORT时只有reactor 0有监听socket
+    std::vector<SmartSocket> _services;         // Server socket.
+    std::vector<EpollInfo*>  _epoll_infos;      // Epoll info and fd mapping.
+    std::vector<std::thread> _reactor_threads;
+    std::atomic<uint64_t>    _accept_count {0};
 
     Bthread         _conn_check_bth;
     Bthread         _heartbeat_bth;
@@ -67,6 +67,7 @@ const std::string SQL_SHOW_KEYS                  = "keys";                  // s
 const std::string SQL_SHOW_PARTITION_TABLE       = "partition_tables";      // show partition table info
 const std::string SQL_SHOW_ABNORMAL_SWITCH       = "abnormal_switch";       // show abnormal_switch
 const std::string SQL_SHOW_META_BINLOG           = "meta_binlog";           // show meta_binlog db.table
+const std::string SQL_SHOW_RESULT_CACHE          = "result_cache";          // show result_cache
 
 namespace baikaldb {
 typedef std::shared_ptr<NetworkSocket> SmartSocket;
@@ -163,6 +164,8 @@ private:
     bool _show_abnormal_switch(const SmartSocket& client, const std::vector<std::string>& split_vec);
 
     bool _show_meta_binlog(const SmartSocket& client, const std::vector<std::string>& split_vec);
+    // sql: show result_cache
+    bool _show_result_cache(const SmartSocket& client, const std::vector<std::string>& split_vec);
 
     bool _handle_client_query_template_dispatch(const SmartSocket& client, const std::vector<std::string>& split_vec);
     int _make_common_resultset_packet(const SmartSocket& sock, 
@@ -122,6 +122,10 @@ private:
     bool _handle_client_query_select_database(SmartSocket client);
     bool _handle_client_query_select_connection_id(SmartSocket client);
     bool _handle_client_query_common_query(SmartSocket client);
+    // 显式事务中语句死锁时回滚整个事务
+    void _rollback_txn_on_deadlock(SmartSocket client);
+    // 返回结果缓存的ttl(s)，0表示不可缓存
+    int64_t _get_result_cache_ttl(SmartSocket client, std::set<int64_t>& table_ids);
     bool _handle_client_query_desc_table(SmartSocket client);
     //int _make_common_resultset_packet(SmartSocket sock, SmartTable table);
     //int _make_common_resultset_packet(SmartSocket sock, SmartResultSet result_set);
@@ -57,6 +57,9 @@ public:
         std::set<uint64_t>& txn_ids, std::map<uint64_t, std::string>& log_entrys);
 private:
     LogEntryReader() {}
+    // 使用segment log的region，按index读取[start, end]内属于txn_ids的日志
+    int read_segment_txn_log_entry(int64_t region_id, int64_t start_log_index, int64_t end_log_index,
+        std::set<uint64_t>& txn_ids, std::map<int64_t, std::pair<uint64_t, std::string>>& log_entrys);
 
 private:
     RocksWrapper*       _rocksdb;
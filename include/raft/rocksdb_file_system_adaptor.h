@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <limits>
 #include <map>
 #ifdef BAIDU_INTERNAL
 #include <raft/file_system_adaptor.h>
@@ -30,6 +31,17 @@ const std::string SNAPSHOT_META_FILE = "region_meta_snapshot.sst";
 const std::string SNAPSHOT_DATA_FILE_WITH_SLASH = "/" + SNAPSHOT_DATA_FILE;
 const std::string SNAPSHOT_META_FILE_WITH_SLASH = "/" + SNAPSHOT_META_FILE;
 const size_t SST_FILE_LENGTH = 128 * 1024 * 1024;
+// 拆分为多个chunk时，每个chunk数据结尾追加: flag(size_t) + key_count(int64_t) + crc32c(uint32_t)
+const size_t SNAPSHOT_CHUNK_TRAILER_FLAG = std::numeric_limits<size_t>::max();
+const size_t SNAPSHOT_CHUNK_TRAILER_SIZE = sizeof(size_t) + sizeof(int64_t) + sizeof(uint32_t);
+
+// 大region的数据快照按key范围拆成chunk_num个文件: region_data_snapshot.sst_<idx>_<num>
+// chunk_num为1时仍使用SNAPSHOT_DATA_FILE，兼容老版本
+inline std::string snapshot_data_chunk_file(int chunk_idx, int chunk_num) {
+    return SNAPSHOT_DATA_FILE + "_" + std::to_string(chunk_idx) + "_" + std::to_string(chunk_num);
+}
+bool parse_snapshot_data_chunk(const std::string& path, int* chunk_idx, int* chunk_num);
+int snapshot_data_chunk_num(uint64_t region_size);
 
 class RocksdbFileSystemAdaptor;
 class Region;
@@ -49,6 +61,13 @@ struct IteratorContext {
     bool need_copy_data = true;
     TimeCost offset_update_time; // 更新offset时更新此时间，长时间未访问可能对端挂掉
     SnapshotContext* sc = nullptr;
+    // 数据chunk，chunk_num为1时为整个region
+    int chunk_idx = 0;
+    int chunk_num = 1;
+    std::string start_key;
+    int64_t chunk_key_count = 0;
+    uint32_t chunk_crc = 0;
+    bool chunk_trailer_sent = false;
 };
 
 typedef std::shared_ptr<IteratorContext> IteratorContextPtr;
@@ -66,6 +85,13 @@ struct SnapshotContext {
     IteratorContextPtr meta_context = nullptr;
     int64_t data_index = 0;
     int64_t binlog_check_point = 0;
+    bool copy_data_checked = false;
+    bool need_copy_data = true;
+    // chunk i的范围为[chunk_bounds[i], chunk_bounds[i + 1])
+    std::vector<std::string> chunk_bounds;
+    std::map<int, IteratorContextPtr> chunk_contexts;
+    bthread::Mutex chunk_size_mutex;
+    std::map<int, int64_t> chunk_sizes;
 };
 
 typedef std::shared_ptr<SnapshotContext> SnapshotContextPtr;
@@ -126,6 +152,11 @@ private:
     bool region_shutdown();
 
     void context_reset();
+    int64_t read_package(butil::IOPortal* portal, size_t size);
+    void set_snapshot_size(SmartRegion region);
+    // 当前包发给对端的同时在后台生成下一个包
+    void start_read_ahead(size_t size);
+    int wait_read_ahead();
 
 private:
 
@@ -139,6 +170,10 @@ private:
     size_t _num_lines = 0;
     butil::IOPortal _last_package;
     off_t _last_offset = 0;
+    Bthread _read_ahead_bth {&BTHREAD_ATTR_SMALL};
+    bool _read_ahead_running = false;
+    int64_t _read_ahead_ret = 0;
+    butil::IOPortal _read_ahead_package;
 };
 
 class SstWriterAdaptor : public braft::FileAdaptor {
@@ -165,6 +200,16 @@ protected:
 private:
     bool finish_sst();
     int iobuf_to_sst(butil::IOBuf data);
+    int check_chunk_trailer(butil::IOBuf& data);
+    std::string sst_path() const {
+        if (_is_meta) {
+            return _path;
+        }
+        if (_chunk_num > 1) {
+            return _path + "_" + std::to_string(_sst_idx);
+        }
+        return _path + std::to_string(_sst_idx);
+    }
     int64_t _region_id;
     SmartRegion _region_ptr;
     std::string _path;
@@ -173,6 +218,11 @@ private:
     size_t _data_size = 0;
     bool _closed = true;
     bool _is_meta = false;
+    int _chunk_idx = 0;
+    int _chunk_num = 1;
+    int64_t _chunk_key_count = 0;
+    uint32_t _chunk_crc = 0;
+    bool _chunk_verified = false;
     std::unique_ptr<SstFileWriter> _writer;
 };
 
@@ -226,6 +276,9 @@ private:
                               butil::File::Error* e);
 
     SnapshotContextPtr get_snapshot(const std::string& path);
+    bool check_need_copy_data(SnapshotContextPtr sc);
+    void init_chunk_bounds(SnapshotContextPtr sc, int chunk_num,
+                           const std::string& prefix, const std::string& upper_bound);
 
 private:
     struct ContextEnv {
@@ -0,0 +1,204 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <unistd.h>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <bthread/mutex.h>
+#include <bthread/condition_variable.h>
+#ifdef BAIDU_INTERNAL
+#include <raft/storage.h>
+#else
+#include <braft/storage.h>
+#endif
+#include "common.h"
+
+namespace baikaldb {
+DECLARE_string(raftlog_uri);
+
+// 整个store共享的追加写raft日志，替代raft_log cf
+// 所有region的日志顺序追加到segment_<id>文件，多个region的fsync合并为一次
+// 内存中维护每个region的 index => (segment, offset) 索引，启动时扫描全部segment恢复
+// 所有region都truncate过的segment整体删除，不再依赖compaction
+//
+// 记录格式: RecordHead(SEGMENT_LOG_HEAD_SIZE) + data
+// RecordHead: magic(4) + record_type(4) + region_id(8) + index(8) + term(8)
+//             + entry_type(4) + data_len(4) + crc32c(4)
+enum SegmentRecordType {
+    SEGMENT_RECORD_ENTRY           = 1,  // index/term/entry_type有效
+    SEGMENT_RECORD_TRUNCATE_PREFIX = 2,  // index为first_index_kept
+    SEGMENT_RECORD_TRUNCATE_SUFFIX = 3,  // index为last_index_kept
+    SEGMENT_RECORD_RESET           = 4,  // index为next_log_index
+    SEGMENT_RECORD_DROP            = 5,  // region被删除
+    SEGMENT_RECORD_CHECKPOINT      = 6   // 新segment头部记录各region的first_log_index
+};
+
+struct SegmentLogPos {
+    int64_t segment_id = 0;
+    int64_t offset = 0;     // data在segment中的偏移
+    int64_t term = 0;
+    int32_t data_len = 0;
+    int32_t type = 0;
+};
+
+struct SegmentRegionIndex {
+    int64_t first_log_index = 1;
+    std::deque<SegmentLogPos> entries;  // entries[i]对应first_log_index + i
+    int64_t last_log_index() const {
+        return first_log_index + (int64_t)entries.size() - 1;
+    }
+};
+
+struct LogSegment {
+    int64_t id = 0;
+    int fd = -1;
+    int64_t size = 0;
+    std::string path;
+    ~LogSegment() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+typedef std::shared_ptr<LogSegment> SmartLogSegment;
+
+class SegmentLogManager {
+public:
+    static const uint32_t SEGMENT_LOG_MAGIC = 0x5345474c;
+    static const size_t SEGMENT_LOG_HEAD_SIZE = 4 + 4 + 8 + 8 + 8 + 4 + 4 + 4;
+
+    static SegmentLogManager* get_instance() {
+        static SegmentLogManager _instance;
+        return &_instance;
+    }
+    static bool is_segment_log_uri(const std::string& uri) {
+        return uri.compare(0, strlen("segmentlog://"), "segmentlog://") == 0;
+    }
+
+    // store启动时调用，扫描目录恢复各region索引
+    int init(const std::string& path);
+    bool is_inited() const {
+        return _inited;
+    }
+    bool has_region(int64_t region_id);
+    // 不存在则新建(first_log_index=1)
+    void open_region(int64_t region_id, int64_t& first_log_index, int64_t& last_log_index);
+    void get_log_index(int64_t region_id, int64_t& first_log_index, int64_t& last_log_index);
+    void get_configuration_indexes(int64_t region_id, std::vector<int64_t>& indexes);
+    int64_t get_term(int64_t region_id, int64_t index);
+    int read_entry(int64_t region_id, int64_t index, int64_t& term, int& type, std::string& data);
+
+    int append_entries(int64_t region_id, const std::vector<braft::LogEntry*>& entries);
+    int truncate_prefix(int64_t region_id, int64_t first_index_kept);
+    int truncate_suffix(int64_t region_id, int64_t last_index_kept);
+    int reset(int64_t region_id, int64_t next_log_index);
+    int remove_region(int64_t region_id);
+
+protected:
+    // 测试中可构造独立实例模拟store重启
+    SegmentLogManager() {}
+
+private:
+    int open_segment(int64_t id, bool create, SmartLogSegment& segment);
+    int replay_segment(const SmartLogSegment& segment, bool is_last);
+    int apply_record(int record_type, int64_t region_id, int64_t index,
+                     const SegmentLogPos& pos);
+    static void apply_truncate_prefix(SegmentRegionIndex& region, int64_t first_index_kept);
+    static void apply_truncate_suffix(SegmentRegionIndex& region, int64_t last_index_kept);
+    static void append_record(butil::IOBuf& buf, int record_type, int64_t region_id,
+                              int64_t index, int64_t term, int entry_type,
+                              const butil::IOBuf& data);
+    int sync_to(int64_t write_seq);
+    void gc_segments();
+    // 以下需持有_write_mutex
+    int write_records(butil::IOBuf& buf, int64_t& offset);
+    int write_control_record(int record_type, int64_t region_id, int64_t index);
+    int rotate_segment();
+
+    bool _inited = false;
+    std::string _path;
+
+    // 写入、索引修改、segment切换都在_write_mutex下串行
+    bthread::Mutex _write_mutex;
+    SmartLogSegment _active_segment;
+    int64_t _write_seq = 0;
+
+    bthread::Mutex _sync_mutex;
+    bthread::ConditionVariable _sync_cond;
+    int64_t _synced_seq = 0;
+    bool _syncing = false;
+
+    bthread::Mutex _index_mutex;
+    std::unordered_map<int64_t, SegmentRegionIndex> _regions;
+
+    bthread::Mutex _segment_mutex;
+    std::map<int64_t, SmartLogSegment> _segments;
+
+    bvar::LatencyRecorder _sync_latency {"segment_log_sync"};
+    bvar::Adder<int64_t> _write_bytes {"segment_log_write_bytes"};
+    bvar::Adder<int64_t> _gc_segment_count {"segment_log_gc_segment_count"};
+};
+
+// 基于SegmentLogManager的LogStorage，uri: segmentlog://segment_log?id=region_id
+class SegmentLogStorage : public braft::LogStorage {
+public:
+    SegmentLogStorage() {}
+    ~SegmentLogStorage() {}
+
+    int init(braft::ConfigurationManager* configuration_manager) override;
+
+    int64_t first_log_index() override {
+        return _first_log_index.load(std::memory_order_relaxed);
+    }
+
+    int64_t last_log_index() override {
+        return _last_log_index.load(std::memory_order_relaxed);
+    }
+
+    braft::LogEntry* get_entry(const int64_t index) override;
+
+    int64_t get_term(const int64_t index) override;
+
+    int append_entry(const braft::LogEntry* entry) override;
+
+    int append_entries(const std::vector<braft::LogEntry*>& entries,
+                       braft::IOMetric* metric) override;
+
+    int truncate_prefix(const int64_t first_index_kept) override;
+
+    int truncate_suffix(const int64_t last_index_kept) override;
+
+    int reset(const int64_t next_log_index) override;
+
+    LogStorage* new_instance(const std::string& uri) const override;
+
+private:
+    explicit SegmentLogStorage(int64_t region_id) : _region_id(region_id) {}
+    void update_log_index();
+
+    int64_t _region_id = 0;
+    std::atomic<int64_t> _first_log_index {1};
+    std::atomic<int64_t> _last_log_index {0};
+};
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -301,6 +301,14 @@ public:
         return _optimize_1pc;
     }
 
+    void set_async_commit(bool async_commit) {
+        _async_commit = async_commit;
+    }
+
+    bool async_commit() {
+        return _async_commit;
+    }
+
     bool is_eos() { 
         return _eos;
     }
@@ -389,6 +397,7 @@ public:
     MysqlErrCode      error_code = ER_ERROR_FIRST;
     std::ostringstream error_msg;
     bool              is_full_export = false;
+    bool              stream_result = false;
     bool              is_separate = false;
     bool              need_condition_again = true; // update/delete在raft状态机外再次检查条件
     BthreadCond       txn_cond;
@@ -415,6 +424,7 @@ public:
 
     uint64_t          sign = 0;
     bool              need_use_read_index = false;
+    int64_t           max_staleness_us = 0;
 private:
     bool _is_inited    = false;
     bool _is_cancelled = false;
@@ -442,6 +452,7 @@ private:
     uint64_t _log_id = 0;
 
     bool              _single_sql_autocommit = true;     // used for baikaldb and store
+    bool              _async_commit = false;  // prepare全部成功即返回，commit在后台执行
     bool              _optimize_1pc = false;  // 2pc de-generates to 1pc when autocommit=true and
     // 如果用了排序列做索引，就不需要排序了
     bool              _sort_use_index = false;
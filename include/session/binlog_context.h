@@ -18,6 +18,7 @@
 #include "expr_value.h"
 #include "schema_factory.h"
 #include "meta_server_interact.hpp"
+#include "tso_client.h"
 
 #ifdef BAIDU_INTERNAL
 #include <base/endpoint.h>
@@ -66,6 +67,7 @@ private:
     bthread::Mutex _tso_mutex;  // 保护_tso_time
     bool _need_degrade = false;
     uint64_t _instance_id = 0;
+    TsoClient _tso_client {MetaServerInteract::get_tso_instance()};
 };
 
 struct PartitionBinlog {
@@ -84,6 +84,18 @@ struct NetworkSocket {
     SmartBinlogContext get_binlog_ctx();
     SmartQueryContex get_query_ctx();
     void reset_query_ctx(QueryContext* ctx);
+    // 压缩协议下一个帧可能包含多个命令，已解压未读取的数据不会再触发epoll事件
+    bool has_buffered_input() const {
+        return use_compress && uncompress_buf != nullptr
+            && uncompress_offset < (int)uncompress_buf->_size;
+    }
+    // 等待本连接上一个async commit事务的后台commit完成，保证读到自己的写
+    // 只对本连接生效，其他连接在后台commit完成前可能读到旧数据
+    void wait_async_commit() {
+        if (async_commit_cond != nullptr) {
+            async_commit_cond->wait();
+        }
+    }
     void cancel_rpc(const std::set<std::string>& addrs, int fd) {
         BAIDU_SCOPED_LOCK(region_lock);
         for (auto& addr : addrs) {
@@ -173,6 +185,15 @@ struct NetworkSocket {
     int             is_auth_result_send_partly;     // Auth result is sended partly,
                                                     // need to go on sending.
     int64_t         last_insert_id;
+    // 压缩协议(CLIENT_COMPRESS)，认证结果发送后生效
+    bool            need_compress = false;          // 客户端握手时要求压缩
+    bool            use_compress = false;
+    uint8_t         compress_seq = 0;               // 压缩帧序号，与packet_id相互独立
+    DataBuffer*     compress_send_buf = nullptr;    // 压缩后待发送的帧
+    int             compress_send_offset = 0;
+    DataBuffer*     compress_read_buf = nullptr;    // 未读完整的压缩帧
+    DataBuffer*     uncompress_buf = nullptr;       // 解压后还未被读取的数据
+    int             uncompress_offset = 0;
     // Socket status.
     std::string     current_db;                     // Current use database.
     int             charset_num;                    // Client charset number.
@@ -213,6 +234,7 @@ struct NetworkSocket {
     //ddl
     int64_t txn_start_time = 0;
     int64_t txn_pri_region_last_exec_time = 0;
+    std::shared_ptr<BthreadCond> async_commit_cond; // 后台commit持有，连接释放后仍有效
     std::unordered_set<int64_t> txn_table_id_set;
     bthread::Mutex txn_tid_set_lock;
     bool is_index_ddl = false;
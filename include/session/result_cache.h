@@ -0,0 +1,110 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#ifdef BAIDU_INTERNAL
+#include <bthread.h>
+#else
+#include <bthread/bthread.h>
+#endif
+#include <bthread/mutex.h>
+#include "common.h"
+
+namespace baikaldb {
+DECLARE_bool(enable_result_cache);
+
+// table_id => (本机写版本, schema版本)
+typedef std::map<int64_t, std::pair<int64_t, int64_t>> TableVersionMap;
+
+struct RegionDataVersion {
+    int64_t table_id = 0;
+    int64_t version = 0;        // region版本，分裂/合并后变化
+    int64_t data_index = -1;    // store返回的最后一次数据变更的raft index，-1表示未知
+};
+// region_id => 查询时读到的region数据版本
+typedef std::map<int64_t, RegionDataVersion> RegionVersionMap;
+
+struct ResultCacheItem {
+    uint64_t        key = 0;
+    std::string     sql;                // 防止hash冲突
+    std::string     result;             // 打包好的mysql结果集
+    int             start_packet_id = 0;
+    int             end_packet_id = 0;
+    int64_t         num_returned_rows = 0;
+    int64_t         create_time_us = 0;
+    int64_t         expire_time_us = 0;
+    std::atomic<int64_t> hit_count = {0};
+    TableVersionMap table_versions;
+    RegionVersionMap region_versions;
+
+    size_t mem_size() const {
+        return sizeof(ResultCacheItem) + sql.size() + result.size()
+            + table_versions.size() * 4 * sizeof(int64_t)
+            + region_versions.size() * 6 * sizeof(int64_t);
+    }
+};
+typedef std::shared_ptr<ResultCacheItem> SmartResultCacheItem;
+
+// baikaldb只读查询结果缓存，通过hint /*{"result_cache":ttl_s}*/ 或表的schema_conf result_cache_ttl_s开启
+// 失效条件: ttl过期、本机对涉及表的写入、表schema版本变化、涉及region的版本或数据版本变化
+// region数据版本由store在select返回，命中时向region leader校验，覆盖其他baikaldb的写入
+class ResultCache {
+public:
+    static ResultCache* get_instance() {
+        static ResultCache _instance;
+        return &_instance;
+    }
+
+    static uint64_t make_key(uint64_t sign, const std::string& db, const std::string& charset,
+                             const std::string& username, const std::string& sql);
+    // 命中且本机校验有效返回item，否则返回nullptr
+    SmartResultCacheItem find(uint64_t key, const std::string& sql);
+    // 向region leader校验数据版本，失败或有变化时删除item并返回false
+    bool check_region_versions(const SmartResultCacheItem& item);
+    void add(const SmartResultCacheItem& item);
+    // 执行前获取涉及表的版本，写入缓存时使用
+    void get_table_versions(const std::set<int64_t>& table_ids, TableVersionMap& versions);
+    // 本机有写入时调用
+    void table_write(int64_t table_id);
+    void clear();
+    void get_info(std::vector<std::vector<std::string>>& rows);
+
+private:
+    ResultCache() {}
+    bool is_valid(const SmartResultCacheItem& item, int64_t now);
+    void remove(const SmartResultCacheItem& item);
+    void erase(std::unordered_map<uint64_t, std::pair<SmartResultCacheItem,
+               std::list<uint64_t>::iterator>>::iterator iter);
+
+    bthread::Mutex _mutex;
+    // 头部为最久未使用
+    std::list<uint64_t> _lru_list;
+    std::unordered_map<uint64_t, std::pair<SmartResultCacheItem, std::list<uint64_t>::iterator>> _cache;
+    int64_t _mem_size = 0;
+
+    bthread::Mutex _version_mutex;
+    std::unordered_map<int64_t, int64_t> _table_write_versions;
+
+    bvar::Adder<int64_t> _hit_count {"result_cache_hit_count"};
+    bvar::Adder<int64_t> _miss_count {"result_cache_miss_count"};
+    bvar::Adder<int64_t> _invalid_count {"result_cache_invalid_count"};
+};
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -39,6 +39,14 @@ struct DMLClosure : public braft::Closure {
     uint64_t log_id = 0;
 };
 
+// store内部提交、没有rpc等待结果的日志，如拆分的中间kv batch、closed ts
+struct InternalDMLClosure : public DMLClosure {
+    InternalDMLClosure() {
+        response = &internal_response;
+    }
+    pb::StoreRes internal_response;
+};
+
 struct BinlogClosure : public braft::Closure {
     BinlogClosure() : cond(nullptr) { };
     BinlogClosure(BthreadCond* cond) : cond(cond) { };
@@ -89,6 +89,7 @@ public:
     int read_pre_commit_key(int64_t region_id, uint64_t txn_id, int64_t& num_table_lines, int64_t& applied_index);
     int read_doing_snapshot(int64_t region_id);
     int read_transcation_rollbacked_tag(int64_t region_id, uint64_t txn_id);
+    int write_transcation_rollbacked_tag(int64_t region_id, uint64_t txn_id);
     int write_binlog_check_point(int64_t region_id, int64_t ts);
     int64_t read_binlog_check_point(int64_t region_id);
     std::string binlog_oldest_ts_key(int64_t region_id) const;
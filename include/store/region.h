@@ -326,6 +326,10 @@ public:
     static const uint8_t PRIMARY_INDEX_FLAG;
     static const uint8_t SECOND_INDEX_FLAG;
 
+    // 按batch_ops拆出除最后一批外的kv batch，最后一批留在raft_req中，不需要拆分返回false
+    static bool split_kv_sub_batches(pb::StoreReq* raft_req, int batch_ops,
+                                     std::vector<pb::StoreReq>& sub_reqs);
+
     virtual ~Region() {
         shutdown();
         join();
@@ -498,6 +502,9 @@ public:
     
     virtual void on_leader_stop();
     virtual void on_leader_stop(const butil::Status& status);
+
+    virtual void on_start_following(const braft::LeaderChangeContext& ctx);
+    virtual void on_stop_following(const braft::LeaderChangeContext& ctx);
     
     virtual void on_error(const ::braft::Error& e);
 
@@ -511,6 +518,16 @@ public:
 
     void construct_heart_beat_request(pb::StoreHeartBeatRequest& request, bool need_peer_balance); 
 
+    // 空闲region休眠，拉长选举超时(braft心跳间隔随之拉长)并停掉no op定时器
+    // follower空闲region_hibernate_idle_s后休眠，leader空闲两倍时间且follower全部追上后休眠
+    // 保证leader总是晚睡早醒，follower拒绝投票的窗口不短于leader lease
+    void check_hibernate();
+    // leader在读写请求入口唤醒，follower在apply到新日志时唤醒
+    void wake_up();
+    bool is_hibernated() {
+        return _hibernated.load();
+    }
+
     void construct_peers_status(pb::LeaderHeartBeat* leader_heart);
   
     void set_can_add_peer();
@@ -599,6 +616,8 @@ public:
                                            int64_t term);
     void exec_update_primary_timestamp(const pb::StoreReq& request,
             braft::Closure* done, int64_t applied_index, int64_t term);
+    void exec_txn_rollback_fence(const pb::StoreReq& request,
+            braft::Closure* done, int64_t applied_index, int64_t term);
     
     void adjustkey_and_add_version_query(google::protobuf::RpcController* controller,
             const pb::StoreReq* request, 
@@ -663,6 +682,8 @@ public:
             int64_t& split_end_index);
     
     int get_split_key(std::string& split_key, int64_t& split_key_term);
+    // 按访问分布选择分裂点
+    int get_load_split_key(std::string& split_key, int64_t& split_key_term);
     
     bool is_splitting() {
         return _split_param.new_region_id != 0;
@@ -796,6 +817,17 @@ public:
     int64_t get_dml_latency() {
         return _dml_time_cost.latency();
     }
+    void add_write_load(const pb::StoreReq& request, int64_t time_us) {
+        if (is_leader()) {
+            _load_stat->add_write(request, time_us);
+        }
+    }
+    // 上一个心跳周期的读写qps
+    int64_t get_load_qps() {
+        pb::RegionLoad load;
+        _load_stat->get_last_load(&load);
+        return load.read_qps() + load.write_qps();
+    }
     pb::RegionInfo& region_info() {
         return _region_info;
     }
@@ -1100,6 +1132,9 @@ public:
     void set_snapshot_data_size(size_t size) {
         _snapshot_data_size = size;
     }
+    void add_snapshot_data_size(size_t size) {
+        _snapshot_data_size += size;
+    }
     uint64_t snapshot_meta_size() const {
         return _snapshot_meta_size;
     }
@@ -1162,6 +1197,7 @@ public:
             || is_2pc_op_type(op_type)
             || op_type == pb::OP_NONE
             || op_type == pb::OP_UPDATE_PRIMARY_TIMESTAMP
+            || op_type == pb::OP_TXN_ROLLBACK_FENCE
             || op_type == pb::OP_KILL) {
                 return true;
             }
@@ -1169,6 +1205,9 @@ public:
     }
     void check_peer_latency();
     void get_read_index(const baikaldb::pb::GetAppliedIndex* request, pb::StoreRes* response);
+    // 有界陈旧读：leader发布closed ts，副本据此判断能否本地读
+    void publish_closed_ts();
+    bool can_stale_read(int64_t max_staleness_us);
     
     // if seek_table_lines != nullptr, seek all sst for seek_table_lines
     bool has_sst_data(int64_t* seek_table_lines);
@@ -1273,9 +1312,16 @@ private:
     //binlog end
     void apply_kv_in_txn(const pb::StoreReq& request, braft::Closure* done, 
                          int64_t index, int64_t term);
+    // 事务内大DML的kv batch拆成多条日志propose，最后一批留在raft_req
+    int propose_kv_sub_batches(pb::StoreReq* raft_req, int64_t expected_term,
+                               uint64_t log_id, const std::string& remote_side);
 
     void apply_kv_out_txn(const pb::StoreReq& request, braft::Closure* done, 
                                   int64_t index, int64_t term);
+    // follower上连续的非事务OP_KV_BATCH日志合并到一个事务，一次提交
+    bool can_batch_apply(const pb::StoreReq& request, braft::Closure* done, int64_t index);
+    void batch_apply_kv_out_txn(const pb::StoreReq& request, int64_t index, int64_t term);
+    void flush_batch_apply();
     bool validate_version(const pb::StoreReq* request, pb::StoreRes* response);
     void print_log_entry(const int64_t start_index, const int64_t end_index);
     void set_region(const pb::RegionInfo& region_info) {
@@ -1435,7 +1481,11 @@ private:
     uint64_t   _region_uuid = 0;
 
     TimeCost                        _time_cost; //上次收到请求的时间，每次收到请求都重置一次
+    TimeCost                        _active_time_cost; //上次读写或apply的时间，用于判断是否休眠
+    bthread::Mutex                  _hibernate_mutex;
+    std::atomic<bool>               _hibernated{false};
     LatencyOnly                     _dml_time_cost;
+    SmartRegionLoadStat             _load_stat {std::make_shared<RegionLoadStat>()};
     bool                                _restart = false;
     //计算存储分离开关，在store定时任务中更新，避免每次dml都访问schema factory
     bool                                _storage_compute_separate = false;
@@ -1452,6 +1502,12 @@ private:
     int64_t                             _braft_apply_index = 0;
     int64_t                             _applied_index = 0;  //current log index
     int64_t                             _done_applied_index = 0; // 确保已经log已经执行完(数据已写盘)，follow read用
+    // on_apply中待合并提交的日志
+    SmartTransaction                    _batch_apply_txn;
+    int64_t                             _batch_apply_index = 0;
+    int64_t                             _batch_apply_term = 0;
+    int64_t                             _batch_num_increase_rows = 0;
+    int32_t                             _batch_apply_count = 0;
     // 表示数据版本，conf_change,no_op等不影响数据时版本不变
     // TODO, 裸用的地方太多, 需要整理
     int64_t                             _data_index = 0;
@@ -1525,6 +1581,8 @@ private:
     // leader address for learner, 单线程不加锁
     std::string _leader_addr_for_read_idx;
     bool _ready_for_follower_read = true;
+    // 已apply的leader发布的最大closed ts，用于有界陈旧读
+    std::atomic<int64_t> _closed_ts_us{0};
     // 解决零星写时主从延迟高,有写入时每100ms发一条NO OP, 停写5min后不再发NO OP
     NoOpTimer _no_op_timer; 
 
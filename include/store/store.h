@@ -37,6 +37,8 @@
 #include "rocks_wrapper.h"
 #include "table_record.h"
 #include "meta_server_interact.hpp"
+#include "tso_client.h"
+#include "lru_cache.h"
 namespace baikaldb {
 DECLARE_int32(snapshot_load_num);
 DECLARE_int32(raft_write_concurrency);
@@ -158,6 +160,8 @@ public:
 
     void check_region_peer_delay();
 
+    void closed_ts_thread();
+
     void reverse_merge_thread();
     void unsafe_reverse_merge_thread();
     void ttl_remove_thread();
@@ -253,6 +257,7 @@ public:
     void shutdown_raft() {
         _shutdown = true;
         _region_peer_delay_bth.join();
+        _closed_ts_bth.join();
         traverse_copy_region_map([](const SmartRegion& region) {
             region->shutdown();
         });
@@ -363,6 +368,8 @@ private:
     void process_heart_beat_response(const pb::StoreHeartBeatResponse& response);
 
     void monitor_memory();
+    // 将attachment中共享的plan和tuples与region相关信息合并成完整请求
+    int merge_plan_fragment(brpc::Controller* cntl, const pb::StoreReq& request, pb::StoreReq* merged);
     void print_properties(const std::string& name);
     void print_heartbeat_info(const pb::StoreHeartBeatRequest& request);
 private:
@@ -395,6 +402,7 @@ private:
     MetaServerInteract _meta_server_interact;
     
     MetaServerInteract _tso_server_interact;
+    TsoClient _tso_client {&_tso_server_interact};
     
     //发送心跳的线程
     Bthread _heart_beat_bth;
@@ -425,6 +433,8 @@ private:
     Bthread _db_statistic_bth;
 
     Bthread _region_peer_delay_bth;
+    // leader定期发布closed ts
+    Bthread _closed_ts_bth;
 
     std::atomic<int32_t> _split_num;    
     bool _shutdown = false;
@@ -442,6 +452,8 @@ private:
     BthreadCond _multi_thread_cond;
     bthread_mutex_t _param_mutex;
     std::map<std::string, std::string> _param_map;
+    // plan_fragment_sign => 解析后的plan和tuples
+    Cache<uint64_t, std::shared_ptr<pb::StoreReq>> _plan_fragment_cache;
 public:
     bool exist_prepared_log(int64_t region_id, uint64_t txn_id) {
         if (prepared_txns.find(region_id) != prepared_txns.end()
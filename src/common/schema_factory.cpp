@@ -1917,7 +1917,8 @@ void SchemaFactory::get_schema_conf_open(const std::string& conf_name, std::vect
         if (!has_field) {
             continue;
         }
-        if (conf_name == "pk_prefix_balance" || conf_name == "tail_split_num" || conf_name == "tail_split_step") {
+        if (conf_name == "pk_prefix_balance" || conf_name == "tail_split_num" || conf_name == "tail_split_step"
+                || conf_name == "result_cache_ttl_s") {
             auto value = reflection->GetInt32(pb_conf, field);
             database_table.emplace_back(table.second->namespace_ + "." + table.second->name + "." + std::to_string(value));
         } else if (conf_name == "backup_table") {
@@ -0,0 +1,100 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tso_client.h"
+
+namespace baikaldb {
+DEFINE_int32(tso_max_inflight_batch, 2, "max concurrent tso_service requests of one tso client");
+
+int64_t TsoClient::get_tso(int64_t count) {
+    TsoWaiter waiter;
+    waiter.count = count;
+    waiter.cond.increase();
+    std::vector<TsoWaiter*> batch;
+    {
+        BAIDU_SCOPED_LOCK(_mutex);
+        _pending.emplace_back(&waiter);
+        if (_inflight < FLAGS_tso_max_inflight_batch) {
+            ++_inflight;
+            batch.swap(_pending);
+        }
+    }
+    if (!batch.empty()) {
+        send_batch(std::move(batch));
+    }
+    waiter.cond.wait();
+    return waiter.timestamp;
+}
+
+void TsoClient::send_batch(std::vector<TsoWaiter*> batch) {
+    static bvar::LatencyRecorder tso_batch_size("tso_client_batch_size");
+    static bvar::LatencyRecorder tso_batch_time("tso_client_batch_time");
+    TimeCost cost;
+    int64_t total_count = 0;
+    for (auto waiter : batch) {
+        total_count += waiter->count;
+    }
+    int64_t timestamp = fetch_tso(total_count);
+    tso_batch_size << batch.size();
+    tso_batch_time << cost.get_time();
+    // 唤醒后waiter可能已析构，不能再访问
+    for (auto waiter : batch) {
+        if (timestamp >= 0) {
+            waiter->timestamp = timestamp;
+            timestamp += waiter->count;
+        }
+        waiter->cond.decrease_signal();
+    }
+    std::vector<TsoWaiter*> next_batch;
+    {
+        BAIDU_SCOPED_LOCK(_mutex);
+        if (_pending.empty()) {
+            --_inflight;
+            return;
+        }
+        next_batch.swap(_pending);
+    }
+    // 在途期间积攒的调用方交给新bthread发送，当前调用方直接返回
+    Bthread bth(&BTHREAD_ATTR_SMALL);
+    bth.run([this, next_batch]() {
+        send_batch(next_batch);
+    });
+}
+
+int64_t TsoClient::fetch_tso(int64_t count) {
+    pb::TsoRequest request;
+    request.set_op_type(pb::OP_GEN_TSO);
+    request.set_count(count);
+    pb::TsoResponse response;
+    int retry_time = 0;
+    for (;;) {
+        retry_time++;
+        int ret = _interact->send_request("tso_service", request, response);
+        if (ret == 0 && response.errcode() == pb::SUCCESS) {
+            break;
+        }
+        if (response.errcode() == pb::RETRY_LATER && retry_time < 5) {
+            bthread_usleep(tso::update_timestamp_interval_ms * 1000LL);
+            continue;
+        }
+        DB_FATAL("get tso failed, request:%s, response:%s",
+                request.ShortDebugString().c_str(), response.ShortDebugString().c_str());
+        return -1;
+    }
+    auto& tso = response.start_timestamp();
+    return (tso.physical() << tso::logical_bits) + tso.logical();
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
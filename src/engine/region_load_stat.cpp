@@ -0,0 +1,123 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "region_load_stat.h"
+#include <algorithm>
+
+namespace baikaldb {
+DEFINE_int64(region_load_key_sample_rate, 16, "sample one of N primary key accesses for load split");
+DEFINE_int64(region_load_max_sample_keys, 256, "max sampled keys per region in one heartbeat window");
+DEFINE_int64(region_load_min_sample_keys, 32, "min sampled keys to choose a load split key");
+DEFINE_int64(region_load_bytes_sample_rate, 64, "compute request/response size for one of N requests");
+
+int64_t RegionLoadStat::sample_bytes(const google::protobuf::Message& message) {
+    // ByteSizeLong需要遍历整个message，按比例采样后放大
+    int64_t rate = std::max(FLAGS_region_load_bytes_sample_rate, (int64_t)1);
+    if (rate > 1 && butil::fast_rand() % rate != 0) {
+        return 0;
+    }
+    return message.ByteSizeLong() * rate;
+}
+
+void RegionLoadStat::sample_key(const rocksdb::Slice& key) {
+    int64_t rate = std::max(FLAGS_region_load_key_sample_rate, (int64_t)1);
+    if (rate > 1 && butil::fast_rand() % rate != 0) {
+        return;
+    }
+    size_t max_keys = std::max(FLAGS_region_load_max_sample_keys, (int64_t)1);
+    BAIDU_SCOPED_LOCK(_mutex);
+    ++_sample_seen;
+    if (_sample_keys.size() < max_keys) {
+        _sample_keys.emplace_back(key.data(), key.size());
+        return;
+    }
+    uint64_t pos = butil::fast_rand() % _sample_seen;
+    if (pos < max_keys) {
+        _sample_keys[pos].assign(key.data(), key.size());
+    }
+}
+
+void RegionLoadStat::roll_window(pb::RegionLoad* load) {
+    int64_t read_count = _read_count.exchange(0, std::memory_order_relaxed);
+    int64_t write_count = _write_count.exchange(0, std::memory_order_relaxed);
+    int64_t read_bytes = _read_bytes.exchange(0, std::memory_order_relaxed);
+    int64_t write_bytes = _write_bytes.exchange(0, std::memory_order_relaxed);
+    int64_t exec_time_us = _exec_time_us.exchange(0, std::memory_order_relaxed);
+    int64_t now = butil::gettimeofday_us();
+    BAIDU_SCOPED_LOCK(_mutex);
+    int64_t window_us = std::max(now - _window_start_us, (int64_t)1);
+    _window_start_us = now;
+    _last_load.set_read_qps(read_count * 1000000 / window_us);
+    _last_load.set_write_qps(write_count * 1000000 / window_us);
+    _last_load.set_read_bytes(read_bytes * 1000000 / window_us);
+    _last_load.set_write_bytes(write_bytes * 1000000 / window_us);
+    _last_load.set_exec_time_us(exec_time_us * 1000000 / window_us);
+    _last_sample_keys.swap(_sample_keys);
+    _sample_keys.clear();
+    _sample_seen = 0;
+    if (load != nullptr) {
+        load->CopyFrom(_last_load);
+    }
+}
+
+void RegionLoadStat::get_last_load(pb::RegionLoad* load) {
+    BAIDU_SCOPED_LOCK(_mutex);
+    load->CopyFrom(_last_load);
+}
+
+bool RegionLoadStat::get_load_split_key(const std::string& start_key, const std::string& end_key,
+                                        std::string& split_key) {
+    std::vector<std::string> keys;
+    {
+        BAIDU_SCOPED_LOCK(_mutex);
+        keys = _last_sample_keys;
+    }
+    return select_split_key(keys, start_key, end_key, split_key);
+}
+
+bool RegionLoadStat::select_split_key(std::vector<std::string>& keys, const std::string& start_key,
+                                      const std::string& end_key, std::string& split_key) {
+    // 分裂后region范围变化，去掉范围外的key
+    keys.erase(std::remove_if(keys.begin(), keys.end(), [&](const std::string& key) {
+        return key < start_key || (!end_key.empty() && key >= end_key);
+    }), keys.end());
+    if ((int64_t)keys.size() < std::max(FLAGS_region_load_min_sample_keys, (int64_t)2)) {
+        return false;
+    }
+    std::sort(keys.begin(), keys.end());
+    // 左侧region为[start_key, keys[i])，访问量为i，选择最接近一半的key边界
+    // keys[i] > keys[0] >= start_key，保证左侧region非空
+    size_t half = keys.size() / 2;
+    size_t best = 0;
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (keys[i] == keys[i - 1]) {
+            continue;
+        }
+        size_t diff = i > half ? i - half : half - i;
+        size_t best_diff = best > half ? best - half : half - best;
+        if (best == 0 || diff < best_diff) {
+            best = i;
+        }
+    }
+    // 分裂后较小一侧不足1/4的访问量，说明热点集中在少数key上
+    if (best == 0 || std::min(best, keys.size() - best) < keys.size() / 4) {
+        return false;
+    }
+    split_key = keys[best];
+    return true;
+}
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -27,6 +27,10 @@ namespace baikaldb {
 
 DEFINE_int32(rocks_transaction_lock_timeout_ms, 20000, "rocksdb transaction_lock_timeout, real lock_time is 'time + rand_less(time)' (ms)");
 DEFINE_int32(rocks_default_lock_timeout_ms, 30000, "rocksdb default_lock_timeout(ms)");
+DEFINE_bool(rocks_transaction_deadlock_detect, true, "rocksdb transaction wait-for graph deadlock detect");
+DEFINE_int64(rocks_transaction_deadlock_detect_depth, 50, "rocksdb transaction deadlock detect max depth");
+DEFINE_int32(rocks_transaction_lock_num_stripes, 64, "rocksdb lock table stripes(hash buckets of key) per cf");
+DEFINE_int32(rocks_max_num_deadlocks, 16, "rocksdb deadlock info buffer size");
 
 DEFINE_bool(rocks_use_partitioned_index_filters, false, "rocksdb use Partitioned Index Filters");
 DEFINE_bool(rocks_skip_stats_update_on_db_open, false, "rocks_skip_stats_update_on_db_open");
@@ -155,6 +159,9 @@ int32_t RocksWrapper::init(const std::string& path) {
     DB_NOTICE("FLAGS_rocks_transaction_lock_timeout_ms:%d FLAGS_rocks_default_lock_timeout_ms:%d", FLAGS_rocks_transaction_lock_timeout_ms, FLAGS_rocks_default_lock_timeout_ms);
     txn_db_options.transaction_lock_timeout = FLAGS_rocks_transaction_lock_timeout_ms;
     txn_db_options.default_lock_timeout = FLAGS_rocks_default_lock_timeout_ms;
+    // 每个stripe一把bthread mutex和等待队列，热点场景下减少不同key的互相阻塞
+    txn_db_options.num_stripes = FLAGS_rocks_transaction_lock_num_stripes;
+    txn_db_options.max_num_deadlocks = FLAGS_rocks_max_num_deadlocks;
     txn_db_options.custom_mutex_factory = std::shared_ptr<rocksdb::TransactionDBMutexFactory>(
                           new TransactionDBBthreadFactory());
 
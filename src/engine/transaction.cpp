@@ -24,6 +24,9 @@ DEFINE_bool(disable_wal, false, "disable rocksdb interanal WAL log, only use raf
 DECLARE_int32(rocks_transaction_lock_timeout_ms);
 DEFINE_int64(exec_1pc_out_fsm_timeout_ms, 5 * 1000, "exec 1pc out of fsm, timeout");
 DEFINE_int64(exec_1pc_in_fsm_timeout_ms, 100, "exec 1pc in fsm, timeout");
+DEFINE_int64(txn_lock_wait_record_us, 1000, "lock call cost more than this is recorded as lock wait");
+DECLARE_bool(rocks_transaction_deadlock_detect);
+DECLARE_int64(rocks_transaction_deadlock_detect_depth);
 
 // value 出参，会remove prefix
 int64_t ttl_decode(rocksdb::Slice& value, const IndexInfo* const index_info, int64_t base_expire_time_us) {
@@ -146,6 +149,10 @@ int Transaction::begin(const rocksdb::TransactionOptions& txn_opt) {
         return -1;
     }
     _txn_opt = txn_opt;
+    // 加锁等待前沿wait-for图检测环，成环时本次加锁的事务立即返回Busy(kDeadlock)，
+    // 不必等到lock_timeout
+    _txn_opt.deadlock_detect = FLAGS_rocks_transaction_deadlock_detect;
+    _txn_opt.deadlock_detect_depth = FLAGS_rocks_transaction_deadlock_detect_depth;
     if (_txn_opt.lock_timeout == -1) {
         _txn_opt.lock_timeout = FLAGS_rocks_transaction_lock_timeout_ms +
             butil::fast_rand_less_than(FLAGS_rocks_transaction_lock_timeout_ms);
@@ -416,6 +423,11 @@ int Transaction::put_primary(int64_t region, IndexInfo& pk_index, SmartRecord re
         DB_WARNING("lock failed, region_id: %ld, txn:%ld, timedout: %s, key:%s", 
                 region_id, _txn_id, res.ToString().c_str(), record->debug_string().c_str());
         return -1;
+    } else if (res.IsDeadlock()) {
+        int64_t region_id =  _region_info != nullptr ? _region_info->region_id() : 0;
+        DB_WARNING("lock failed, region_id: %ld, txn:%ld, deadlock: %s", 
+                region_id, _txn_id, res.ToString().c_str());
+        return -5;
     } else if (!res.ok()) {
         DB_FATAL("put primary fail, error: %s", res.ToString().c_str());
         return -1;
@@ -423,6 +435,9 @@ int Transaction::put_primary(int64_t region, IndexInfo& pk_index, SmartRecord re
     if (_is_separate) {
         add_kvop_put(key.data(), value, _write_ttl_timestamp_us, true);
     }
+    rocksdb::Slice pk_slice(key.data());
+    pk_slice.remove_prefix(2 * sizeof(int64_t));
+    sample_load_key(pk_slice);
     // cstore, put non-pk columns values to db
     if (is_cstore()) {
         return put_primary_columns(key, record, update_fields);
@@ -483,6 +498,11 @@ int Transaction::put_secondary(int64_t region, IndexInfo& index, SmartRecord rec
         DB_WARNING("lock failed, region_id: %ld, txn:%ld, timedout: %s, key:%s", 
                 region_id, _txn_id, res.ToString().c_str(), record->debug_string().c_str());
         return -1;
+    } else if (res.IsDeadlock()) {
+        int64_t region_id =  _region_info != nullptr ? _region_info->region_id() : 0;
+        DB_WARNING("lock failed, region_id: %ld, txn:%ld, deadlock: %s", 
+                region_id, _txn_id, res.ToString().c_str());
+        return -5;
     } else if (!res.ok()) {
         DB_FATAL("put secondary fail, error: %s", res.ToString().c_str());
         return -1;
@@ -528,6 +548,7 @@ rocksdb::Status Transaction::put_kv_without_lock(const std::string& key, const s
         value_slice_parts.num_parts = 1;
     }
     auto res = _txn->Put(_data_cf, key_slice_parts, value_slice_parts);
+    add_lock_result(res, cost);
     return res;
 }
 
@@ -643,6 +664,7 @@ int Transaction::get_update_primary(
     }
     MutTableKey _key;
     _key.append_i64(region).append_i64(pk_index.id).append_index(key);
+    sample_load_key(key.data());
 
     rocksdb::PinnableSlice pin_slice;
     rocksdb::Status res;
@@ -656,6 +678,7 @@ int Transaction::get_update_primary(
     } else if (mode == LOCK_ONLY || mode == GET_LOCK) {
         rocksdb::ReadOptions read_opt;
         res = _txn->GetForUpdate(read_opt, _data_cf, _key.data(), &pin_slice);
+        add_lock_result(res, cost);
         //DB_WARNING("data: %s %d", _value.c_str(), _value.size());
     } else {
         DB_WARNING("invalid GetMode: %d", mode);
@@ -704,6 +727,11 @@ int Transaction::get_update_primary(
     } else if (res.IsNotFound()) {
         DB_DEBUG("lock ok but key not exist");
         return -2;
+    } else if (res.IsDeadlock()) {
+        int64_t region_id =  _region_info != nullptr ? _region_info->region_id() : 0;
+        DB_WARNING("lock failed, region_id: %ld, txn:%ld, deadlock: %s", 
+                region_id, _txn_id, res.ToString().c_str());
+        return -5;
     } else if (res.IsBusy()) {
         DB_WARNING("lock failed, busy: %s", res.ToString().c_str());
         return -1;
@@ -1088,6 +1116,7 @@ int Transaction::get_update_secondary(
     } else if (mode == LOCK_ONLY || mode == GET_LOCK) {
         rocksdb::ReadOptions read_opt;
         res = _txn->GetForUpdate(read_opt, _data_cf, _key.data(), &pin_slice);
+        add_lock_result(res, cost);
     } else {
         DB_WARNING("invalid GetMode: %d", mode);
         return -1;
@@ -1097,6 +1126,11 @@ int Transaction::get_update_secondary(
     } else if (res.IsNotFound()) {
         DB_DEBUG("lock ok but key not exist");
         return -2;
+    } else if (res.IsDeadlock()) {
+        int64_t region_id =  _region_info != nullptr ? _region_info->region_id() : 0;
+        DB_WARNING("lock failed, region_id: %ld, txn:%ld, deadlock: %s", 
+                region_id, _txn_id, res.ToString().c_str());
+        return -5;
     } else if (res.IsBusy()) {
         DB_WARNING("lock failed, busy: %s", res.ToString().c_str());
         return -1;
@@ -1152,7 +1186,9 @@ int Transaction::remove(int64_t region, IndexInfo& index, /*IndexInfo& pk_index,
         }
     }
 
+    TimeCost cost;
     auto res = _txn->Delete(_data_cf, _key.data());
+    add_lock_result(res, cost);
     DB_DEBUG("delete key=%s", str_to_hex(_key.data()).c_str());
     if (res.IsTimedOut()) {
         print_txninfo_holding_lock(_key.data());        
@@ -1160,6 +1196,11 @@ int Transaction::remove(int64_t region, IndexInfo& index, /*IndexInfo& pk_index,
         DB_WARNING("lock failed, region_id: %ld, txn:%ld, timedout: %s, key:%s", 
                 region_id, _txn_id, res.ToString().c_str(), key->debug_string().c_str());
         return -1;
+    } else if (res.IsDeadlock()) {
+        int64_t region_id =  _region_info != nullptr ? _region_info->region_id() : 0;
+        DB_WARNING("lock failed, region_id: %ld, txn:%ld, deadlock: %s", 
+                region_id, _txn_id, res.ToString().c_str());
+        return -5;
     } else if (!res.ok()) {
         DB_WARNING("delete error: code=%d, msg=%s", res.code(), res.ToString().c_str());
         return -1;
@@ -1189,13 +1230,20 @@ int Transaction::remove(int64_t region, IndexInfo& index, const TableKey& key) {
         return -1;
     }
 
+    TimeCost cost;
     auto res = _txn->Delete(_data_cf, _key.data());
+    add_lock_result(res, cost);
     if (res.IsTimedOut()) {
         print_txninfo_holding_lock(_key.data());        
         int64_t region_id =  _region_info != nullptr ? _region_info->region_id() : 0;
         DB_WARNING("lock failed, region_id: %ld, txn:%ld, timedout: %s, key:%s", 
                 region_id, _txn_id, res.ToString().c_str(), key.decode_start_key_string(index).c_str());
         return -1;
+    } else if (res.IsDeadlock()) {
+        int64_t region_id =  _region_info != nullptr ? _region_info->region_id() : 0;
+        DB_WARNING("lock failed, region_id: %ld, txn:%ld, deadlock: %s", 
+                region_id, _txn_id, res.ToString().c_str());
+        return -5;
     } else if (!res.ok()) {
         DB_WARNING("delete error: code=%d, msg=%s", res.code(), res.ToString().c_str());
         return -1;
@@ -1219,6 +1267,10 @@ rocksdb::Status Transaction::prepare() {
         DB_WARNING("TransactionWarn: prepare a rolledback txn: %lu", _txn_id);
         return rocksdb::Status::Expired();
     }
+    if (_is_rollback_fenced) {
+        DB_WARNING("TransactionWarn: prepare a rollback fenced txn: %lu", _txn_id);
+        return rocksdb::Status::Expired();
+    }
     last_active_time = butil::gettimeofday_us();
     auto res = _txn->Prepare();
     if (res.ok()) {
@@ -1271,6 +1323,8 @@ rocksdb::Status Transaction::rollback() {
 int Transaction::set_save_point() {
     BAIDU_SCOPED_LOCK(_txn_mutex);
     last_active_time = butil::gettimeofday_us();
+    // 每条语句开始时设置savepoint，清理上条语句残留的死锁标记
+    _is_deadlock = false;
     //if (_save_point_seq.empty()) {
     //    DB_WARNING("txn:%s seq_id:%d top_seq:%d",_txn->GetName().c_str(),  _seq_id, -1);
     //} else {
@@ -1310,6 +1364,27 @@ void Transaction::rollback_to_point(int seq_id) {
     }
 }
 
+void Transaction::rollback_incomplete_kv_batch(int seq_id) {
+    BAIDU_SCOPED_LOCK(_txn_mutex);
+    last_active_time = butil::gettimeofday_us();
+    {
+        BAIDU_SCOPED_LOCK(_cache_map_mutex);
+        _cache_plan_map.erase(seq_id);
+    }
+    if (!_save_point_seq.empty() && _save_point_seq.top() == seq_id) {
+        num_increase_rows = _save_point_increase_rows.top();
+        _save_point_seq.pop();
+        _save_point_increase_rows.pop();
+        _txn->RollbackToSavePoint();
+    }
+    _seq_id = seq_id - 1;
+    _current_req_point_seq.clear();
+    _current_req_point_seq.insert(_seq_id);
+    _kv_batch_incomplete_seq = 0;
+    DB_WARNING("txn:%s rollback incomplete kv batch seq_id: %d, num_increase_rows: %ld",
+        _txn->GetName().c_str(), seq_id, num_increase_rows);
+}
+
 void Transaction::rollback_current_request() {
     BAIDU_SCOPED_LOCK(_txn_mutex);
     last_active_time = butil::gettimeofday_us();
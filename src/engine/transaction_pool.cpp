@@ -235,6 +235,118 @@ void TransactionPool::txn_query_primary_region(uint64_t txn_id, Region* region,
     } while (!success && retry_times <= 5);
 }
 
+// OP_TXN_QUERY_STATE查询secondary上的事务状态，OP_TXN_ROLLBACK_FENCE在secondary上写fence
+int TransactionPool::secondary_txn_state(uint64_t txn_id, int64_t secondary_region_id,
+            pb::OpType op_type, pb::TxnState& txn_state) {
+    pb::RegionInfo region_info;
+    if (get_region_info_from_meta(secondary_region_id, region_info) < 0) {
+        DB_WARNING("get region info from meta fail, region_id: %ld, secondary_region_id: %ld, txn_id: %lu",
+            _region_id, secondary_region_id, txn_id);
+        return -1;
+    }
+    pb::StoreReq request;
+    pb::StoreRes response;
+    request.set_op_type(op_type);
+    request.set_region_id(secondary_region_id);
+    request.set_region_version(region_info.version());
+    pb::TransactionInfo* pb_txn = request.add_txn_infos();
+    pb_txn->set_txn_id(txn_id);
+    pb_txn->set_seq_id(0);
+    for (int retry_times = 1; retry_times <= 3; ++retry_times) {
+        response.Clear();
+        RpcSender::send_query_method(request, response, region_info.leader(), secondary_region_id);
+        if (response.errcode() == pb::SUCCESS && response.txn_infos_size() == 1) {
+            txn_state = response.txn_infos(0).txn_state();
+            return 0;
+        }
+        if (response.errcode() == pb::VERSION_OLD) {
+            for (auto& r : response.regions()) {
+                if (r.region_id() == secondary_region_id) {
+                    region_info.CopyFrom(r);
+                    request.set_region_version(r.version());
+                }
+            }
+        } else if (response.errcode() == pb::NOT_LEADER && response.leader() != ""
+                && response.leader() != "0.0.0.0:0") {
+            region_info.set_leader(response.leader());
+        } else {
+            other_peer_to_leader(region_info);
+        }
+        bthread_usleep(retry_times * FLAGS_retry_interval_us);
+    }
+    DB_WARNING("secondary txn request fail, region_id: %ld, secondary_region_id: %ld, txn_id: %lu, "
+        "op_type: %s, response:%s", _region_id, secondary_region_id, txn_id,
+        pb::OpType_Name(op_type).c_str(), response.ShortDebugString().c_str());
+    return -1;
+}
+
+void TransactionPool::resolve_async_commit(uint64_t txn_id, Region* region) {
+    SmartTransaction txn = get_txn(txn_id);
+    if (txn == nullptr || !txn->is_async_commit() || !txn->is_prepared() || txn->is_finished()) {
+        return;
+    }
+    // 和原有超时回滚一样，依赖prepare请求不会在途这么久
+    if (butil::gettimeofday_us() - txn->last_active_time
+            < FLAGS_transaction_query_primary_region_interval_ms * 1000LL) {
+        return;
+    }
+    {
+        BAIDU_SCOPED_LOCK(_resolving_mutex);
+        if (_resolving_txns.count(txn_id) > 0) {
+            return;
+        }
+        _resolving_txns.insert(txn_id);
+    }
+    ON_SCOPE_EXIT(([this, txn_id]() {
+        BAIDU_SCOPED_LOCK(_resolving_mutex);
+        _resolving_txns.erase(txn_id);
+    }));
+    pb::OpType op_type = pb::OP_COMMIT;
+    for (auto secondary_region_id : txn->secondary_region_ids()) {
+        pb::TxnState txn_state = pb::TXN_UNKEOWN;
+        if (secondary_txn_state(txn_id, secondary_region_id, pb::OP_TXN_QUERY_STATE, txn_state) < 0) {
+            // 状态未知，不能决议，下次再查
+            return;
+        }
+        if (txn_state == pb::TXN_BEGINED || txn_state == pb::TXN_NOT_FOUND) {
+            // 先写fence，保证在途的prepare之后不会成功，fence返回的才是最终状态
+            if (secondary_txn_state(txn_id, secondary_region_id, pb::OP_TXN_ROLLBACK_FENCE, txn_state) < 0) {
+                return;
+            }
+        }
+        if (txn_state == pb::TXN_ROLLBACKED) {
+            op_type = pb::OP_ROLLBACK;
+            break;
+        }
+        if (txn_state != pb::TXN_PREPARED && txn_state != pb::TXN_COMMITTED) {
+            DB_WARNING("TransactionNote: unexpected secondary txn state, region_id: %ld, secondary_region_id: %ld, "
+                "txn_id: %lu, txn_state: %s", _region_id, secondary_region_id, txn_id,
+                pb::TxnState_Name(txn_state).c_str());
+            return;
+        }
+    }
+    DB_WARNING("TransactionNote: resolve async commit txn, region_id: %ld, txn_id: %lu, op_type: %s",
+        _region_id, txn_id, pb::OpType_Name(op_type).c_str());
+    txn_commit_through_raft(txn_id, region->region_info(), op_type);
+}
+
+void TransactionPool::resolve_async_commit_in_background(uint64_t txn_id, Region* region) {
+    {
+        BAIDU_SCOPED_LOCK(_resolving_mutex);
+        if (_resolving_txns.count(txn_id) > 0) {
+            return;
+        }
+    }
+    SmartRegion region_ptr = Store::get_instance()->get_region(region->get_region_id());
+    if (region_ptr == nullptr) {
+        return;
+    }
+    Bthread bth(&BTHREAD_ATTR_SMALL);
+    bth.run([this, txn_id, region_ptr]() {
+        resolve_async_commit(txn_id, region_ptr.get());
+    });
+}
+
 void TransactionPool::get_txn_state(const pb::StoreReq* request, pb::StoreRes* response) {
     _txn_map.traverse(
             [this, request, response](SmartTransaction& txn) {
@@ -259,7 +371,7 @@ void TransactionPool::get_txn_state(const pb::StoreReq* request, pb::StoreRes* r
     );
 }
 
-void TransactionPool::read_only_txn_process(int64_t region_id,
+int TransactionPool::read_only_txn_process(int64_t region_id,
                     SmartTransaction txn,
                     pb::OpType op_type,
                     bool optimize_1pc) {
@@ -269,8 +381,13 @@ void TransactionPool::read_only_txn_process(int64_t region_id,
             if (optimize_1pc) {
                 txn->rollback();
                 remove_txn(txn_id, true);
-            } else {
-                txn->prepare();
+            } else if (!txn->prepare().ok()) {
+                // 被async commit的primary fence，事务已决议回滚
+                DB_WARNING("TransactionNote: read only txn prepare failed, region_id: %ld, txn_id: %lu",
+                        _region_id, txn_id);
+                txn->rollback();
+                remove_txn(txn_id, false);
+                return -1;
             }
             break;
         case pb::OP_ROLLBACK:
@@ -287,6 +404,7 @@ void TransactionPool::read_only_txn_process(int64_t region_id,
     }
     DB_DEBUG("dml type: %s region_id: %ld, txn_id: %lu optimize_1pc:%d", pb::OpType_Name(op_type).c_str(),
             _region_id, txn_id, optimize_1pc);
+    return 0;
 }
 
 void TransactionPool::txn_commit_through_raft(uint64_t txn_id,
@@ -591,8 +709,13 @@ void TransactionPool::clear_transactions(Region* region) {
         }
         return ;
     }
-    // 只对primary region进行超时rollback
+    // 只对primary region进行超时rollback，async commit事务需要根据secondary状态决议
     for (auto txn_id : primary_txns_need_clear) {
+        SmartTransaction txn = get_txn(txn_id);
+        if (txn != nullptr && txn->is_async_commit() && txn->is_prepared()) {
+            resolve_async_commit(txn_id, region);
+            continue;
+        }
         txn_commit_through_raft(txn_id, region->region_info(), pb::OP_ROLLBACK);
     }
     for (auto txn_id : txns_need_query_primary) {
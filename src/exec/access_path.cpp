@@ -14,6 +14,8 @@
 
 #include "access_path.h"
 #include "slot_ref.h"
+#include <algorithm>
+#include <set>
 #ifdef BAIDU_INTERNAL 
 #include <base/containers/flat_map.h>
 #else
@@ -119,6 +121,20 @@ struct RecordRange {
     MutTableKey right_key;
     int64_t partition_id = -1;
 };
+
+// in的值按索引字段编码去重，重复值在多个字段组合展开时会成倍放大
+static void unique_in_values(const std::vector<ExprValue>& values, pb::PrimitiveType type,
+        std::vector<ExprValue>& unique_values) {
+    std::set<std::string> keys;
+    for (auto& value : values) {
+        ExprValue key_value = value;
+        MutTableKey key;
+        key.append_value(key_value.cast_to(type));
+        if (keys.insert(key.data()).second) {
+            unique_values.emplace_back(value);
+        }
+    }
+}
 // 现在只支持CNF，DNF怎么做?
 // 普通索引按照range匹配，匹配到EQ可以往下走，匹配到RANGE、LIKE_PREFIX停止
 // 匹配到IN，如果之前是IN停止（row_expr除外）
@@ -428,9 +444,15 @@ void AccessPath::calc_index_range(int64_t partition_field_id, const std::map<std
                         // (("a1", "b1") ("a2", "b1")),则b的offset = in_records.size();
                         in_row_expr_map[*range.conditions.begin()] = std::pair<uint32_t, uint32_t>(in_records.size(), 1);
                     }
+                    // in_row_expr的值与后续字段按下标对应，不能去重
+                    std::vector<ExprValue> unique_values;
+                    if (!range.is_row_expr) {
+                        unique_in_values(range.eq_in_values, field.type, unique_values);
+                    }
+                    const std::vector<ExprValue>& in_values = range.is_row_expr ? range.eq_in_values : unique_values;
                     std::vector<RecordRange> comb_in_records;
-                    comb_in_records.reserve(range.eq_in_values.size() * in_records.size());
-                    for (auto value : range.eq_in_values) {
+                    comb_in_records.reserve(in_values.size() * in_records.size());
+                    for (auto value : in_values) {
                         // 为保持前面已处理字段步长稳定性, 当前字段需要写在外层循环与in_records进行展开.
                         for (auto record : in_records) {
                             RecordRange rg;
@@ -472,13 +494,15 @@ void AccessPath::calc_index_range(int64_t partition_field_id, const std::map<std
         pos_index.add_ranges();
     } else if (in_records.size() > 0) {
         is_possible = true;
-        butil::FlatSet<std::string> filter;
-        filter.init(ajust_flat_size(in_records.size()));
+        // 按key排序去重，store按序扫描，按region切分range时也只需顺序遍历
+        std::sort(in_records.begin(), in_records.end(), [](const RecordRange& l, const RecordRange& r) {
+            return l.left_key.data() < r.left_key.data();
+        });
+        in_records.erase(std::unique(in_records.begin(), in_records.end(),
+            [](const RecordRange& l, const RecordRange& r) {
+                return l.left_key.data() == r.left_key.data();
+            }), in_records.end());
         for (auto& rg : in_records) {
-            if (filter.seek(rg.left_key.data()) != nullptr) {
-                continue;
-            }
-            filter.insert(rg.left_key.data());
             auto range = pos_index.add_ranges();
             if (_left_field_cnt == index_info_ptr->fields.size()
                 && (index_type == pb::I_PRIMARY || index_type == pb::I_UNIQ)
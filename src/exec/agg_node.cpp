@@ -17,6 +17,15 @@
 #include "query_context.h"
 
 namespace baikaldb {
+DEFINE_bool(adaptive_partial_agg, false, "store partial agg switch to pass-through when reduction is low");
+DEFINE_int64(partial_agg_sample_rows, 100000, "rows sampled before deciding whether partial agg is useful");
+DEFINE_double(partial_agg_min_reduction_ratio, 0.5, "partial agg is bypassed when 1 - groups/rows below this ratio");
+// 按列路径需先把MemRow转成arrow列，收益取决于聚合列数和机器，
+// 默认关闭，打开前在目标机器上压测确认
+DEFINE_bool(partial_agg_by_column, false, "store partial agg without group by computed on arrow columns");
+DEFINE_bool(agg_key_encode_by_column, true, "encode fixed-width integer group by keys column by column");
+static bvar::Adder<int64_t> partial_agg_bypass_count {"partial_agg_bypass_count"};
+static bvar::Adder<int64_t> partial_agg_by_column_rows {"partial_agg_by_column_rows"};
 
 int AggNode::init(const pb::PlanNode& node) {
     int ret = 0;
@@ -122,10 +131,17 @@ int AggNode::open(RuntimeState* state) {
     }
     _mem_row_desc = state->mem_row_desc();
 
+    _adaptive_partial_agg = can_bypass_partial_agg();
+    _agg_by_column = can_agg_by_column();
+    _encode_key_by_column = can_encode_agg_key_by_column();
+    _bypass = false;
+    _bypass_child_idx = 0;
+
     TimeCost cost;
     int64_t agg_time = 0;
     int64_t scan_time = 0;
-    for (auto child : _children) {
+    for (size_t child_idx = 0; child_idx < _children.size() && !_bypass; child_idx++) {
+        ExecNode* child = _children[child_idx];
         bool eos = false;
         do {
             if (state->is_cancelled()) {
@@ -145,7 +161,9 @@ int AggNode::open(RuntimeState* state) {
             cost.reset();
             int64_t used_size = 0;
             int64_t release_size = 0;
-            process_row_batch(state, batch, used_size, release_size);
+            if (!_agg_by_column || process_row_batch_by_column(batch, used_size, release_size) < 0) {
+                process_row_batch(state, batch, used_size, release_size);
+            }
             agg_time += cost.get_time();
             _row_cnt += batch.size();
             state->memory_limit_release(_row_cnt, release_size);
@@ -154,6 +172,13 @@ int AggNode::open(RuntimeState* state) {
                 DB_WARNING_STATE(state, "memory limit exceeded");
                 return -1;
             }
+            if (!eos && need_bypass_partial_agg()) {
+                _bypass = true;
+                _bypass_child_idx = child_idx;
+                partial_agg_bypass_count << 1;
+                DB_DEBUG("partial agg bypass, rows:%ld groups:%lu, log_id:%lu", _row_cnt, _hash_map.size(), state->log_id());
+                break;
+            }
             // 对于用order by分组的特殊优化
             //if (_agg_tuple_id == -1 && _limit != -1 && (int64_t)_hash_map.size() >= _limit) {
             //    break;
@@ -161,7 +186,7 @@ int AggNode::open(RuntimeState* state) {
         } while (!eos);
     }
     LOCAL_TRACE_DESC << "agg time cost:" << agg_time << 
-        " scan time cost:" << scan_time << " rows:" << _row_cnt;
+        " scan time cost:" << scan_time << " rows:" << _row_cnt << " bypass:" << _bypass;
 
     // 兼容mysql: select count(*) from t; 无数据时返回0
     if (_hash_map.size() == 0 && _group_exprs.size() == 0) {
@@ -182,6 +207,93 @@ int AggNode::open(RuntimeState* state) {
     return 0;
 }
 
+bool AggNode::can_agg_by_column() {
+    if (!FLAGS_partial_agg_by_column || _is_merger || _group_exprs.size() > 0) {
+        return false;
+    }
+    // baikaldb上的agg直接输出最终结果，只在store上使用
+    if (get_parent_node(pb::PACKET_NODE) != nullptr) {
+        return false;
+    }
+    _column_batch = ArrowColumnBatch();
+    _agg_column_idx.clear();
+    for (auto agg : _agg_fn_calls) {
+        if (!agg->can_update_by_column()) {
+            return false;
+        }
+        if (agg->agg_type() == AggFnCall::COUNT_STAR) {
+            _agg_column_idx.push_back(-1);
+            continue;
+        }
+        ExprNode* slot_ref = agg->children(0);
+        if (!ArrowColumnBatch::support_type(slot_ref->col_type())) {
+            return false;
+        }
+        _agg_column_idx.push_back(_column_batch.add_column(
+                slot_ref->tuple_id(), slot_ref->slot_id(), slot_ref->col_type()));
+    }
+    return true;
+}
+
+// 整批行只保留第一行作为聚合结果行，其余行按列聚合后随batch释放
+// 返回-1时batch未被修改，由调用方逐行处理
+int AggNode::process_row_batch_by_column(RowBatch& batch, int64_t& used_size, int64_t& release_size) {
+    if (batch.size() == 0) {
+        return 0;
+    }
+    if (_column_batch.build(batch) < 0) {
+        return -1;
+    }
+    int64_t batch_size = batch.used_bytes_size();
+    batch.reset();
+    MutTableKey key;
+    encode_agg_key(batch.get_row().get(), key);
+    MemRow** agg_row = _hash_map.seek(key.data());
+    if (agg_row == nullptr) {
+        MemRow* row = batch.get_row().release();
+        AggFnCall::initialize_all(_agg_fn_calls, key.data(), row, used_size, false);
+        batch_size -= row->used_size();
+        used_size += row->used_size();
+        used_size += key.size();
+        _hash_map.insert(key.data(), row);
+        agg_row = _hash_map.seek(key.data());
+    }
+    release_size += batch_size;
+    for (size_t i = 0; i < _agg_fn_calls.size(); i++) {
+        const arrow::Array* column = nullptr;
+        if (_agg_column_idx[i] >= 0) {
+            column = _column_batch.column(_agg_column_idx[i]);
+        }
+        _agg_fn_calls[i]->update_by_column(column, _column_batch.num_rows(), *agg_row);
+    }
+    partial_agg_by_column_rows << _column_batch.num_rows();
+    return 0;
+}
+
+// 只在store上的预聚合做自适应，merger需要完整结果
+bool AggNode::can_bypass_partial_agg() {
+    if (!FLAGS_adaptive_partial_agg || _is_merger || _group_exprs.size() == 0) {
+        return false;
+    }
+    if (get_parent_node(pb::PACKET_NODE) != nullptr) {
+        return false;
+    }
+    for (auto agg : _agg_fn_calls) {
+        if (!agg->is_row_local_agg()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AggNode::need_bypass_partial_agg() {
+    if (!_adaptive_partial_agg || _bypass || _row_cnt < FLAGS_partial_agg_sample_rows) {
+        return false;
+    }
+    double reduction_ratio = 1.0 - (double)_hash_map.size() / _row_cnt;
+    return reduction_ratio < FLAGS_partial_agg_min_reduction_ratio;
+}
+
 void AggNode::encode_agg_key(MemRow* row, MutTableKey& key) {
     uint8_t null_flag = 0;
     key.append_u8(null_flag);
@@ -196,12 +308,110 @@ void AggNode::encode_agg_key(MemRow* row, MutTableKey& key) {
     key.replace_u8(null_flag, 0);
 }
 
+// 只处理4/8字节整数类型的slot，与MutTableKey::append_value编码一致
+static size_t fixed_key_width(pb::PrimitiveType type) {
+    switch (type) {
+        case pb::INT32:
+        case pb::TIME:
+        case pb::UINT32:
+        case pb::TIMESTAMP:
+        case pb::DATE:
+            return sizeof(uint32_t);
+        case pb::INT64:
+        case pb::UINT64:
+        case pb::DATETIME:
+            return sizeof(uint64_t);
+        default:
+            return 0;
+    }
+}
+
+bool AggNode::can_encode_agg_key_by_column() {
+    // null_flag只有8位
+    if (!FLAGS_agg_key_encode_by_column || _group_exprs.size() == 0 || _group_exprs.size() > 8) {
+        return false;
+    }
+    for (auto expr : _group_exprs) {
+        if (!expr->is_slot_ref() || fixed_key_width(expr->col_type()) == 0) {
+            return false;
+        }
+    }
+    _key_columns.resize(_group_exprs.size());
+    return true;
+}
+
+void AggNode::encode_agg_keys_by_column(RowBatch& batch, std::vector<std::string>& keys) {
+    size_t num_rows = batch.size();
+    std::vector<uint8_t> null_flags(num_rows, 0);
+    std::vector<uint64_t> values(num_rows);
+    std::vector<uint32_t> values_32(num_rows);
+    size_t key_size = 1;
+    for (size_t i = 0; i < _group_exprs.size(); i++) {
+        pb::PrimitiveType type = _group_exprs[i]->col_type();
+        size_t width = fixed_key_width(type);
+        key_size += width;
+        for (size_t row_idx = 0; row_idx < num_rows; row_idx++) {
+            ExprValue value = _group_exprs[i]->get_value(batch.get_row(row_idx).get());
+            if (value.is_null()) {
+                null_flags[row_idx] |= (0x01 << (7 - i));
+                value._u.uint64_val = 0;
+            }
+            if (width == sizeof(uint64_t)) {
+                values[row_idx] = value._u.uint64_val;
+            } else {
+                values_32[row_idx] = value._u.uint32_val;
+            }
+        }
+        std::vector<char>& column = _key_columns[i];
+        column.resize(num_rows * width);
+        switch (type) {
+            case pb::INT32:
+            case pb::TIME:
+                KeyEncoder::encode_i32_batch((const int32_t*)values_32.data(), num_rows, column.data());
+                break;
+            case pb::INT64:
+                KeyEncoder::encode_i64_batch((const int64_t*)values.data(), num_rows, column.data());
+                break;
+            case pb::UINT64:
+            case pb::DATETIME:
+                KeyEncoder::encode_u64_batch(values.data(), num_rows, column.data());
+                break;
+            default:
+                KeyEncoder::encode_u32_batch(values_32.data(), num_rows, column.data());
+                break;
+        }
+    }
+    keys.resize(num_rows);
+    for (size_t row_idx = 0; row_idx < num_rows; row_idx++) {
+        std::string& key = keys[row_idx];
+        key.clear();
+        key.reserve(key_size);
+        key.append(1, (char)null_flags[row_idx]);
+        for (size_t i = 0; i < _group_exprs.size(); i++) {
+            if ((null_flags[row_idx] >> (7 - i)) & 0x01) {
+                continue;
+            }
+            size_t width = _key_columns[i].size() / num_rows;
+            key.append(_key_columns[i].data() + row_idx * width, width);
+        }
+    }
+}
+
 void AggNode::process_row_batch(RuntimeState* state, RowBatch& batch, int64_t& used_size, int64_t& release_size) {
+    std::vector<std::string> keys;
+    bool by_column = _encode_key_by_column && batch.size() > 0;
+    if (by_column) {
+        encode_agg_keys_by_column(batch, keys);
+    }
     for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
         std::unique_ptr<MemRow>& row = batch.get_row();
         MutTableKey key;
         MemRow* cur_row = row.get();
-        encode_agg_key(cur_row, key);
+        if (by_column) {
+            key.data().swap(keys[batch.index()]);
+        } else {
+            encode_agg_key(cur_row, key);
+        }
         MemRow** agg_row = _hash_map.seek(key.data());
         
         if (agg_row == nullptr) { //不存在则新建
@@ -243,7 +453,14 @@ int AggNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
             *eos = true;
             return 0;
         }
-        if (reached_limit() || _iter == _hash_map.end()) {
+        if (reached_limit()) {
+            *eos = true;
+            return 0;
+        }
+        if (_iter == _hash_map.end()) {
+            if (_bypass) {
+                return get_next_bypass(state, batch, eos);
+            }
             *eos = true;
             return 0;
         }
@@ -258,6 +475,43 @@ int AggNode::get_next(RuntimeState* state, RowBatch* batch, bool* eos) {
     }
 }
 
+// 透传模式：每行单独初始化为一个预聚合结果，由merger合并
+int AggNode::get_next_bypass(RuntimeState* state, RowBatch* batch, bool* eos) {
+    static const std::string empty_key;
+    while (_bypass_child_idx < _children.size()) {
+        if (state->is_cancelled()) {
+            DB_WARNING_STATE(state, "cancelled");
+            *eos = true;
+            return 0;
+        }
+        RowBatch child_batch;
+        bool child_eos = false;
+        int ret = _children[_bypass_child_idx]->get_next(state, &child_batch, &child_eos);
+        if (ret < 0) {
+            DB_WARNING_STATE(state, "child->get_next fail, ret:%d", ret);
+            return ret;
+        }
+        if (child_eos) {
+            _bypass_child_idx++;
+        }
+        int64_t used_size = 0;
+        for (child_batch.reset(); !child_batch.is_traverse_over(); child_batch.next()) {
+            std::unique_ptr<MemRow>& row = child_batch.get_row();
+            AggFnCall::initialize_all(_agg_fn_calls, empty_key, row.get(), used_size, false);
+            AggFnCall::update_all(_agg_fn_calls, empty_key, row.get(), row.get(), used_size);
+            AggFnCall::finalize_all(_agg_fn_calls, empty_key, row.get());
+            batch->move_row(std::move(row));
+            _num_rows_returned++;
+        }
+        _row_cnt += child_batch.size();
+        if (batch->size() > 0) {
+            return 0;
+        }
+    }
+    *eos = true;
+    return 0;
+}
+
 void AggNode::close(RuntimeState* state) {
     ExecNode::close(state);
     for (auto expr : _group_exprs) {
@@ -270,6 +524,8 @@ void AggNode::close(RuntimeState* state) {
         delete _iter->second;
     }
     _hash_map.clear();
+    _bypass = false;
+    _bypass_child_idx = 0;
 }
 void AggNode::transfer_pb(int64_t region_id, pb::PlanNode* pb_node) {
     ExecNode::transfer_pb(region_id, pb_node);
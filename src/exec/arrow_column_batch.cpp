@@ -0,0 +1,95 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "arrow_column_batch.h"
+#include <arrow/api.h>
+
+namespace baikaldb {
+
+template <typename Builder, typename T>
+static arrow::Status build_array(RowBatch& batch, int32_t tuple_id, int32_t slot_id,
+        std::shared_ptr<arrow::Array>* array) {
+    Builder builder;
+    ARROW_RETURN_NOT_OK(builder.Reserve(batch.size()));
+    for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+        ExprValue value = batch.get_row()->get_value(tuple_id, slot_id);
+        if (value.is_null()) {
+            ARROW_RETURN_NOT_OK(builder.AppendNull());
+        } else {
+            ARROW_RETURN_NOT_OK(builder.Append(value.get_numberic<T>()));
+        }
+    }
+    return builder.Finish(array);
+}
+
+int ArrowColumnBatch::add_column(int32_t tuple_id, int32_t slot_id, pb::PrimitiveType type) {
+    for (size_t i = 0; i < _columns.size(); i++) {
+        if (_columns[i].tuple_id == tuple_id && _columns[i].slot_id == slot_id) {
+            return i;
+        }
+    }
+    _columns.push_back({tuple_id, slot_id, type});
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    for (size_t i = 0; i < _columns.size(); i++) {
+        std::shared_ptr<arrow::DataType> data_type;
+        if (is_double(_columns[i].type)) {
+            data_type = arrow::float64();
+        } else if (is_uint(_columns[i].type)) {
+            data_type = arrow::uint64();
+        } else {
+            data_type = arrow::int64();
+        }
+        fields.emplace_back(arrow::field("c" + std::to_string(i), data_type));
+    }
+    _schema = arrow::schema(fields);
+    return _columns.size() - 1;
+}
+
+int ArrowColumnBatch::build(RowBatch& batch) {
+    _num_rows = batch.size();
+    if (_columns.empty()) {
+        return 0;
+    }
+    std::vector<std::shared_ptr<arrow::Array>> arrays;
+    for (auto& column : _columns) {
+        std::shared_ptr<arrow::Array> array;
+        arrow::Status status;
+        if (is_double(column.type)) {
+            status = build_array<arrow::DoubleBuilder, double>(
+                    batch, column.tuple_id, column.slot_id, &array);
+        } else if (is_uint(column.type)) {
+            status = build_array<arrow::UInt64Builder, uint64_t>(
+                    batch, column.tuple_id, column.slot_id, &array);
+        } else {
+            status = build_array<arrow::Int64Builder, int64_t>(
+                    batch, column.tuple_id, column.slot_id, &array);
+        }
+        if (!status.ok()) {
+            DB_WARNING("build arrow array fail, slot_id: %d, %s",
+                    column.slot_id, status.ToString().c_str());
+            return -1;
+        }
+        arrays.emplace_back(array);
+    }
+    _record_batch = arrow::RecordBatch::Make(_schema, batch.size(), arrays);
+    return 0;
+}
+
+const arrow::Array* ArrowColumnBatch::column(int idx) const {
+    return _record_batch->column(idx).get();
+}
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
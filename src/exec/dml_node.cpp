@@ -19,6 +19,12 @@ namespace baikaldb {
 
 DEFINE_bool(replace_no_get, false, "no get before replace if true");
 
+// 任一加锁路径被死锁检测选为牺牲者，都统一返回ER_LOCK_DEADLOCK，baikaldb据此回滚整个事务
+static void set_deadlock_error(RuntimeState* state) {
+    state->error_code = ER_LOCK_DEADLOCK;
+    state->error_msg << "Deadlock found when trying to get lock; try restarting transaction";
+}
+
 int DMLNode::expr_optimize(QueryContext* ctx) {
     int ret = 0;
     ret = ExecNode::expr_optimize(ctx);
@@ -308,7 +314,9 @@ int DMLNode::insert_row(RuntimeState* state, SmartRecord record, bool is_update)
                 }
             } else {
                 DB_WARNING_STATE(state, "insert row rocksdb error, index:%ld, ret:%d", _table_id, ret);
-                if (ret == -5) {
+                if (ret == -5 && _txn->is_deadlock()) {
+                    set_deadlock_error(state);
+                } else if (ret == -5) {
                     state->error_code = ER_LOCK_WAIT_TIMEOUT;
                     state->error_msg << "Lock '" << 
                         old_record->get_index_value(*_pri_info) << "' for key 'PRIMARY' Timeout";
@@ -378,7 +386,11 @@ int DMLNode::insert_row(RuntimeState* state, SmartRecord record, bool is_update)
         // ret == -3 means the primary_key returned by get_update_secondary is out of the region
         // (dirty data), this does not affect the insertion
         if (ret != -2 && ret != -3 && ret != -4) {
-            if (ret == -5) {
+            if (ret == -5 && _txn->is_deadlock()) {
+                set_deadlock_error(state);
+                DB_WARNING_STATE(state, "insert rocksdb get lock deadlock, index:%ld, ret:%d", info.id, ret);
+                return -1;
+            } else if (ret == -5) {
                 state->error_code = ER_LOCK_WAIT_TIMEOUT;
                 state->error_msg << "Lock '" << 
                      old_record->get_index_value(info) << "' for key '" << info.short_name << "' Timeout";
@@ -439,7 +451,10 @@ int DMLNode::insert_row(RuntimeState* state, SmartRecord record, bool is_update)
         ret = _txn->put_secondary(_region_id, info, record);
         if (ret < 0) {
             DB_WARNING_STATE(state, "put index:%ld fail:%d, table_id:%ld", info.id, ret, _table_id);
-            return ret;
+            if (ret == -5 && _txn->is_deadlock()) {
+                set_deadlock_error(state);
+            }
+            return -1;
         }
     }
 
@@ -452,6 +467,9 @@ int DMLNode::insert_row(RuntimeState* state, SmartRecord record, bool is_update)
                             cstore_update_fields_partly ? &_update_field_ids : nullptr);
     if (ret < 0) {
         DB_WARNING_STATE(state, "put table:%ld fail:%d", _table_id, ret);
+        if (ret == -5 && _txn->is_deadlock()) {
+            set_deadlock_error(state);
+        }
         return -1;
     }
     //DB_WARNING_STATE(state, "insert succes:%ld, %s", _region_id, record->to_string().c_str());
@@ -478,6 +496,9 @@ int DMLNode::get_lock_row(RuntimeState* state, SmartRecord record, std::string*
     }
     //delete requires all fields (index and non-index fields)
     ret = _txn->get_update_primary(_region_id, *_pri_info, record, _field_ids, GET_LOCK, true);
+    if (ret == -5 && _txn->is_deadlock()) {
+        set_deadlock_error(state);
+    }
     if (ret < 0) {
         return ret;
     }
@@ -499,6 +520,9 @@ int DMLNode::remove_row(RuntimeState* state, SmartRecord record,
         ret = _txn->remove(_region_id, *_pri_info, record);
         if (ret != 0) {
             DB_WARNING_STATE(state, "remove fail, index:%ld ,ret:%d", _table_id, ret);
+            if (ret == -5 && _txn->is_deadlock()) {
+                set_deadlock_error(state);
+            }
             return -1;
         }
     }
@@ -551,11 +575,17 @@ int DMLNode::remove_row(RuntimeState* state, SmartRecord record,
         ret = _txn->get_update_secondary(_region_id, *_pri_info, info, record, LOCK_ONLY, false);
         if (ret != 0 && ret != -2) {
             DB_WARNING_STATE(state, "lock fail, index:%ld, ret:%d", info.id, ret);
+            if (ret == -5 && _txn->is_deadlock()) {
+                set_deadlock_error(state);
+            }
             return -1;
         }
         ret = _txn->remove(_region_id, info, record);
         if (ret != 0) {
             DB_WARNING_STATE(state, "remove index:%ld failed", info.id);
+            if (ret == -5 && _txn->is_deadlock()) {
+                set_deadlock_error(state);
+            }
             return -1;
         }
     }
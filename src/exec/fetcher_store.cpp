@@ -23,6 +23,7 @@
 #include <gflags/gflags.h>
 #include "binlog_context.h"
 #include "query_context.h"
+#include "result_cache.h"
 #include "dml_node.h"
 #include "scan_node.h"
 #include "trace_state.h"
@@ -46,6 +47,11 @@ DEFINE_string(fetcher_resource_tag, "", "store read resource_tag perfered, only
 DECLARE_int32(transaction_clear_delay_ms);
 DEFINE_bool(use_dynamic_timeout, false, "whether use dynamic_timeout");
 DEFINE_bool(use_read_index, false, "whether use follower read");
+DEFINE_bool(limit_wave_fanout, false, "select with limit and without order by send region requests in waves");
+DEFINE_int32(limit_wave_init_region_num, 4, "region num of the first wave for limit select");
+DEFINE_int32(limit_wave_growth_factor, 4, "region num growth factor between waves for limit select");
+DEFINE_int32(plan_fragment_min_regions, 0, "select with region num >= this shares one serialized plan "
+        "in rpc attachment, 0 means disable, stores must support plan_fragment_sign");
 BRPC_VALIDATE_GFLAG(use_dynamic_timeout, brpc::PassValidate);
 bvar::Adder<int64_t> OnRPCDone::async_rpc_region_count {"async_rpc_region_count"};
 bvar::LatencyRecorder OnRPCDone::total_send_request {"total_send_request"};
@@ -148,9 +154,12 @@ ErrorType OnRPCDone::fill_request() {
     _request.set_log_id(_state->log_id());
     _request.set_sql_sign(_state->sign);
     _request.mutable_extra_req()->set_sign_latency(_fetcher_store->sign_latency);
-    for (auto& desc : _state->tuple_descs()) {
-        if (desc.has_tuple_id()){
-            _request.add_tuples()->CopyFrom(desc);
+    bool use_plan_fragment = _fetcher_store->plan_fragment_sign != 0;
+    if (!use_plan_fragment) {
+        for (auto& desc : _state->tuple_descs()) {
+            if (desc.has_tuple_id()){
+                _request.add_tuples()->CopyFrom(desc);
+            }
         }
     }
     pb::TransactionInfo* txn_info = _request.add_txn_infos();
@@ -180,6 +189,18 @@ ErrorType OnRPCDone::fill_request() {
         } else if (_client_conn->primary_region_id == _region_id) {
             _client_conn->txn_pri_region_last_exec_time = butil::gettimeofday_us();
         }
+        if (_op_type == pb::OP_PREPARE && _state->async_commit()) {
+            txn_info->set_async_commit(true);
+            // 只有primary需要secondary列表
+            if (_client_conn->primary_region_id == _region_id) {
+                BAIDU_SCOPED_LOCK(_client_conn->region_lock);
+                for (auto& pair : _client_conn->region_infos) {
+                    if (pair.first != _region_id) {
+                        txn_info->add_secondary_region_ids(pair.first);
+                    }
+                }
+            }
+        }
     }
 
     // 将缓存的plan中seq_id >= start_seq_id的部分追加到request中
@@ -245,12 +266,42 @@ ErrorType OnRPCDone::fill_request() {
         scan_node->set_index_useage_and_lock(use_global_backup);
     }
 
-    ExecNode::create_pb_plan(_old_region_id, _request.mutable_plan(), _store_request);
+    if (use_plan_fragment) {
+        // plan在attachment中，只需带上按region裁剪后的索引范围
+        _request.set_plan_fragment_sign(_fetcher_store->plan_fragment_sign);
+        if (scan_node != nullptr) {
+            pb::PlanNode pb_scan_node;
+            scan_node->transfer_pb(_old_region_id, &pb_scan_node);
+            const pb::ScanNode& region_scan = pb_scan_node.derive_node().scan_node();
+            const pb::ScanNode& fragment_scan = _fetcher_store->plan_fragment_scan;
+            bool same_indexes = region_scan.indexes_size() == fragment_scan.indexes_size()
+                    && region_scan.learner_index() == fragment_scan.learner_index();
+            for (int i = 0; same_indexes && i < region_scan.indexes_size(); ++i) {
+                same_indexes = region_scan.indexes(i) == fragment_scan.indexes(i);
+            }
+            if (!same_indexes) {
+                _request.mutable_region_indexes()->CopyFrom(region_scan.indexes());
+                _request.set_region_learner_index(region_scan.learner_index());
+            }
+        }
+    } else {
+        ExecNode::create_pb_plan(_old_region_id, _request.mutable_plan(), _store_request);
+    }
 
     if (scan_node != nullptr) {
         scan_node->current_index_unlock();
     }
 
+    // 分批发送时只需要剩余的行数
+    if (_fetcher_store->wave_limit > 0) {
+        int64_t remain_limit = std::max(_fetcher_store->wave_limit - _fetcher_store->row_cnt.load(), (int64_t)1);
+        for (auto& pb_node : *_request.mutable_plan()->mutable_nodes()) {
+            if (pb_node.limit() > remain_limit) {
+                pb_node.set_limit(remain_limit);
+            }
+        }
+    }
+
     return E_OK;
 }   
 
@@ -319,7 +370,10 @@ void OnRPCDone::select_addr() {
         // 没有learner副本时报警
         DB_DONE(DEBUG, "has abnormal learner, learner size: 0");
     }
-    if (_op_type == pb::OP_SELECT && _state->txn_id == 0 && _state->need_use_read_index) {
+    if (_op_type == pb::OP_SELECT && _state->txn_id == 0 && _state->max_staleness_us > 0) {
+        // 有界陈旧读，副本按closed ts本地判断，不满足时返回NOT_LEADER重试leader
+        _request.mutable_extra_req()->set_max_staleness_us(_state->max_staleness_us);
+    } else if (_op_type == pb::OP_SELECT && _state->txn_id == 0 && _state->need_use_read_index) {
         _request.mutable_extra_req()->set_use_read_idx(true);
     }
     // 是否指定访问资源隔离, 如offline
@@ -402,6 +456,15 @@ void OnRPCDone::select_addr() {
             }
         }
         _request.set_select_without_leader(true);
+    } else if (_op_type == pb::OP_SELECT && _state->txn_id == 0 && _state->max_staleness_us > 0) {
+        // 仅第一次选择就近副本，副本拒绝后重试访问leader
+        if (_retry_times == 0) {
+            pb::Status addr_status = pb::NORMAL;
+            FetcherStore::choose_opt_instance(_info.region_id(), _info.peers(), _addr, addr_status, nullptr);
+        } else {
+            FetcherStore::choose_other_if_dead(_info, _addr);
+        }
+        _request.set_select_without_leader(true);
     } else if (_retry_times == 0) {
         // 重试前已经选择了normal的实例
         // 或者store返回了正确的leader
@@ -481,6 +544,10 @@ ErrorType OnRPCDone::send_async() {
 #endif
     _fetcher_store->insert_callid(_cntl.call_id());
     _query_time.reset();
+    if (_request.plan_fragment_sign() != 0) {
+        // 引用同一块IOBuf，不拷贝
+        _cntl.request_attachment().append(_fetcher_store->plan_fragment);
+    }
     pb::StoreService_Stub(&channel).query(&_cntl, &_request, &_response, this);
     return E_ASYNC;
 }
@@ -499,6 +566,12 @@ void OnRPCDone::Run() {
         add_backup_send_request << query_cost;
     }
     SchemaFactory* schema_factory = SchemaFactory::get_instance();
+    if (_cntl.Failed() && _cntl.ErrorCode() == ECANCELED && _fetcher_store->limit_reached) {
+        // limit已满足主动取消，不算失败
+        DB_DONE(DEBUG, "cancelled by limit reached");
+        _rpc_ctrl->task_finish(this);
+        return;
+    }
     if (_cntl.Failed()) {
         DB_DONE(WARNING, "call failed, errcode:%d, error:%s", _cntl.ErrorCode(), _cntl.ErrorText().c_str());
         schema_factory->update_instance(remote_side, pb::FAULTY, false, false);
@@ -844,10 +917,28 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
             _client_conn->region_infos[_region_id].set_leader(_response.leader());
         }
     }
+    auto top_ctx = _client_conn->query_ctx;
+    if (top_ctx != nullptr && top_ctx->record_region_versions) {
+        BAIDU_SCOPED_LOCK(top_ctx->region_versions_lock);
+        // 老版本store未返回时置为未知，命中时校验失败
+        RegionDataVersion region_version;
+        region_version.table_id = _info.table_id();
+        region_version.version = _info.version();
+        region_version.data_index = _response.has_data_index() ? _response.data_index() : -1;
+        auto ret = top_ctx->region_versions.emplace(_region_id, region_version);
+        // 同一region可能重复请求，取较旧的版本
+        if (!ret.second && ret.first->second.data_index >= 0
+                && region_version.data_index < ret.first->second.data_index) {
+            ret.first->second = region_version;
+        }
+    }
     TimeCost cost;
     if (_response.row_values_size() > 0) {
         _fetcher_store->row_cnt += _response.row_values_size();
     }
+    if (_fetcher_store->wave_limit > 0 && _fetcher_store->row_cnt >= _fetcher_store->wave_limit) {
+        _fetcher_store->cancel_rpc_for_limit();
+    }
     // TODO reduce mem used by streaming
     if ((!_state->is_full_export) && (_fetcher_store->row_cnt > FLAGS_max_select_rows)) {
         DB_DONE(FATAL, "_row_cnt:%ld > %ld max_select_rows", _fetcher_store->row_cnt.load(), FLAGS_max_select_rows);
@@ -935,6 +1026,10 @@ ErrorType OnRPCDone::handle_response(const std::string& remote_side) {
 }
 
 void OnRPCDone::send_request() {
+    if (_fetcher_store->limit_reached) {
+        _rpc_ctrl->task_finish(this);
+        return;
+    }
     auto err = check_status();
     if (err != E_OK) {
         _fetcher_store->error = err;
@@ -1062,6 +1157,36 @@ ErrorType FetcherStore::process_binlog_start(RuntimeState* state, pb::OpType op_
     return E_OK;
 }
 
+void FetcherStore::send_request_in_waves(RuntimeState* state,
+                    ExecNode* store_request,
+                    std::vector<pb::RegionInfo*>& infos,
+                    int start_seq_id,
+                    int current_seq_id,
+                    pb::OpType op_type) {
+    std::sort(infos.begin(), infos.end(), [](const pb::RegionInfo* left, const pb::RegionInfo* right) {
+        return left->start_key() < right->start_key();
+    });
+    size_t wave_size = std::max(FLAGS_limit_wave_init_region_num, 1);
+    size_t growth_factor = std::max(FLAGS_limit_wave_growth_factor, 1);
+    size_t pos = 0;
+    int wave_cnt = 0;
+    while (pos < infos.size()) {
+        size_t end = std::min(infos.size(), pos + wave_size);
+        std::vector<pb::RegionInfo*> wave_infos(infos.begin() + pos, infos.begin() + end);
+        send_request(state, store_request, wave_infos, start_seq_id, current_seq_id, op_type);
+        pos = end;
+        ++wave_cnt;
+        if (error != E_OK || limit_reached || row_cnt >= wave_limit) {
+            break;
+        }
+        wave_size *= growth_factor;
+    }
+    if (pos < infos.size()) {
+        DB_DEBUG("limit reached, wave_cnt: %d, skip region num: %lu, row_cnt: %ld, log_id: %lu",
+                wave_cnt, infos.size() - pos, row_cnt.load(), state->log_id());
+    }
+}
+
 int64_t FetcherStore::get_dynamic_timeout_ms(ExecNode* store_request, pb::OpType op_type, uint64_t sign) {
     int64_t dynamic_timeout_ms = -1;
 
@@ -1104,6 +1229,71 @@ int64_t FetcherStore::get_sign_latency(pb::OpType op_type, uint64_t sign) {
     return latency;
 }
 
+void FetcherStore::build_plan_fragment(RuntimeState* state, ExecNode* store_request,
+        pb::OpType op_type, size_t region_num) {
+    plan_fragment.clear();
+    plan_fragment_sign = 0;
+    plan_fragment_scan.Clear();
+    // 事务中需要携带cache_plan，limit分批时需要按region改写limit，不使用共享plan
+    if (FLAGS_plan_fragment_min_regions <= 0 || (int64_t)region_num < FLAGS_plan_fragment_min_regions
+            || op_type != pb::OP_SELECT || state->txn_id != 0 || wave_limit > 0
+            || global_backup_type != GBT_INIT) {
+        return;
+    }
+    std::vector<ExecNode*> scan_nodes;
+    store_request->get_node(pb::SCAN_NODE, scan_nodes);
+    if (scan_nodes.size() > 1) {
+        return;
+    }
+    ScanNode* scan_node = scan_nodes.size() == 1 ? static_cast<ScanNode*>(scan_nodes[0]) : nullptr;
+    pb::StoreReq fragment;
+    for (auto& desc : state->tuple_descs()) {
+        if (desc.has_tuple_id()) {
+            fragment.add_tuples()->CopyFrom(desc);
+        }
+    }
+    if (scan_node != nullptr) {
+        scan_node->set_index_useage_and_lock(false);
+    }
+    // region_id传0，scan_node中为未按region裁剪的索引范围
+    ExecNode::create_pb_plan(0, fragment.mutable_plan(), store_request);
+    if (scan_node != nullptr) {
+        scan_node->current_index_unlock();
+    }
+    for (auto& pb_node : fragment.plan().nodes()) {
+        if (pb_node.node_type() == pb::SCAN_NODE) {
+            plan_fragment_scan.CopyFrom(pb_node.derive_node().scan_node());
+        }
+    }
+    std::string fragment_str;
+    if (!fragment.SerializePartialToString(&fragment_str)) {
+        DB_WARNING("serialize plan fragment fail, log_id:%lu", state->log_id());
+        plan_fragment_scan.Clear();
+        return;
+    }
+    uint64_t out[2];
+    butil::MurmurHash3_x64_128(fragment_str.c_str(), fragment_str.size(), 0x1234, out);
+    plan_fragment.append(fragment_str);
+    plan_fragment_sign = out[0] == 0 ? 1 : out[0];
+}
+
+void FetcherStore::update_result_cache(std::map<int64_t, pb::RegionInfo>& region_infos,
+        pb::OpType op_type) {
+    if (!FLAGS_enable_result_cache || op_type == pb::OP_SELECT || op_type == pb::OP_SELECT_FOR_UPDATE
+            || op_type == pb::OP_BEGIN || op_type == pb::OP_ROLLBACK) {
+        return;
+    }
+    std::set<int64_t> table_ids;
+    for (auto& pair : region_infos) {
+        auto& info = pair.second;
+        table_ids.insert(info.has_main_table_id() && info.main_table_id() > 0 ?
+                info.main_table_id() : info.table_id());
+    }
+    for (int64_t table_id : table_ids) {
+        ResultCache::get_instance()->table_write(table_id);
+    }
+}
+
 int FetcherStore::run_not_set_state(RuntimeState* state,
                     std::map<int64_t, pb::RegionInfo>& region_infos,
                     ExecNode* store_request,
@@ -1133,6 +1323,7 @@ int FetcherStore::run_not_set_state(RuntimeState* state,
 
     dynamic_timeout_ms = get_dynamic_timeout_ms(store_request, op_type, state->sign);
     sign_latency = get_sign_latency(op_type, state->sign);
+    build_plan_fragment(state, store_request, op_type, region_infos.size());
     // 预分配空洞
     for (auto& pair : region_infos) {
         start_key_sort.emplace(pair.second.start_key(), pair.first);
@@ -1242,7 +1433,11 @@ int FetcherStore::run_not_set_state(RuntimeState* state,
         infos.emplace_back(info);
     }
 
-    send_request(state, store_request, infos, start_seq_id, current_seq_id, op_type);
+    if (wave_limit > 0 && op_type == pb::OP_SELECT && state->txn_id == 0) {
+        send_request_in_waves(state, store_request, infos, start_seq_id, current_seq_id, op_type);
+    } else {
+        send_request(state, store_request, infos, start_seq_id, current_seq_id, op_type);
+    }
 
     process_binlog_done(state, op_type);
 
@@ -0,0 +1,60 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "group_insert.h"
+
+namespace baikaldb {
+DEFINE_int64(group_insert_window_us, 0,
+        "merge concurrent autocommit inserts to the same region within window(us), 0 means disable");
+DEFINE_int32(group_insert_max_statements, 128, "max statements merged into one insert request");
+
+int GroupInsert::join(int64_t region_id, Request* request, std::vector<Request*>& group) {
+    bool is_leader = false;
+    {
+        BAIDU_SCOPED_LOCK(_mutex);
+        auto& pending = _pending[region_id];
+        if ((int)pending.size() >= FLAGS_group_insert_max_statements) {
+            return -1;
+        }
+        is_leader = pending.empty();
+        pending.emplace_back(request);
+    }
+    if (!is_leader) {
+        request->cond.wait();
+        return 0;
+    }
+    bthread_usleep(FLAGS_group_insert_window_us);
+    BAIDU_SCOPED_LOCK(_mutex);
+    auto iter = _pending.find(region_id);
+    group.swap(iter->second);
+    _pending.erase(iter);
+    return 0;
+}
+
+void GroupInsert::finish(const std::vector<Request*>& group, Request* leader, Result result,
+        MysqlErrCode error_code, const std::string& error_msg) {
+    for (auto request : group) {
+        if (request == leader) {
+            continue;
+        }
+        request->result = result;
+        request->error_code = error_code;
+        request->error_msg = error_msg;
+        request->cond.decrease_signal();
+    }
+}
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
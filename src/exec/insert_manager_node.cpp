@@ -22,6 +22,7 @@
 #include "binlog_context.h"
 #include "auto_inc.h"
 #include "hll_common.h"
+#include "group_insert.h"
 #include <set>
 
 namespace baikaldb {
@@ -113,6 +114,95 @@ int InsertManagerNode::init_insert_info(InsertNode* insert_node, bool is_local)
     return 0;
 }
 
+bool InsertManagerNode::can_group_insert(RuntimeState* state) {
+    // replace/ignore/on dup key update的affected rows与冲突有关，无法按语句拆分
+    if (FLAGS_group_insert_window_us <= 0 || state->txn_id != 0 || _return_empty) {
+        return false;
+    }
+    if (_op_type != pb::OP_INSERT || _is_replace || _need_ignore || _on_dup_key_update) {
+        return false;
+    }
+    if (_sub_query_node != nullptr || _row_ttl_duration > 0 || state->open_binlog()) {
+        return false;
+    }
+    return _region_infos.size() == 1;
+}
+
+int InsertManagerNode::group_insert(RuntimeState* state) {
+    static bvar::Adder<int64_t> group_insert_merged_count("group_insert_merged_count");
+    static bvar::Adder<int64_t> group_insert_fallback_count("group_insert_fallback_count");
+    auto client_conn = state->client_conn();
+    if (client_conn == nullptr) {
+        DB_WARNING("connection is nullptr: %lu", state->txn_id);
+        return -1;
+    }
+    int64_t region_id = _region_infos.begin()->first;
+    DMLNode* insert_node = static_cast<DMLNode*>(_children[0]);
+    int64_t record_count = insert_node->insert_records_by_region()[region_id].size();
+    GroupInsert::Request request;
+    request.node = this;
+    std::vector<GroupInsert::Request*> group;
+    if (GroupInsert::get_instance()->join(region_id, &request, group) < 0) {
+        return DmlManagerNode::open(state);
+    }
+    if (group.empty()) {
+        // follower，记录已由leader写入
+        if (request.result == GroupInsert::DONE) {
+            client_conn->seq_id++;
+            push_cmd_to_cache(state, _op_type, insert_node);
+            return record_count;
+        }
+        if (request.result == GroupInsert::FAILED) {
+            state->error_code = request.error_code;
+            state->error_msg.str(request.error_msg);
+            return -1;
+        }
+        group_insert_fallback_count << 1;
+        return DmlManagerNode::open(state);
+    }
+    if (group.size() == 1) {
+        return DmlManagerNode::open(state);
+    }
+    // leader，合并同region的记录一次发送，结束后恢复自身的记录
+    auto& records = insert_node->insert_records_by_region()[region_id];
+    std::vector<SmartRecord> origin_records = records;
+    std::map<int64_t, pb::RegionInfo> origin_region_infos = _region_infos;
+    for (auto other : group) {
+        if (other == &request) {
+            continue;
+        }
+        DMLNode* other_node = static_cast<DMLNode*>(other->node->_children[0]);
+        auto& other_records = other_node->insert_records_by_region()[region_id];
+        records.insert(records.end(), other_records.begin(), other_records.end());
+    }
+    client_conn->seq_id++;
+    int ret = _fetcher_store.run(state, _region_infos, insert_node,
+            client_conn->seq_id, client_conn->seq_id, _op_type);
+    records.swap(origin_records);
+    _region_infos.swap(origin_region_infos);
+    if (ret < 0) {
+        GroupInsert::Result result = GroupInsert::fail_result(state->error_code);
+        DB_WARNING("group insert fail, region_id: %ld, statements: %lu, error_code: %d, "
+                "fallback: %d, log_id: %lu", region_id, group.size(), state->error_code,
+                result == GroupInsert::FALLBACK, state->log_id());
+        if (result == GroupInsert::FAILED) {
+            GroupInsert::get_instance()->finish(group, &request, result,
+                    state->error_code, state->error_msg.str());
+            return -1;
+        }
+        // 组内某条语句主键冲突，各自单独执行以返回准确的错误
+        GroupInsert::get_instance()->finish(group, &request, result);
+        group_insert_fallback_count << group.size();
+        state->error_code = ER_ERROR_FIRST;
+        state->error_msg.str("");
+        return DmlManagerNode::open(state);
+    }
+    GroupInsert::get_instance()->finish(group, &request, GroupInsert::DONE);
+    group_insert_merged_count << group.size();
+    push_cmd_to_cache(state, _op_type, insert_node);
+    return record_count;
+}
+
 int InsertManagerNode::subquery_open(RuntimeState* state) {
     int ret = 0;
     for (auto expr : _select_projections) {
@@ -287,7 +377,11 @@ int InsertManagerNode::open(RuntimeState* state) {
                 return ret;
             }
         }
-        ret = DmlManagerNode::open(state);
+        if (can_group_insert(state)) {
+            ret = group_insert(state);
+        } else {
+            ret = DmlManagerNode::open(state);
+        }
         if (ret >= 0) {
             if (process_binlog(state, true) < 0) {
                 return -1;
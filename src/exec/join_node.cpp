@@ -617,14 +617,15 @@ bool JoinNode::need_reorder(
         std::map<int32_t, ExecNode*>& tuple_join_child_map,
         std::map<int32_t, std::set<int32_t>>& tuple_equals_map, 
         std::vector<int32_t>& tuple_order,
-        std::vector<ExprNode*>& conditions) {
+        std::vector<ExprNode*>& conditions,
+        std::vector<std::pair<SlotRef*, SlotRef*>>& equal_slots) {
     if (_join_type != pb::INNER_JOIN) {
         return false;
     }
     for (auto& child : _children) {
         if (child->node_type() == pb::JOIN_NODE) {
             if (!static_cast<JoinNode*>(child)->need_reorder(
-                        tuple_join_child_map, tuple_equals_map, tuple_order, conditions)) {
+                        tuple_join_child_map, tuple_equals_map, tuple_order, conditions, equal_slots)) {
                 return false;
             }
         } else {
@@ -646,6 +647,8 @@ bool JoinNode::need_reorder(
         int32_t right_tuple_id = static_cast<SlotRef*>(_inner_equal_slot[i])->tuple_id();
         tuple_equals_map[left_tuple_id].insert(right_tuple_id);
         tuple_equals_map[right_tuple_id].insert(left_tuple_id);
+        equal_slots.emplace_back(static_cast<SlotRef*>(_outer_equal_slot[i]),
+                static_cast<SlotRef*>(_inner_equal_slot[i]));
     }
     return true;
 }
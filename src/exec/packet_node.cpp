@@ -21,6 +21,12 @@
 namespace baikaldb {
 DEFINE_int32(expect_bucket_count, 100, "expect_bucket_count");
 DEFINE_bool(field_charsetnr_set_by_client, false, "set charsetnr by client");
+// 流式发送时执行线程会等待客户端消费，期间store结果和内存仍被占用，默认关闭
+DEFINE_bool(enable_stream_result, false, "send large select result to client during execution");
+DEFINE_int64(stream_result_flush_size, 4 * 1024 * 1024LL,
+        "select result is sent to client when send_buf exceeds this size, 0 means disable");
+DEFINE_int64(stream_result_write_timeout_ms, 5000, "max time waiting for client to consume streamed result");
+DEFINE_bool(packet_projection_cse, true, "calc same select projections once per row");
 int PacketNode::init(const pb::PlanNode& node) {
     int ret = 0;
     ret = ExecNode::init(node);
@@ -328,6 +334,7 @@ int PacketNode::open(RuntimeState* state) {
             return ret;
         }
     }
+    find_same_projections();
     if (state->is_expr_subquery()) {
         return fatch_expr_subquery_results(state);
     }
@@ -394,6 +401,13 @@ int PacketNode::open(RuntimeState* state) {
                 DB_WARNING("pack_row fail:%d", ret);
                 return ret;
             }
+            if (state->stream_result && FLAGS_stream_result_flush_size > 0
+                    && _send_buf->_size >= (size_t)FLAGS_stream_result_flush_size) {
+                ret = stream_flush(state);
+                if (ret < 0) {
+                    return ret;
+                }
+            }
         }
     } while (!eos);
     //DB_WARNING("txn_id: %lu, pack_time: %ld", state->txn_id, pack_time);
@@ -401,6 +415,25 @@ int PacketNode::open(RuntimeState* state) {
     return 0;
 }
 
+int PacketNode::stream_flush(RuntimeState* state) {
+    static bvar::Adder<int64_t> stream_result_flush_count("stream_result_flush_count");
+    static bvar::Adder<int64_t> stream_result_bytes("stream_result_bytes");
+    if (_client == nullptr || _client->query_ctx == nullptr || _client->send_buf != _send_buf) {
+        return 0;
+    }
+    size_t size = _send_buf->_size;
+    int ret = _wrapper->stream_write(_client, FLAGS_stream_result_write_timeout_ms * 1000LL);
+    if (ret != RET_SUCCESS) {
+        DB_WARNING("stream write fail, ret: %d, log_id: %lu", ret, state->log_id());
+        state->error_code = ER_NET_ERROR_ON_WRITE;
+        state->error_msg << "send result to client fail";
+        return -1;
+    }
+    stream_result_flush_count << 1;
+    stream_result_bytes << size;
+    return 0;
+}
+
 int PacketNode::open_trace(RuntimeState* state) {
     bool eos = false;
     int ret = 0;
@@ -763,6 +796,52 @@ int PacketNode::pack_vector_row(const std::vector<std::string>& row) {
     return 0;
 }
 
+void PacketNode::find_same_projections() {
+    _same_projection_idx.clear();
+    _projection_values.clear();
+    if (!FLAGS_packet_projection_cse || _projections.size() < 2) {
+        return;
+    }
+    bool has_same = false;
+    std::vector<int> same_idx(_projections.size(), -1);
+    std::vector<std::string> signs(_projections.size());
+    for (size_t i = 0; i < _projections.size(); i++) {
+        ExprNode* expr = _projections[i];
+        // 字面量和列引用取值代价很小，无参函数每次结果不同
+        if (expr->is_literal() || expr->is_slot_ref() || expr->has_no_arg_function()) {
+            continue;
+        }
+        pb::Expr pb_expr;
+        ExprNode::create_pb_expr(&pb_expr, expr);
+        signs[i] = pb_expr.SerializeAsString();
+        for (size_t j = 0; j < i; j++) {
+            if (signs[j] == signs[i]) {
+                same_idx[i] = j;
+                has_same = true;
+                break;
+            }
+        }
+    }
+    if (has_same) {
+        _same_projection_idx.swap(same_idx);
+        _projection_values.resize(_projections.size());
+    }
+}
+
+ExprValue PacketNode::projection_value(size_t idx, MemRow* row) {
+    ExprNode* expr = _projections[idx];
+    if (_same_projection_idx.empty()) {
+        return expr->get_value(row).cast_to(expr->col_type());
+    }
+    // 按下标顺序取值，相同的投影已在本行算过
+    int same_idx = _same_projection_idx[idx];
+    if (same_idx >= 0) {
+        return _projection_values[same_idx];
+    }
+    _projection_values[idx] = expr->get_value(row).cast_to(expr->col_type());
+    return _projection_values[idx];
+}
+
 int PacketNode::pack_text_row(MemRow* row) {
     int start_pos = _send_buf->_size;
     uint8_t bytes[4];
@@ -776,8 +855,8 @@ int PacketNode::pack_text_row(MemRow* row) {
     }
 
     // package body.
-    for (auto expr : _projections) {
-        if (!_send_buf->append_text_value(expr->get_value(row).cast_to(expr->col_type()))) {
+    for (size_t i = 0; i < _projections.size(); i++) {
+        if (!_send_buf->append_text_value(projection_value(i, row))) {
             DB_FATAL("Failed to append table cell.");
             return -1;
         }
@@ -836,8 +915,8 @@ int PacketNode::pack_binary_row(MemRow* row) {
 
     int field_idx = 0;
     // package body.
-    for (auto expr : _projections) {
-        if (!_send_buf->append_binary_value(expr->get_value(row).cast_to(expr->col_type()),
+    for (size_t i = 0; i < _projections.size(); i++) {
+        if (!_send_buf->append_binary_value(projection_value(i, row),
                 _fields[field_idx].type, null_map.get(), field_idx, 2)) {
             DB_FATAL("Failed to append table cell.");
             return -1;
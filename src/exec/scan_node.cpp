@@ -509,6 +509,24 @@ int64_t AccessPathMgr::pre_process_select_index() {
 
 }
 
+int64_t AccessPathMgr::estimate_rows(int64_t index_id) {
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    if (factory->get_statistics_ptr(_table_id) == nullptr) {
+        return -1;
+    }
+    int64_t table_rows = factory->get_total_rows(_table_id);
+    auto iter = _paths.find(index_id);
+    if (iter == _paths.end() || iter->second == nullptr) {
+        return table_rows;
+    }
+    auto& path = iter->second;
+    path->calc_cost(nullptr, _filed_selectiy);
+    double selectivity = path->selectivity
+            * path->fields_to_selectivity(path->index_other_field_ids, _filed_selectiy)
+            * path->fields_to_selectivity(path->other_field_ids, _filed_selectiy);
+    return std::max((int64_t)(table_rows * selectivity), (int64_t)1);
+}
+
 int64_t AccessPathMgr::select_index() {
     int64_t select_idx = pre_process_select_index();
     if (select_idx == 0) {
@@ -22,6 +22,7 @@
 
 namespace baikaldb {
 DEFINE_bool(global_index_read_consistent, true, "double check for global and primary region consistency");
+DECLARE_bool(limit_wave_fanout);
 int SelectManagerNode::open(RuntimeState* state) {
     START_LOCAL_TRACE(get_trace(), state->get_trace_cost(), OPEN_TRACE, ([state](TraceLocalNode& local_node) {
         local_node.set_scan_rows(state->num_scan_rows());
@@ -152,6 +153,9 @@ int SelectManagerNode::single_fetcher_store_open(FetcherInfo* fetcher, RuntimeSt
     int ret = 0;
     // 如果命中的不是全局二级索引，或者全局二级索引是covering_index, 则直接在主表或者索引表上做scan即可
     if (router_index_id == main_table_id || scan_index_info->covering_index) {
+        if (can_use_limit_wave(state)) {
+            fetcher->fetcher_store.wave_limit = _limit;
+        }
         ret = fetcher->fetcher_store.run_not_set_state(state, fetcher->scan_index->region_infos, _children[0], 
                 client_conn->seq_id, client_conn->seq_id, pb::OP_SELECT, fetcher->global_backup_type);
     } else {
@@ -291,6 +295,23 @@ int SelectManagerNode::fetcher_store_run(RuntimeState* state, ExecNode* exec_nod
 
 }
 
+// 无排序无聚合的limit查询，任意region返回的行都可以满足limit，可以分批发送
+bool SelectManagerNode::can_use_limit_wave(RuntimeState* state) {
+    if (!FLAGS_limit_wave_fanout || _limit <= 0) {
+        return false;
+    }
+    if (state->txn_id != 0 || state->is_full_export || state->explain_type != EXPLAIN_NULL) {
+        return false;
+    }
+    if (!_slot_order_exprs.empty()) {
+        return false;
+    }
+    if (get_node(pb::AGG_NODE) != nullptr || get_node(pb::SORT_NODE) != nullptr) {
+        return false;
+    }
+    return true;
+}
+
 int SelectManagerNode::open_global_index(FetcherInfo* fetcher, RuntimeState* state, ExecNode* exec_node, 
         int64_t global_index_id, int64_t main_table_id) {
     RocksdbScanNode* scan_node = static_cast<RocksdbScanNode*>(exec_node);
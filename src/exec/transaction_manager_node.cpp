@@ -16,9 +16,94 @@
 #include "transaction_manager_node.h"
 #include "network_socket.h"
 #include "network_server.h"
+#include "store_interact.hpp"
 
 namespace baikaldb {
 DEFINE_int32(wait_after_prepare_us, 0, "wait time after prepare(us)");
+// async commit只保证本连接读到自己的写(下一条请求前wait_async_commit)。
+// 其他连接的读碰到secondary上prepare未提交的事务时不会通过primary决议，
+// 在后台commit完成前可能读到旧数据，需要跨连接读一致的业务不要打开
+DEFINE_bool(enable_async_commit, false, "multi-region txn is committed once all prepares succeed, "
+        "commit round runs in background; other sessions may read stale data until "
+        "the background commit finishes, default: false");
+DECLARE_int64(retry_interval_us);
+
+// 后台commit单个region，失败由store侧事务恢复兜底
+static bool async_commit_region(uint64_t txn_id, int seq_id, int64_t primary_region_id,
+        pb::RegionInfo info, uint64_t log_id) {
+    pb::StoreReq request;
+    request.set_op_type(pb::OP_COMMIT);
+    request.set_region_id(info.region_id());
+    request.set_region_version(info.version());
+    request.set_log_id(log_id);
+    pb::TransactionInfo* txn_info = request.add_txn_infos();
+    txn_info->set_txn_id(txn_id);
+    txn_info->set_seq_id(seq_id);
+    txn_info->set_start_seq_id(seq_id);
+    txn_info->set_optimize_1pc(false);
+    txn_info->set_primary_region_id(primary_region_id);
+    pb::PlanNode* pb_node = request.mutable_plan()->add_nodes();
+    pb_node->set_node_type(pb::TRANSACTION_NODE);
+    pb_node->set_limit(-1);
+    pb_node->set_num_children(0);
+    pb_node->mutable_derive_node()->mutable_transaction_node()->set_txn_cmd(pb::TXN_COMMIT_STORE);
+    for (int retry_times = 1; retry_times <= 5; ++retry_times) {
+        if (info.leader() == "0.0.0.0:0" || info.leader() == "") {
+            info.set_leader(rand_peer(info));
+        }
+        pb::StoreRes response;
+        StoreInteract interact(info.leader());
+        interact.send_request_for_leader(log_id, "query", request, response);
+        if (response.errcode() == pb::SUCCESS) {
+            return true;
+        }
+        if (response.errcode() == pb::TXN_IS_ROLLBACK) {
+            DB_WARNING("TransactionWarn: async commit txn is rollback, region_id: %ld, txn_id: %lu, log_id: %lu",
+                    info.region_id(), txn_id, log_id);
+            return false;
+        }
+        if (response.errcode() == pb::VERSION_OLD) {
+            for (auto& r : response.regions()) {
+                if (r.region_id() == info.region_id()) {
+                    info.CopyFrom(r);
+                    request.set_region_version(r.version());
+                }
+            }
+        } else if (response.errcode() == pb::NOT_LEADER && response.leader() != "0.0.0.0:0"
+                && response.leader() != "") {
+            info.set_leader(response.leader());
+        } else {
+            other_peer_to_leader(info);
+        }
+        bthread_usleep(retry_times * FLAGS_retry_interval_us);
+    }
+    DB_WARNING("TransactionWarn: async commit failed, wait for store recovery, region_id: %ld, "
+            "txn_id: %lu, log_id: %lu", info.region_id(), txn_id, log_id);
+    return false;
+}
+
+// primary先提交，再并发提交secondary，与同步commit顺序一致
+// primary提交失败时不提交secondary，secondary通过查询primary决议，
+// 保证primary的事务还在时没有secondary先提交
+static void async_commit_regions(uint64_t txn_id, int seq_id, int64_t primary_region_id,
+        const std::map<int64_t, pb::RegionInfo>& region_infos, uint64_t log_id) {
+    auto iter = region_infos.find(primary_region_id);
+    if (iter != region_infos.end()
+            && !async_commit_region(txn_id, seq_id, primary_region_id, iter->second, log_id)) {
+        return;
+    }
+    ConcurrencyBthread commit_bth(region_infos.size(), &BTHREAD_ATTR_SMALL);
+    for (auto& pair : region_infos) {
+        if (pair.first == primary_region_id) {
+            continue;
+        }
+        const pb::RegionInfo& info = pair.second;
+        commit_bth.run([txn_id, seq_id, primary_region_id, &info, log_id]() {
+            async_commit_region(txn_id, seq_id, primary_region_id, info, log_id);
+        });
+    }
+    commit_bth.join();
+}
 
 int TransactionManagerNode::exec_begin_node(RuntimeState* state, ExecNode* begin_node) {
     auto client_conn = state->client_conn();
@@ -35,6 +120,9 @@ int TransactionManagerNode::exec_prepared_node(RuntimeState* state, ExecNode* pr
         state->set_optimize_1pc(true);
         DB_WARNING("enable optimize_1pc: txn_id: %lu, start_seq_id: %d seq_id: %d, log_id: %lu", 
                 state->txn_id, start_seq_id, client_conn->seq_id, log_id);
+    } else if (FLAGS_enable_async_commit && !state->open_binlog()) {
+        // binlog需要commit_ts，不走async commit
+        state->set_async_commit(true);
     }
     return _fetcher_store.run(state, client_conn->region_infos, prepared_node, start_seq_id,
                    client_conn->seq_id, pb::OP_PREPARE); 
@@ -51,6 +139,30 @@ int TransactionManagerNode::exec_commit_node(RuntimeState* state, ExecNode* comm
         bthread_usleep(FLAGS_wait_after_prepare_us);
     }
     int seq_id = client_conn->seq_id;
+    if (state->async_commit() && client_conn->primary_region_id != -1) {
+        // 所有prepare已持久化，事务已提交，commit在后台执行
+        // 下一条请求执行前等待后台commit完成
+        if (client_conn->async_commit_cond == nullptr) {
+            client_conn->async_commit_cond = std::make_shared<BthreadCond>();
+        }
+        std::shared_ptr<BthreadCond> cond = client_conn->async_commit_cond;
+        std::map<int64_t, pb::RegionInfo> region_infos;
+        {
+            BAIDU_SCOPED_LOCK(client_conn->region_lock);
+            region_infos = client_conn->region_infos;
+        }
+        uint64_t txn_id = state->txn_id;
+        int64_t primary_region_id = client_conn->primary_region_id;
+        uint64_t log_id = state->log_id();
+        cond->increase();
+        Bthread bth(&BTHREAD_ATTR_SMALL);
+        bth.run([txn_id, seq_id, primary_region_id, region_infos, log_id, cond]() {
+            async_commit_regions(txn_id, seq_id, primary_region_id, region_infos, log_id);
+            cond->decrease_signal();
+        });
+        client_conn->primary_region_id = -1;
+        return 0;
+    }
     int ret = _fetcher_store.run(state, client_conn->region_infos, commit_node, seq_id, seq_id, pb::OP_COMMIT);
     if (ret < 0) {
         // un-expected case since infinite retry of commit after prepare
@@ -13,9 +13,11 @@
 // limitations under the License.
 
 #include "agg_fn_call.h"
+#include <limits>
 #include <unordered_map>
 #include "hll_common.h"
 #include "slot_ref.h"
+#include <arrow/api.h>
 
 namespace baikaldb {
 
@@ -817,6 +819,116 @@ int AggFnCall::merge(const std::string& key, MemRow* src, MemRow* dst, int64_t&
             return -1;
     }
 }
+static inline void set_column_value(ExprValue& value, int64_t val) {
+    value._u.int64_val = val;
+}
+static inline void set_column_value(ExprValue& value, uint64_t val) {
+    value._u.uint64_val = val;
+}
+static inline void set_column_value(ExprValue& value, double val) {
+    value._u.double_val = val;
+}
+
+// 一次遍历计算非null值的个数、和、最小值、最大值；无null时走可向量化的循环
+template <typename ArrayType, typename T>
+static int64_t column_stat(const arrow::Array* column, pb::PrimitiveType type,
+        ExprValue& sum, ExprValue& min, ExprValue& max) {
+    const ArrayType* array = static_cast<const ArrayType*>(column);
+    const T* values = array->raw_values();
+    int64_t length = array->length();
+    int64_t valid_count = length - array->null_count();
+    if (valid_count == 0) {
+        return 0;
+    }
+    T sum_val = 0;
+    T min_val = std::numeric_limits<T>::max();
+    T max_val = std::numeric_limits<T>::lowest();
+    if (array->null_count() == 0) {
+        for (int64_t i = 0; i < length; i++) {
+            sum_val += values[i];
+            min_val = values[i] < min_val ? values[i] : min_val;
+            max_val = values[i] > max_val ? values[i] : max_val;
+        }
+    } else {
+        for (int64_t i = 0; i < length; i++) {
+            if (array->IsNull(i)) {
+                continue;
+            }
+            sum_val += values[i];
+            min_val = values[i] < min_val ? values[i] : min_val;
+            max_val = values[i] > max_val ? values[i] : max_val;
+        }
+    }
+    sum = ExprValue(type);
+    min = ExprValue(type);
+    max = ExprValue(type);
+    set_column_value(sum, sum_val);
+    set_column_value(min, min_val);
+    set_column_value(max, max_val);
+    return valid_count;
+}
+
+int AggFnCall::update_by_column(const arrow::Array* column, int64_t num_rows, MemRow* dst) {
+    if (_agg_type == COUNT_STAR || _agg_type == COUNT) {
+        int64_t count = num_rows;
+        if (_agg_type == COUNT) {
+            count = column->length() - column->null_count();
+        }
+        ExprValue result = dst->get_value(_tuple_id, _intermediate_slot_id);
+        result._u.int64_val += count;
+        dst->set_value(_tuple_id, _intermediate_slot_id, result);
+        return 0;
+    }
+    ExprValue sum;
+    ExprValue min;
+    ExprValue max;
+    int64_t valid_count = 0;
+    switch (column->type_id()) {
+        case arrow::Type::INT64:
+            valid_count = column_stat<arrow::Int64Array, int64_t>(column, pb::INT64, sum, min, max);
+            break;
+        case arrow::Type::UINT64:
+            valid_count = column_stat<arrow::UInt64Array, uint64_t>(column, pb::UINT64, sum, min, max);
+            break;
+        case arrow::Type::DOUBLE:
+            valid_count = column_stat<arrow::DoubleArray, double>(column, pb::DOUBLE, sum, min, max);
+            break;
+        default:
+            DB_WARNING("not support arrow type: %d", column->type_id());
+            return -1;
+    }
+    if (valid_count == 0) {
+        return 0;
+    }
+    // 与update逐行更新的语义一致
+    ExprValue result = dst->get_value(_tuple_id, _intermediate_slot_id);
+    switch (_agg_type) {
+        case SUM:
+            // 结果slot类型为sum的类型(INT64/DOUBLE)，与逐行update写入后的类型一致
+            sum.cast_to(_col_type);
+            result.add(sum);
+            dst->set_value(_tuple_id, _intermediate_slot_id, result);
+            break;
+        case MIN:
+            min.cast_to(_col_type);
+            result.cast_to(_col_type);
+            if (result.is_null() || result.compare(min) > 0) {
+                dst->set_value(_tuple_id, _intermediate_slot_id, min);
+            }
+            break;
+        case MAX:
+            max.cast_to(_col_type);
+            result.cast_to(_col_type);
+            if (result.is_null() || result.compare(max) < 0) {
+                dst->set_value(_tuple_id, _intermediate_slot_id, max);
+            }
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
 int AggFnCall::finalize(const std::string& key, MemRow* dst) {
     if (_agg_type == GROUP_CONCAT && _mem_row_compare != nullptr) {
         auto& intermediate_row_batch = _intermediate_row_batch_map[key];
@@ -22,6 +22,7 @@
 
 namespace baikaldb {
 bvar::Adder<int64_t> ExprNode::_s_non_boolean_sql_cnts{"non_boolean_sql_cnts"};
+
 // only pre_calc children nodes
 void ExprNode::const_pre_calc() {
     if (_children.size() == 0 || _node_type == pb::AGG_EXPR) {
@@ -46,7 +47,9 @@ void ExprNode::const_pre_calc() {
     }
     //const表达式等着父节点来替换
     //root是const表达式则外部替换
-    if (!is_row_expr() && is_constant()) {
+    //含place holder的const表达式不会被整体替换，继续替换其中不含place holder的常量子树
+    bool has_place_holder_parent = !is_row_expr() && is_constant() && has_place_holder();
+    if (!is_row_expr() && is_constant() && !has_place_holder_parent) {
         return;
     }
     int ret = 0;
@@ -66,6 +69,10 @@ void ExprNode::const_pre_calc() {
         if (c->has_place_holder()) {
             continue;
         }
+        // prepare复用计划时无参函数不能提前计算
+        if (has_place_holder_parent && c->has_no_arg_function()) {
+            continue;
+        }
         //替换,常量表达式优先类型推导
         ret = c->type_inferer();
         if (ret < 0) {
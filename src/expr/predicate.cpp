@@ -15,10 +15,14 @@
 #include "predicate.h"
 #include "parser.h"
 #include <boost/algorithm/string.hpp>
+#include <string.h>
+#include <algorithm>
 
 namespace baikaldb {
 
 DEFINE_bool(like_predicate_use_re2, false, "LikePredicate use re2");
+DEFINE_bool(like_predicate_literal_match, true, "LikePredicate match literal const pattern by bytes");
+DEFINE_int32(in_predicate_binary_search_max, 16, "InPredicate use binary search when int values not more than this");
 
 int InPredicate::open() {
     int ret = 0;
@@ -140,9 +144,20 @@ int InPredicate::singel_open() {
             }
         }
     }
+    if (!_int_set.empty() && (int)_int_set.size() <= FLAGS_in_predicate_binary_search_max) {
+        _sorted_ints.assign(_int_set.begin(), _int_set.end());
+        std::sort(_sorted_ints.begin(), _sorted_ints.end());
+    }
     return 0;
 }
 
+bool InPredicate::find_int(int64_t value) {
+    if (!_sorted_ints.empty()) {
+        return std::binary_search(_sorted_ints.begin(), _sorted_ints.end(), value);
+    }
+    return _int_set.count(value) == 1;
+}
+
 ExprValue InPredicate::get_value(MemRow* row) {
     if (_is_row_expr) {
         auto v = make_key(children(0), row);
@@ -164,7 +179,7 @@ ExprValue InPredicate::get_value(MemRow* row) {
         case pb::DATETIME:
         case pb::TIME:
         case pb::DATE:
-            if (_int_set.count(value.cast_to(_map_type).get_numberic<int64_t>()) == 1) {
+            if (find_int(value.cast_to(_map_type).get_numberic<int64_t>())) {
                 return ExprValue::True();
             }
             break;
@@ -232,6 +247,7 @@ int LikePredicate::open_by_pattern() {
                 split_pattern.swap(_patterns);
             }
         }
+        compile_literal_matchers();
     } else {
         _const_pattern = false;
     }
@@ -269,12 +285,119 @@ int LikePredicate::open_by_re2() {
     }
     if (slot_ids.size() == 0) {
         reset_regex(nullptr);
+        // exact like大小写不敏感，仍然走re2
+        if (_fn.fn_op() != parser::FT_EXACT_LIKE) {
+            reset_pattern(nullptr);
+            compile_literal_matchers();
+        }
     } else {
         _const_regex = false;
     }
     return 0;
 }
 
+void LikePredicate::compile_literal_matchers() {
+    _literal_matchers.clear();
+    if (!FLAGS_like_predicate_literal_match || charset() == pb::GBK) {
+        return;
+    }
+    std::vector<std::string> patterns = _patterns;
+    if (patterns.empty()) {
+        patterns.emplace_back(_pattern);
+    }
+    for (auto& pattern : patterns) {
+        LiteralMatcher matcher;
+        if (!matcher.compile(pattern, _escape_char)) {
+            _literal_matchers.clear();
+            return;
+        }
+        _literal_matchers.emplace_back(std::move(matcher));
+    }
+}
+
+bool LikePredicate::literal_match(const std::string& target) {
+    for (auto& matcher : _literal_matchers) {
+        if (matcher.match(target.data(), target.size())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LikePredicate::LiteralMatcher::compile(const std::string& pattern, char escape_char) {
+    segments.clear();
+    segments.emplace_back();
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '_') {
+            return false;
+        } else if (c == '%') {
+            segments.emplace_back();
+        } else if (c == escape_char && i + 1 < pattern.size()) {
+            segments.back().append(1, pattern[++i]);
+        } else {
+            segments.back().append(1, c);
+        }
+    }
+    if (segments.size() == 1) {
+        type = EXACT;
+    } else if (segments.size() == 2 && segments.back().empty()) {
+        type = PREFIX;
+    } else if (segments.size() == 2 && segments.front().empty()) {
+        type = SUFFIX;
+    } else if (segments.size() == 3 && segments.front().empty() && segments.back().empty()) {
+        type = INFIX;
+    } else {
+        type = SEGMENTS;
+    }
+    return true;
+}
+
+bool LikePredicate::LiteralMatcher::match(const char* data, size_t size) const {
+    const std::string& head = segments.front();
+    const std::string& tail = segments.back();
+    switch (type) {
+    case EXACT:
+        return size == head.size() && memcmp(data, head.data(), size) == 0;
+    case PREFIX:
+        return size >= head.size() && memcmp(data, head.data(), head.size()) == 0;
+    case SUFFIX:
+        return size >= tail.size() && memcmp(data + size - tail.size(), tail.data(), tail.size()) == 0;
+    case INFIX: {
+        // glibc的memchr/memmem有向量化实现
+        const std::string& infix = segments[1];
+        if (infix.size() == 1) {
+            return memchr(data, infix[0], size) != nullptr;
+        }
+        return memmem(data, size, infix.data(), infix.size()) != nullptr;
+    }
+    default:
+        break;
+    }
+    if (size < head.size() + tail.size()) {
+        return false;
+    }
+    if (memcmp(data, head.data(), head.size()) != 0 ||
+            memcmp(data + size - tail.size(), tail.data(), tail.size()) != 0) {
+        return false;
+    }
+    // 中间的segment只需按顺序不重叠出现，贪心取最左的匹配位置
+    const char* pos = data + head.size();
+    const char* end = data + size - tail.size();
+    for (size_t i = 1; i + 1 < segments.size(); ++i) {
+        const std::string& seg = segments[i];
+        if (seg.empty()) {
+            continue;
+        }
+        const char* found = (const char*)memmem(pos, end - pos, seg.data(), seg.size());
+        if (found == nullptr) {
+            return false;
+        }
+        pos = found + seg.size();
+    }
+    return true;
+}
+
 void LikePredicate::covent_pattern(const std::string& pattern) {
     bool is_escaped = false;
     static std::set<char> need_escape_set = {
@@ -344,6 +467,10 @@ ExprValue LikePredicate::get_value_by_re2(MemRow* row) {
     ExprValue value = children(0)->get_value(row);
     value.cast_to(pb::STRING);
     ExprValue ret(pb::BOOL);
+    if (_const_regex && !_literal_matchers.empty()) {
+        ret._u.bool_val = literal_match(value.str_val);
+        return ret;
+    }
     try {
         ret._u.bool_val = RE2::FullMatch(value.str_val, *_regex_ptr);
         if (_regex_ptr->error_code() != 0) {
@@ -433,7 +560,9 @@ ExprValue LikePredicate::get_value_by_pattern(MemRow* row) {
     target.cast_to(pb::STRING);
     ExprValue ret(pb::BOOL);
     ret._u.bool_val = false;
-    if (!_const_pattern || _patterns.size() == 0) {
+    if (_const_pattern && !_literal_matchers.empty()) {
+        ret._u.bool_val = literal_match(target.str_val);
+    } else if (!_const_pattern || _patterns.size() == 0) {
         ret._u.bool_val = like_one(target.str_val, _pattern, charset());
     } else {
         for (auto& pattern : _patterns) {
@@ -20,6 +20,7 @@
 
 namespace baikaldb {
 DEFINE_bool(open_nonboolean_sql_forbid, false, "open nonboolean sqls forbid default:false");
+DEFINE_bool(scalar_fn_typed_binary, true, "calc numeric binary operators without fn call");
 int ScalarFnCall::init(const pb::ExprNode& node) {
     int ret = 0;
     ret = ExprNode::init(node);
@@ -183,9 +184,106 @@ int ScalarFnCall::open() {
     if (node_type() == pb::FUNCTION_CALL && _fn_call == NULL) {
         DB_WARNING("fn call is null, name:%s", _fn.name().c_str());
     }
+    _typed_arg_type = pb::INVALID_TYPE;
+    if (!FLAGS_scalar_fn_typed_binary || _is_row_expr || _fn_call == NULL ||
+            node_type() != pb::FUNCTION_CALL || _children.size() != 2 ||
+            _fn.arg_types_size() != 2 || _fn.arg_types(0) != _fn.arg_types(1)) {
+        return 0;
+    }
+    pb::PrimitiveType arg_type = _fn.arg_types(0);
+    if (arg_type != pb::INT64 && arg_type != pb::UINT64 && arg_type != pb::DOUBLE) {
+        return 0;
+    }
+    // 结果类型与函数返回类型一致，保证与通用路径最后的cast_to结果相同
+    switch (_fn.fn_op()) {
+        case parser::FT_ADD:
+        case parser::FT_MINUS:
+        case parser::FT_MULTIPLIES:
+            if (_col_type == arg_type && _fn.return_type() == arg_type) {
+                _typed_arg_type = arg_type;
+            }
+            break;
+        case parser::FT_EQ:
+        case parser::FT_NE:
+        case parser::FT_GT:
+        case parser::FT_GE:
+        case parser::FT_LT:
+        case parser::FT_LE:
+            if (_col_type == pb::BOOL && _fn.return_type() == pb::BOOL) {
+                _typed_arg_type = arg_type;
+            }
+            break;
+        default:
+            break;
+    }
     return 0;
 }
 
+static inline void set_typed_value(ExprValue& value, int64_t val) {
+    value._u.int64_val = val;
+}
+static inline void set_typed_value(ExprValue& value, uint64_t val) {
+    value._u.uint64_val = val;
+}
+static inline void set_typed_value(ExprValue& value, double val) {
+    value._u.double_val = val;
+}
+
+template <typename T>
+static ExprValue typed_binary_calc(int32_t fn_op, pb::PrimitiveType type, T left, T right) {
+    switch (fn_op) {
+        case parser::FT_EQ:
+            return left == right ? ExprValue::True() : ExprValue::False();
+        case parser::FT_NE:
+            return left != right ? ExprValue::True() : ExprValue::False();
+        case parser::FT_GT:
+            return left > right ? ExprValue::True() : ExprValue::False();
+        case parser::FT_GE:
+            return left >= right ? ExprValue::True() : ExprValue::False();
+        case parser::FT_LT:
+            return left < right ? ExprValue::True() : ExprValue::False();
+        case parser::FT_LE:
+            return left <= right ? ExprValue::True() : ExprValue::False();
+        default:
+            break;
+    }
+    ExprValue ret(type);
+    switch (fn_op) {
+        case parser::FT_ADD:
+            set_typed_value(ret, left + right);
+            break;
+        case parser::FT_MINUS:
+            set_typed_value(ret, left - right);
+            break;
+        case parser::FT_MULTIPLIES:
+            set_typed_value(ret, left * right);
+            break;
+        default:
+            return ExprValue::Null();
+    }
+    return ret;
+}
+
+ExprValue ScalarFnCall::typed_binary_value(MemRow* row) {
+    ExprValue left = _children[0]->get_value(row);
+    ExprValue right = _children[1]->get_value(row);
+    if (left.is_null() || right.is_null()) {
+        return ExprValue::Null();
+    }
+    left.cast_to(_typed_arg_type);
+    right.cast_to(_typed_arg_type);
+    switch (_typed_arg_type) {
+        case pb::INT64:
+            return typed_binary_calc(_fn.fn_op(), _typed_arg_type, left._u.int64_val, right._u.int64_val);
+        case pb::UINT64:
+            return typed_binary_calc(_fn.fn_op(), _typed_arg_type, left._u.uint64_val, right._u.uint64_val);
+        case pb::DOUBLE:
+            return typed_binary_calc(_fn.fn_op(), _typed_arg_type, left._u.double_val, right._u.double_val);
+        default:
+            return ExprValue::Null();
+    }
+}
+
 ExprValue ScalarFnCall::get_value(MemRow* row) {
     if (_is_row_expr) {
         switch (_fn.fn_op()) {
@@ -205,6 +303,9 @@ ExprValue ScalarFnCall::get_value(MemRow* row) {
                 return ExprValue::Null();
         }
     }
+    if (_typed_arg_type != pb::INVALID_TYPE) {
+        return typed_binary_value(row);
+    }
     if (_fn_call == NULL) {
         return ExprValue::Null();
     }
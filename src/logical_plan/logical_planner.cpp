@@ -586,6 +586,9 @@ int LogicalPlanner::gen_subquery_plan(parser::DmlNode* subquery, const SmartPlan
         DB_WARNING("gen plan failed, type:%d", _cur_sub_ctx->stmt_type);
         return -1;
     }
+    if (_cur_sub_ctx->has_non_deterministic_expr) {
+        _ctx->has_non_deterministic_expr = true;
+    }
     if (_ctx->stat_info.family.empty()) {
         _ctx->stat_info.family = _cur_sub_ctx->stat_info.family;
     }
@@ -1615,6 +1618,15 @@ int LogicalPlanner::create_scala_func_expr(const parser::FuncExpr* item,
         pb::Expr& expr, parser::FuncType op, const CreateExprOptions& options) {
     if (op == parser::FT_COMMON) {
         std::string lower_fn_name = item->fn_name.to_lower();
+        // 结果随时间或session变化的函数，包括下面直接替换为常量的session函数
+        static const std::unordered_set<std::string> non_deterministic_fns = {
+            "rand", "now", "sysdate", "utc_timestamp", "curdate", "current_date",
+            "curtime", "current_time", "current_timestamp", "last_insert_id",
+            "user", "session_user", "system_user"};
+        if (non_deterministic_fns.count(lower_fn_name) == 1
+                || (lower_fn_name == "unix_timestamp" && item->children.size() == 0)) {
+            _ctx->has_non_deterministic_expr = true;
+        }
         if (lower_fn_name == "last_insert_id" && item->children.size() == 0) {
             pb::ExprNode* node = expr.add_nodes();
             node->set_node_type(pb::INT_LITERAL);
@@ -2467,6 +2479,7 @@ int LogicalPlanner::create_term_slot_ref_node(
         vars = &client->user_vars;
     }
     if (vars != nullptr) {
+        _ctx->has_non_deterministic_expr = true;
         auto iter = vars->find(var_name);
         pb::ExprNode* node = expr.add_nodes();
         if (iter != vars->end()) {
@@ -178,6 +178,7 @@ int PreparePlanner::stmt_prepare(const std::string& stmt_name, const std::string
     case parser::NT_SELECT:
         planner.reset(new SelectPlanner(prepare_ctx.get()));
         prepare_ctx->is_select = true;
+        prepare_ctx->point_query = std::make_shared<PointQueryPlan>();
         break;
     case parser::NT_INSERT:
         planner.reset(new InsertPlanner(prepare_ctx.get()));
@@ -276,6 +277,7 @@ int PreparePlanner::stmt_execute(const std::string& stmt_name, std::vector<pb::E
         _ctx->runtime_state = prepare_ctx->runtime_state;
         _ctx->root = prepare_ctx->root;
         _ctx->placeholders = prepare_ctx->placeholders;
+        _ctx->point_query = prepare_ctx->point_query;
     }
 
     for (size_t idx = 0; idx < params.size(); ++idx) {
@@ -1670,6 +1670,31 @@ int ClusterManager::load_snapshot() {
     }
     return 0;
 }
+int ClusterManager::select_instance_min_load(const IdcInfo& idc,
+                                             const std::set<std::string>& exclude_stores,
+                                             std::string& selected_instance) {
+    selected_instance.clear();
+    int64_t min_load = INT_FAST64_MAX;
+    BAIDU_SCOPED_LOCK(_instance_mutex);
+    if (_resource_tag_instance_map.count(idc.resource_tag) == 0) {
+        DB_WARNING("there is no instance, idc: %s", idc.to_string().c_str());
+        return -1;
+    }
+    for (auto& instance : _resource_tag_instance_map[idc.resource_tag]) {
+        if (!is_legal_for_select_instance(idc, instance, exclude_stores)) {
+            continue;
+        }
+        if (_instance_info[instance].leader_load < min_load) {
+            min_load = _instance_info[instance].leader_load;
+            selected_instance = instance;
+        }
+    }
+    if (selected_instance.empty()) {
+        return -1;
+    }
+    return 0;
+}
+
 bool ClusterManager::is_legal_for_select_instance(
             const IdcInfo& idc,
             const std::string& candicate_instance,
@@ -1855,6 +1880,7 @@ int ClusterManager::update_instance_info(const pb::InstanceInfo& instance_info)
     is.raft_total_qps = instance_info.raft_total_qps();
     is.select_latency = instance_info.select_latency();
     is.select_qps = instance_info.select_qps();
+    is.leader_load = instance_info.leader_load();
     is.instance_status.timestamp = butil::gettimeofday_us();
     int64_t store_rocks_check_cost = instance_info.rocks_hang_check_cost();
     auto& status = is.instance_status.state;
@@ -30,6 +30,12 @@ DECLARE_int32(region_faulty_interval_times);
 DEFINE_int64(modify_learner_peer_interval_us, 100 * 1000 * 1000LL, "modify learner peer interval");
 DEFINE_int32(balance_add_peer_num, 10, "add peer num each time, default(10)");
 DEFINE_int32(binlog_keep_days, 7, "binlog keep days, default(7)");
+DEFINE_bool(enable_hot_region_balance, false, "transfer leader or peer of hot region away from overloaded store");
+DEFINE_int64(hot_region_balance_ratio, 30, "store is hot when leader load > (100 + ratio)% of average");
+DEFINE_int64(hot_instance_min_load, 200 * 1000LL, "min leader load(exec time us per second) of hot store");
+DEFINE_int32(hot_region_max_move, 2, "max hot region leader/peer moves per heartbeat");
+DEFINE_int64(hot_region_add_peer_timeout_us, 600 * 1000 * 1000LL,
+        "clear hot region remove-peer mark when add peer not done in time");
 BRPC_VALIDATE_GFLAG(balance_add_peer_num, brpc::PositiveInteger);
 BRPC_VALIDATE_GFLAG(binlog_keep_days, brpc::NonNegativeInteger);
 
@@ -1101,6 +1107,12 @@ void RegionManager::leader_load_balance(bool whether_can_decide,
     
     leader_main_logical_room_check(request, response, leader_idc, table_replica, table_main_idc, trans_leader_region_ids);
 
+    // 热点调度不依赖leader数量是否均衡
+    if (FLAGS_enable_hot_region_balance && whether_can_decide && load_balance
+            && instance_status == pb::NORMAL) {
+        hot_region_load_balance(instance, request, leader_idc, trans_leader_region_ids, response);
+    }
+
     if (!request->need_leader_balance() && 
             instance_status != pb::MIGRATE && instance_status != pb::SLOW) {
         return;
@@ -1282,6 +1294,115 @@ void RegionManager::leader_load_balance(bool whether_can_decide,
     }
 }
 
+void RegionManager::hot_region_load_balance(const std::string& instance,
+            const pb::StoreHeartBeatRequest* request,
+            const IdcInfo& leader_idc,
+            std::set<int64_t>& trans_leader_region_ids,
+            pb::StoreHeartBeatResponse* response) {
+    ClusterManager* cluster_manager = ClusterManager::get_instance();
+    int64_t instance_load = request->instance_info().leader_load();
+    int64_t average_load = cluster_manager->get_average_leader_load(leader_idc.resource_tag);
+    int64_t high_load = average_load * (100 + FLAGS_hot_region_balance_ratio) / 100;
+    if (instance_load < FLAGS_hot_instance_min_load || instance_load <= high_load) {
+        return;
+    }
+    DB_WARNING("hot instance: %s, leader_load: %ld, average_load: %ld",
+                instance.c_str(), instance_load, average_load);
+    // 负载从高到低处理
+    std::vector<std::pair<int64_t, const pb::LeaderHeartBeat*>> hot_regions;
+    for (auto& leader_region : request->leader_regions()) {
+        int64_t region_load = leader_region.load().exec_time_us();
+        if (region_load > 0) {
+            hot_regions.emplace_back(region_load, &leader_region);
+        }
+    }
+    std::sort(hot_regions.begin(), hot_regions.end(),
+        [](const std::pair<int64_t, const pb::LeaderHeartBeat*>& left,
+           const std::pair<int64_t, const pb::LeaderHeartBeat*>& right) {
+            return left.first > right.first;
+        });
+    std::set<int64_t> binlog_table_ids;
+    TableManager::get_instance()->get_binlog_table_ids(binlog_table_ids);
+    // leader只在本逻辑机房内迁移，peer在本物理机房内迁移，不改变副本分布
+    IdcInfo leader_room(leader_idc.resource_tag, leader_idc.logical_room, "");
+    int32_t move_count = 0;
+    for (auto& hot_region : hot_regions) {
+        if (instance_load <= high_load || move_count >= FLAGS_hot_region_max_move) {
+            break;
+        }
+        int64_t region_load = hot_region.first;
+        const pb::LeaderHeartBeat& leader_region = *hot_region.second;
+        int64_t table_id = leader_region.region().table_id();
+        int64_t region_id = leader_region.region().region_id();
+        if (leader_region.status() != pb::IDLE || trans_leader_region_ids.count(region_id) > 0) {
+            continue;
+        }
+        int64_t replica_num = 0;
+        if (TableManager::get_instance()->get_replica_num(table_id, replica_num) < 0
+                || leader_region.region().peers_size() != replica_num) {
+            continue;
+        }
+        // 迁移后目标实例的负载仍需低于本实例，否则只是转移热点
+        int64_t max_target_load = instance_load - 2 * region_load;
+        std::string transfer_to_peer;
+        int64_t min_peer_load = INT_FAST64_MAX;
+        for (auto& peer : leader_region.region().peers()) {
+            if (peer == instance || cluster_manager->get_instance_status(peer) != pb::NORMAL) {
+                continue;
+            }
+            IdcInfo peer_idc;
+            if (cluster_manager->get_instance_idc(peer, peer_idc) < 0 || !peer_idc.match(leader_room)) {
+                continue;
+            }
+            int64_t peer_load = cluster_manager->get_leader_load(peer);
+            if (peer_load < min_peer_load) {
+                transfer_to_peer = peer;
+                min_peer_load = peer_load;
+            }
+        }
+        std::string target_instance;
+        if (!transfer_to_peer.empty() && min_peer_load < max_target_load) {
+            pb::TransLeaderRequest transfer_request;
+            transfer_request.set_table_id(table_id);
+            transfer_request.set_region_id(region_id);
+            transfer_request.set_old_leader(instance);
+            transfer_request.set_new_leader(transfer_to_peer);
+            *(response->add_trans_leader()) = transfer_request;
+            trans_leader_region_ids.insert(region_id);
+            add_leader_count(transfer_to_peer, table_id);
+            target_instance = transfer_to_peer;
+        } else if (binlog_table_ids.count(table_id) == 0) {
+            // follower也都是热点，把本实例上的peer迁到负载最低的实例
+            std::set<std::string> exclude_stores(leader_region.region().peers().begin(),
+                                                 leader_region.region().peers().end());
+            std::string new_instance;
+            if (cluster_manager->select_instance_min_load(leader_idc, exclude_stores, new_instance) < 0
+                    || cluster_manager->get_leader_load(new_instance) >= max_target_load) {
+                continue;
+            }
+            pb::AddPeer* add_peer = response->add_add_peers();
+            add_peer->set_region_id(region_id);
+            for (auto& peer : leader_region.region().peers()) {
+                add_peer->add_old_peers(peer);
+                add_peer->add_new_peers(peer);
+            }
+            add_peer->add_new_peers(new_instance);
+            add_remove_peer_on_hot(region_id, instance);
+            trans_leader_region_ids.insert(region_id);
+            target_instance = new_instance;
+        } else {
+            continue;
+        }
+        instance_load -= region_load;
+        cluster_manager->add_leader_load(instance, -region_load);
+        cluster_manager->add_leader_load(target_instance, region_load);
+        ++move_count;
+        DB_WARNING("hot region balance, instance: %s, region_id: %ld, region_load: %ld, "
+                    "target: %s, is_trans_leader: %d", instance.c_str(), region_id, region_load,
+                    target_instance.c_str(), target_instance == transfer_to_peer);
+    }
+}
+
 /*
  * pk_prefix_add_peer_counts:   pk_prefix_key -> 需要add peer的数量
  * pk_prefix_regions:           pk_prefix_key -> region_id list
@@ -1662,6 +1783,22 @@ void RegionManager::update_binlog_status(const pb::StoreHeartBeatRequest* reques
 }
  
 void RegionManager::update_leader_status(const pb::StoreHeartBeatRequest* request, int64_t timestamp) {
+    // 休眠的leader只上报region_id，沿用上次上报的peer列表刷新时间戳
+    for (auto region_id : request->hibernated_leader_region_ids()) {
+        if (get_region_info(region_id) == nullptr) {
+            DB_WARNING("master region info is nullptr when update status %ld.", region_id);
+            continue;
+        }
+        RegionStateInfo region_state;
+        region_state.timestamp = timestamp;
+        region_state.status = pb::NORMAL;
+        _region_state_map.set(region_id, region_state);
+        _region_peer_state_map.update(region_id, [timestamp](RegionPeerState& peer_state) {
+            for (auto& peer_status : peer_state.legal_peers_state) {
+                peer_status.set_timestamp(timestamp);
+            }
+        });
+    }
     for (auto& leader_region : request->leader_regions()) {
         int64_t region_id = leader_region.region().region_id();
         auto master_region_info = get_region_info(region_id);
@@ -2344,6 +2481,10 @@ void RegionManager::check_peer_count(int64_t region_id,
             return;
         }
     }
+    if (leader_region_info.peers_size() <= replica_num) {
+        // 热点迁移的add peer失败时，标记不能一直残留
+        clear_remove_peer_on_hot_if_expired(region_id, FLAGS_hot_region_add_peer_timeout_us);
+    }
     //选择一个peer被remove
     if (leader_region_info.peers_size() > replica_num) {
         bool is_binlog_region = false;
@@ -2393,6 +2534,20 @@ void RegionManager::check_peer_count(int64_t region_id,
             DB_WARNING("table_id: %ld, region_id: %ld, remove peer: %s, because of not in replicaDist.",
                        table_id, region_id, remove_peer.c_str());
         }
+        // 热点迁移发起的add peer，删除热点实例上的peer
+        // 标记在remove peer请求真正发出后才清理，先transfer leader的轮次保留
+        std::string hot_remove_peer;
+        bool removed_by_hot = false;
+        if (remove_peer.empty() && need_remove_peer_on_hot(region_id, hot_remove_peer)) {
+            if (candidate_remove_peers.count(hot_remove_peer) > 0) {
+                remove_peer = hot_remove_peer;
+                removed_by_hot = true;
+                DB_WARNING("table_id: %ld, region_id: %ld, remove peer: %s, because of hot region balance",
+                           table_id, region_id, remove_peer.c_str());
+            } else {
+                clear_remove_peer_on_hot(region_id);
+            }
+        }
         // 按照用户指定的副本分布来做remove_peer
         int64_t max_peer_count = 0;
         if (remove_peer.empty()) {
@@ -2460,6 +2615,21 @@ void RegionManager::check_peer_count(int64_t region_id,
         if (remove_peer == leader_region_info.leader() && leader_region_info.peers().size() > 1) {
             // 如果删除的是leader，本轮心跳先让store transfer leader，下轮心跳再remove follower
             std::string new_leader = remove_peer;
+            if (removed_by_hot) {
+                // 热点迁移选leader负载最低的peer，一般是新加的peer，避免leader留在热点实例
+                int64_t min_peer_load = INT_FAST64_MAX;
+                for (auto& peer : leader_region_info.peers()) {
+                    if (peer == remove_peer
+                            || ClusterManager::get_instance()->get_instance_status(peer) != pb::NORMAL) {
+                        continue;
+                    }
+                    int64_t peer_load = ClusterManager::get_instance()->get_leader_load(peer);
+                    if (peer_load < min_peer_load) {
+                        new_leader = peer;
+                        min_peer_load = peer_load;
+                    }
+                }
+            }
             while (new_leader == remove_peer) {
                 int64_t rand = butil::fast_rand() % leader_region_info.peers().size();
                 new_leader = leader_region_info.peers(rand);
@@ -2480,6 +2650,9 @@ void RegionManager::check_peer_count(int64_t region_id,
                 remove_peer_request.add_new_peers(peer);
             }
         }
+        if (removed_by_hot) {
+            clear_remove_peer_on_hot(region_id);
+        }
         if (removed_by_pk_prefix) {
             ClusterManager::get_instance()->sub_peer_count_on_pk_prefix(remove_peer, table_id, pk_prefix_key);
         } else {
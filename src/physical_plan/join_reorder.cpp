@@ -19,19 +19,233 @@
 #include "query_context.h"
 
 namespace baikaldb {
-int JoinReorder::analyze(QueryContext* ctx) {
-    JoinNode* join = static_cast<JoinNode*>(ctx->root->get_node(pb::JOIN_NODE));
-    if (join == nullptr) {
-        return 0;
+DEFINE_bool(join_reorder_by_cost, true, "reorder inner join by statistics when all tables have statistics");
+DEFINE_int32(join_reorder_dp_max_tables, 8, "use dynamic programming for join reorder when table num <= this, "
+        "greedy otherwise");
+
+enum JoinMethod {
+    JM_FIRST = 0,           // 第一张驱动表
+    JM_HASH_IN_PUSHDOWN,    // 等值join，驱动表的值以in条件下推到被驱动表
+    JM_NESTED_LOOP          // 无等值条件，笛卡尔积后过滤
+};
+
+struct JoinTableCost {
+    int32_t tuple_id = 0;
+    int64_t table_id = 0;
+    double rows = 1.0;          // 过滤后行数
+    double total_rows = 1.0;
+    SmartStatistics statistics;
+    std::map<int32_t, double> field_ndv;
+    std::set<int32_t> index_prefix_fields; // 可用于in下推点查的索引第一列
+};
+
+struct JoinPlanCost {
+    double rows = 0.0;
+    double cost = -1.0;
+    std::vector<int> order;
+    std::vector<JoinMethod> methods;
+};
+
+// 采样的distinct数，采样中几乎不重复时按比例放大
+static double estimate_ndv(JoinTableCost& table, int32_t field_id) {
+    auto iter = table.field_ndv.find(field_id);
+    if (iter != table.field_ndv.end()) {
+        return iter->second;
     }
-    std::map<int32_t, ExecNode*> tuple_join_child_map;  // join的所有非join孩子
-    std::map<int32_t, std::set<int32_t>> tuple_equals_map; // 等值条件信息
-    std::vector<int32_t> tuple_order; // 目前join顺序
-    std::vector<ExprNode*> conditions; // join的全部条件,reorder需要重新下推
-    // 获取所有信息
-    if (!join->need_reorder(tuple_join_child_map, tuple_equals_map, tuple_order, conditions)) {
-        return 0;
+    double ndv = table.total_rows;
+    int64_t distinct_cnt = table.statistics->get_distinct_cnt(field_id);
+    int64_t sample_cnt = table.statistics->get_sample_cnt();
+    if (distinct_cnt > 0) {
+        ndv = distinct_cnt;
+        if (sample_cnt > 0 && table.total_rows > sample_cnt && distinct_cnt >= sample_cnt * 0.9) {
+            ndv = distinct_cnt * table.total_rows / sample_cnt;
+        }
     }
+    ndv = std::max(std::min(ndv, table.total_rows), 1.0);
+    table.field_ndv[field_id] = ndv;
+    return ndv;
+}
+
+// 在已join的表集合(prefix_mask)后join第idx张表
+static void join_step(std::vector<JoinTableCost>& tables,
+        std::vector<std::vector<std::vector<std::pair<int32_t, int32_t>>>>& edges,
+        const JoinPlanCost& prefix, uint64_t prefix_mask, int idx, JoinPlanCost& result) {
+    JoinTableCost& inner = tables[idx];
+    double selectivity = 1.0;
+    double in_values = prefix.rows;
+    double lookup_rows = -1.0;
+    bool has_equal = false;
+    for (size_t i = 0; i < tables.size(); ++i) {
+        if ((prefix_mask & (1ULL << i)) == 0) {
+            continue;
+        }
+        for (auto& field_pair : edges[i][idx]) {
+            has_equal = true;
+            double outer_ndv = std::min(estimate_ndv(tables[i], field_pair.first), prefix.rows);
+            double inner_ndv = std::min(estimate_ndv(inner, field_pair.second), inner.rows);
+            selectivity /= std::max(std::max(outer_ndv, inner_ndv), 1.0);
+            in_values = std::min(in_values, outer_ndv);
+            if (inner.index_prefix_fields.count(field_pair.second) > 0) {
+                // in下推后走索引点查，每个值平均命中total/ndv行
+                double rows = outer_ndv * inner.total_rows / estimate_ndv(inner, field_pair.second);
+                lookup_rows = lookup_rows < 0 ? rows : std::min(lookup_rows, rows);
+            }
+        }
+    }
+    double inner_read_rows = inner.rows;
+    if (lookup_rows >= 0) {
+        inner_read_rows = std::min(inner_read_rows, lookup_rows);
+    }
+    result.order = prefix.order;
+    result.order.emplace_back(idx);
+    result.methods = prefix.methods;
+    if (has_equal) {
+        result.rows = std::max(prefix.rows * inner.rows * selectivity, 1.0);
+        // 驱动表构造in条件和hash表，被驱动表读取，输出
+        result.cost = prefix.cost + prefix.rows + in_values + inner_read_rows + result.rows;
+        result.methods.emplace_back(JM_HASH_IN_PUSHDOWN);
+    } else {
+        result.rows = std::max(prefix.rows * inner.rows, 1.0);
+        result.cost = prefix.cost + prefix.rows + inner.rows + result.rows;
+        result.methods.emplace_back(JM_NESTED_LOOP);
+    }
+}
+
+bool JoinReorder::reorder_by_cost(std::map<int32_t, ExecNode*>& tuple_join_child_map,
+        std::vector<std::pair<SlotRef*, SlotRef*>>& equal_slots,
+        std::vector<int32_t>& tuple_order,
+        std::vector<int32_t>& tuple_reorder) {
+    if (!FLAGS_join_reorder_by_cost || tuple_order.size() > 64) {
+        return false;
+    }
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    std::vector<JoinTableCost> tables;
+    std::map<int32_t, int> tuple_idx_map;
+    tables.reserve(tuple_order.size());
+    for (int32_t tuple_id : tuple_order) {
+        ScanNode* scan_node = static_cast<ScanNode*>(
+                tuple_join_child_map[tuple_id]->get_node(pb::SCAN_NODE));
+        JoinTableCost table;
+        table.tuple_id = tuple_id;
+        table.table_id = scan_node->table_id();
+        table.statistics = factory->get_statistics_ptr(table.table_id);
+        if (table.statistics == nullptr || !factory->is_switch_open(table.table_id, TABLE_SWITCH_COST)) {
+            return false;
+        }
+        int64_t rows = scan_node->estimate_rows();
+        int64_t total_rows = factory->get_total_rows(table.table_id);
+        if (rows < 0 || total_rows <= 0) {
+            return false;
+        }
+        table.rows = std::max((double)rows, 1.0);
+        table.total_rows = std::max((double)total_rows, table.rows);
+        auto table_info = factory->get_table_info_ptr(table.table_id);
+        if (table_info != nullptr) {
+            for (int64_t index_id : table_info->indices) {
+                auto index_info = factory->get_index_info_ptr(index_id);
+                if (index_info == nullptr || index_info->fields.empty() || index_info->state != pb::IS_PUBLIC) {
+                    continue;
+                }
+                if (index_info->type == pb::I_PRIMARY || index_info->type == pb::I_UNIQ
+                        || index_info->type == pb::I_KEY) {
+                    table.index_prefix_fields.insert(index_info->fields[0].id);
+                }
+            }
+        }
+        tuple_idx_map[tuple_id] = tables.size();
+        tables.emplace_back(table);
+    }
+    size_t table_cnt = tables.size();
+    // edges[i][j]: 第i张表和第j张表的等值列(i的field_id, j的field_id)
+    std::vector<std::vector<std::vector<std::pair<int32_t, int32_t>>>> edges(
+            table_cnt, std::vector<std::vector<std::pair<int32_t, int32_t>>>(table_cnt));
+    for (auto& pair : equal_slots) {
+        if (tuple_idx_map.count(pair.first->tuple_id()) == 0
+                || tuple_idx_map.count(pair.second->tuple_id()) == 0) {
+            continue;
+        }
+        int left = tuple_idx_map[pair.first->tuple_id()];
+        int right = tuple_idx_map[pair.second->tuple_id()];
+        edges[left][right].emplace_back(pair.first->field_id(), pair.second->field_id());
+        edges[right][left].emplace_back(pair.second->field_id(), pair.first->field_id());
+    }
+
+    JoinPlanCost best;
+    if ((int)table_cnt <= std::min(FLAGS_join_reorder_dp_max_tables, 16)) {
+        // 左深树动态规划，dp[mask]为join完mask中的表的最小代价
+        std::vector<JoinPlanCost> dp(1ULL << table_cnt);
+        for (size_t i = 0; i < table_cnt; ++i) {
+            JoinPlanCost& first = dp[1ULL << i];
+            first.rows = tables[i].rows;
+            first.cost = tables[i].rows;
+            first.order.emplace_back(i);
+            first.methods.emplace_back(JM_FIRST);
+        }
+        for (uint64_t mask = 1; mask < dp.size(); ++mask) {
+            if (dp[mask].cost < 0) {
+                continue;
+            }
+            for (size_t j = 0; j < table_cnt; ++j) {
+                if (mask & (1ULL << j)) {
+                    continue;
+                }
+                JoinPlanCost next;
+                join_step(tables, edges, dp[mask], mask, j, next);
+                JoinPlanCost& target = dp[mask | (1ULL << j)];
+                if (target.cost < 0 || next.cost < target.cost) {
+                    target = next;
+                }
+            }
+        }
+        best = dp.back();
+    } else {
+        // 贪心：从过滤后行数最少的表开始，每次选择代价最小的下一张表
+        uint64_t mask = 0;
+        size_t first_idx = 0;
+        for (size_t i = 1; i < table_cnt; ++i) {
+            if (tables[i].rows < tables[first_idx].rows) {
+                first_idx = i;
+            }
+        }
+        best.rows = tables[first_idx].rows;
+        best.cost = tables[first_idx].rows;
+        best.order.emplace_back(first_idx);
+        best.methods.emplace_back(JM_FIRST);
+        mask |= 1ULL << first_idx;
+        for (size_t step = 1; step < table_cnt; ++step) {
+            JoinPlanCost step_best;
+            int step_idx = -1;
+            for (size_t j = 0; j < table_cnt; ++j) {
+                if (mask & (1ULL << j)) {
+                    continue;
+                }
+                JoinPlanCost next;
+                join_step(tables, edges, best, mask, j, next);
+                if (step_idx < 0 || next.cost < step_best.cost) {
+                    step_best = next;
+                    step_idx = j;
+                }
+            }
+            best = step_best;
+            mask |= 1ULL << step_idx;
+        }
+    }
+    static const char* method_names[] = {"first", "hash_in_pushdown", "nested_loop"};
+    std::ostringstream os;
+    tuple_reorder.clear();
+    for (size_t i = 0; i < best.order.size(); ++i) {
+        auto& table = tables[best.order[i]];
+        tuple_reorder.emplace_back(table.tuple_id);
+        os << table.tuple_id << ":" << method_names[best.methods[i]] << ":" << (int64_t)table.rows << ";";
+    }
+    DB_DEBUG("join reorder by cost, plan:%s rows:%f cost:%f", os.str().c_str(), best.rows, best.cost);
+    return true;
+}
+
+bool JoinReorder::reorder_by_rule(std::map<int32_t, ExecNode*>& tuple_join_child_map,
+        std::map<int32_t, std::set<int32_t>>& tuple_equals_map,
+        std::vector<int32_t>& tuple_order,
+        std::vector<int32_t>& tuple_reorder) {
     ScanNode* first_node = static_cast<ScanNode*>(
             tuple_join_child_map[tuple_order[0]]->get_node(pb::SCAN_NODE));
     bool first_has_index = false;
@@ -56,12 +270,11 @@ int JoinReorder::analyze(QueryContext* ctx) {
     }
     // 第一驱动表有索引并且符合等值join的暂不做reorder
     if (first_has_index && is_equal_join) {
-        return 0;
+        return false;
     }
 
     // do reorder
     // 选出有index的tuple
-    std::vector<int32_t> tuple_reorder;
     for (auto& pair : tuple_join_child_map) {
         int32_t tuple_id = pair.first;
         ScanNode* scan_node = static_cast<ScanNode*>(
@@ -74,7 +287,7 @@ int JoinReorder::analyze(QueryContext* ctx) {
     }
     if (tuple_reorder.empty()) {
         if (is_equal_join) {
-            return 0;
+            return false;
         }
         tuple_reorder.push_back(tuple_order[0]);
         tuple_equals_map.erase(tuple_order[0]);
@@ -96,11 +309,39 @@ int JoinReorder::analyze(QueryContext* ctx) {
         if (select_tuple == -1) {
             // no equal join
             DB_WARNING("has no equal condition in join");
-            return 0;
+            return false;
         }
         tuple_reorder.push_back(select_tuple);
         tuple_equals_map.erase(select_tuple);
     }
+    return true;
+}
+
+int JoinReorder::analyze(QueryContext* ctx) {
+    JoinNode* join = static_cast<JoinNode*>(ctx->root->get_node(pb::JOIN_NODE));
+    if (join == nullptr) {
+        return 0;
+    }
+    std::map<int32_t, ExecNode*> tuple_join_child_map;  // join的所有非join孩子
+    std::map<int32_t, std::set<int32_t>> tuple_equals_map; // 等值条件信息
+    std::vector<int32_t> tuple_order; // 目前join顺序
+    std::vector<ExprNode*> conditions; // join的全部条件,reorder需要重新下推
+    std::vector<std::pair<SlotRef*, SlotRef*>> equal_slots; // 等值条件的两侧列
+    // 获取所有信息
+    if (!join->need_reorder(tuple_join_child_map, tuple_equals_map, tuple_order, conditions, equal_slots)) {
+        return 0;
+    }
+    std::vector<int32_t> tuple_reorder;
+    if (reorder_by_cost(tuple_join_child_map, equal_slots, tuple_order, tuple_reorder)) {
+        if (tuple_reorder == tuple_order) {
+            return 0;
+        }
+    } else {
+        tuple_reorder.clear();
+        if (!reorder_by_rule(tuple_join_child_map, tuple_equals_map, tuple_order, tuple_reorder)) {
+            return 0;
+        }
+    }
     // 创建新的join节点
     ExecNode* last_node = tuple_join_child_map[tuple_reorder[0]];
     for (size_t i = 1; i < tuple_reorder.size(); i++) {
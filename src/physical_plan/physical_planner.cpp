@@ -14,12 +14,25 @@
 
 #include "physical_planner.h"
 #include "query_context.h"
+#include "filter_node.h"
+#include "rocksdb_scan_node.h"
+#include "select_manager_node.h"
+#include "scalar_fn_call.h"
+#include "slot_ref.h"
 namespace baikaldb {
 DEFINE_int32(cmsketch_depth, 5, "cmsketch_depth");
 DEFINE_int32(cmsketch_width, 2048, "cmsketch_width");
 DEFINE_int32(sample_rows, 1000000, "sample rows 100w");
+DEFINE_bool(prepare_point_query, false, "prepared primary key point select skips index selection and routing");
 int PhysicalPlanner::analyze(QueryContext* ctx) {
     int ret = 0;
+    if (ctx->point_query != nullptr && ctx->point_query->valid) {
+        ret = analyze_point_query(ctx);
+        if (ret <= 0) {
+            return ret;
+        }
+        ret = 0;
+    }
     for (auto sub_query_ctx : ctx->sub_query_plans) {
         ret = analyze(sub_query_ctx.get());
         if (ret < 0) {
@@ -88,6 +101,159 @@ int PhysicalPlanner::analyze(QueryContext* ctx) {
     if (ctx->return_empty) {
         ctx->root->set_return_empty();
     }
+    if (ctx->point_query != nullptr && !ctx->point_query->checked) {
+        build_point_query(ctx);
+    }
+    return 0;
+}
+
+void PhysicalPlanner::build_point_query(QueryContext* ctx) {
+    PointQueryPlan& point_query = *ctx->point_query;
+    // 参数为null等导致的空结果不代表计划形态，下次执行再判断
+    if (ctx->return_empty) {
+        return;
+    }
+    point_query.checked = true;
+    if (!FLAGS_prepare_point_query || ctx->sub_query_plans.size() > 0 || ctx->has_derived_table
+            || ctx->is_full_export || ctx->is_explain || ctx->debug_region_id != -1) {
+        return;
+    }
+    ExecNode* plan = ctx->root;
+    std::vector<ExecNode*> scan_nodes;
+    plan->get_node(pb::SCAN_NODE, scan_nodes);
+    if (scan_nodes.size() != 1 || plan->get_node(pb::JOIN_NODE) != nullptr
+            || plan->get_node(pb::APPLY_NODE) != nullptr) {
+        return;
+    }
+    SelectManagerNode* manager_node =
+        static_cast<SelectManagerNode*>(plan->get_node(pb::SELECT_MANAGER_NODE));
+    RocksdbScanNode* scan_node = static_cast<RocksdbScanNode*>(scan_nodes[0]);
+    if (manager_node == nullptr || scan_node->engine() != pb::ROCKSDB
+            || scan_node->router_policy() != RouterPolicy::RP_RANGE
+            || scan_node->scan_indexs().size() != 1) {
+        return;
+    }
+    // 只支持主键，本地二级索引无法按key路由
+    int64_t table_id = scan_node->table_id();
+    ScanIndexInfo* scan_index = scan_node->main_scan_index();
+    if (scan_index->index_id != table_id || scan_index->router_index_id != table_id) {
+        return;
+    }
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    auto table_info = factory->get_table_info_ptr(table_id);
+    auto pri_info = factory->get_index_info_ptr(table_id);
+    if (table_info == nullptr || pri_info == nullptr || table_info->partition_num != 1
+            || factory->is_binlog_table(table_id)) {
+        return;
+    }
+    pb::PossibleIndex primary;
+    if (!primary.ParseFromString(scan_index->raw_index) || primary.ranges_size() != 1
+            || !primary.is_eq() || !primary.ranges(0).left_full()) {
+        return;
+    }
+    // 过滤条件只能是主键列 = ?，被主键range裁剪后store不需要再过滤
+    ExecNode* parent = scan_node->get_parent();
+    if (parent == nullptr || (parent->node_type() != pb::WHERE_FILTER_NODE
+            && parent->node_type() != pb::TABLE_FILTER_NODE)) {
+        return;
+    }
+    std::map<ExprNode*, int> placeholder_ids;
+    for (auto& pair : ctx->placeholders) {
+        placeholder_ids[pair.second] = pair.first;
+    }
+    FilterNode* filter_node = static_cast<FilterNode*>(parent);
+    std::map<int32_t, int> field_placeholders;
+    for (auto expr : *filter_node->mutable_conjuncts()) {
+        if (expr->node_type() != pb::FUNCTION_CALL
+                || static_cast<ScalarFnCall*>(expr)->fn().fn_op() != parser::FT_EQ
+                || expr->children_size() != 2 || !expr->children(0)->is_slot_ref()
+                || !expr->children(1)->is_place_holder()) {
+            return;
+        }
+        SlotRef* slot_ref = static_cast<SlotRef*>(expr->children(0));
+        auto iter = placeholder_ids.find(expr->children(1));
+        if (slot_ref->tuple_id() != scan_node->tuple_id() || iter == placeholder_ids.end()) {
+            return;
+        }
+        field_placeholders[slot_ref->field_id()] = iter->second;
+    }
+    if (field_placeholders.size() != pri_info->fields.size()) {
+        return;
+    }
+    point_query.placeholder_ids.clear();
+    for (auto& field : pri_info->fields) {
+        auto iter = field_placeholders.find(field.id);
+        if (iter == field_placeholders.end()) {
+            return;
+        }
+        point_query.placeholder_ids.emplace_back(iter->second);
+    }
+    point_query.table_id = table_id;
+    point_query.filter_node = filter_node;
+    point_query.scan_node = scan_node;
+    point_query.manager_node = manager_node;
+    point_query.primary.Swap(&primary);
+    point_query.valid = true;
+}
+
+int PhysicalPlanner::analyze_point_query(QueryContext* ctx) {
+    static bvar::Adder<int64_t> prepare_point_query_count("prepare_point_query_count");
+    PointQueryPlan& point_query = *ctx->point_query;
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    auto pri_info = factory->get_index_info_ptr(point_query.table_id);
+    SmartRecord record = factory->new_record(point_query.table_id);
+    if (pri_info == nullptr || record == nullptr) {
+        DB_WARNING("table info not found:%ld", point_query.table_id);
+        return -1;
+    }
+    // 先检查参数，不能走点查时直接返回，由完整规划做类型推导
+    for (size_t i = 0; i < pri_info->fields.size(); ++i) {
+        auto iter = ctx->placeholders.find(point_query.placeholder_ids[i]);
+        if (iter == ctx->placeholders.end() || iter->second == nullptr) {
+            point_query.valid = false;
+            return 1;
+        }
+        ExprValue value = iter->second->get_value(nullptr);
+        // 主键为null时结果为空，由完整规划处理，之后重新生成点查计划
+        if (value.is_null()) {
+            point_query.valid = false;
+            point_query.checked = false;
+            return 1;
+        }
+        auto& field = pri_info->fields[i];
+        record->set_value(record->get_field_by_tag(field.id), value.cast_to(field.type));
+    }
+    // placeholder已替换为新参数，重新做类型推导
+    int ret = ExprOptimize().analyze(ctx);
+    if (ret < 0) {
+        return ret;
+    }
+    MutTableKey key;
+    if (record->encode_key(*pri_info, key, pri_info->fields.size(), false, false) != 0) {
+        DB_WARNING("Fail to encode_key, table:%ld", point_query.table_id);
+        return -1;
+    }
+    key.set_full(true);
+    auto range = point_query.primary.mutable_ranges(0);
+    range->set_left_key(key.data());
+    range->set_left_full(true);
+    range->set_right_key(key.data());
+    range->set_right_full(true);
+    ScanIndexInfo* scan_index = point_query.scan_node->main_scan_index();
+    point_query.primary.SerializeToString(&scan_index->raw_index);
+    ret = factory->get_region_by_key(point_query.table_id, *pri_info, &point_query.primary,
+            scan_index->region_infos, &scan_index->region_primary);
+    if (ret < 0) {
+        DB_WARNING("get_region_by_key:fail :%d", ret);
+        return ret;
+    }
+    // 参数cast到主键类型后range可能比原条件宽(如id = '1.5')，store仍按原条件过滤
+    std::vector<ExprNode*> store_conditions(point_query.filter_node->mutable_conjuncts()->begin(),
+            point_query.filter_node->mutable_conjuncts()->end());
+    point_query.filter_node->modifiy_pruned_conjuncts_by_index(store_conditions);
+    point_query.scan_node->set_region_infos(scan_index->region_infos);
+    point_query.manager_node->set_region_infos(scan_index->region_infos);
+    prepare_point_query_count << 1;
     return 0;
 }
 
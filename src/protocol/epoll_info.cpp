@@ -25,18 +25,27 @@ EpollInfo::~EpollInfo() {
     }
 }
 
-bool EpollInfo::init() {
+bool EpollInfo::init(int reactor_idx) {
     _event_size = CONFIG_MPL_EPOLL_MAX_SIZE;
     _epfd = epoll_create(CONFIG_MPL_EPOLL_MAX_SIZE);
     if (_epfd < 0) {
         DB_FATAL("epoll_create() failed.");
         return false;
     }
+    std::string prefix = "epoll_reactor_" + std::to_string(reactor_idx);
+    _conn_count.expose(prefix + "_conn_count");
+    _event_count.expose(prefix + "_event_count");
+    _event_qps.expose(prefix + "_event_qps");
+    // 两次epoll_wait之间处理就绪事件的耗时，反映reactor是否繁忙
+    _handle_time.expose(prefix + "_handle_time");
     return true;
 }
 
 int EpollInfo::wait(uint32_t timeout) {
-    return epoll_wait(_epfd, _events, _event_size, timeout);
+    _handle_time << _handle_cost.get_time();
+    int ret = epoll_wait(_epfd, _events, _event_size, timeout);
+    _handle_cost.reset();
+    return ret;
 }
 
 bool EpollInfo::set_fd_mapping(int fd, SmartSocket sock) {
@@ -45,6 +54,11 @@ bool EpollInfo::set_fd_mapping(int fd, SmartSocket sock) {
         return false;
     }
     std::unique_lock<std::mutex> lock(_mutex);
+    if (_fd_mapping[fd] == nullptr && sock != nullptr) {
+        _conn_count << 1;
+    } else if (_fd_mapping[fd] != nullptr && sock == nullptr) {
+        _conn_count << -1;
+    }
     _fd_mapping[fd] = sock;
     return true;
 }
@@ -63,6 +77,9 @@ void EpollInfo::delete_fd_mapping(int fd) {
         return;
     }
     std::unique_lock<std::mutex> lock(_mutex);
+    if (_fd_mapping[fd] != nullptr) {
+        _conn_count << -1;
+    }
     _fd_mapping[fd] = SmartSocket();
     return;
 }
@@ -1447,6 +1447,9 @@ bool HandleHelper::_handle_schema_conf(const SmartSocket& client, const std::vec
     } else if (key == "tail_split_step") {
         int32_t tail_split_step = strtol(split_vec[4].c_str(), NULL, 10);
         schema_conf->set_tail_split_step(tail_split_step);
+    } else if (key == "result_cache_ttl_s") {
+        int32_t result_cache_ttl_s = strtol(split_vec[4].c_str(), NULL, 10);
+        schema_conf->set_result_cache_ttl_s(result_cache_ttl_s);
     } else if (key == "auto_inc_rand_max") {
         int64_t num = strtol(split_vec[4].c_str(), NULL, 10);
         schema_conf->set_auto_inc_rand_max(num);
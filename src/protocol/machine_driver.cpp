@@ -43,6 +43,11 @@ void* MachineDriver::bthread_callback(void* void_arg) {
     // }
 
     StateMachine::get_instance()->run_machine(task->socket, task->epoll_info, task->shutdown);
+    // 上一个命令处理完后继续处理已解压的后续命令，不等待epoll
+    while (!task->shutdown && task->socket->state == STATE_SEND_AUTH_RESULT
+            && task->socket->has_buffered_input()) {
+        StateMachine::get_instance()->run_machine(task->socket, task->epoll_info, task->shutdown);
+    }
     task->socket->mutex.unlock();
     task->is_succ = true;
     return NULL;
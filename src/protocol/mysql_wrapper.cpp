@@ -13,12 +13,17 @@
 // limitations under the License.
 
 #include "mysql_wrapper.h"
+#include <sys/epoll.h>
+#include <zlib.h>
 #include <unordered_set>
 #include "network_socket.h"
 #include "query_context.h"
 #include "packet_node.h"
 
 namespace baikaldb {
+DEFINE_bool(mysql_compress_enable, false, "declare CLIENT_COMPRESS in handshake, use zlib compressed protocol");
+DEFINE_int32(mysql_compress_min_size, 50, "payload shorter than this is sent uncompressed in compressed protocol");
+DEFINE_int32(mysql_compress_level, 1, "zlib level for compressed protocol");
 
 MysqlWrapper::MysqlWrapper() {
     _err_handler = MysqlErrHandler::get_instance();
@@ -72,6 +77,10 @@ int MysqlWrapper::handshake_send(SmartSocket sock) {
     memcpy(packet_handshake, packet_handshake_1, len1);
     memcpy(packet_handshake + len1, (uint8_t*)(&sock->conn_id), 4);
     memcpy(packet_handshake + len1 + 4, packet_handshake_2, len2);
+    if (FLAGS_mysql_compress_enable) {
+        // capability flags (lower 2 bytes)位于connection id + 8字节auth-plugin-data + filter之后
+        packet_handshake[len1 + 4 + 9] |= CLIENT_COMPRESS;
+    }
 
     if (!sock->send_buf->network_queue_send_append(packet_handshake,
                                                 (sizeof(packet_handshake)), 0, 0)) {
@@ -517,7 +526,7 @@ int MysqlWrapper::real_read_header(SmartSocket sock, int want_len, int* real_rea
         DB_FATAL("Failed to byte_array_append_size.len:[%d]", want_len);
         return RET_ERROR;
     }
-    int len = read(sock->fd, sock->self_buf->_data + sock->header_read_len, want_len);
+    int len = socket_read(sock.get(), sock->self_buf->_data + sock->header_read_len, want_len);
     *real_read_len = (len >= 0 ? len : 0);
     if (sock->self_buf->_size < 4) {
         sock->self_buf->_size += *real_read_len;
@@ -555,7 +564,7 @@ int MysqlWrapper::real_read(SmartSocket sock, int want_len, int* real_read_len)
         DB_FATAL("Failed to byte_array_append_size.len:[%d]", want_len);
         return RET_ERROR;
     }
-    int len = read(sock->fd, sock->self_buf->_data + sock->self_buf->_size, want_len);
+    int len = socket_read(sock.get(), sock->self_buf->_data + sock->self_buf->_size, want_len);
     *real_read_len = (len >= 0 ? len : 0);
     sock->self_buf->_size += *real_read_len;
 
@@ -583,7 +592,21 @@ int MysqlWrapper::real_write(SmartSocket sock) {
         return RET_ERROR;
     }
     int ret = RET_ERROR;
-    int32_t we_want = sock->send_buf->_size - sock->send_buf_offset;
+    DataBuffer* out_buf = sock->send_buf;
+    int* out_offset = &sock->send_buf_offset;
+    if (sock->use_compress) {
+        // 上一段压缩数据写完后再压缩下一段，大结果集不会整体多占一份内存
+        out_buf = sock->compress_send_buf;
+        out_offset = &sock->compress_send_offset;
+        if (*out_offset >= (int)out_buf->_size) {
+            out_buf->byte_array_clear();
+            *out_offset = 0;
+            if (compress_send_buf(sock.get(), COMPRESS_CHUNK_LEN) != RET_SUCCESS) {
+                return RET_ERROR;
+            }
+        }
+    }
+    int32_t we_want = out_buf->_size - *out_offset;
 
     if (we_want <= 0) {
         if (sock->state == STATE_CONNECTED_CLIENT) {
@@ -602,9 +625,9 @@ int MysqlWrapper::real_write(SmartSocket sock) {
     if (we_want > (int)MAX_WRITE_QUERY_RESULT_PACKET_LEN) {
         real_write = MAX_WRITE_QUERY_RESULT_PACKET_LEN;
     }
-    int len = write(sock->fd, sock->send_buf->_data + sock->send_buf_offset, real_write);
+    int len = write(sock->fd, out_buf->_data + *out_offset, real_write);
     if (0 < len) {
-        sock->send_buf_offset += len;
+        *out_offset += len;
     } else if (len == 0) {
         return RET_SHUTDOWN;
     } else {
@@ -621,10 +644,15 @@ int MysqlWrapper::real_write(SmartSocket sock) {
         }
         return ret;
     }
-    if (len < real_write || we_want > (int)MAX_WRITE_QUERY_RESULT_PACKET_LEN) {
+    if (len < real_write || we_want > (int)MAX_WRITE_QUERY_RESULT_PACKET_LEN
+            || sock->send_buf_offset < (int)sock->send_buf->_size) {
         ret = RET_WAIT_FOR_EVENT;
         return RET_WAIT_FOR_EVENT;
     }
+    if (sock->use_compress) {
+        sock->compress_send_buf->byte_array_clear();
+        sock->compress_send_offset = 0;
+    }
     sock->send_buf->byte_array_clear();
     sock->self_buf->byte_array_clear();
     sock->send_buf_offset = 0;
@@ -632,6 +660,202 @@ int MysqlWrapper::real_write(SmartSocket sock) {
     return RET_SUCCESS;
 }
 
+int MysqlWrapper::stream_write(NetworkSocket* sock, int64_t timeout_us) {
+    if (sock == nullptr || sock->send_buf == nullptr) {
+        DB_FATAL("sock == NULL or sock->send_buf == NULL");
+        return RET_ERROR;
+    }
+    DataBuffer* send_buf = sock->send_buf;
+    DataBuffer* out_buf = send_buf;
+    int* out_offset = &sock->send_buf_offset;
+    if (sock->use_compress) {
+        out_buf = sock->compress_send_buf;
+        out_offset = &sock->compress_send_offset;
+    }
+    while (true) {
+        if (*out_offset >= (int)out_buf->_size) {
+            if (!sock->use_compress || sock->send_buf_offset >= (int)send_buf->_size) {
+                break;
+            }
+            out_buf->byte_array_clear();
+            *out_offset = 0;
+            if (compress_send_buf(sock, COMPRESS_CHUNK_LEN) != RET_SUCCESS) {
+                return RET_ERROR;
+            }
+        }
+        int len = write(sock->fd, out_buf->_data + *out_offset, out_buf->_size - *out_offset);
+        if (len > 0) {
+            *out_offset += len;
+            continue;
+        } else if (len == 0) {
+            return RET_SHUTDOWN;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN) {
+            DB_WARNING("stream write fail, fd: %d, errno: %d", sock->fd, errno);
+            return RET_SHUTDOWN;
+        }
+        // 客户端消费慢，挂起执行等待socket可写，内存不再继续增长
+        timespec abstime = butil::microseconds_from_now(timeout_us);
+        if (bthread_fd_timedwait(sock->fd, EPOLLOUT, &abstime) != 0 && errno == ETIMEDOUT) {
+            DB_WARNING("stream write timeout, fd: %d, ip: %s, port: %d",
+                    sock->fd, sock->ip.c_str(), sock->port);
+            return RET_ERROR;
+        }
+    }
+    if (sock->use_compress) {
+        out_buf->byte_array_clear();
+        sock->compress_send_offset = 0;
+    }
+    // 剩余部分在语句结束时由StateMachine累加
+    if (sock->query_ctx != nullptr) {
+        sock->query_ctx->stat_info.send_buf_size += send_buf->_size;
+    }
+    send_buf->byte_array_clear();
+    sock->send_buf_offset = 0;
+    // 已发送的包不能回退，后续错误包在此之后编号
+    sock->last_packet_id = sock->packet_id;
+    return RET_SUCCESS;
+}
+
+void MysqlWrapper::enable_compress(NetworkSocket* sock) {
+    if (sock->compress_send_buf == nullptr) {
+        sock->compress_send_buf = new DataBuffer(SEND_BUF_DEFAULT_SIZE);
+        sock->compress_read_buf = new DataBuffer(SELF_BUF_DEFAULT_SIZE);
+        sock->uncompress_buf = new DataBuffer(SELF_BUF_DEFAULT_SIZE);
+    }
+    sock->compress_send_offset = 0;
+    sock->uncompress_offset = 0;
+    sock->compress_seq = 0;
+    sock->use_compress = true;
+}
+
+int MysqlWrapper::socket_read(NetworkSocket* sock, uint8_t* buf, int want_len) {
+    if (!sock->use_compress) {
+        return read(sock->fd, buf, want_len);
+    }
+    int read_len = 0;
+    while (read_len < want_len) {
+        DataBuffer* uncompress_buf = sock->uncompress_buf;
+        int remain = uncompress_buf->_size - sock->uncompress_offset;
+        if (remain > 0) {
+            int len = std::min(remain, want_len - read_len);
+            memcpy(buf + read_len, uncompress_buf->_data + sock->uncompress_offset, len);
+            sock->uncompress_offset += len;
+            read_len += len;
+            continue;
+        }
+        uncompress_buf->byte_array_clear();
+        sock->uncompress_offset = 0;
+        int ret = read_compress_frame(sock);
+        if (ret <= 0) {
+            // 已读到部分数据时先返回，错误在下次读取时再报告
+            if (read_len > 0) {
+                break;
+            }
+            return ret;
+        }
+    }
+    return read_len;
+}
+
+int MysqlWrapper::read_compress_frame(NetworkSocket* sock) {
+    DataBuffer* frame = sock->compress_read_buf;
+    size_t frame_len = COMPRESS_HEADER_LEN;
+    while (true) {
+        if (frame->_size >= COMPRESS_HEADER_LEN) {
+            frame_len = COMPRESS_HEADER_LEN +
+                (frame->_data[0] | frame->_data[1] << 8 | frame->_data[2] << 16);
+        }
+        if (frame->_size >= frame_len) {
+            break;
+        }
+        if (!frame->byte_array_append_size(frame_len - frame->_size, 1)) {
+            DB_FATAL("Failed to byte_array_append_size.len:[%zu]", frame_len);
+            errno = ENOMEM;
+            return -1;
+        }
+        int len = read(sock->fd, frame->_data + frame->_size, frame_len - frame->_size);
+        if (len <= 0) {
+            return len;
+        }
+        frame->_size += len;
+    }
+    uint8_t* header = frame->_data;
+    uLong payload_len = frame_len - COMPRESS_HEADER_LEN;
+    uLongf uncompress_len = header[4] | header[5] << 8 | header[6] << 16;
+    DataBuffer* out = sock->uncompress_buf;
+    // 回包的压缩序号接在请求之后
+    sock->compress_seq = header[3] + 1;
+    if (uncompress_len == 0) {
+        if (!out->byte_array_append_len(header + COMPRESS_HEADER_LEN, payload_len)) {
+            errno = ENOMEM;
+            return -1;
+        }
+    } else {
+        if (!out->byte_array_append_size(uncompress_len, 1)) {
+            DB_FATAL("Failed to byte_array_append_size.len:[%lu]", uncompress_len);
+            errno = ENOMEM;
+            return -1;
+        }
+        uLongf expect_len = uncompress_len;
+        int ret = uncompress(out->_data + out->_size, &uncompress_len,
+                header + COMPRESS_HEADER_LEN, payload_len);
+        if (ret != Z_OK || uncompress_len != expect_len) {
+            DB_WARNING("uncompress fail, fd: %d, ret: %d, len: %lu, expect: %lu",
+                    sock->fd, ret, uncompress_len, expect_len);
+            errno = EPROTO;
+            return -1;
+        }
+        out->_size += uncompress_len;
+    }
+    frame->byte_array_clear();
+    return 1;
+}
+
+int MysqlWrapper::compress_send_buf(NetworkSocket* sock, uint32_t max_len) {
+    static bvar::Adder<int64_t> mysql_compress_raw_bytes("mysql_compress_raw_bytes");
+    static bvar::Adder<int64_t> mysql_compress_send_bytes("mysql_compress_send_bytes");
+    DataBuffer* send_buf = sock->send_buf;
+    DataBuffer* out = sock->compress_send_buf;
+    uint32_t total_len = 0;
+    while (sock->send_buf_offset < (int)send_buf->_size && total_len < max_len) {
+        const uint8_t* raw = send_buf->_data + sock->send_buf_offset;
+        uLong raw_len = std::min((size_t)(max_len - total_len),
+                send_buf->_size - sock->send_buf_offset);
+        raw_len = std::min(raw_len, (uLong)PACKET_LEN_MAX);
+        uLongf payload_len = compressBound(raw_len);
+        if (!out->byte_array_append_size(COMPRESS_HEADER_LEN + std::max(payload_len, raw_len), 1)) {
+            DB_FATAL("Failed to byte_array_append_size.len:[%lu]", payload_len);
+            return RET_ERROR;
+        }
+        uint8_t* header = out->_data + out->_size;
+        uint8_t* payload = header + COMPRESS_HEADER_LEN;
+        uLong uncompress_len = raw_len;
+        // 小包和压缩无收益的数据原样发送，压缩前长度填0
+        if ((int64_t)raw_len < FLAGS_mysql_compress_min_size
+                || compress2(payload, &payload_len, raw, raw_len, FLAGS_mysql_compress_level) != Z_OK
+                || payload_len >= raw_len) {
+            memcpy(payload, raw, raw_len);
+            payload_len = raw_len;
+            uncompress_len = 0;
+        }
+        header[0] = payload_len & 0xff;
+        header[1] = (payload_len >> 8) & 0xff;
+        header[2] = (payload_len >> 16) & 0xff;
+        header[3] = sock->compress_seq++;
+        header[4] = uncompress_len & 0xff;
+        header[5] = (uncompress_len >> 8) & 0xff;
+        header[6] = (uncompress_len >> 16) & 0xff;
+        out->_size += COMPRESS_HEADER_LEN + payload_len;
+        sock->send_buf_offset += raw_len;
+        total_len += raw_len;
+        mysql_compress_raw_bytes << raw_len;
+        mysql_compress_send_bytes << COMPRESS_HEADER_LEN + payload_len;
+    }
+    return RET_SUCCESS;
+}
+
 bool MysqlWrapper::make_eof_packet(DataBuffer* send_buf, const int packet_id) {
     uint8_t bytes[4];
     bytes[0] = '\x05';
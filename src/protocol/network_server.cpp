@@ -35,6 +35,9 @@ namespace baikaldb {
 DEFINE_int32(backlog, 1024, "Size of waitting queue in listen()");
 DEFINE_int32(baikal_port, 28282, "Server port");
 DEFINE_int32(epoll_timeout, 2000, "Epoll wait timeout in epoll_wait().");
+DEFINE_int32(epoll_reactor_num, 1, "number of epoll reactors, each has its own epoll and fd mapping");
+DEFINE_bool(epoll_reuseport, true, "every reactor listens with SO_REUSEPORT, "
+        "otherwise reactor 0 accepts and assigns connections round-robin");
 DEFINE_int32(check_interval, 10, "interval for conn idle timeout");
 DEFINE_int32(connect_idle_timeout_s, 1800, "connection idle timeout threshold (second)");
 DEFINE_int32(slow_query_timeout_s, 60, "slow query threshold (second)");
@@ -868,13 +871,14 @@ void NetworkServer::connection_timeout_check() {
             DB_WARNING("get current time failed.");
             return;
         }
-        if (_epoll_info == NULL) {
+        if (_epoll_infos.empty()) {
             DB_WARNING("_epoll_info not initialized yet.");
             return;
         }
 
         for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-            SmartSocket sock = _epoll_info->get_fd_mapping(idx);
+            EpollInfo* epoll_info = nullptr;
+            SmartSocket sock = get_fd_mapping(idx, &epoll_info);
             if (sock == NULL || sock->is_free || sock->fd == -1) {
                 continue;
             }
@@ -897,7 +901,7 @@ void NetworkServer::connection_timeout_check() {
                 DB_WARNING("close un_authed connection [fd=%d][ip=%s][port=%d].",
                         sock->fd, sock->ip.c_str(), sock->port);
                 sock->shutdown = true;
-                MachineDriver::get_instance()->dispatch(sock, _epoll_info,
+                MachineDriver::get_instance()->dispatch(sock, epoll_info,
                         sock->shutdown || _shutdown);
                 continue;
             }
@@ -960,7 +964,7 @@ void NetworkServer::connection_timeout_check() {
                     time_now, sock->last_active,
                     sock->user_info->username.c_str());
             sock->shutdown = true;
-            MachineDriver::get_instance()->dispatch(sock, _epoll_info,
+            MachineDriver::get_instance()->dispatch(sock, epoll_info,
                     sock->shutdown || _shutdown);
         }
     };
@@ -1072,7 +1076,6 @@ int NetworkServer::insert_slow_query_infos(const std::string& slow_query_info_va
 NetworkServer::NetworkServer():
         _is_init(false),
         _shutdown(false),
-        _epoll_info(NULL),
         _heart_beat_count("heart_beat_count") {
 }
 
@@ -1083,10 +1086,10 @@ NetworkServer::~NetworkServer() {
     _other_heartbeat_bth.join();
     _agg_sql_bth.join();
     _health_check_bth.join();
-    if (_epoll_info != NULL) {
-        delete _epoll_info;
-        _epoll_info = NULL;
+    for (auto epoll_info : _epoll_infos) {
+        delete epoll_info;
     }
+    _epoll_infos.clear();
 }
 
 int NetworkServer::fetch_instance_info() {
@@ -1178,12 +1181,13 @@ void NetworkServer::stop() {
     _heartbeat_bth.join();
     _other_heartbeat_bth.join();
 
-    if (_epoll_info == nullptr) {
+    if (_epoll_infos.empty()) {
         DB_WARNING("_epoll_info not initialized yet.");
         return;
     }
     for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        SmartSocket sock = _epoll_info->get_fd_mapping(idx);
+        EpollInfo* epoll_info = nullptr;
+        SmartSocket sock = get_fd_mapping(idx, &epoll_info);
         if (!sock) {
             continue;
         }
@@ -1194,19 +1198,20 @@ void NetworkServer::stop() {
         // 待现有工作处理完成，需要获取锁
         if (sock->mutex.try_lock()) {
             sock->shutdown = true;
-            MachineDriver::get_instance()->dispatch(sock, _epoll_info, true);
+            MachineDriver::get_instance()->dispatch(sock, epoll_info, true);
         }
     }
     return;
 }
 
 void NetworkServer::fast_stop() {
-    if (_epoll_info == nullptr) {
+    if (_epoll_infos.empty()) {
         DB_WARNING("_epoll_info not initialized yet.");
         return;
     }
     for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        SmartSocket sock = _epoll_info->get_fd_mapping(idx);
+        EpollInfo* epoll_info = nullptr;
+        SmartSocket sock = get_fd_mapping(idx, &epoll_info);
         if (!sock) {
             continue;
         }
@@ -1216,7 +1221,7 @@ void NetworkServer::fast_stop() {
 
         if (sock->mutex.try_lock()) {
             sock->shutdown = true;
-            MachineDriver::get_instance()->dispatch(sock, _epoll_info, true);
+            MachineDriver::get_instance()->dispatch(sock, epoll_info, true);
         }
     }
     return;
@@ -1236,7 +1241,7 @@ bool NetworkServer::start() {
     return true;
 }
 
-SmartSocket NetworkServer::create_listen_socket() {
+SmartSocket NetworkServer::create_listen_socket(bool reuseport) {
     // Fetch a socket.
     SocketFactory* socket_pool = SocketFactory::get_instance();
     SmartSocket sock = socket_pool->create(SERVER_SOCKET);
@@ -1250,6 +1255,11 @@ SmartSocket NetworkServer::create_listen_socket() {
         DB_FATAL("setsockopt fail");
         return SmartSocket();
     }
+    // 多个reactor各自监听同一端口，由内核分发新连接
+    if (reuseport && setsockopt(sock->fd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)) != 0) {
+        DB_FATAL("setsockopt SO_REUSEPORT fail, errno=%d", errno);
+        return SmartSocket();
+    }
     
     if (FLAGS_enable_tcp_keep_alive && set_keep_tcp_alive(sock->fd) != 0) {
         DB_FATAL("setsockopt fail");
@@ -1330,6 +1340,36 @@ int NetworkServer::make_worker_process() {
         DB_FATAL("Failed to init machine driver.");
         exit(-1);
     }
+    int reactor_num = std::max(FLAGS_epoll_reactor_num, 1);
+    // 单reactor或不使用SO_REUSEPORT时，只有reactor 0监听，accept后轮询分配
+    bool reuseport = FLAGS_epoll_reuseport && reactor_num > 1;
+    for (int idx = 0; idx < reactor_num; ++idx) {
+        SmartSocket service;
+        if (idx == 0 || reuseport) {
+            // Create listen socket.
+            service = create_listen_socket(reuseport);
+            if (service == nullptr) {
+                DB_FATAL("Failed to create listen socket.");
+                return -1;
+            }
+        }
+        // Initail epoll info.
+        EpollInfo* epoll_info = new EpollInfo();
+        if (!epoll_info->init(idx)) {
+            DB_FATAL("initial epoll info failed.");
+            delete epoll_info;
+            return -1;
+        }
+        if (service != nullptr && !epoll_info->poll_events_add(service, EPOLLIN)) {
+            DB_FATAL("poll_events_add add socket[%d] error", service->fd);
+            delete epoll_info;
+            return -1;
+        }
+        _services.emplace_back(service);
+        _epoll_infos.emplace_back(epoll_info);
+    }
+    DB_NOTICE("start %d epoll reactors, reuseport: %d", reactor_num, reuseport);
+    // 后台线程会遍历_epoll_infos，需在reactor创建完成后启动
     _conn_check_bth.run([this]() {connection_timeout_check();});
     _heartbeat_bth.run([this]() {report_heart_beat();});
     _other_heartbeat_bth.run([this]() {report_other_heart_beat();});
@@ -1337,38 +1377,40 @@ int NetworkServer::make_worker_process() {
     if (FLAGS_need_health_check) {
         _health_check_bth.run([this]() {store_health_check();});
     }
-
-
-    // Create listen socket.
-    _service = create_listen_socket();
-    if (_service == nullptr) {
-        DB_FATAL("Failed to create listen socket.");
-        return -1;
-    }
-
-    // Initail epoll info.
-    _epoll_info = new EpollInfo();
-    if (!_epoll_info->init()) {
-        DB_FATAL("initial epoll info failed.");
-        return -1;
+    // reactor 0在当前线程运行，其余reactor各占一个线程，epoll_wait不占用bthread worker
+    for (int idx = 1; idx < reactor_num; ++idx) {
+        _reactor_threads.emplace_back([this, idx]() {reactor_loop(idx);});
     }
-    if (!_epoll_info->poll_events_add(_service, EPOLLIN)) {
-        DB_FATAL("poll_events_add add socket[%d] error", _service->fd);
-        return -1;
+    int ret = reactor_loop(0);
+    for (auto& thread : _reactor_threads) {
+        thread.join();
     }
+    _reactor_threads.clear();
+    DB_NOTICE("Baikal instance exit.");
+    return ret;
+}
+
+int NetworkServer::reactor_loop(int reactor_idx) {
+    EpollInfo* epoll_info = _epoll_infos[reactor_idx];
+    SmartSocket service = _services[reactor_idx];
     // Process epoll events.
-    int listen_fd = _service->fd;
+    int listen_fd = service != nullptr ? service->fd : -1;
     SocketFactory* socket_pool = SocketFactory::get_instance();
     while (!_shutdown) {
-        int fd_cnt = _epoll_info->wait(FLAGS_epoll_timeout);
-        if (_shutdown) {
+        int fd_cnt = epoll_info->wait(FLAGS_epoll_timeout);
+        if (_shutdown && service != nullptr) {
             // Delete event from epoll.
-            _epoll_info->poll_events_delete(_service);
+            epoll_info->poll_events_delete(service);
+        }
+        if (fd_cnt > 0) {
+            epoll_info->add_event_count(fd_cnt);
         }
 
         for (int cnt = 0; cnt < fd_cnt; ++cnt) {
-            int fd = _epoll_info->get_ready_fd(cnt);
-            int event = _epoll_info->get_ready_events(cnt);
+            int fd = epoll_info->get_ready_fd(cnt);
+            int event = epoll_info->get_ready_events(cnt);
+            // 连接固定在所属reactor上，新连接可能被分配到其他reactor
+            EpollInfo* sock_epoll_info = epoll_info;
 
             // New connection.
             if (!_shutdown && listen_fd == fd) {
@@ -1410,12 +1452,16 @@ int NetworkServer::make_worker_process() {
                 client_socket->addr = client_addr;
                 client_socket->server_instance_id = _instance_id;
 
+                if (_services.size() > 1 && _services[1] == nullptr) {
+                    // 只有reactor 0 accept，轮询分配给各reactor
+                    sock_epoll_info = _epoll_infos[_accept_count.fetch_add(1) % _epoll_infos.size()];
+                }
                 // Set socket mapping and event.
-                if (!_epoll_info->set_fd_mapping(client_socket->fd, client_socket)) {
+                if (!sock_epoll_info->set_fd_mapping(client_socket->fd, client_socket)) {
                     DB_FATAL("Failed to set fd mapping.");
                     return -1;
                 }
-                _epoll_info->poll_events_add(client_socket, 0);
+                sock_epoll_info->poll_events_add(client_socket, 0);
 
                 // New connection will be handled immediately.
                 fd = client_fd;
@@ -1427,7 +1473,7 @@ int NetworkServer::make_worker_process() {
             }
 
             // Check if socket in fd_mapping or not.
-            SmartSocket sock = _epoll_info->get_fd_mapping(fd);
+            SmartSocket sock = sock_epoll_info->get_fd_mapping(fd);
             if (sock == NULL) {
                 DB_DEBUG("Can't find fd in fd_mapping, fd:[%d], listen_fd:[%d], fd_cnt:[%d]",
                             fd, listen_fd, cnt);
@@ -1475,18 +1521,41 @@ int NetworkServer::make_worker_process() {
                 }
                 // close the socket event on epoll when the sock is being process
                 // and reopen it when finish process
-                _epoll_info->poll_events_mod(sock, 0);
-                MachineDriver::get_instance()->dispatch(sock, _epoll_info,
+                sock_epoll_info->poll_events_mod(sock, 0);
+                MachineDriver::get_instance()->dispatch(sock, sock_epoll_info,
                     sock->shutdown || _shutdown);
             } else {
                 DB_WARNING("unknown network socket type[%d].", sock->socket_type);
             }
         }
     }
-    DB_NOTICE("Baikal instance exit.");
+    DB_NOTICE("epoll reactor %d exit.", reactor_idx);
     return 0;
 }
 
+SmartSocket NetworkServer::get_fd_mapping(int fd, EpollInfo** epoll_info) {
+    // fd在进程内唯一，只会出现在一个reactor的fd_mapping中
+    for (auto info : _epoll_infos) {
+        SmartSocket sock = info->get_fd_mapping(fd);
+        if (sock != nullptr) {
+            if (epoll_info != nullptr) {
+                *epoll_info = info;
+            }
+            return sock;
+        }
+    }
+    return SmartSocket();
+}
+
+bool NetworkServer::all_txn_time_large_then(int64_t query_time, int64_t table_id) {
+    for (auto info : _epoll_infos) {
+        if (!info->all_txn_time_large_then(query_time, table_id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 std::string NetworkServer::state2str(SmartSocket client) {
     switch (client->state) {
     case STATE_CONNECTED_CLIENT: {
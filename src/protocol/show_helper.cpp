@@ -17,6 +17,7 @@
 #include "network_server.h"
 #include "store_interact.hpp"
 #include "query_context.h"
+#include "result_cache.h"
 #include "re2/re2.h"
 
 DEFINE_int64(show_table_status_cache_time, 3600 * 1000 * 1000LL, "show table status cache time : 3600s");
@@ -104,6 +105,8 @@ void ShowHelper::init() {
             this, std::placeholders::_1, std::placeholders::_2);
     _calls[SQL_SHOW_META_BINLOG] = std::bind(&ShowHelper::_show_meta_binlog,
             this, std::placeholders::_1, std::placeholders::_2);
+    _calls[SQL_SHOW_RESULT_CACHE] = std::bind(&ShowHelper::_show_result_cache,
+            this, std::placeholders::_1, std::placeholders::_2);
     _calls[SQL_SHOW_FUNCTION_STATUS] = std::bind(&ShowHelper::_show_function_status,
             this, std::placeholders::_1, std::placeholders::_2);
     _calls[SQL_SHOW_PROCEDURE_STATUS] = std::bind(&ShowHelper::_show_procedure_status,
@@ -1025,9 +1028,9 @@ bool ShowHelper::_show_socket(const SmartSocket& client, const std::vector<std::
         fields.emplace_back(field);
     } while (0);
     std::map<std::string, std::map<std::string, int>> ip_map;
-    EpollInfo* epoll_info = NetworkServer::get_instance()->get_epoll_info();
+    NetworkServer* server = NetworkServer::get_instance();
     for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        const SmartSocket& sock = epoll_info->get_fd_mapping(idx);
+        const SmartSocket& sock = server->get_fd_mapping(idx);
         if (sock == NULL || sock->is_free || sock->fd == -1 || sock->ip == "") {
             continue;
         }
@@ -1129,9 +1132,9 @@ bool ShowHelper::_show_processlist(const SmartSocket& client, const std::vector<
     // Make rows.
     std::vector< std::vector<std::string> > rows;
     rows.reserve(10);
-    EpollInfo* epoll_info = NetworkServer::get_instance()->get_epoll_info();
+    NetworkServer* server = NetworkServer::get_instance();
     for (int32_t idx = 0; idx < CONFIG_MPL_EPOLL_MAX_SIZE; ++idx) {
-        const SmartSocket& sock = epoll_info->get_fd_mapping(idx);
+        const SmartSocket& sock = server->get_fd_mapping(idx);
         if (sock == NULL || sock->is_free || sock->fd == -1 || sock->ip == "") {
             if (sock != NULL) {
                 DB_WARNING_CLIENT(sock, "processlist, free:%d", sock->is_free);
@@ -1885,7 +1888,8 @@ bool ShowHelper::_show_schema_conf(const SmartSocket& client, const std::vector<
                                                     "backup_table",
                                                     "in_fast_import",
                                                     "tail_split_num",
-                                                    "tail_split_step"};
+                                                    "tail_split_step",
+                                                    "result_cache_ttl_s"};
     // 前三个conf按照bool解析, pk_prefix_balance按照int32来解析
     if (split_vec.size() != 3 || allowed_conf.find(split_vec[2]) == allowed_conf.end()) {
         client->state = STATE_ERROR;
@@ -3800,6 +3804,35 @@ bool ShowHelper::_show_abnormal_switch(const SmartSocket& client, const std::vec
     return true;
 }
 
+bool ShowHelper::_show_result_cache(const SmartSocket& client, const std::vector<std::string>& split_vec) {
+    if (client == nullptr || client->query_ctx == nullptr) {
+        DB_FATAL("param invalid");
+        return false;
+    }
+    std::vector<ResultField> fields;
+    std::vector<std::string> names = {"key", "sql", "result_size", "rows", "hit_count", "age_s", "ttl_left_s"};
+    fields.reserve(names.size());
+    for (auto& name : names) {
+        ResultField field;
+        field.name = name;
+        field.type = MYSQL_TYPE_VARCHAR;
+        field.length = 1024;
+        fields.emplace_back(field);
+    }
+    std::vector<std::vector<std::string>> rows;
+    ResultCache::get_instance()->get_info(rows);
+
+    // Make mysql packet.
+    if (_make_common_resultset_packet(client, fields, rows) != 0) {
+        DB_FATAL_CLIENT(client, "Failed to make result packet.");
+        _wrapper->make_err_packet(client, ER_MAKE_RESULT_PACKET, "Failed to make result packet.");
+        client->state = STATE_ERROR;
+        return false;
+    }
+    client->state = STATE_READ_QUERY_RESULT;
+    return true;
+}
+
 //  handle meta_binlog instance;
 //  handle meta_binlog db table;
 bool ShowHelper::_show_meta_binlog(const SmartSocket& client, const std::vector<std::string>& split_vec) {
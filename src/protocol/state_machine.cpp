@@ -16,6 +16,7 @@
 #include <boost/algorithm/string.hpp>
 #include "network_server.h"
 #include "query_context.h"
+#include "result_cache.h"
 #include "store_interact.hpp"
 #include <rapidjson/reader.h>
 #include <rapidjson/document.h>
@@ -28,6 +29,7 @@ DEFINE_int32(query_quota_per_user, 3000, "default user query quota by 1 second")
 DEFINE_string(log_plat_name, "test", "plat name for print log, distinguish monitor");
 DEFINE_int64(baikal_max_allowed_packet, 268435456LL, "The largest possible packet : 256M");
 DECLARE_int64(print_time_us);
+DECLARE_bool(enable_stream_result);
 DECLARE_string(meta_server_bns);
 DECLARE_int32(baikal_port);
 DECLARE_bool(open_to_collect_slow_query_infos);
@@ -129,6 +131,10 @@ void StateMachine::run_machine(SmartSocket client,
         TimeCost cost;
         int ret = _wrapper->auth_result_send(client);
         if (ret == RET_SUCCESS) {
+            // 认证OK包以非压缩格式发送，之后的包都走压缩协议
+            if (client->need_compress) {
+                _wrapper->enable_compress(client.get());
+            }
             client->state = STATE_SEND_AUTH_RESULT;
             epoll_info->poll_events_mod(client, EPOLLIN);
         } else if (ret == RET_WAIT_FOR_EVENT) {
@@ -550,6 +556,8 @@ int StateMachine::_auth_read(SmartSocket sock) {
         DB_WARNING("read capability failed");
         return RET_ERROR;
     }
+    // 服务端开启压缩时才会在握手包中声明CLIENT_COMPRESS
+    sock->need_compress = (capability & CLIENT_COMPRESS) != 0;
 
     off = PACKET_HEADER_LEN + 8;
     uint8_t charset_num = 0;
@@ -1000,6 +1008,7 @@ bool StateMachine::_query_process(SmartSocket client) {
     bool ret = true;
     auto command = client->query_ctx->mysql_cmd;
     int type = client->query_ctx->type;
+    client->wait_async_commit();
     if (command == COM_PING) {            // 0x0e command:MYSQL_PING
         _wrapper->make_simple_ok_packet(client);
         client->state = STATE_READ_QUERY_RESULT;
@@ -1186,11 +1195,21 @@ int StateMachine::_get_json_attributes(std::shared_ptr<QueryContext> ctx) {
             if (json_iter != root.MemberEnd() && json_iter->value.IsString()) {
                 ctx->stat_info.trace_id = json_iter->value.GetString();
             }
+            json_iter = root.FindMember("result_cache");
+            if (json_iter != root.MemberEnd() && json_iter->value.IsInt64()) {
+                ctx->result_cache_ttl_s = json_iter->value.GetInt64();
+                DB_DEBUG("result_cache_ttl_s: %ld", ctx->result_cache_ttl_s);
+            }
             json_iter = root.FindMember("peer_index");
             if (json_iter != root.MemberEnd()) {
                 ctx->peer_index = json_iter->value.GetInt64();
                 DB_WARNING("peer_index: %ld", ctx->peer_index);
             }
+            json_iter = root.FindMember("max_staleness");
+            if (json_iter != root.MemberEnd() && json_iter->value.IsInt64()) {
+                ctx->max_staleness_ms = json_iter->value.GetInt64();
+                DB_DEBUG("max_staleness_ms: %ld", ctx->max_staleness_ms);
+            }
         } catch (...) {
             DB_WARNING("parse extra file error [%s]", json_str.c_str());
             continue;
@@ -1512,6 +1531,10 @@ int StateMachine::_reset_network_socket_client_resource(SmartSocket client) {
     client->send_buf->byte_array_clear();
     client->self_buf->byte_array_clear();
     client->send_buf_offset = 0;
+    if (client->compress_send_buf != nullptr) {
+        client->compress_send_buf->byte_array_clear();
+        client->compress_send_offset = 0;
+    }
     client->packet_len = 0;
     return 0;
 }
@@ -1544,6 +1567,25 @@ void StateMachine::client_free(SmartSocket sock, EpollInfo* epoll_info) {
     sock->is_free = true;
 }
 
+// 与mysql一致，死锁的事务整体回滚，不能只回滚当前语句后继续执行，
+// 否则事务已持有的锁不释放，重试时仍会死锁
+// 复用rollback语句，autocommit=0时同时开启新事务；丢弃其返回包，客户端只收到死锁错误
+void StateMachine::_rollback_txn_on_deadlock(SmartSocket client) {
+    SmartQueryContex failed_ctx = client->query_ctx;
+    size_t send_buf_size = client->send_buf->_size;
+    int packet_id = client->packet_id;
+    DB_WARNING_CLIENT(client, "deadlock, rollback txn_id:%lu seq_id:%d", client->txn_id, client->seq_id);
+    client->reset_query_ctx(new (std::nothrow)QueryContext(client->user_info, client->current_db));
+    client->query_ctx->sql = "rollback";
+    _handle_client_query_common_query(client);
+    client->send_buf->_size = send_buf_size;
+    client->packet_id = packet_id;
+    {
+        BAIDU_SCOPED_LOCK(client->region_lock);
+        client->query_ctx = failed_ctx;
+    }
+}
+
 int StateMachine::_get_query_type(std::shared_ptr<QueryContext> ctx) {
     _parse_comment(ctx);
 
@@ -1639,6 +1681,52 @@ int StateMachine::_get_query_type(std::shared_ptr<QueryContext> ctx) {
     return SQL_WRITE_NUM;
 }
 
+static void get_query_tables(QueryContext* ctx, std::set<int64_t>& table_ids) {
+    for (auto& tuple_desc : ctx->tuple_descs()) {
+        if (tuple_desc.has_table_id()) {
+            table_ids.insert(tuple_desc.table_id());
+        }
+    }
+    for (auto& sub_ctx : ctx->sub_query_plans) {
+        get_query_tables(sub_ctx.get(), table_ids);
+    }
+    for (auto& pair : ctx->derived_table_ctx_mapping) {
+        get_query_tables(pair.second.get(), table_ids);
+    }
+}
+
+int64_t StateMachine::_get_result_cache_ttl(SmartSocket client, std::set<int64_t>& table_ids) {
+    QueryContext* ctx = client->query_ctx.get();
+    if (!FLAGS_enable_result_cache || ctx->mysql_cmd != COM_QUERY
+            || ctx->stmt_type != parser::NT_SELECT || client->txn_id != 0
+            || ctx->explain_type != EXPLAIN_NULL || ctx->is_full_export
+            || ctx->has_information_schema) {
+        return 0;
+    }
+    // 由planner根据表达式树标记，子查询的标记已合并到外层
+    if (ctx->has_non_deterministic_expr) {
+        return 0;
+    }
+    get_query_tables(ctx, table_ids);
+    if (table_ids.empty()) {
+        return 0;
+    }
+    if (ctx->result_cache_ttl_s > 0) {
+        return ctx->result_cache_ttl_s;
+    }
+    // 未指定hint时，所有表都配置了ttl才缓存，取最小值
+    int64_t ttl_s = INT64_MAX;
+    for (int64_t table_id : table_ids) {
+        int32_t table_ttl_s = 0;
+        if (SchemaFactory::get_instance()->get_schema_conf_value<int32_t>(
+                table_id, TABLE_RESULT_CACHE_TTL, table_ttl_s) != 0 || table_ttl_s <= 0) {
+            return 0;
+        }
+        ttl_s = std::min(ttl_s, (int64_t)table_ttl_s);
+    }
+    return ttl_s;
+}
+
 bool StateMachine::_handle_client_query_common_query(SmartSocket client) {
     if (client == nullptr) {
         DB_FATAL("param invalid: socket==NULL");
@@ -1677,6 +1765,30 @@ bool StateMachine::_handle_client_query_common_query(SmartSocket client) {
         client->query_ctx->stat_info.old_seq_id = client->seq_id;
         return true;
     }
+    // 只读查询结果缓存
+    std::set<int64_t> result_cache_tables;
+    int64_t result_cache_ttl_s = _get_result_cache_ttl(client, result_cache_tables);
+    uint64_t result_cache_key = 0;
+    TableVersionMap result_cache_versions;
+    int result_start_packet_id = client->packet_id;
+    size_t result_start_pos = client->send_buf->_size;
+    if (result_cache_ttl_s > 0) {
+        result_cache_key = ResultCache::make_key(client->query_ctx->stat_info.sign,
+                client->current_db, client->charset_name, client->username, client->query_ctx->sql);
+        auto item = ResultCache::get_instance()->find(result_cache_key, client->query_ctx->sql);
+        if (item != nullptr && item->start_packet_id == client->packet_id
+                && ResultCache::get_instance()->check_region_versions(item)) {
+            client->send_buf->byte_array_append_len((const uint8_t*)item->result.data(),
+                    item->result.size());
+            client->packet_id = item->end_packet_id;
+            client->query_ctx->stat_info.hit_cache = true;
+            client->query_ctx->stat_info.num_returned_rows = item->num_returned_rows;
+            client->query_ctx->stat_info.send_buf_size = client->send_buf->_size;
+            return true;
+        }
+        ResultCache::get_instance()->get_table_versions(result_cache_tables, result_cache_versions);
+        client->query_ctx->record_region_versions = true;
+    }
     // const std::vector<pb::TupleDescriptor>& tuples = ctx->tuple_descs();
     // for (uint32_t idx = 0; idx < tuples.size(); ++idx) {
     //     DB_WARNING("TupleDescriptor: %s", pb2json(tuples[idx]).c_str());
@@ -1793,6 +1905,8 @@ bool StateMachine::_handle_client_query_common_query(SmartSocket client) {
     //DB_WARNING("client: %ld ,seq_id: %d", client.get(), client->seq_id);
     // 不会有fether那一层，重构
     if (!client->query_ctx->is_full_export) {
+        // 结果缓存需要完整结果，不能流式发送
+        client->query_ctx->stream_result = FLAGS_enable_stream_result && result_cache_ttl_s <= 0;
         ret = PhysicalPlanner::execute(client->query_ctx.get(), client->send_buf);
         //DB_WARNING("client: %ld ,seq_id: %d", client.get(), client->seq_id);
         // 空值优化时可能执行不到TransactionNode
@@ -1801,7 +1915,8 @@ bool StateMachine::_handle_client_query_common_query(SmartSocket client) {
             client->on_commit_rollback();
          }
         client->query_ctx->stat_info.query_exec_time = cost.get_time();
-        client->query_ctx->stat_info.send_buf_size = client->send_buf->_size;
+        // 流式发送的部分已在MysqlWrapper::stream_write中累加
+        client->query_ctx->stat_info.send_buf_size += client->send_buf->_size;
     } else {
         ret = PhysicalPlanner::full_export_start(client->query_ctx.get(), client->send_buf);
         client->query_ctx->stat_info.query_exec_time += cost.get_time();
@@ -1814,11 +1929,29 @@ bool StateMachine::_handle_client_query_common_query(SmartSocket client) {
             client->query_ctx->stat_info.error_code = ER_EXEC_PLAN_FAILED;
             client->query_ctx->stat_info.error_msg << "exec physical plan failed";
         }
+        if (client->query_ctx->stat_info.error_code == ER_LOCK_DEADLOCK && client->txn_id != 0) {
+            _rollback_txn_on_deadlock(client);
+        }
         _wrapper->make_err_packet(client,
             client->query_ctx->stat_info.error_code, "%s",
             client->query_ctx->stat_info.error_msg.str().c_str());
         return false;
     }
+    if (result_cache_ttl_s > 0 && client->send_buf->_size > result_start_pos) {
+        auto item = std::make_shared<ResultCacheItem>();
+        item->key = result_cache_key;
+        item->sql = client->query_ctx->sql;
+        item->result.assign((const char*)client->send_buf->_data + result_start_pos,
+                client->send_buf->_size - result_start_pos);
+        item->start_packet_id = result_start_packet_id;
+        item->end_packet_id = client->packet_id;
+        item->num_returned_rows = client->query_ctx->stat_info.num_returned_rows;
+        item->create_time_us = butil::gettimeofday_us();
+        item->expire_time_us = item->create_time_us + result_cache_ttl_s * 1000000LL;
+        item->table_versions.swap(result_cache_versions);
+        item->region_versions.swap(client->query_ctx->region_versions);
+        ResultCache::get_instance()->add(item);
+    }
     return true;
 }
 } // namespace baikal
@@ -63,9 +63,9 @@ void TaskManager::process_txn_ddl_work(pb::DdlWorkInfo work) {
                 continue;
             }
         }
-        auto epool_ptr = NetworkServer::get_instance()->get_epoll_info();
-        if (epool_ptr != nullptr) {
-            if (epool_ptr->all_txn_time_large_then(write_only_time, work.table_id())) {
+        auto server = NetworkServer::get_instance();
+        if (server->is_epoll_inited()) {
+            if (server->all_txn_time_large_then(write_only_time, work.table_id())) {
                 DB_NOTICE("epool time write_only_time %ld", write_only_time);
                 work.set_status(pb::DdlWorkDone);
                 break;
@@ -14,13 +14,64 @@
 
 #include "log_entry_reader.h"
 #include "my_raft_log_storage.h"
+#include "segment_log_storage.h"
 #include "common.h"
 #include "table_key.h"
 #include "mut_table_key.h"
 #include "proto/store.interface.pb.h"
 
 namespace baikaldb {
+int LogEntryReader::read_segment_txn_log_entry(int64_t region_id, int64_t start_log_index,
+        int64_t end_log_index, std::set<uint64_t>& txn_ids,
+        std::map<int64_t, std::pair<uint64_t, std::string>>& log_entrys) {
+    SegmentLogManager* manager = SegmentLogManager::get_instance();
+    int64_t first_log_index = 0;
+    int64_t last_log_index = 0;
+    manager->get_log_index(region_id, first_log_index, last_log_index);
+    start_log_index = std::max(start_log_index, first_log_index);
+    end_log_index = std::min(end_log_index, last_log_index);
+    for (int64_t log_index = start_log_index; log_index <= end_log_index; ++log_index) {
+        int64_t term = 0;
+        int type = 0;
+        std::string value;
+        if (manager->read_entry(region_id, log_index, term, type, value) != 0) {
+            DB_WARNING("read end info, region_id: %ld, log_index:%ld", region_id, log_index);
+            break;
+        }
+        if (type != braft::ENTRY_TYPE_DATA) {
+            continue;
+        }
+        pb::StoreReq store_req;
+        if (!store_req.ParseFromString(value)) {
+            DB_FATAL("Fail to parse request fail, region_id: %ld", region_id);
+            return -1;
+        }
+        if (!is_txn_op_type(store_req.op_type()) || store_req.txn_infos_size() == 0) {
+            continue;
+        }
+        uint64_t txn_id = store_req.txn_infos(0).txn_id();
+        if (txn_ids.count(txn_id) == 1) {
+            log_entrys[log_index] = std::make_pair(txn_id, std::move(value));
+            DB_WARNING("read txn log entry region_id:%ld, log_index:%ld, txn_id:%ld", region_id, log_index, txn_id);
+        }
+    }
+    return 0;
+}
+
 int LogEntryReader::read_log_entry(int64_t region_id, int64_t log_index, std::string& log_entry) {
+    if (SegmentLogManager::get_instance()->has_region(region_id)) {
+        int64_t term = 0;
+        int type = 0;
+        if (SegmentLogManager::get_instance()->read_entry(region_id, log_index, term, type, log_entry) != 0) {
+            DB_FATAL("read log entry fail, region_id: %ld, log_index: %ld", region_id, log_index);
+            return -1;
+        }
+        if (type != braft::ENTRY_TYPE_DATA) {
+            DB_FATAL("log entry is not data, log_index:%ld, region_id: %ld", log_index, region_id);
+            return -1;
+        }
+        return 0;
+    }
     MutTableKey log_data_key;
     log_data_key.append_i64(region_id).append_u8(MyRaftLogStorage::LOG_DATA_IDENTIFY).append_i64(log_index);
     std::string log_value;
@@ -50,6 +101,15 @@ int LogEntryReader::read_log_entry(int64_t region_id, int64_t start_log_index, i
         return -1;
     }
     TimeCost cost;
+    if (SegmentLogManager::get_instance()->has_region(region_id)) {
+        std::map<int64_t, std::pair<uint64_t, std::string>> txn_log_entrys;
+        int ret = read_segment_txn_log_entry(region_id, start_log_index, end_log_index, txn_ids, txn_log_entrys);
+        for (auto& pair : txn_log_entrys) {
+            log_entrys[pair.first] = std::move(pair.second.second);
+        }
+        DB_WARNING("read txn log entry region_id:%ld, time_cost:%ld", region_id, cost.get_time());
+        return ret;
+    }
     std::string log_entry;
     MutTableKey log_data_key;
     MutTableKey prefix;
@@ -112,6 +172,15 @@ int LogEntryReader::read_txn_last_log_entry(int64_t region_id, int64_t start_log
         return 0;
     }
     TimeCost cost;
+    if (SegmentLogManager::get_instance()->has_region(region_id)) {
+        std::map<int64_t, std::pair<uint64_t, std::string>> txn_log_entrys;
+        int ret = read_segment_txn_log_entry(region_id, start_log_index, end_log_index, txn_ids, txn_log_entrys);
+        for (auto& pair : txn_log_entrys) {
+            log_entrys[pair.second.first] = std::move(pair.second.second);
+        }
+        DB_WARNING("read txn log entry region_id:%ld, time_cost:%ld", region_id, cost.get_time());
+        return ret;
+    }
     std::string log_entry;
     MutTableKey log_data_key;
     MutTableKey prefix;
@@ -15,6 +15,7 @@
 #include <my_raft_log.h>
 #include <my_raft_log_storage.h>
 #include <my_raft_meta_storage.h>
+#include <segment_log_storage.h>
 #include <pthread.h> 
 
 namespace baikaldb {
@@ -25,12 +26,14 @@ struct MyRaftExtension {
     MyRaftLogStorage my_raft_log_storage;
     MyRaftLogStorage my_bin_log_storage;
     MyRaftMetaStorage my_raft_meta_storage;
+    SegmentLogStorage segment_log_storage;
 };
 
 static void register_once_or_die() {
     static MyRaftExtension* s_ext = new MyRaftExtension;
     braft::log_storage_extension()->RegisterOrDie("myraftlog", &s_ext->my_raft_log_storage);
     braft::log_storage_extension()->RegisterOrDie("mybinlog", &s_ext->my_bin_log_storage);
+    braft::log_storage_extension()->RegisterOrDie("segmentlog", &s_ext->segment_log_storage);
 #ifdef BAIDU_INTERNAL
     braft::stable_storage_extension()->RegisterOrDie("myraftmeta", &s_ext->my_raft_meta_storage);
 #else
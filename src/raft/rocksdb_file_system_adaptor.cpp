@@ -13,6 +13,11 @@
 // limitations under the License.
 
 #include "rocksdb_file_system_adaptor.h"
+#ifdef BAIDU_INTERNAL
+#include <base/crc32c.h>
+#else
+#include <butil/crc32c.h>
+#endif
 #include "mut_table_key.h"
 #include "sst_file_writer.h"
 #include "meta_writer.h"
@@ -21,12 +26,47 @@
 
 namespace baikaldb {
 DEFINE_int64(snapshot_timeout_min, 10, "snapshot_timeout_min : 10min");
+DEFINE_int32(snapshot_max_chunk_num, 1, "split region data snapshot into at most N key range chunks, "
+        "1 means no split, enable after all stores upgraded");
+DEFINE_int64(snapshot_chunk_size, 1024 * 1024 * 1024LL, "region data size per snapshot chunk");
+DEFINE_bool(snapshot_read_ahead, false, "generate next snapshot package while sending current one");
+
+bool parse_snapshot_data_chunk(const std::string& path, int* chunk_idx, int* chunk_num) {
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    if (name.compare(0, SNAPSHOT_DATA_FILE.size() + 1, SNAPSHOT_DATA_FILE + "_") != 0) {
+        return false;
+    }
+    int idx = 0;
+    int num = 0;
+    char tail = 0;
+    if (sscanf(name.c_str() + SNAPSHOT_DATA_FILE.size(), "_%d_%d%c", &idx, &num, &tail) != 2) {
+        return false;
+    }
+    if (num < 1 || idx < 0 || idx >= num) {
+        return false;
+    }
+    *chunk_idx = idx;
+    *chunk_num = num;
+    return true;
+}
+
+int snapshot_data_chunk_num(uint64_t region_size) {
+    // region_size未知时为UINT64_MAX，按最大chunk数拆分，空chunk代价很小
+    if (FLAGS_snapshot_max_chunk_num <= 1 || FLAGS_snapshot_chunk_size <= 0) {
+        return 1;
+    }
+    uint64_t num = region_size / FLAGS_snapshot_chunk_size + 1;
+    return std::min(num, (uint64_t)FLAGS_snapshot_max_chunk_num);
+}
+
 bool inline is_snapshot_data_file(const std::string& path) {
     butil::StringPiece sp(path);
     if (sp.ends_with(SNAPSHOT_DATA_FILE_WITH_SLASH)) {
         return true;
     }
-    return false;
+    int chunk_idx = 0;
+    int chunk_num = 0;
+    return parse_snapshot_data_chunk(path, &chunk_idx, &chunk_num);
 }
 bool inline is_snapshot_meta_file(const std::string& path) {
     butil::StringPiece sp(path);
@@ -88,6 +128,9 @@ void RocksdbReaderAdaptor::context_reset() {
     iter_context->snapshot_index = _context->snapshot_index;
     iter_context->need_copy_data = _context->need_copy_data;
     iter_context->sc = _context->sc;
+    iter_context->chunk_idx = _context->chunk_idx;
+    iter_context->chunk_num = _context->chunk_num;
+    iter_context->start_key = _context->start_key;
     if (!iter_context->is_meta_sst) {
         rocksdb::ReadOptions read_options;
         read_options.snapshot = iter_context->sc->snapshot;
@@ -96,8 +139,12 @@ void RocksdbReaderAdaptor::context_reset() {
         read_options.iterate_upper_bound = &iter_context->upper_bound_slice;
         rocksdb::ColumnFamilyHandle* column_family = RocksWrapper::get_instance()->get_data_handle();
         iter_context->iter.reset(RocksWrapper::get_instance()->new_iterator(read_options, column_family));
-        iter_context->iter->Seek(iter_context->prefix);
-        iter_context->sc->data_context = iter_context;
+        iter_context->iter->Seek(iter_context->start_key);
+        if (iter_context->chunk_num > 1) {
+            iter_context->sc->chunk_contexts[iter_context->chunk_idx] = iter_context;
+        } else {
+            iter_context->sc->data_context = iter_context;
+        }
     } else {        
         rocksdb::ReadOptions read_options;
         read_options.snapshot = iter_context->sc->snapshot;
@@ -123,6 +170,10 @@ ssize_t RocksdbReaderAdaptor::read(butil::IOPortal* portal, off_t offset, size_t
         return -1;
     }
 
+    // 预读bthread会修改_context，先等其结束
+    if (wait_read_ahead() != 0) {
+        return -1;
+    }
     if (region_shutdown()) {
         DB_FATAL("region_id: %ld shutdown, "
                 "last_off:%lu, off:%lu, ctx->off:%lu, size:%lu", 
@@ -137,36 +188,62 @@ ssize_t RocksdbReaderAdaptor::read(butil::IOPortal* portal, off_t offset, size_t
                 _region_id, time_cost.get_time());
         return 0;
     }
-    if (offset > _context->offset) {
+    // 预读的包对端还未收到，不计入offset
+    int64_t read_offset = _context->offset - _read_ahead_package.size();
+    if (offset > read_offset) {
         DB_FATAL("region_id: %ld, retry last_offset, offset biger fail "
                 "time_cost: %ld, last_off:%lu, off:%lu, ctx->off:%lu, size:%lu", 
-                _region_id, time_cost.get_time(), _last_offset, offset, _context->offset, size);
+                _region_id, time_cost.get_time(), _last_offset, offset, read_offset, size);
         return -1;
     }
-    if (offset < _context->offset) {
+    if (offset < read_offset) {
         // 缓存上一个包，重试一次可以恢复
         if (_last_offset == offset) {
             *portal = _last_package;
             DB_FATAL("region_id: %ld, retry last_offset time_cost: %ld, "
                     "off:%lu, ctx->off:%lu, size:%lu, ret_size:%lu", 
-                    _region_id, time_cost.get_time(), offset, _context->offset, size, _last_package.size());
+                    _region_id, time_cost.get_time(), offset, read_offset, size, _last_package.size());
             return _last_package.size();
         }
 
-        // 重置 _context
+        // 重置 _context，拆分chunk时只需重读当前chunk
         if (offset == 0 && _context->offset_update_time.get_time() > FLAGS_snapshot_timeout_min * 60 * 1000 * 1000ULL) {
             _last_offset = 0;
             _num_lines = 0;
+            _read_ahead_package.clear();
             context_reset();
-            DB_FATAL("region_id: %ld, context_reset", _region_id);
+            DB_FATAL("region_id: %ld, context_reset, chunk: %d/%d", 
+                    _region_id, _context->chunk_idx, _context->chunk_num);
         } else {
             DB_FATAL("region_id: %ld, retry last_offset fail time_cost: %ld, "
                     "last_off:%lu, off:%lu, ctx->off:%lu, size:%lu", 
-                    _region_id, time_cost.get_time(), _last_offset, offset, _context->offset, size);
+                    _region_id, time_cost.get_time(), _last_offset, offset, read_offset, size);
             return -1;
         }
     }
 
+    int64_t count = 0;
+    if (!_read_ahead_package.empty()) {
+        portal->swap(_read_ahead_package);
+        _read_ahead_package.clear();
+        count = portal->size();
+    } else {
+        count = read_package(portal, size);
+        if (count < 0) {
+            return -1;
+        }
+    }
+    DB_WARNING("region_id: %ld read done. count: %ld, time_cost: %ld, "
+            "off:%lu, size:%lu, last_off:%lu, last_count:%lu", 
+                _region_id, count, time_cost.get_time(), offset, size, 
+                _last_offset, _last_package.size());
+    _last_offset = offset;
+    _last_package = *portal;
+    start_read_ahead(size);
+    return count;
+}
+
+int64_t RocksdbReaderAdaptor::read_package(butil::IOPortal* portal, size_t size) {
     size_t count = 0;
     int64_t key_num = 0;
     std::string log_index_prefix = MetaWriter::get_instance()->log_index_key_prefix(_region_id);
@@ -180,18 +257,24 @@ ssize_t RocksdbReaderAdaptor::read(butil::IOPortal* portal, off_t offset, size_t
         if (!_context->iter->Valid()
                 || !_context->iter->key().starts_with(_context->prefix)) {
             _context->done = true;
+            if (_context->chunk_num > 1 && !_context->chunk_trailer_sent) {
+                // chunk结尾带上key数和校验和，接收端据此校验
+                portal->append((void*)&SNAPSHOT_CHUNK_TRAILER_FLAG, sizeof(size_t));
+                portal->append((void*)&_context->chunk_key_count, sizeof(int64_t));
+                portal->append((void*)&_context->chunk_crc, sizeof(uint32_t));
+                count += SNAPSHOT_CHUNK_TRAILER_SIZE;
+                _context->offset += SNAPSHOT_CHUNK_TRAILER_SIZE;
+                _context->chunk_trailer_sent = true;
+            }
             //portal->append((void*)iter_context->offset, sizeof(size_t));
-            DB_WARNING("region_id: %ld snapshot read over, total size: %ld", _region_id, _context->offset);
+            DB_WARNING("region_id: %ld snapshot read over, total size: %ld, chunk: %d/%d", 
+                    _region_id, _context->offset, _context->chunk_idx, _context->chunk_num);
             auto region = Store::get_instance()->get_region(_region_id);
             if (region == nullptr) {
                 DB_FATAL("region_id: %ld is null region", _region_id);
                 return -1;
             }
-            if (_context->is_meta_sst) {
-                region->set_snapshot_meta_size(_context->offset);
-            } else {
-                region->set_snapshot_data_size(_context->offset);
-            }
+            set_snapshot_size(region);
             break;
         }
         // debug meta region_info applied_index
@@ -234,8 +317,15 @@ ssize_t RocksdbReaderAdaptor::read(butil::IOPortal* portal, off_t offset, size_t
             
         } else {
             key_num++;
-            read_size += serialize_to_iobuf(portal, _context->iter->key());
-            read_size += serialize_to_iobuf(portal, _context->iter->value());
+            rocksdb::Slice key = _context->iter->key();
+            rocksdb::Slice value = _context->iter->value();
+            read_size += serialize_to_iobuf(portal, key);
+            read_size += serialize_to_iobuf(portal, value);
+            if (_context->chunk_num > 1) {
+                ++_context->chunk_key_count;
+                _context->chunk_crc = butil::crc32c::Extend(_context->chunk_crc, key.data(), key.size());
+                _context->chunk_crc = butil::crc32c::Extend(_context->chunk_crc, value.data(), value.size());
+            }
         }
         count += read_size;
         ++_num_lines;
@@ -243,27 +333,72 @@ ssize_t RocksdbReaderAdaptor::read(butil::IOPortal* portal, off_t offset, size_t
         _context->offset_update_time.reset();
         _context->iter->Next();
     }
-    DB_WARNING("region_id: %ld read done. count: %ld, key_num: %ld, time_cost: %ld, "
-            "off:%lu, size:%lu, last_off:%lu, last_count:%lu", 
-                _region_id, count, key_num, time_cost.get_time(), offset, size, 
-                _last_offset, _last_package.size());
-    _last_offset = offset;
-    _last_package = *portal;
+    DB_DEBUG("region_id: %ld read package, count: %ld, key_num: %ld", _region_id, count, key_num);
     return count;
 }
 
+void RocksdbReaderAdaptor::set_snapshot_size(SmartRegion region) {
+    if (_context->is_meta_sst) {
+        region->set_snapshot_meta_size(_context->offset);
+        return;
+    }
+    if (_context->chunk_num <= 1) {
+        region->set_snapshot_data_size(_context->offset);
+        return;
+    }
+    // 各chunk大小之和，与接收端收到的数据量比较
+    SnapshotContext* sc = _context->sc;
+    BAIDU_SCOPED_LOCK(sc->chunk_size_mutex);
+    sc->chunk_sizes[_context->chunk_idx] = _context->offset;
+    int64_t total_size = 0;
+    for (auto& pair : sc->chunk_sizes) {
+        total_size += pair.second;
+    }
+    region->set_snapshot_data_size(total_size);
+}
+
+void RocksdbReaderAdaptor::start_read_ahead(size_t size) {
+    // meta数据量小，不预读
+    if (!FLAGS_snapshot_read_ahead || _is_meta_reader || _context->done) {
+        return;
+    }
+    _read_ahead_running = true;
+    _read_ahead_bth.run([this, size]() {
+        _read_ahead_ret = read_package(&_read_ahead_package, size);
+    });
+}
+
+int RocksdbReaderAdaptor::wait_read_ahead() {
+    if (!_read_ahead_running) {
+        return 0;
+    }
+    _read_ahead_bth.join();
+    _read_ahead_running = false;
+    if (_read_ahead_ret < 0) {
+        DB_FATAL("region_id: %ld read ahead fail, ctx->off:%lu", _region_id, _context->offset);
+        _read_ahead_package.clear();
+        return -1;
+    }
+    return 0;
+}
+
 bool RocksdbReaderAdaptor::close() {
     if (_closed) {
         DB_WARNING("file has been closed, region_id: %ld, num_lines: %ld, path: %s", 
                 _region_id, _num_lines, _path.c_str());
         return true;
     }
+    wait_read_ahead();
     _rs->close(_path);
     _closed = true;
     return true;
 }
 
 ssize_t RocksdbReaderAdaptor::size() {
+    // 预读中的数据对端还未收到，_context不能访问
+    if (_read_ahead_running || !_read_ahead_package.empty()) {
+        return std::numeric_limits<ssize_t>::max();
+    }
     if (_context->done) {
         return _context->offset;
     }
@@ -299,10 +434,10 @@ int SstWriterAdaptor::open() {
         return -1;
     }
     _is_meta = _path.find("meta") != std::string::npos;
-    std::string path = _path;
     if (!_is_meta) {
-        path += std::to_string(_sst_idx);
+        parse_snapshot_data_chunk(_path, &_chunk_idx, &_chunk_num);
     }
+    std::string path = sst_path();
     auto s = _writer->open(path);
     if (!s.ok()) {
         DB_FATAL("open sst file path: %s failed, err: %s, region_id: %ld",
@@ -316,10 +451,7 @@ int SstWriterAdaptor::open() {
 
 ssize_t SstWriterAdaptor::write(const butil::IOBuf& data, off_t offset) {
     (void)offset;
-    std::string path = _path;
-    if (!_is_meta) {
-        path += std::to_string(_sst_idx);
-    }
+    std::string path = sst_path();
     if (region_shutdown()) {
         DB_FATAL("write sst file path: %s failed, region shutdown, data len: %lu, region_id: %ld",
                 path.c_str(), data.size(), _region_id);
@@ -349,7 +481,7 @@ ssize_t SstWriterAdaptor::write(const butil::IOBuf& data, off_t offset) {
         }
         _count = 0;
         ++_sst_idx;
-        path = _path + std::to_string(_sst_idx);
+        path = sst_path();
         auto s = _writer->open(path);
         if (!s.ok()) {
             DB_FATAL("open sst file path: %s failed, err: %s, region_id: %ld", 
@@ -376,17 +508,26 @@ bool SstWriterAdaptor::close() {
     _closed = true;
     if (_is_meta) {
         _region_ptr->set_snapshot_meta_size(_data_size);
-    } else {
+    } else if (_chunk_idx == 0) {
+        // chunk文件名排序后chunk 0最先拷贝
         _region_ptr->set_snapshot_data_size(_data_size);
+    } else {
+        _region_ptr->add_snapshot_data_size(_data_size);
+    }
+    if (!finish_sst()) {
+        return false;
     }
-    return finish_sst();
+    // leader判断无需复制数据时chunk为空
+    if (_chunk_num > 1 && _data_size > 0 && !_chunk_verified) {
+        DB_FATAL("snapshot chunk not verified, path: %s, region_id: %ld, key_count: %ld",
+                _path.c_str(), _region_id, _chunk_key_count);
+        return false;
+    }
+    return true;
 }
 
 bool SstWriterAdaptor::finish_sst() {
-    std::string path = _path;
-    if (!_is_meta) {
-        path += std::to_string(_sst_idx);
-    }
+    std::string path = sst_path();
     if (_count > 0) {
         DB_WARNING("_writer finished, path: %s, region_id: %ld, file_size: %lu, total_count: %ld, all_size:%lu",
                 path.c_str(), _region_id, _writer->file_size(), _count, _data_size);
@@ -435,6 +576,17 @@ int SstWriterAdaptor::iobuf_to_sst(butil::IOBuf data) {
             DB_FATAL("read key size from iobuf fail, region_id: %ld", _region_id);
             return -1;
         }
+        if (_chunk_verified) {
+            DB_FATAL("receive data after chunk trailer, path: %s, region_id: %ld",
+                    _path.c_str(), _region_id);
+            return -1;
+        }
+        if (_chunk_num > 1 && key_size == SNAPSHOT_CHUNK_TRAILER_FLAG) {
+            if (check_chunk_trailer(data) != 0) {
+                return -1;
+            }
+            continue;
+        }
         rocksdb::Slice key;
         std::unique_ptr<char[]> big_key_buf; 
         // sst_file_writer不支持SliceParts，使用fetch可以尽量0拷贝
@@ -491,6 +643,11 @@ int SstWriterAdaptor::iobuf_to_sst(butil::IOBuf data) {
             }
         }
         _count++;
+        if (_chunk_num > 1) {
+            ++_chunk_key_count;
+            _chunk_crc = butil::crc32c::Extend(_chunk_crc, key.data(), key.size());
+            _chunk_crc = butil::crc32c::Extend(_chunk_crc, value.data(), value.size());
+        }
         
         auto s = _writer->put(key, value);
         if (!s.ok()) {            
@@ -502,6 +659,26 @@ int SstWriterAdaptor::iobuf_to_sst(butil::IOBuf data) {
     return 0;
 }
 
+int SstWriterAdaptor::check_chunk_trailer(butil::IOBuf& data) {
+    int64_t key_count = 0;
+    uint32_t crc = 0;
+    if (data.cutn((void*)&key_count, sizeof(int64_t)) < sizeof(int64_t)
+            || data.cutn((void*)&crc, sizeof(uint32_t)) < sizeof(uint32_t)) {
+        DB_FATAL("read chunk trailer fail, path: %s, region_id: %ld", _path.c_str(), _region_id);
+        return -1;
+    }
+    if (key_count != _chunk_key_count || crc != _chunk_crc) {
+        DB_FATAL("snapshot chunk check fail, path: %s, region_id: %ld, "
+                "key_count: %ld vs %ld, crc: %u vs %u", _path.c_str(), _region_id,
+                key_count, _chunk_key_count, crc, _chunk_crc);
+        return -1;
+    }
+    _chunk_verified = true;
+    DB_WARNING("snapshot chunk %d/%d verified, path: %s, region_id: %ld, key_count: %ld",
+            _chunk_idx, _chunk_num, _path.c_str(), _region_id, key_count);
+    return 0;
+}
+
 SstWriterAdaptor::~SstWriterAdaptor() {
     close();
 }
@@ -513,6 +690,12 @@ ssize_t SstWriterAdaptor::size() {
 
 bool SstWriterAdaptor::sync() {
     //already sync in SstFileWriter::Finish
+    // chunk未收到结尾校验信息说明数据不完整，拷贝失败
+    if (_chunk_num > 1 && _data_size > 0 && !_chunk_verified) {
+        DB_FATAL("snapshot chunk not verified when sync, path: %s, region_id: %ld",
+                _path.c_str(), _region_id);
+        return false;
+    }
     return true;
 }
 
@@ -662,13 +845,30 @@ braft::FileAdaptor* RocksdbFileSystemAdaptor::open_reader_adaptor(const std::str
     IteratorContextPtr iter_context = nullptr;
     if (is_snapshot_data_file(path)) {
         is_meta_reader = false;
-        iter_context = sc->data_context;
+        int chunk_idx = 0;
+        int chunk_num = 1;
+        parse_snapshot_data_chunk(path, &chunk_idx, &chunk_num);
+        if (chunk_num > 1) {
+            iter_context = sc->chunk_contexts[chunk_idx];
+        } else {
+            iter_context = sc->data_context;
+        }
         //first open snapshot file
         if (iter_context == nullptr) {
             iter_context.reset(new IteratorContext);
             iter_context->prefix = prefix;
             iter_context->is_meta_sst = false;
             iter_context->upper_bound = upper_bound;
+            iter_context->start_key = prefix;
+            iter_context->chunk_idx = chunk_idx;
+            iter_context->chunk_num = chunk_num;
+            if (chunk_num > 1) {
+                if (sc->chunk_bounds.empty()) {
+                    init_chunk_bounds(sc, chunk_num, prefix, upper_bound);
+                }
+                iter_context->start_key = sc->chunk_bounds[chunk_idx];
+                iter_context->upper_bound = sc->chunk_bounds[chunk_idx + 1];
+            }
             iter_context->upper_bound_slice = iter_context->upper_bound;
             iter_context->sc = sc.get();
             rocksdb::ReadOptions read_options;
@@ -678,29 +878,15 @@ braft::FileAdaptor* RocksdbFileSystemAdaptor::open_reader_adaptor(const std::str
             read_options.iterate_upper_bound = &iter_context->upper_bound_slice;
             rocksdb::ColumnFamilyHandle* column_family = RocksWrapper::get_instance()->get_data_handle();
             iter_context->iter.reset(RocksWrapper::get_instance()->new_iterator(read_options, column_family));
-            iter_context->iter->Seek(prefix);
-            braft::NodeStatus status;
-
-            auto region = Store::get_instance()->get_region(_region_id);
-            region->get_node_status(&status);
-            int64_t peer_next_index = 0;
-            // 通过peer状态和data_index判断是否需要复制数据
-            // addpeer在unstable里，peer_next_index=0就会走复制流程
-            for (auto iter : status.stable_followers) {
-                auto& peer = iter.second;
-                DB_WARNING("region_id: %ld %s %d %ld", _region_id, iter.first.to_string().c_str(),
-                peer.installing_snapshot, peer.next_index);
-                if (peer.installing_snapshot) {
-                    peer_next_index = peer.next_index;
-                    break;
-                }
-            }
-            if (sc->data_index < peer_next_index) {
-                iter_context->need_copy_data = false;
+            iter_context->iter->Seek(iter_context->start_key);
+            iter_context->need_copy_data = check_need_copy_data(sc);
+            if (chunk_num > 1) {
+                sc->chunk_contexts[chunk_idx] = iter_context;
+            } else {
+                sc->data_context = iter_context;
             }
-            sc->data_context = iter_context;
-            DB_WARNING("region_id: %ld open reader, data_index:%ld,peer_next_index:%ld, path: %s, time_cost: %ld", 
-                    _region_id, sc->data_index, peer_next_index, path.c_str(), time_cost.get_time());
+            DB_WARNING("region_id: %ld open reader, data_index:%ld, chunk: %d/%d, path: %s, time_cost: %ld", 
+                    _region_id, sc->data_index, chunk_idx, chunk_num, path.c_str(), time_cost.get_time());
         }
     }
     int64_t applied_index = 0;
@@ -744,6 +930,76 @@ braft::FileAdaptor* RocksdbFileSystemAdaptor::open_reader_adaptor(const std::str
     return reader;
 }
 
+// 通过peer状态和data_index判断是否需要复制数据，同一个快照只判断一次
+bool RocksdbFileSystemAdaptor::check_need_copy_data(SnapshotContextPtr sc) {
+    if (sc->copy_data_checked) {
+        return sc->need_copy_data;
+    }
+    braft::NodeStatus status;
+    auto region = Store::get_instance()->get_region(_region_id);
+    region->get_node_status(&status);
+    int64_t peer_next_index = 0;
+    // addpeer在unstable里，peer_next_index=0就会走复制流程
+    for (auto iter : status.stable_followers) {
+        auto& peer = iter.second;
+        DB_WARNING("region_id: %ld %s %d %ld", _region_id, iter.first.to_string().c_str(),
+        peer.installing_snapshot, peer.next_index);
+        if (peer.installing_snapshot) {
+            peer_next_index = peer.next_index;
+            break;
+        }
+    }
+    sc->need_copy_data = sc->data_index >= peer_next_index;
+    sc->copy_data_checked = true;
+    DB_WARNING("region_id: %ld data_index:%ld, peer_next_index:%ld, need_copy_data: %d",
+            _region_id, sc->data_index, peer_next_index, sc->need_copy_data);
+    return sc->need_copy_data;
+}
+
+// 按data cf中与region范围相交的sst文件大小，把[prefix, upper_bound)切成chunk_num段
+// 边界取sst文件的最小key，数据集中在少数文件时后面的chunk可能为空
+void RocksdbFileSystemAdaptor::init_chunk_bounds(SnapshotContextPtr sc, int chunk_num,
+        const std::string& prefix, const std::string& upper_bound) {
+    TimeCost cost;
+    std::vector<std::pair<std::string, uint64_t>> file_keys;
+    uint64_t total_size = 0;
+    auto region_ptr = Store::get_instance()->get_region(_region_id);
+    // binlog region的prefix不是region_id，不拆分
+    if (region_ptr != nullptr && !region_ptr->is_binlog_region()) {
+        std::vector<rocksdb::LiveFileMetaData> metas;
+        RocksWrapper::get_instance()->get_db()->GetLiveFilesMetaData(&metas);
+        for (auto& meta : metas) {
+            if (meta.column_family_name != RocksWrapper::DATA_CF) {
+                continue;
+            }
+            if (meta.largestkey < prefix || meta.smallestkey >= upper_bound) {
+                continue;
+            }
+            file_keys.emplace_back(std::max(meta.smallestkey, prefix), meta.size);
+            total_size += meta.size;
+        }
+    }
+    std::sort(file_keys.begin(), file_keys.end());
+    sc->chunk_bounds.clear();
+    sc->chunk_bounds.emplace_back(prefix);
+    uint64_t acc_size = 0;
+    for (auto& file_key : file_keys) {
+        if ((int)sc->chunk_bounds.size() >= chunk_num) {
+            break;
+        }
+        uint64_t next_bound_size = total_size * sc->chunk_bounds.size() / chunk_num;
+        if (acc_size >= next_bound_size && file_key.first > sc->chunk_bounds.back()) {
+            sc->chunk_bounds.emplace_back(file_key.first);
+        }
+        acc_size += file_key.second;
+    }
+    while ((int)sc->chunk_bounds.size() <= chunk_num) {
+        sc->chunk_bounds.emplace_back(upper_bound);
+    }
+    DB_WARNING("region_id: %ld init chunk bounds, chunk_num: %d, sst files: %lu, total_size: %lu, "
+            "time_cost: %ld", _region_id, chunk_num, file_keys.size(), total_size, cost.get_time());
+}
+
 bool RocksdbFileSystemAdaptor::delete_file(const std::string& path, bool recursive) {
     butil::FilePath file_path(path);
     return butil::DeleteFile(file_path, recursive);
@@ -789,7 +1045,8 @@ bool RocksdbFileSystemAdaptor::open_snapshot(const std::string& path) {
         if (iter->second.cost.get_time() > 3600 * 1000 * 1000LL
             && iter->second.count == 1
             && (iter->second.ptr->data_context == nullptr
-            || iter->second.ptr->data_context->offset == 0)) {
+            || iter->second.ptr->data_context->offset == 0)
+            && iter->second.ptr->chunk_contexts.empty()) {
             _snapshots.erase(iter);
             DB_WARNING("region_id: %ld snapshot path: %s is hang over 1 hour, erase", _region_id, path.c_str());
         } else {
@@ -852,7 +1109,12 @@ void RocksdbFileSystemAdaptor::close(const std::string& path) {
         return;
     }
     auto& snapshot_ctx = iter->second;
-    if (is_snapshot_data_file(path) && snapshot_ctx.ptr->data_context != nullptr) {
+    int chunk_idx = 0;
+    int chunk_num = 1;
+    if (parse_snapshot_data_chunk(path, &chunk_idx, &chunk_num)) {
+        DB_WARNING("read snapshot data chunk close, path: %s", path.c_str());
+        snapshot_ctx.ptr->chunk_contexts.erase(chunk_idx);
+    } else if (is_snapshot_data_file(path) && snapshot_ctx.ptr->data_context != nullptr) {
         DB_WARNING("read snapshot data file close, path: %s", path.c_str());
         snapshot_ctx.ptr->data_context.reset();
     } else if (snapshot_ctx.ptr->meta_context != nullptr) {
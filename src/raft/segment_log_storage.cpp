@@ -0,0 +1,825 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "segment_log_storage.h"
+#include <fcntl.h>
+#include <algorithm>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#ifdef BAIDU_INTERNAL
+#include <base/crc32c.h>
+#include <base/raw_pack.h>
+#include <raft/util.h>
+#include <raft/local_storage.pb.h>
+#else
+#include <butil/crc32c.h>
+#include <butil/raw_pack.h>
+#include <braft/util.h>
+#include <braft/local_storage.pb.h>
+#endif
+#include "can_add_peer_setter.h"
+
+namespace baikaldb {
+DEFINE_string(segment_log_path, "./raft_data/segment_log", "segment raft log path");
+DEFINE_int64(segment_log_max_size, 256 * 1024 * 1024LL, "max size of one raft log segment");
+DEFINE_bool(segment_log_sync, true, "fdatasync segment raft log before append returns");
+
+static int pread_full(int fd, char* buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = ::pread(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+static int serialize_configuration(const braft::LogEntry* entry, butil::IOBuf& data) {
+    braft::ConfigurationPBMeta meta;
+    if (entry->peers != nullptr) {
+        for (auto& peer : *entry->peers) {
+            meta.add_peers(peer.to_string());
+        }
+    }
+    if (entry->old_peers != nullptr) {
+        for (auto& peer : *entry->old_peers) {
+            meta.add_old_peers(peer.to_string());
+        }
+    }
+    butil::IOBufAsZeroCopyOutputStream wrapper(&data);
+    if (!meta.SerializeToZeroCopyStream(&wrapper)) {
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_configuration(braft::LogEntry* entry, const std::string& data) {
+    braft::ConfigurationPBMeta meta;
+    if (!meta.ParseFromString(data)) {
+        return -1;
+    }
+    entry->peers = new std::vector<braft::PeerId>;
+    for (int i = 0; i < meta.peers_size(); ++i) {
+        entry->peers->push_back(braft::PeerId(meta.peers(i)));
+    }
+    if (meta.old_peers_size() > 0) {
+        entry->old_peers = new std::vector<braft::PeerId>;
+        for (int i = 0; i < meta.old_peers_size(); ++i) {
+            entry->old_peers->push_back(braft::PeerId(meta.old_peers(i)));
+        }
+    }
+    return 0;
+}
+
+void SegmentLogManager::append_record(butil::IOBuf& buf, int record_type, int64_t region_id,
+                                      int64_t index, int64_t term, int entry_type,
+                                      const butil::IOBuf& data) {
+    char head[SEGMENT_LOG_HEAD_SIZE];
+    butil::RawPacker(head)
+            .pack32(SEGMENT_LOG_MAGIC)
+            .pack32(record_type)
+            .pack64(region_id)
+            .pack64(index)
+            .pack64(term)
+            .pack32(entry_type)
+            .pack32(data.size());
+    uint32_t crc = butil::crc32c::Value(head, SEGMENT_LOG_HEAD_SIZE - 4);
+    for (size_t i = 0; i < data.backing_block_num(); ++i) {
+        auto block = data.backing_block(i);
+        crc = butil::crc32c::Extend(crc, block.data(), block.size());
+    }
+    butil::RawPacker(head + SEGMENT_LOG_HEAD_SIZE - 4).pack32(crc);
+    buf.append(head, SEGMENT_LOG_HEAD_SIZE);
+    buf.append(data);
+}
+
+int SegmentLogManager::init(const std::string& path) {
+    TimeCost cost;
+    _path = path;
+    std::vector<int64_t> segment_ids;
+    try {
+        boost::filesystem::create_directories(path);
+        boost::filesystem::directory_iterator end_iter;
+        for (boost::filesystem::directory_iterator iter(path); iter != end_iter; ++iter) {
+            std::string name = iter->path().filename().string();
+            if (name.compare(0, strlen("segment_"), "segment_") != 0) {
+                continue;
+            }
+            segment_ids.emplace_back(strtoll(name.c_str() + strlen("segment_"), NULL, 10));
+        }
+    } catch (boost::filesystem::filesystem_error& e) {
+        DB_FATAL("list segment log path fail, path:%s, err:%s", path.c_str(), e.what());
+        return -1;
+    }
+    std::sort(segment_ids.begin(), segment_ids.end());
+    for (size_t i = 0; i < segment_ids.size(); ++i) {
+        SmartLogSegment segment;
+        if (open_segment(segment_ids[i], false, segment) != 0) {
+            return -1;
+        }
+        if (replay_segment(segment, i == segment_ids.size() - 1) != 0) {
+            return -1;
+        }
+        _segments[segment->id] = segment;
+    }
+    {
+        BAIDU_SCOPED_LOCK(_write_mutex);
+        if (_segments.empty()) {
+            if (rotate_segment() != 0) {
+                return -1;
+            }
+        } else {
+            _active_segment = _segments.rbegin()->second;
+        }
+    }
+    _inited = true;
+    DB_WARNING("segment log init success, path:%s, segment_num:%lu, region_num:%lu, time_cost:%ld",
+            path.c_str(), _segments.size(), _regions.size(), cost.get_time());
+    gc_segments();
+    return 0;
+}
+
+int SegmentLogManager::open_segment(int64_t id, bool create, SmartLogSegment& segment) {
+    std::string path = _path + "/segment_" + std::to_string(id);
+    int flags = O_RDWR;
+    if (create) {
+        flags |= O_CREAT | O_TRUNC;
+    }
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        DB_FATAL("open segment fail, path:%s, errno:%d", path.c_str(), errno);
+        return -1;
+    }
+    segment.reset(new LogSegment);
+    segment->id = id;
+    segment->fd = fd;
+    segment->path = path;
+    return 0;
+}
+
+int SegmentLogManager::replay_segment(const SmartLogSegment& segment, bool is_last) {
+    struct stat st;
+    if (::fstat(segment->fd, &st) != 0) {
+        DB_FATAL("stat segment fail, path:%s, errno:%d", segment->path.c_str(), errno);
+        return -1;
+    }
+    int64_t file_size = st.st_size;
+    int64_t offset = 0;
+    int64_t record_num = 0;
+    char head[SEGMENT_LOG_HEAD_SIZE];
+    std::string data;
+    while (offset < file_size) {
+        bool broken = true;
+        uint32_t magic = 0;
+        uint32_t record_type = 0;
+        uint64_t region_id = 0;
+        uint64_t index = 0;
+        uint64_t term = 0;
+        uint32_t entry_type = 0;
+        uint32_t data_len = 0;
+        uint32_t crc = 0;
+        if (offset + (int64_t)SEGMENT_LOG_HEAD_SIZE <= file_size
+                && pread_full(segment->fd, head, SEGMENT_LOG_HEAD_SIZE, offset) == 0) {
+            butil::RawUnpacker(head)
+                    .unpack32(magic)
+                    .unpack32(record_type)
+                    .unpack64(region_id)
+                    .unpack64(index)
+                    .unpack64(term)
+                    .unpack32(entry_type)
+                    .unpack32(data_len)
+                    .unpack32(crc);
+            int64_t end = offset + SEGMENT_LOG_HEAD_SIZE + data_len;
+            if (magic == SEGMENT_LOG_MAGIC && end <= file_size) {
+                data.resize(data_len);
+                if (pread_full(segment->fd, &data[0], data_len, offset + SEGMENT_LOG_HEAD_SIZE) == 0) {
+                    uint32_t real_crc = butil::crc32c::Value(head, SEGMENT_LOG_HEAD_SIZE - 4);
+                    real_crc = butil::crc32c::Extend(real_crc, data.data(), data.size());
+                    broken = (real_crc != crc);
+                }
+            }
+        }
+        if (broken) {
+            if (!is_last) {
+                DB_FATAL("segment is corrupted, path:%s, offset:%ld", segment->path.c_str(), offset);
+                return -1;
+            }
+            // 最后一个segment尾部可能有未写完的记录，直接截断
+            DB_WARNING("truncate broken tail, path:%s, offset:%ld, file_size:%ld",
+                    segment->path.c_str(), offset, file_size);
+            if (::ftruncate(segment->fd, offset) != 0) {
+                DB_FATAL("truncate segment fail, path:%s, errno:%d", segment->path.c_str(), errno);
+                return -1;
+            }
+            break;
+        }
+        SegmentLogPos pos;
+        pos.segment_id = segment->id;
+        pos.offset = offset + SEGMENT_LOG_HEAD_SIZE;
+        pos.term = term;
+        pos.data_len = data_len;
+        pos.type = entry_type;
+        if (apply_record(record_type, region_id, index, pos) != 0) {
+            DB_FATAL("apply record fail, path:%s, offset:%ld", segment->path.c_str(), offset);
+            return -1;
+        }
+        offset += SEGMENT_LOG_HEAD_SIZE + data_len;
+        ++record_num;
+    }
+    segment->size = offset;
+    DB_WARNING("replay segment:%s, size:%ld, record_num:%ld",
+            segment->path.c_str(), offset, record_num);
+    return 0;
+}
+
+int SegmentLogManager::apply_record(int record_type, int64_t region_id, int64_t index,
+                                    const SegmentLogPos& pos) {
+    switch (record_type) {
+        case SEGMENT_RECORD_ENTRY: {
+            SegmentRegionIndex& region = _regions[region_id];
+            if (region.entries.empty()) {
+                region.first_log_index = index;
+            } else if (index <= region.first_log_index) {
+                region.entries.clear();
+                region.first_log_index = index;
+            } else if (index <= region.last_log_index()) {
+                apply_truncate_suffix(region, index - 1);
+            } else if (index != region.last_log_index() + 1) {
+                DB_FATAL("found a hole, region_id: %ld, last_log_index:%ld, index:%ld",
+                        region_id, region.last_log_index(), index);
+                return -1;
+            }
+            region.entries.emplace_back(pos);
+            break;
+        }
+        case SEGMENT_RECORD_TRUNCATE_PREFIX:
+        case SEGMENT_RECORD_CHECKPOINT:
+            apply_truncate_prefix(_regions[region_id], index);
+            break;
+        case SEGMENT_RECORD_TRUNCATE_SUFFIX: {
+            auto iter = _regions.find(region_id);
+            if (iter != _regions.end()) {
+                apply_truncate_suffix(iter->second, index);
+            }
+            break;
+        }
+        case SEGMENT_RECORD_RESET: {
+            SegmentRegionIndex& region = _regions[region_id];
+            region.entries.clear();
+            region.first_log_index = index;
+            break;
+        }
+        case SEGMENT_RECORD_DROP:
+            _regions.erase(region_id);
+            break;
+        default:
+            DB_FATAL("unknown record type:%d, region_id: %ld", record_type, region_id);
+            return -1;
+    }
+    return 0;
+}
+
+void SegmentLogManager::apply_truncate_prefix(SegmentRegionIndex& region, int64_t first_index_kept) {
+    if (first_index_kept <= region.first_log_index) {
+        return;
+    }
+    while (!region.entries.empty() && region.first_log_index < first_index_kept) {
+        region.entries.pop_front();
+        ++region.first_log_index;
+    }
+    region.first_log_index = first_index_kept;
+}
+
+void SegmentLogManager::apply_truncate_suffix(SegmentRegionIndex& region, int64_t last_index_kept) {
+    while (!region.entries.empty() && region.last_log_index() > last_index_kept) {
+        region.entries.pop_back();
+    }
+}
+
+bool SegmentLogManager::has_region(int64_t region_id) {
+    if (!_inited) {
+        return false;
+    }
+    BAIDU_SCOPED_LOCK(_index_mutex);
+    return _regions.count(region_id) == 1;
+}
+
+void SegmentLogManager::open_region(int64_t region_id, int64_t& first_log_index,
+                                    int64_t& last_log_index) {
+    BAIDU_SCOPED_LOCK(_index_mutex);
+    SegmentRegionIndex& region = _regions[region_id];
+    first_log_index = region.first_log_index;
+    last_log_index = region.last_log_index();
+}
+
+void SegmentLogManager::get_log_index(int64_t region_id, int64_t& first_log_index,
+                                      int64_t& last_log_index) {
+    BAIDU_SCOPED_LOCK(_index_mutex);
+    auto iter = _regions.find(region_id);
+    if (iter == _regions.end()) {
+        first_log_index = 1;
+        last_log_index = 0;
+        return;
+    }
+    first_log_index = iter->second.first_log_index;
+    last_log_index = iter->second.last_log_index();
+}
+
+void SegmentLogManager::get_configuration_indexes(int64_t region_id, std::vector<int64_t>& indexes) {
+    BAIDU_SCOPED_LOCK(_index_mutex);
+    auto iter = _regions.find(region_id);
+    if (iter == _regions.end()) {
+        return;
+    }
+    int64_t index = iter->second.first_log_index;
+    for (auto& pos : iter->second.entries) {
+        if (pos.type == braft::ENTRY_TYPE_CONFIGURATION) {
+            indexes.emplace_back(index);
+        }
+        ++index;
+    }
+}
+
+int64_t SegmentLogManager::get_term(int64_t region_id, int64_t index) {
+    BAIDU_SCOPED_LOCK(_index_mutex);
+    auto iter = _regions.find(region_id);
+    if (iter == _regions.end()) {
+        return 0;
+    }
+    auto& region = iter->second;
+    if (index < region.first_log_index || index > region.last_log_index()) {
+        return 0;
+    }
+    return region.entries[index - region.first_log_index].term;
+}
+
+int SegmentLogManager::read_entry(int64_t region_id, int64_t index, int64_t& term,
+                                  int& type, std::string& data) {
+    SegmentLogPos pos;
+    {
+        BAIDU_SCOPED_LOCK(_index_mutex);
+        auto iter = _regions.find(region_id);
+        if (iter == _regions.end()) {
+            return -1;
+        }
+        auto& region = iter->second;
+        if (index < region.first_log_index || index > region.last_log_index()) {
+            return -1;
+        }
+        pos = region.entries[index - region.first_log_index];
+    }
+    SmartLogSegment segment;
+    {
+        BAIDU_SCOPED_LOCK(_segment_mutex);
+        auto iter = _segments.find(pos.segment_id);
+        if (iter == _segments.end()) {
+            DB_FATAL("segment:%ld not exist, region_id: %ld, index:%ld",
+                    pos.segment_id, region_id, index);
+            return -1;
+        }
+        segment = iter->second;
+    }
+    term = pos.term;
+    type = pos.type;
+    data.resize(pos.data_len);
+    if (pread_full(segment->fd, &data[0], pos.data_len, pos.offset) != 0) {
+        DB_FATAL("read segment:%ld fail, region_id: %ld, index:%ld, errno:%d",
+                pos.segment_id, region_id, index, errno);
+        return -1;
+    }
+    return 0;
+}
+
+int SegmentLogManager::write_records(butil::IOBuf& buf, int64_t& offset) {
+    if (_active_segment->size > 0
+            && _active_segment->size + (int64_t)buf.size() > FLAGS_segment_log_max_size) {
+        if (rotate_segment() != 0) {
+            return -1;
+        }
+    }
+    offset = _active_segment->size;
+    ssize_t len = buf.size();
+    if (braft::file_pwrite(buf, _active_segment->fd, offset) != len) {
+        DB_FATAL("write segment:%ld fail, offset:%ld, errno:%d",
+                _active_segment->id, offset, errno);
+        ::ftruncate(_active_segment->fd, offset);
+        return -1;
+    }
+    _active_segment->size += len;
+    ++_write_seq;
+    _write_bytes << len;
+    return 0;
+}
+
+int SegmentLogManager::write_control_record(int record_type, int64_t region_id, int64_t index) {
+    butil::IOBuf buf;
+    append_record(buf, record_type, region_id, index, 0, 0, butil::IOBuf());
+    int64_t offset = 0;
+    return write_records(buf, offset);
+}
+
+int SegmentLogManager::rotate_segment() {
+    // 旧segment先落盘，sync_to只需要sync当前segment
+    if (_active_segment != nullptr && ::fdatasync(_active_segment->fd) != 0) {
+        DB_FATAL("sync segment:%ld fail, errno:%d", _active_segment->id, errno);
+        return -1;
+    }
+    int64_t id = _active_segment != nullptr ? _active_segment->id + 1 : 1;
+    SmartLogSegment segment;
+    if (open_segment(id, true, segment) != 0) {
+        return -1;
+    }
+    // 新segment头部记录各region的first_log_index，旧segment被gc后依然能恢复
+    butil::IOBuf buf;
+    {
+        BAIDU_SCOPED_LOCK(_index_mutex);
+        for (auto& pair : _regions) {
+            append_record(buf, SEGMENT_RECORD_CHECKPOINT, pair.first,
+                    pair.second.first_log_index, 0, 0, butil::IOBuf());
+        }
+    }
+    ssize_t len = buf.size();
+    if (len > 0 && (braft::file_pwrite(buf, segment->fd, 0) != len
+            || ::fdatasync(segment->fd) != 0)) {
+        DB_FATAL("write checkpoint to segment:%ld fail, errno:%d", id, errno);
+        return -1;
+    }
+    segment->size = len;
+    {
+        BAIDU_SCOPED_LOCK(_segment_mutex);
+        _segments[id] = segment;
+    }
+    _active_segment = segment;
+    DB_WARNING("rotate to segment:%ld, checkpoint size:%ld", id, len);
+    return 0;
+}
+
+int SegmentLogManager::sync_to(int64_t write_seq) {
+    if (!FLAGS_segment_log_sync) {
+        return 0;
+    }
+    // 组提交: 同一时刻只有一个bthread做fdatasync，其余等待其结果
+    std::unique_lock<bthread::Mutex> lck(_sync_mutex);
+    while (_synced_seq < write_seq) {
+        if (_syncing) {
+            _sync_cond.wait(lck);
+            continue;
+        }
+        _syncing = true;
+        lck.unlock();
+        SmartLogSegment segment;
+        int64_t target_seq = 0;
+        {
+            BAIDU_SCOPED_LOCK(_write_mutex);
+            segment = _active_segment;
+            target_seq = _write_seq;
+        }
+        TimeCost cost;
+        int ret = ::fdatasync(segment->fd);
+        _sync_latency << cost.get_time();
+        lck.lock();
+        _syncing = false;
+        _sync_cond.notify_all();
+        if (ret != 0) {
+            DB_FATAL("sync segment:%ld fail, errno:%d", segment->id, errno);
+            return -1;
+        }
+        _synced_seq = std::max(_synced_seq, target_seq);
+    }
+    return 0;
+}
+
+int SegmentLogManager::append_entries(int64_t region_id,
+                                      const std::vector<braft::LogEntry*>& entries) {
+    if (entries.empty()) {
+        return 0;
+    }
+    butil::IOBuf buf;
+    std::vector<SegmentLogPos> positions;
+    positions.reserve(entries.size());
+    for (auto entry : entries) {
+        butil::IOBuf data;
+        switch (entry->type) {
+            case braft::ENTRY_TYPE_DATA:
+                data = entry->data;
+                break;
+            case braft::ENTRY_TYPE_CONFIGURATION:
+                if (serialize_configuration(entry, data) != 0) {
+                    DB_FATAL("serialize configuration fail, region_id: %ld, index:%ld",
+                            region_id, entry->id.index);
+                    return -1;
+                }
+                break;
+            case braft::ENTRY_TYPE_NO_OP:
+                break;
+            default:
+                DB_FATAL("Unknown type:%d, region_id: %ld", entry->type, region_id);
+                return -1;
+        }
+        SegmentLogPos pos;
+        pos.offset = buf.size() + SEGMENT_LOG_HEAD_SIZE;
+        pos.term = entry->id.term;
+        pos.data_len = data.size();
+        pos.type = entry->type;
+        positions.emplace_back(pos);
+        append_record(buf, SEGMENT_RECORD_ENTRY, region_id, entry->id.index,
+                entry->id.term, entry->type, data);
+    }
+    int64_t write_seq = 0;
+    {
+        BAIDU_SCOPED_LOCK(_write_mutex);
+        int64_t last_log_index = 0;
+        int64_t first_log_index = 0;
+        get_log_index(region_id, first_log_index, last_log_index);
+        if (last_log_index + 1 != entries.front()->id.index) {
+            DB_FATAL("There's gap between appending entries and last_log_index, "
+                    "last_log_index: %ld, entry_log_index: %ld, region_id: %ld",
+                    last_log_index, entries.front()->id.index, region_id);
+            return -1;
+        }
+        int64_t offset = 0;
+        if (write_records(buf, offset) != 0) {
+            return -1;
+        }
+        write_seq = _write_seq;
+        // 索引与写入在同一把锁内更新，gc不会删除已写入但未建索引的segment
+        BAIDU_SCOPED_LOCK(_index_mutex);
+        SegmentRegionIndex& region = _regions[region_id];
+        for (auto& pos : positions) {
+            pos.segment_id = _active_segment->id;
+            pos.offset += offset;
+            region.entries.emplace_back(pos);
+        }
+    }
+    return sync_to(write_seq);
+}
+
+int SegmentLogManager::truncate_prefix(int64_t region_id, int64_t first_index_kept) {
+    {
+        BAIDU_SCOPED_LOCK(_write_mutex);
+        if (write_control_record(SEGMENT_RECORD_TRUNCATE_PREFIX, region_id, first_index_kept) != 0) {
+            return -1;
+        }
+        BAIDU_SCOPED_LOCK(_index_mutex);
+        apply_truncate_prefix(_regions[region_id], first_index_kept);
+    }
+    gc_segments();
+    return 0;
+}
+
+int SegmentLogManager::truncate_suffix(int64_t region_id, int64_t last_index_kept) {
+    int64_t write_seq = 0;
+    {
+        BAIDU_SCOPED_LOCK(_write_mutex);
+        if (write_control_record(SEGMENT_RECORD_TRUNCATE_SUFFIX, region_id, last_index_kept) != 0) {
+            return -1;
+        }
+        write_seq = _write_seq;
+        BAIDU_SCOPED_LOCK(_index_mutex);
+        auto iter = _regions.find(region_id);
+        if (iter != _regions.end()) {
+            apply_truncate_suffix(iter->second, last_index_kept);
+        }
+    }
+    return sync_to(write_seq);
+}
+
+int SegmentLogManager::reset(int64_t region_id, int64_t next_log_index) {
+    int64_t write_seq = 0;
+    {
+        BAIDU_SCOPED_LOCK(_write_mutex);
+        if (write_control_record(SEGMENT_RECORD_RESET, region_id, next_log_index) != 0) {
+            return -1;
+        }
+        write_seq = _write_seq;
+        BAIDU_SCOPED_LOCK(_index_mutex);
+        SegmentRegionIndex& region = _regions[region_id];
+        region.entries.clear();
+        region.first_log_index = next_log_index;
+    }
+    gc_segments();
+    return sync_to(write_seq);
+}
+
+int SegmentLogManager::remove_region(int64_t region_id) {
+    if (!has_region(region_id)) {
+        return 0;
+    }
+    {
+        BAIDU_SCOPED_LOCK(_write_mutex);
+        if (write_control_record(SEGMENT_RECORD_DROP, region_id, 0) != 0) {
+            return -1;
+        }
+        BAIDU_SCOPED_LOCK(_index_mutex);
+        _regions.erase(region_id);
+    }
+    DB_WARNING("remove segment log index, region_id: %ld", region_id);
+    gc_segments();
+    return 0;
+}
+
+void SegmentLogManager::gc_segments() {
+    int64_t min_segment_id = 0;
+    {
+        BAIDU_SCOPED_LOCK(_write_mutex);
+        min_segment_id = _active_segment->id;
+        BAIDU_SCOPED_LOCK(_index_mutex);
+        for (auto& pair : _regions) {
+            if (!pair.second.entries.empty()) {
+                min_segment_id = std::min(min_segment_id, pair.second.entries.front().segment_id);
+            }
+        }
+    }
+    std::vector<SmartLogSegment> removed;
+    {
+        BAIDU_SCOPED_LOCK(_segment_mutex);
+        while (!_segments.empty() && _segments.begin()->first < min_segment_id) {
+            removed.emplace_back(_segments.begin()->second);
+            _segments.erase(_segments.begin());
+        }
+    }
+    // 已打开的fd在unlink后仍可读，正在读的请求不受影响
+    for (auto& segment : removed) {
+        if (::unlink(segment->path.c_str()) != 0) {
+            DB_WARNING("remove segment fail, path:%s, errno:%d", segment->path.c_str(), errno);
+            continue;
+        }
+        _gc_segment_count << 1;
+        DB_WARNING("remove segment:%s, min_segment_id:%ld", segment->path.c_str(), min_segment_id);
+    }
+}
+
+braft::LogStorage* SegmentLogStorage::new_instance(const std::string& uri) const {
+    SegmentLogManager* manager = SegmentLogManager::get_instance();
+    if (!manager->is_inited()) {
+        DB_FATAL("segment log is not inited, uri:%s", uri.c_str());
+        return NULL;
+    }
+    size_t pos = uri.find("id=");
+    if (pos == 0 || pos == std::string::npos) {
+        DB_FATAL("parse uri fail, uri:%s", uri.c_str());
+        return NULL;
+    }
+    int64_t region_id = 0;
+    try {
+        region_id = boost::lexical_cast<int64_t>(uri.substr(pos + 3));
+    } catch (boost::bad_lexical_cast&) {
+        DB_FATAL("parse uri fail, uri:%s", uri.c_str());
+        return NULL;
+    }
+    braft::LogStorage* instance = new(std::nothrow) SegmentLogStorage(region_id);
+    if (instance == NULL) {
+        DB_FATAL("new log_storage instance fail, region_id: %ld", region_id);
+    }
+    return instance;
+}
+
+void SegmentLogStorage::update_log_index() {
+    int64_t first_log_index = 0;
+    int64_t last_log_index = 0;
+    SegmentLogManager::get_instance()->get_log_index(_region_id, first_log_index, last_log_index);
+    _first_log_index.store(first_log_index);
+    _last_log_index.store(last_log_index);
+}
+
+int SegmentLogStorage::init(braft::ConfigurationManager* configuration_manager) {
+    TimeCost time_cost;
+    SegmentLogManager* manager = SegmentLogManager::get_instance();
+    int64_t first_log_index = 0;
+    int64_t last_log_index = 0;
+    manager->open_region(_region_id, first_log_index, last_log_index);
+    std::vector<int64_t> conf_indexes;
+    manager->get_configuration_indexes(_region_id, conf_indexes);
+    for (int64_t index : conf_indexes) {
+        braft::LogEntry* entry = get_entry(index);
+        if (entry == NULL) {
+            DB_FATAL("Fail to read configuration at index:%ld, region_id: %ld", index, _region_id);
+            return -1;
+        }
+        braft::ConfigurationEntry conf_entry;
+        conf_entry.id = entry->id;
+        conf_entry.conf = *(entry->peers);
+        if (entry->old_peers) {
+            conf_entry.old_conf = *(entry->old_peers);
+        }
+        configuration_manager->add(conf_entry);
+        entry->Release();
+    }
+    _first_log_index.store(first_log_index);
+    _last_log_index.store(last_log_index);
+    DB_WARNING("region_id: %ld, first_log_index:%ld, last_log_index:%ld, conf_num:%lu, time_cost: %ld",
+            _region_id, first_log_index, last_log_index, conf_indexes.size(), time_cost.get_time());
+    return 0;
+}
+
+braft::LogEntry* SegmentLogStorage::get_entry(const int64_t index) {
+    int64_t term = 0;
+    int type = 0;
+    std::string data;
+    if (SegmentLogManager::get_instance()->read_entry(_region_id, index, term, type, data) != 0) {
+        DB_WARNING("get index:%ld from segment log fail, region_id: %ld", index, _region_id);
+        return NULL;
+    }
+    braft::LogEntry* entry = new braft::LogEntry;
+    entry->AddRef();
+    entry->type = (braft::EntryType)type;
+    entry->id = braft::LogId(index, term);
+    switch (entry->type) {
+        case braft::ENTRY_TYPE_DATA:
+            entry->data.append(data);
+            break;
+        case braft::ENTRY_TYPE_CONFIGURATION:
+            if (parse_configuration(entry, data) != 0) {
+                DB_FATAL("Fail to parse ConfigurationPBMeta, index:%ld, region_id: %ld",
+                        index, _region_id);
+                entry->Release();
+                entry = NULL;
+            }
+            break;
+        case braft::ENTRY_TYPE_NO_OP:
+            break;
+        default:
+            DB_FATAL("Unknown entry type, log index:%ld of region id:%ld", index, _region_id);
+            entry->Release();
+            entry = NULL;
+            break;
+    }
+    return entry;
+}
+
+int64_t SegmentLogStorage::get_term(const int64_t index) {
+    return SegmentLogManager::get_instance()->get_term(_region_id, index);
+}
+
+int SegmentLogStorage::append_entry(const braft::LogEntry* entry) {
+    std::vector<braft::LogEntry*> entries;
+    entries.push_back(const_cast<braft::LogEntry*>(entry));
+    return append_entries(entries, nullptr) == 1 ? 0 : -1;
+}
+
+int SegmentLogStorage::append_entries(const std::vector<braft::LogEntry*>& entries,
+                                      braft::IOMetric* metric) {
+    if (entries.empty()) {
+        return 0;
+    }
+    if (SegmentLogManager::get_instance()->append_entries(_region_id, entries) != 0) {
+        DB_FATAL("Fail to append entries, region_id: %ld, first_index:%ld",
+                _region_id, entries.front()->id.index);
+        update_log_index();
+        return -1;
+    }
+    _last_log_index.fetch_add(entries.size());
+    return (int)entries.size();
+}
+
+int SegmentLogStorage::truncate_prefix(const int64_t first_index_kept) {
+    if (first_index_kept <= _first_log_index.load()) {
+        return 0;
+    }
+    DB_WARNING("Truncating region_id: %ld to first index kept:%ld from first log index:%ld",
+            _region_id, first_index_kept, _first_log_index.load());
+    int ret = SegmentLogManager::get_instance()->truncate_prefix(_region_id, first_index_kept);
+    update_log_index();
+    CanAddPeerSetter::get_instance()->set_can_add_peer(_region_id);
+    return ret;
+}
+
+int SegmentLogStorage::truncate_suffix(const int64_t last_index_kept) {
+    if (last_index_kept >= _last_log_index.load()) {
+        return 0;
+    }
+    DB_WARNING("Truncating region_id: %ld to last index kept:%ld from last log index:%ld",
+            _region_id, last_index_kept, _last_log_index.load());
+    int ret = SegmentLogManager::get_instance()->truncate_suffix(_region_id, last_index_kept);
+    update_log_index();
+    return ret;
+}
+
+int SegmentLogStorage::reset(const int64_t next_log_index) {
+    DB_WARNING("Reseting region_id: %ld to next log index :%ld", _region_id, next_log_index);
+    int ret = SegmentLogManager::get_instance()->reset(_region_id, next_log_index);
+    update_log_index();
+    return ret;
+}
+
+} // namespace baikaldb
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
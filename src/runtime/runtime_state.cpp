@@ -128,6 +128,8 @@ int RuntimeState::init(QueryContext* ctx, DataBuffer* send_buf) {
     _need_learner_backup = ctx->need_learner_backup;
     _single_store_concurrency = ctx->single_store_concurrency;
     need_use_read_index = ctx->need_use_read_index();
+    max_staleness_us = ctx->max_staleness_ms * 1000;
+    stream_result = ctx->stream_result;
     // prepare 复用runtime
     if (_is_inited) {
         return 0;
@@ -86,32 +86,12 @@ int64_t TsoFetcher::get_tso(int64_t count) {
                 _tso_obj.physical(), _tso_obj.logical(), count);
         return (_tso_obj.physical() << tso::logical_bits) + _tso_obj.logical() - count;
     }
-    pb::TsoRequest request;
-    request.set_op_type(pb::OP_GEN_TSO);
-    request.set_count(count);
-    pb::TsoResponse response;
-    int retry_time = 0;
-    int ret = 0;
     tso_count << 1;
-    for (;;) {
-        retry_time++;
-        ret = MetaServerInteract::get_tso_instance()->send_request("tso_service", request, response);
-        if (ret < 0) {
-            if (response.errcode() == pb::RETRY_LATER && retry_time < 5) {
-                bthread_usleep(tso::update_timestamp_interval_ms * 1000LL);
-                continue;  
-            } else {
-                DB_FATAL("get tso failed, response:%s", response.ShortDebugString().c_str());
-                tso_error << 1;
-                return ret;
-            }
-        }
-        break;
+    // 并发调用合并为一个tso_service请求
+    int64_t timestamp = _tso_client.get_tso(count);
+    if (timestamp < 0) {
+        tso_error << 1;
     }
-    //DB_WARNING("response:%s", response.ShortDebugString().c_str());
-    auto&  tso = response.start_timestamp();
-    int64_t timestamp = (tso.physical() << tso::logical_bits) + tso.logical();
-
     return timestamp;
 }
 
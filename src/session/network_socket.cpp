@@ -115,6 +115,9 @@ NetworkSocket::~NetworkSocket() {
     delete send_buf;
     self_buf = nullptr;
     send_buf = nullptr;
+    delete compress_send_buf;
+    delete compress_read_buf;
+    delete uncompress_buf;
 
     for (auto& pair : cache_plans) {
         delete pair.second.root;
@@ -218,6 +221,10 @@ bool NetworkSocket::reset_when_err() {
     is_handshake_send_partly = 0;
     self_buf->byte_array_clear();
     send_buf->byte_array_clear();
+    if (compress_send_buf != nullptr) {
+        compress_send_buf->byte_array_clear();
+        compress_send_offset = 0;
+    }
     has_error_packet = false;
     query_ctx.reset(new QueryContext);
     return 0;
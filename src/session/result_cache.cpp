@@ -0,0 +1,216 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "result_cache.h"
+#include "schema_factory.h"
+#include "store_interact.hpp"
+
+namespace baikaldb {
+DEFINE_bool(enable_result_cache, true, "enable select result cache, still need hint or schema_conf");
+DEFINE_int64(result_cache_max_memory_mb, 256, "memory budget of select result cache");
+DEFINE_int64(result_cache_max_item_size, 4 * 1024 * 1024LL, "max packed result size of one cached select");
+DEFINE_int32(result_cache_check_timeout_ms, 100, "timeout of checking region data version on cache hit");
+DEFINE_int32(result_cache_check_concurrency, 10, "concurrency of checking region data version on cache hit");
+
+uint64_t ResultCache::make_key(uint64_t sign, const std::string& db, const std::string& charset,
+                               const std::string& username, const std::string& sql) {
+    std::string key_str;
+    key_str.reserve(db.size() + charset.size() + username.size() + sql.size() + 24);
+    key_str.append(std::to_string(sign)).append("\t");
+    key_str.append(db).append("\t");
+    key_str.append(charset).append("\t");
+    key_str.append(username).append("\t");
+    key_str.append(sql);
+    uint64_t out[2];
+    butil::MurmurHash3_x64_128(key_str.c_str(), key_str.size(), 0x1234, out);
+    return out[0];
+}
+
+bool ResultCache::is_valid(const SmartResultCacheItem& item, int64_t now) {
+    if (now > item->expire_time_us) {
+        return false;
+    }
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    for (auto& pair : item->table_versions) {
+        auto table_info = factory->get_table_info_ptr(pair.first);
+        if (table_info == nullptr || table_info->version != pair.second.second) {
+            return false;
+        }
+    }
+    BAIDU_SCOPED_LOCK(_version_mutex);
+    for (auto& pair : item->table_versions) {
+        auto iter = _table_write_versions.find(pair.first);
+        int64_t write_version = iter != _table_write_versions.end() ? iter->second : 0;
+        if (write_version != pair.second.first) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ResultCache::erase(std::unordered_map<uint64_t, std::pair<SmartResultCacheItem,
+                        std::list<uint64_t>::iterator>>::iterator iter) {
+    _mem_size -= iter->second.first->mem_size();
+    _lru_list.erase(iter->second.second);
+    _cache.erase(iter);
+}
+
+SmartResultCacheItem ResultCache::find(uint64_t key, const std::string& sql) {
+    SmartResultCacheItem item;
+    {
+        BAIDU_SCOPED_LOCK(_mutex);
+        auto iter = _cache.find(key);
+        if (iter == _cache.end()) {
+            _miss_count << 1;
+            return nullptr;
+        }
+        item = iter->second.first;
+        _lru_list.splice(_lru_list.end(), _lru_list, iter->second.second);
+    }
+    if (item->sql != sql || !is_valid(item, butil::gettimeofday_us())) {
+        remove(item);
+        return nullptr;
+    }
+    item->hit_count++;
+    _hit_count << 1;
+    return item;
+}
+
+void ResultCache::remove(const SmartResultCacheItem& item) {
+    {
+        BAIDU_SCOPED_LOCK(_mutex);
+        auto iter = _cache.find(item->key);
+        if (iter != _cache.end() && iter->second.first == item) {
+            erase(iter);
+        }
+    }
+    _invalid_count << 1;
+}
+
+bool ResultCache::check_region_versions(const SmartResultCacheItem& item) {
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    std::map<int64_t, std::string> region_leaders;
+    for (auto& pair : item->region_versions) {
+        pb::RegionInfo info;
+        if (pair.second.data_index < 0
+                || factory->get_region_info(pair.second.table_id, pair.first, info) != 0
+                || info.version() != pair.second.version) {
+            remove(item);
+            return false;
+        }
+        region_leaders[pair.first] = info.leader();
+    }
+    StoreReqOptions req_options;
+    req_options.request_timeout = FLAGS_result_cache_check_timeout_ms;
+    req_options.retry_times = 1;
+    std::atomic<bool> valid = {true};
+    ConcurrencyBthread check_bth(FLAGS_result_cache_check_concurrency);
+    for (auto& pair : region_leaders) {
+        int64_t region_id = pair.first;
+        std::string leader = pair.second;
+        int64_t data_index = item->region_versions[region_id].data_index;
+        check_bth.run([region_id, leader, data_index, &valid, &req_options]() {
+            pb::GetAppliedIndex request;
+            request.set_region_id(region_id);
+            pb::StoreRes response;
+            StoreInteract interact(leader, req_options);
+            // leader变化时follower的数据版本可能落后，只认leader的返回
+            if (interact.send_request("get_applied_index", request, response) != 0
+                    || response.errcode() != pb::SUCCESS
+                    || response.leader() != leader
+                    || !response.has_data_index()
+                    || response.data_index() != data_index) {
+                valid = false;
+            }
+        });
+    }
+    check_bth.join();
+    if (!valid) {
+        remove(item);
+        return false;
+    }
+    return true;
+}
+
+void ResultCache::add(const SmartResultCacheItem& item) {
+    if ((int64_t)item->result.size() > FLAGS_result_cache_max_item_size) {
+        return;
+    }
+    int64_t max_mem_size = FLAGS_result_cache_max_memory_mb * 1024 * 1024LL;
+    BAIDU_SCOPED_LOCK(_mutex);
+    auto iter = _cache.find(item->key);
+    if (iter != _cache.end()) {
+        erase(iter);
+    }
+    while (!_lru_list.empty() && _mem_size + (int64_t)item->mem_size() > max_mem_size) {
+        erase(_cache.find(_lru_list.front()));
+    }
+    if (_mem_size + (int64_t)item->mem_size() > max_mem_size) {
+        return;
+    }
+    _lru_list.emplace_back(item->key);
+    _cache[item->key] = std::make_pair(item, std::prev(_lru_list.end()));
+    _mem_size += item->mem_size();
+}
+
+void ResultCache::get_table_versions(const std::set<int64_t>& table_ids, TableVersionMap& versions) {
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    for (int64_t table_id : table_ids) {
+        auto table_info = factory->get_table_info_ptr(table_id);
+        versions[table_id].second = table_info != nullptr ? table_info->version : -1;
+    }
+    BAIDU_SCOPED_LOCK(_version_mutex);
+    for (int64_t table_id : table_ids) {
+        auto iter = _table_write_versions.find(table_id);
+        versions[table_id].first = iter != _table_write_versions.end() ? iter->second : 0;
+    }
+}
+
+void ResultCache::table_write(int64_t table_id) {
+    BAIDU_SCOPED_LOCK(_version_mutex);
+    _table_write_versions[table_id]++;
+}
+
+void ResultCache::clear() {
+    BAIDU_SCOPED_LOCK(_mutex);
+    _lru_list.clear();
+    _cache.clear();
+    _mem_size = 0;
+}
+
+void ResultCache::get_info(std::vector<std::vector<std::string>>& rows) {
+    std::vector<SmartResultCacheItem> items;
+    {
+        BAIDU_SCOPED_LOCK(_mutex);
+        items.reserve(_cache.size());
+        for (auto key : _lru_list) {
+            items.emplace_back(_cache[key].first);
+        }
+    }
+    int64_t now = butil::gettimeofday_us();
+    for (auto& item : items) {
+        std::vector<std::string> row;
+        row.emplace_back(std::to_string(item->key));
+        row.emplace_back(item->sql);
+        row.emplace_back(std::to_string(item->result.size()));
+        row.emplace_back(std::to_string(item->num_returned_rows));
+        row.emplace_back(std::to_string(item->hit_count.load()));
+        row.emplace_back(std::to_string((now - item->create_time_us) / 1000000));
+        row.emplace_back(std::to_string(std::max((item->expire_time_us - now) / 1000000, (int64_t)0)));
+        rows.emplace_back(row);
+    }
+}
+} // namespace baikaldb
+
+/* vim: set ts=4 sw=4 sts=4 tw=100 */
@@ -198,6 +198,12 @@ int MetaWriter::read_transcation_rollbacked_tag(int64_t region_id, uint64_t txn_
     return 0;
 }
 
+int MetaWriter::write_transcation_rollbacked_tag(int64_t region_id, uint64_t txn_id) {
+    rocksdb::WriteBatch batch;
+    batch.Put(_meta_cf, rollbacked_transcation_key(region_id, txn_id), rocksdb::Slice(""));
+    return write_batch(&batch, region_id);
+}
+
 int MetaWriter::write_meta_after_commit(int64_t region_id, int64_t num_table_lines, 
             int64_t applied_index, int64_t data_index, uint64_t txn_id, bool need_write_rollback) {
     if (applied_index == 0) {
@@ -24,6 +24,7 @@
 #include "table_record.h"
 #include "my_raft_log_storage.h"
 #include "log_entry_reader.h"
+#include "segment_log_storage.h"
 #include "raft_log_compaction_filter.h"
 #include "split_compaction_filter.h"
 #include "rpc_sender.h"
@@ -77,6 +78,7 @@ DEFINE_int64(throttle_throughput_bytes, 50 * 1024 * 1024LL, "throttle throughput
 DEFINE_int64(tail_split_wait_threshold, 600 * 1000 * 1000LL, "tail split wait threshold(10min)");
 DEFINE_int64(split_send_first_log_entry_threshold, 3600 * 1000 * 1000LL, "split send log entry threshold(1h)");
 DEFINE_int64(split_send_log_batch_size, 20, "split send log batch size");
+DEFINE_int32(apply_log_batch_size, 1, "max consecutive kv log entries committed together on follower, <=1 disable");
 DEFINE_int64(no_write_log_entry_threshold, 1000, "max left logEntry to be exec before no write");
 DEFINE_int64(check_peer_notice_delay_s, 1, "check peer delay notice second");
 DECLARE_int64(transfer_leader_catchup_time_threshold);
@@ -84,13 +86,19 @@ DEFINE_bool(force_clear_txn_for_fast_recovery, false, "clear all txn info for fa
 DEFINE_bool(split_add_peer_asyc, false, "asyc split add peer");
 DEFINE_int32(no_op_timer_timeout_ms, 100, "no op timer timeout(ms)");
 DEFINE_int32(follow_read_timeout_s, 10, "follow read timeout(s)");
+DEFINE_int64(closed_ts_max_clock_skew_us, 100 * 1000LL, "max clock skew between stores for stale read");
 DEFINE_bool(apply_partial_rollback, true, "apply partial rollback");
 DEFINE_bool(demotion_read_index_without_leader, true, "demotion read index without leader");
+DEFINE_bool(enable_region_hibernate, false, "idle region stretch election timeout and summarize heartbeat");
+DEFINE_int64(region_hibernate_idle_s, 600, "follower hibernate after idle(s), leader after 2 * idle(s)");
+DEFINE_int32(region_hibernate_election_timeout_ms, 60 * 1000, "election timeout of hibernated region(ms)");
 // 并发控制
 DEFINE_int64(sign_concurrency_timeout_rate,  5,      "sign_concurrency_timeout_rate, default: 5. (0 means without timeout)");
 DEFINE_int64(min_sign_concurrency_timeout_ms,1000,   "min_sign_concurrency_timeout_ms, default: 1s");
 DEFINE_int64(max_sign_concurrency_wait_cnt, 2000,   "max_sign_concurrency_wait_cnt, default: 2k");
 DEFINE_bool(open_sign_concurrency, true,   "open_sign_concurrency");
+// 所有store都升级到认识kv_batch_continue/kv_batch_has_more后才能打开，否则老follower会把拆分的日志当成多条语句
+DEFINE_int32(txn_kv_sub_batch_ops, 0, "split in-txn kv batch with more kv ops into pipelined raft logs, 0 means no split");
 DECLARE_int64(exec_1pc_out_fsm_timeout_ms);
 DECLARE_string(db_path);
 DECLARE_int64(print_time_us);
@@ -152,6 +160,8 @@ int Region::init(bool new_region, int32_t snapshot_times) {
     _meta_writer = MetaWriter::get_instance();
     TimeCost time_cost;
     _resource.reset(new RegionResource);
+    _resource->load_stat = _load_stat;
+    _resource->lock_stat = std::make_shared<RegionLockStat>(_region_id);
     //如果是新建region需要
     if (new_region) {
         std::string snapshot_path_str(FLAGS_snapshot_uri, FLAGS_snapshot_uri.find("//") + 2);
@@ -567,8 +577,40 @@ void Region::exec_txn_query_state(google::protobuf::RpcController* controller,
     //     log_id = cntl->log_id();
     // }
     response->add_regions()->CopyFrom(this->region_info());
-    _txn_pool.get_txn_state(request, response);
     response->set_leader(butil::endpoint2str(get_leader()).c_str());
+    if (request->txn_infos_size() > 0) {
+        // async commit的primary查询secondary的事务状态，只认leader上的状态
+        if (!is_leader()) {
+            response->set_errcode(pb::NOT_LEADER);
+            response->set_errmsg("not leader");
+            return;
+        }
+        for (auto& txn_info : request->txn_infos()) {
+            auto txn_res = response->add_txn_infos();
+            txn_res->set_txn_id(txn_info.txn_id());
+            txn_res->set_seq_id(txn_info.seq_id());
+            SmartTransaction txn = _txn_pool.get_txn(txn_info.txn_id());
+            if (txn == nullptr) {
+                // 没有rollback标记不能推断事务状态，可能prepare还在途，由primary写fence后决议
+                if (_meta_writer->read_transcation_rollbacked_tag(_region_id, txn_info.txn_id()) == 0) {
+                    txn_res->set_txn_state(pb::TXN_ROLLBACKED);
+                } else {
+                    txn_res->set_txn_state(pb::TXN_NOT_FOUND);
+                }
+            } else if (txn->is_rolledback()) {
+                txn_res->set_txn_state(pb::TXN_ROLLBACKED);
+            } else if (txn->is_finished()) {
+                txn_res->set_txn_state(pb::TXN_COMMITTED);
+            } else if (txn->is_prepared()) {
+                txn_res->set_txn_state(pb::TXN_PREPARED);
+            } else {
+                txn_res->set_txn_state(pb::TXN_BEGINED);
+            }
+        }
+        response->set_errcode(pb::SUCCESS);
+        return;
+    }
+    _txn_pool.get_txn_state(request, response);
     response->set_errcode(pb::SUCCESS);
 }
 
@@ -642,6 +684,38 @@ void Region::exec_update_primary_timestamp(const pb::StoreReq& request, braft::C
     }
 }
 
+void Region::exec_txn_rollback_fence(const pb::StoreReq& request, braft::Closure* done,
+        int64_t applied_index, int64_t term) {
+    const pb::TransactionInfo& txn_info = request.txn_infos(0);
+    uint64_t txn_id = txn_info.txn_id();
+    pb::TxnState txn_state = pb::TXN_ROLLBACKED;
+    SmartTransaction txn = _txn_pool.get_txn(txn_id);
+    if (txn != nullptr && !txn->rollback_fence()) {
+        // 已经prepare或结束，fence不生效，返回实际状态
+        if (txn->is_rolledback()) {
+            txn_state = pb::TXN_ROLLBACKED;
+        } else if (txn->is_finished()) {
+            txn_state = pb::TXN_COMMITTED;
+        } else {
+            txn_state = pb::TXN_PREPARED;
+        }
+    } else {
+        // 未prepare的事务之后prepare失败，不存在的事务之后的请求返回TXN_IS_ROLLBACK
+        _meta_writer->write_transcation_rollbacked_tag(_region_id, txn_id);
+    }
+    DB_WARNING("TransactionNote: rollback fence, region_id: %ld, txn_id: %lu, txn_state: %s, applied_index:%ld",
+        _region_id, txn_id, pb::TxnState_Name(txn_state).c_str(), applied_index);
+    if (done != nullptr) {
+        pb::StoreRes* response = ((DMLClosure*)done)->response;
+        response->set_errcode(pb::SUCCESS);
+        response->set_errmsg("success");
+        auto txn_res = response->add_txn_infos();
+        txn_res->set_txn_id(txn_id);
+        txn_res->set_seq_id(txn_info.seq_id());
+        txn_res->set_txn_state(txn_state);
+    }
+}
+
 void Region::exec_txn_query_primary_region(google::protobuf::RpcController* controller,
             const pb::StoreReq* request,
             pb::StoreRes* response,
@@ -666,6 +740,11 @@ void Region::exec_txn_query_primary_region(google::protobuf::RpcController* cont
         //txn还在，不做处理，可能primary region正在执行commit
         DB_WARNING("TransactionNote: txn is alive, region_id: %ld, txn_id: %lu, log_id: %lu try later",
                 _region_id, txn_id, log_id);
+        // async commit事务由primary根据secondary列表决议，不必等primary超时
+        if (txn_state == pb::TXN_PREPARED && is_leader() && txn->is_async_commit()
+                && txn->is_prepared() && !txn->is_finished()) {
+            _txn_pool.resolve_async_commit_in_background(txn_id, this);
+        }
         response->set_errcode(pb::TXN_IS_EXISTING);
         txn_res->set_seq_id(txn->seq_id());
         return;
@@ -782,6 +861,14 @@ void Region::exec_in_txn_query(google::protobuf::RpcController* controller,
     if (txn_info.need_update_primary_timestamp()) {
         _txn_pool.update_primary_timestamp(txn_info);
     }
+    // 拆分提交的大DML在follower上只apply了一部分就切主，回滚该语句后重新执行
+    if (txn != nullptr && last_seq == seq_id && txn->kv_batch_incomplete_seq() == seq_id) {
+        DB_WARNING("TransactionNote: kv batch incomplete, re-execute, remote_side:%s "
+                "region_id: %ld, txn_id: %lu, seq_id: %d, log_id:%lu",
+                remote_side, _region_id, txn_id, seq_id, log_id);
+        txn->rollback_incomplete_kv_batch(seq_id);
+        last_seq = seq_id - 1;
+    }
 
     if (txn == nullptr) {
         ret = _meta_writer->read_transcation_rollbacked_tag(_region_id, txn_id);
@@ -863,10 +950,10 @@ void Region::exec_in_txn_query(google::protobuf::RpcController* controller,
     if (txn_info.start_seq_id() != 1 && !txn_info.has_from_store() && is_2pc_op_type(op_type)) {
         if (txn != nullptr && !txn->has_dml_executed()) {
             bool optimize_1pc = txn_info.optimize_1pc();
-            _txn_pool.read_only_txn_process(_region_id, txn, op_type, optimize_1pc);
+            ret = _txn_pool.read_only_txn_process(_region_id, txn, op_type, optimize_1pc);
             txn->set_in_process(false);
             response->set_affected_rows(0);
-            response->set_errcode(pb::SUCCESS);
+            response->set_errcode(ret == 0 ? pb::SUCCESS : pb::TXN_IS_ROLLBACK);
             // DB_WARNING("TransactionNote: no write DML when commit/rollback, remote_side:%s "
             //         "region_id: %ld, txn_id: %lu, op_type: %s log_id:%lu optimize_1pc:%d",
             //         remote_side, _region_id, txn_id, pb::OpType_Name(op_type).c_str(), log_id, optimize_1pc);
@@ -939,6 +1026,7 @@ void Region::exec_in_txn_query(google::protobuf::RpcController* controller,
             }
             int64_t select_cost = cost.get_time();
             Store::get_instance()->select_time_cost << select_cost;
+            _load_stat->add_read(*response, select_cost);
             if (select_cost > FLAGS_print_time_us) {
                 //担心ByteSizeLong对性能有影响，先对耗时长的，返回行多的请求做压缩
                 if (response->affected_rows() > 1024) {
@@ -988,6 +1076,7 @@ void Region::exec_in_txn_query(google::protobuf::RpcController* controller,
             }
             int64_t select_cost = cost.get_time();
             Store::get_instance()->select_time_cost << select_cost;
+            _load_stat->add_read(*response, select_cost);
             if (select_cost > FLAGS_print_time_us) {
                 //担心ByteSizeLong对性能有影响，先对耗时长的，返回行多的请求做压缩
                 if (response->affected_rows() > 1024) {
@@ -1109,13 +1198,18 @@ void Region::exec_in_txn_query(google::protobuf::RpcController* controller,
                     raft_req->set_region_id(_region_id);
                     raft_req->set_region_version(_version);
                     raft_req->set_num_increase_rows(txn->num_increase_rows);
+                    if (propose_kv_sub_batches(raft_req, expected_term, log_id, remote_side) != 0) {
+                        apply_success = false;
+                        cntl->SetFailed(brpc::EREQUEST, "Fail to serialize request");
+                        return;
+                    }
                 }
             } else if (is_2pc_op_type(op_type) && txn != nullptr && !txn->has_dml_executed()) {
                 bool optimize_1pc = txn_info.optimize_1pc();
-                _txn_pool.read_only_txn_process(_region_id, txn, op_type, optimize_1pc);
+                ret = _txn_pool.read_only_txn_process(_region_id, txn, op_type, optimize_1pc);
                 txn->set_in_process(false);
                 response->set_affected_rows(0);
-                response->set_errcode(pb::SUCCESS);
+                response->set_errcode(ret == 0 ? pb::SUCCESS : pb::TXN_IS_ROLLBACK);
                 DB_WARNING("TransactionNote: no write DML when commit/rollback, remote_side:%s "
                         "region_id: %ld, txn_id: %lu, op_type: %s log_id:%lu optimize_1pc:%d",
                         remote_side, _region_id, txn_id, pb::OpType_Name(op_type).c_str(), log_id, optimize_1pc);
@@ -1182,9 +1276,13 @@ void Region::exec_out_txn_query(google::protobuf::RpcController* controller,
         // OP_SELECT_FOR_UPDATE 只出现在事务中。
         case pb::OP_SELECT: {
             TimeCost cost;
+            // 先取数据版本再读，版本只会偏旧，baikaldb结果缓存据此校验
+            int64_t data_index = _data_index;
             select(*request, *response);
+            response->set_data_index(data_index);
             int64_t select_cost = cost.get_time();
             Store::get_instance()->select_time_cost << select_cost;
+            _load_stat->add_read(*response, select_cost);
             if (select_cost > FLAGS_print_time_us) {
                 //担心ByteSizeLong对性能有影响，先对耗时长的，返回行多的请求做压缩
                 if (response->affected_rows() > 1024) {
@@ -1402,6 +1500,7 @@ void Region::exec_kv_out_txn(const pb::StoreReq* request,
     int64_t dml_cost = cost.get_time();
     Store::get_instance()->dml_time_cost << dml_cost;
     _dml_time_cost << dml_cost;
+    add_write_load(*request, dml_cost);
     if (dml_cost > FLAGS_print_time_us) {
         DB_NOTICE("region_id: %ld, txn_id: %lu, num_table_lines:%ld, "
                   "affected_rows:%d, log_id:%lu,"
@@ -1605,6 +1704,10 @@ void Region::query(google::protobuf::RpcController* controller,
     }
     const auto& remote_side_tmp = butil::endpoint2str(cntl->remote_side());
     const char* remote_side = remote_side_tmp.c_str();
+    if (is_leader()) {
+        _active_time_cost.reset();
+        wake_up();
+    }
     if (!is_leader()) {
         if (!is_learner()) {
             _not_leader_alarm.not_leader_alarm(_node.leader_id());
@@ -1629,7 +1732,16 @@ void Region::query(google::protobuf::RpcController* controller,
                     _region_id, log_id, remote_side);
             return;
         }
-        if (request->extra_req().use_read_idx()) {
+        if (request->extra_req().max_staleness_us() > 0) {
+            // 有界陈旧读，不需要向leader获取read index
+            if (!can_stale_read(request->extra_req().max_staleness_us())) {
+                response->set_errcode(is_learner() ? pb::LEARNER_NOT_READY : pb::NOT_LEADER);
+                response->set_errmsg("closed ts too old for stale read");
+                DB_DEBUG("region_id: %ld closed_ts_us: %ld, max_staleness_us: %ld, log_id:%lu",
+                        _region_id, _closed_ts_us.load(), request->extra_req().max_staleness_us(), log_id);
+                return;
+            }
+        } else if (request->extra_req().use_read_idx()) {
             if (!_ready_for_follower_read) {
                 response->set_errcode(is_learner() ? pb::LEARNER_NOT_READY : pb::NOT_LEADER);
                 response->set_errmsg("not readly for follower read");
@@ -1728,6 +1840,7 @@ void Region::query(google::protobuf::RpcController* controller,
         }
         case pb::OP_ADD_VERSION_FOR_SPLIT_REGION:
         case pb::OP_UPDATE_PRIMARY_TIMESTAMP:
+        case pb::OP_TXN_ROLLBACK_FENCE:
         case pb::OP_NONE: {
             if (request->op_type() == pb::OP_NONE) {
                 if (_split_param.split_slow_down) {
@@ -1889,6 +2002,17 @@ void Region::dml_2pc(const pb::StoreReq& request,
         if (txn_info.has_primary_region_id()) {
             txn->set_primary_region_id(txn_info.primary_region_id());
         }
+        if (op_type == pb::OP_PREPARE && txn->is_rollback_fenced()) {
+            // primary已按async commit决议回滚
+            response.set_errcode(pb::TXN_IS_ROLLBACK);
+            response.set_errmsg("txn rollback fenced");
+            DB_WARNING("TransactionNote: prepare rollback fenced txn, region_id: %ld, txn_id: %lu, applied_index: %ld",
+                _region_id, txn_id, applied_index);
+            return;
+        }
+        if (op_type == pb::OP_PREPARE && txn_info.async_commit()) {
+            txn->set_async_commit(txn_info);
+        }
         need_write_rollback = txn->need_write_rollback(op_type);
         rocksdb_txn_id = txn->rocksdb_txn_id();
     }
@@ -2116,11 +2240,13 @@ void Region::dml_2pc(const pb::StoreReq& request,
     if ((op_type == pb::OP_PREPARE) && auto_commit && txn != nullptr) {
         Store::get_instance()->dml_time_cost << (dml_cost + txn->get_exec_time_cost());
         _dml_time_cost << (dml_cost + txn->get_exec_time_cost());
+        add_write_load(request, dml_cost + txn->get_exec_time_cost());
     } else if (auto_commit && txn != nullptr) {
         txn->add_exec_time_cost(dml_cost);
     } else if (op_type == pb::OP_INSERT || op_type == pb::OP_DELETE || op_type == pb::OP_UPDATE) {
         Store::get_instance()->dml_time_cost << dml_cost;
         _dml_time_cost << dml_cost;
+        add_write_load(request, dml_cost);
     }
     if (dml_cost > FLAGS_print_time_us ||
         //op_type == pb::OP_BEGIN ||
@@ -2305,7 +2431,8 @@ void Region::dml_1pc(const pb::StoreReq& request, pb::OpType op_type,
                         "applied_index: %ld, error_code: %d", 
                         _region_id, state.txn_id, state.seq_id, applied_index, 
                         state.error_code);
-            } else if (state.error_code == ER_LOCK_WAIT_TIMEOUT && done == nullptr) { 
+            } else if ((state.error_code == ER_LOCK_WAIT_TIMEOUT || state.error_code == ER_LOCK_DEADLOCK)
+                    && done == nullptr) { 
                 response.set_errcode(pb::RETRY_LATER);
                 DB_WARNING("1pc in fsm Lock timeout region_id: %ld, txn_id: %lu:%d"
                         "applied_index: %ld, error_code: %d", 
@@ -2426,9 +2553,11 @@ void Region::dml_1pc(const pb::StoreReq& request, pb::OpType op_type,
     if ((op_type == pb::OP_PREPARE) && auto_commit) {
         Store::get_instance()->dml_time_cost << (dml_cost + txn->get_exec_time_cost());
         _dml_time_cost << (dml_cost + txn->get_exec_time_cost());
+        add_write_load(request, dml_cost + txn->get_exec_time_cost());
     } else if (op_type == pb::OP_INSERT || op_type == pb::OP_DELETE || op_type == pb::OP_UPDATE) {
         Store::get_instance()->dml_time_cost << dml_cost;
         _dml_time_cost << dml_cost;
+        add_write_load(request, dml_cost);
     }
     if (dml_cost > FLAGS_print_time_us ||
         op_type == pb::OP_COMMIT ||
@@ -2481,6 +2610,75 @@ void Region::kv_apply_raft(RuntimeState* state, SmartTransaction txn) {
     _node.apply(task); 
 }
 
+bool Region::split_kv_sub_batches(pb::StoreReq* raft_req, int batch_ops,
+                                  std::vector<pb::StoreReq>& sub_reqs) {
+    int total_ops = raft_req->kv_ops_size();
+    if (batch_ops <= 0 || total_ops <= batch_ops) {
+        return false;
+    }
+    int last_start = (total_ops - 1) / batch_ops * batch_ops;
+    google::protobuf::RepeatedPtrField<pb::KvOp> kv_ops;
+    kv_ops.Swap(raft_req->mutable_kv_ops());
+    pb::StoreReq sub_req;
+    sub_req.CopyFrom(*raft_req);
+    // 行数变化只在最后一批带上
+    sub_req.set_num_increase_rows(0);
+    sub_req.set_kv_batch_has_more(true);
+    for (int start = 0; start < last_start; start += batch_ops) {
+        sub_reqs.push_back(sub_req);
+        pb::StoreReq& req = sub_reqs.back();
+        for (int i = start; i < start + batch_ops; ++i) {
+            req.add_kv_ops()->Swap(kv_ops.Mutable(i));
+        }
+        req.set_kv_batch_continue(start > 0);
+    }
+    for (int i = last_start; i < total_ops; ++i) {
+        raft_req->add_kv_ops()->Swap(kv_ops.Mutable(i));
+    }
+    raft_req->set_kv_batch_continue(true);
+    return true;
+}
+
+// 事务内大DML的kv_ops按txn_kv_sub_batch_ops拆成多条日志连续propose，不等待前面的日志apply
+// 前面的日志使用InternalDMLClosure，最后一批留在raft_req中按原流程提交，结果以最后一批为准
+// 同一seq_id只在第一条日志设置save point，局部回滚仍按seq_id整体回滚
+int Region::propose_kv_sub_batches(pb::StoreReq* raft_req, int64_t expected_term,
+                                   uint64_t log_id, const std::string& remote_side) {
+    int total_ops = raft_req->kv_ops_size();
+    std::vector<pb::StoreReq> sub_reqs;
+    if (!split_kv_sub_batches(raft_req, FLAGS_txn_kv_sub_batch_ops, sub_reqs)) {
+        return 0;
+    }
+    // 先全部序列化，避免只propose一部分
+    std::vector<butil::IOBuf> datas(sub_reqs.size());
+    for (size_t i = 0; i < sub_reqs.size(); ++i) {
+        butil::IOBufAsZeroCopyOutputStream wrapper(&datas[i]);
+        if (!sub_reqs[i].SerializeToZeroCopyStream(&wrapper)) {
+            DB_FATAL("Fail to serialize kv sub batch, region_id: %ld, log_id:%lu", _region_id, log_id);
+            return -1;
+        }
+    }
+    for (auto& data : datas) {
+        InternalDMLClosure* c = new InternalDMLClosure;
+        c->cost.reset();
+        c->op_type = pb::OP_KV_BATCH;
+        c->log_id = log_id;
+        c->region = this;
+        c->remote_side = remote_side;
+        braft::Task task;
+        task.data = &data;
+        task.done = c;
+        task.expected_term = expected_term;
+        _real_writing_cond.increase();
+        _node.apply(task);
+    }
+    static bvar::Adder<int64_t> kv_sub_batch_count("txn_kv_sub_batch_count");
+    kv_sub_batch_count << datas.size();
+    DB_DEBUG("region_id: %ld, log_id:%lu, kv ops: %d, sub batches: %lu",
+            _region_id, log_id, total_ops, datas.size() + 1);
+    return 0;
+}
+
 //
 void deal_learner_plan(pb::Plan& plan) {
     for (auto& node : *plan.mutable_nodes()) {
@@ -3020,6 +3218,13 @@ void Region::construct_heart_beat_request(pb::StoreHeartBeatRequest& request, bo
         return;
     }
     _region_info.set_num_table_lines(_num_table_lines.load());
+    // 休眠的leader只上报region_id，meta据此刷新region和peer状态
+    // balance周期需要完整信息，照常上报
+    if (_hibernated.load() && is_leader() && !need_peer_balance
+            && !request.need_leader_balance() && !is_merged()) {
+        request.add_hibernated_leader_region_ids(_region_id);
+        return;
+    }
     //增加peer心跳信息
     if ((need_peer_balance || is_merged()) 
         // addpeer过程中，还没走到on_configuration_committed，此时删表，会导致peer清理不掉
@@ -3062,6 +3267,7 @@ void Region::construct_heart_beat_request(pb::StoreHeartBeatRequest& request, bo
             //_region_info.add_peers(butil::endpoint2str(peer.addr).c_str());
         }
         construct_peers_status(leader_heart);
+        _load_stat->roll_window(leader_heart->mutable_load());
     }
 
     if (is_learner()) {
@@ -3078,6 +3284,70 @@ void Region::construct_heart_beat_request(pb::StoreHeartBeatRequest& request, bo
     }
 }
 
+void Region::check_hibernate() {
+    if (!FLAGS_enable_region_hibernate || _hibernated.load()) {
+        return;
+    }
+    if (_shutdown || !_init_success || _removed || is_learner()
+            || _is_binlog_region || get_version() == 0) {
+        return;
+    }
+    int64_t idle_us = FLAGS_region_hibernate_idle_s * 1000 * 1000LL;
+    if (is_leader()) {
+        if (_active_time_cost.get_time() < idle_us * 2
+                || _region_control.get_status() != pb::IDLE
+                || _txn_pool.num_prepared() > 0) {
+            return;
+        }
+        braft::NodeStatus status;
+        _node.get_status(&status);
+        if (status.unstable_followers.size() > 0
+                || status.committed_index != status.last_index
+                || _applied_index < status.committed_index) {
+            return;
+        }
+        for (auto& iter : status.stable_followers) {
+            if (iter.second.consecutive_error_times > 0
+                    || iter.second.installing_snapshot
+                    || iter.second.next_index != status.last_index + 1) {
+                return;
+            }
+        }
+    } else if (_active_time_cost.get_time() < idle_us) {
+        return;
+    }
+    BAIDU_SCOPED_LOCK(_hibernate_mutex);
+    if (_hibernated.load()) {
+        return;
+    }
+    _hibernated.store(true);
+    _no_op_timer.stop_timer();
+    _node.reset_election_timeout_ms(FLAGS_region_hibernate_election_timeout_ms);
+    static bvar::Adder<int64_t> hibernate_count("region_hibernate_count");
+    hibernate_count << 1;
+    DB_WARNING("region_id: %ld hibernate, is_leader: %d, idle_time: %ld",
+            _region_id, is_leader(), _active_time_cost.get_time());
+}
+
+void Region::wake_up() {
+    if (!_hibernated.load()) {
+        return;
+    }
+    BAIDU_SCOPED_LOCK(_hibernate_mutex);
+    if (!_hibernated.load()) {
+        return;
+    }
+    _node.reset_election_timeout_ms(FLAGS_election_timeout_ms);
+    _hibernated.store(false);
+    // 休眠时停掉的no op定时器，leader唤醒后重新启动
+    if (is_leader()) {
+        _no_op_timer.reset_timer();
+    }
+    static bvar::Adder<int64_t> wake_up_count("region_wake_up_count");
+    wake_up_count << 1;
+    DB_WARNING("region_id: %ld wake up, is_leader: %d", _region_id, is_leader());
+}
+
 void Region::set_can_add_peer() {
     if (!_region_info.can_add_peer()) {
         pb::RegionInfo region_info_mem;
@@ -3236,9 +3506,17 @@ void Region::do_apply(int64_t term, int64_t index, const pb::StoreReq& request,
             _meta_writer->update_apply_index(_region_id, _applied_index, _data_index);
             break;
         }
+        case pb::OP_TXN_ROLLBACK_FENCE: {
+            exec_txn_rollback_fence(request, done, _applied_index, term);
+            _meta_writer->update_apply_index(_region_id, _applied_index, _data_index);
+            break;
+        }
         //split的各类请求传进的来的done类型各不相同，不走下边的if(done)逻辑，直接处理完成，然后continue
         case pb::OP_NONE: {
             _meta_writer->update_apply_index(_region_id, _applied_index, _data_index);
+            if (request.has_closed_ts_us() && request.closed_ts_us() > _closed_ts_us.load()) {
+                _closed_ts_us.store(request.closed_ts_us());
+            }
             if (done != nullptr) {
                 ((DMLClosure*)done)->response->set_errcode(pb::SUCCESS);
             }
@@ -3311,9 +3589,16 @@ void Region::on_apply(braft::Iterator& iter) {
             continue;
         }
         reset_timecost();
+        _active_time_cost.reset();
+        wake_up();
         auto term = iter.term();
         auto index = iter.index();
         _braft_apply_index = index;
+        if (can_batch_apply(*request, done, index)) {
+            batch_apply_kv_out_txn(*request, index, term);
+            continue;
+        }
+        flush_batch_apply();
         if (request->op_type() == pb::OP_ADD_VERSION_FOR_SPLIT_REGION ||
                 (get_version() == 0 && request->op_type() == pb::OP_CLEAR_APPLYING_TXN)) {
             // 异步队列排空
@@ -3362,6 +3647,7 @@ void Region::on_apply(braft::Iterator& iter) {
             braft::run_closure_in_bthread(done_guard.release());
         }
     }
+    flush_batch_apply();
 }
 
 bool Region::check_key_fits_region_range(SmartIndex pk_info, SmartTransaction txn,
@@ -3405,11 +3691,12 @@ void Region::apply_kv_in_txn(const pb::StoreReq& request, braft::Closure* done,
     bool apply_success = true;
     int64_t num_increase_rows = 0;
     //DB_WARNING("index:%ld request:%s", index, request.ShortDebugString().c_str());
-    ScopeGuard auto_rollback_current_request([this, &txn, &apply_success]() {
+    ScopeGuard auto_rollback_current_request([this, &txn, &apply_success, &request]() {
         if (txn != nullptr && !apply_success) {
             txn->rollback_current_request();
         }
-        if (txn != nullptr) {
+        // 拆分提交的中间kv batch，leader上最后一批还未propose
+        if (txn != nullptr && !request.kv_batch_has_more()) {
             txn->set_in_process(false);
             txn->clear_raftreq();
         }
@@ -3474,39 +3761,57 @@ void Region::apply_kv_in_txn(const pb::StoreReq& request, braft::Closure* done,
 
     if (txn != nullptr) {
         txn->set_write_begin_index(false);
-        txn->set_applying(false);
+        // 拆分提交的kv batch在最后一条日志apply后才结束
+        if (!request.kv_batch_has_more()) {
+            txn->set_applying(false);
+        }
         txn->set_applied_seq_id(seq_id);
         txn->set_resource(resource);
     }
     
     if (done == nullptr) {
         // follower
-        if (last_seq >= seq_id) {
-            DB_WARNING("Transaction exec before, region_id: %ld, txn_id: %lu, seq_id: %d, req_seq: %d",
-                _region_id, txn_id, txn->seq_id(), seq_id);
-            return;
-        }
-        // rollback already executed cmds
-        std::set<int> need_rollback_seq;
-        for (int rollback_seq : txn_info.need_rollback_seq()) {
-            need_rollback_seq.insert(rollback_seq);
-        }
-        for (auto it = need_rollback_seq.rbegin(); it != need_rollback_seq.rend(); ++it) {
-            int seq = *it;
-            txn->rollback_to_point(seq);
-            //DB_WARNING("rollback seq_id: %d region_id: %ld, txn_id: %lu, seq_id: %d, req_seq: %d", 
-            //    seq, _region_id, txn_id, txn->seq_id(), seq_id);
-        }
-        // if current cmd need rollback, simply not execute
-        if (need_rollback_seq.count(seq_id) != 0) {
-            DB_WARNING("need rollback, not executed and cached. region_id: %ld, txn_id: %lu, seq_id: %d, req_seq: %d",
-                _region_id, txn_id, txn->seq_id(), seq_id);
+        bool kv_batch_continue = request.kv_batch_continue();
+        if (kv_batch_continue) {
+            // 同一seq_id的后续kv batch，前面的日志没有执行(如需要回滚)则跳过
+            if (last_seq != seq_id || txn->kv_batch_incomplete_seq() != seq_id) {
+                DB_WARNING("kv batch not continued, region_id: %ld, txn_id: %lu, seq_id: %d, req_seq: %d",
+                    _region_id, txn_id, txn->seq_id(), seq_id);
+                return;
+            }
+        } else {
+            // 上次只apply了一部分，新leader重新执行该seq_id
+            if (last_seq == seq_id && txn->kv_batch_incomplete_seq() == seq_id) {
+                txn->rollback_incomplete_kv_batch(seq_id);
+                last_seq = seq_id - 1;
+            }
+            if (last_seq >= seq_id) {
+                DB_WARNING("Transaction exec before, region_id: %ld, txn_id: %lu, seq_id: %d, req_seq: %d",
+                    _region_id, txn_id, txn->seq_id(), seq_id);
+                return;
+            }
+            // rollback already executed cmds
+            std::set<int> need_rollback_seq;
+            for (int rollback_seq : txn_info.need_rollback_seq()) {
+                need_rollback_seq.insert(rollback_seq);
+            }
+            for (auto it = need_rollback_seq.rbegin(); it != need_rollback_seq.rend(); ++it) {
+                int seq = *it;
+                txn->rollback_to_point(seq);
+                //DB_WARNING("rollback seq_id: %d region_id: %ld, txn_id: %lu, seq_id: %d, req_seq: %d", 
+                //    seq, _region_id, txn_id, txn->seq_id(), seq_id);
+            }
+            // if current cmd need rollback, simply not execute
+            if (need_rollback_seq.count(seq_id) != 0) {
+                DB_WARNING("need rollback, not executed and cached. region_id: %ld, txn_id: %lu, seq_id: %d, req_seq: %d",
+                    _region_id, txn_id, txn->seq_id(), seq_id);
+                txn->set_seq_id(seq_id);
+                return;
+            }
             txn->set_seq_id(seq_id);
-            return;
+            // set checkpoint for current DML operator
+            txn->set_save_point();
         }
-        txn->set_seq_id(seq_id);
-        // set checkpoint for current DML operator
-        txn->set_save_point();
         txn->set_primary_region_id(txn_info.primary_region_id());
         auto pk_info = _factory->get_index_info_ptr(_table_id);
         for (auto& kv_op : request.kv_ops()) {
@@ -3556,13 +3861,18 @@ void Region::apply_kv_in_txn(const pb::StoreReq& request, braft::Closure* done,
             num_increase_rows = request.num_increase_rows();
         }
         txn->num_increase_rows += num_increase_rows;
-        pb::CachePlan plan_item;
-        plan_item.set_op_type(request.op_type());
-        plan_item.set_seq_id(seq_id);
-        for (auto& kv_op : request.kv_ops()) {
-            plan_item.add_kv_ops()->CopyFrom(kv_op);
+        if (kv_batch_continue) {
+            txn->append_kv_ops_to_cache(seq_id, request);
+        } else {
+            pb::CachePlan plan_item;
+            plan_item.set_op_type(request.op_type());
+            plan_item.set_seq_id(seq_id);
+            for (auto& kv_op : request.kv_ops()) {
+                plan_item.add_kv_ops()->CopyFrom(kv_op);
+            }
+            txn->push_cmd_to_cache(seq_id, plan_item);
         }
-        txn->push_cmd_to_cache(seq_id, plan_item);
+        txn->set_kv_batch_incomplete_seq(request.kv_batch_has_more() ? seq_id : 0);
     } else {
         // leader
         ((DMLClosure*)done)->response->set_errcode(pb::SUCCESS);
@@ -3694,6 +4004,99 @@ void Region::apply_kv_out_txn(const pb::StoreReq& request, braft::Closure* done,
     }
 }
 
+bool Region::can_batch_apply(const pb::StoreReq& request, braft::Closure* done, int64_t index) {
+    // leader的日志各自持有已加锁的事务，只能逐条提交；分裂中的region走异步队列
+    if (FLAGS_apply_log_batch_size <= 1 || done != nullptr || get_version() == 0) {
+        return false;
+    }
+    if (request.op_type() != pb::OP_KV_BATCH || index <= _applied_index) {
+        return false;
+    }
+    return request.txn_infos_size() == 0 || request.txn_infos(0).txn_id() == 0;
+}
+
+void Region::batch_apply_kv_out_txn(const pb::StoreReq& request, int64_t index, int64_t term) {
+    if (_batch_apply_txn == nullptr) {
+        _batch_apply_txn = SmartTransaction(new Transaction(0, &_txn_pool));
+        _batch_apply_txn->set_resource(get_resource());
+        _batch_apply_txn->begin(Transaction::TxnOptions());
+    }
+    // 单条日志失败只回滚自己的kv，与逐条apply时一致
+    auto rocksdb_txn = _batch_apply_txn->get_txn();
+    rocksdb_txn->SetSavePoint();
+    bool apply_succ = true;
+    for (auto& kv_op : request.kv_ops()) {
+        pb::OpType op_type = kv_op.op_type();
+        int ret = 0;
+        if (op_type == pb::OP_PUT_KV) {
+            ret = _batch_apply_txn->put_kv(kv_op.key(), kv_op.value(), kv_op.ttl_timestamp_us());
+        } else {
+            ret = _batch_apply_txn->delete_kv(kv_op.key());
+        }
+        if (ret < 0) {
+            DB_FATAL("kv operation fail, op_type:%s, region_id: %ld, "
+                    "applied_index: %ld, term:%ld",
+                    pb::OpType_Name(op_type).c_str(), _region_id, index, term);
+            apply_succ = false;
+            break;
+        }
+    }
+    if (apply_succ) {
+        rocksdb_txn->PopSavePoint();
+        _batch_num_increase_rows += request.num_increase_rows();
+    } else {
+        rocksdb_txn->RollbackToSavePoint();
+    }
+    _batch_apply_index = index;
+    _batch_apply_term = term;
+    ++_batch_apply_count;
+    if (_batch_apply_count >= FLAGS_apply_log_batch_size) {
+        flush_batch_apply();
+    }
+}
+
+void Region::flush_batch_apply() {
+    if (_batch_apply_txn == nullptr) {
+        return;
+    }
+    static bvar::LatencyRecorder apply_batch_size("apply_log_batch_size");
+    TimeCost cost;
+    SmartTransaction txn = _batch_apply_txn;
+    int64_t index = _batch_apply_index;
+    int64_t num_increase_rows = _batch_num_increase_rows;
+    int32_t batch_count = _batch_apply_count;
+    _batch_apply_txn = nullptr;
+    _batch_num_increase_rows = 0;
+    _batch_apply_count = 0;
+
+    _region_info.set_log_index(index);
+    _applied_index = index;
+    _data_index = index;
+    int64_t num_table_lines = _num_table_lines + num_increase_rows;
+    _meta_writer->write_meta_index_and_num_table_lines(_region_id, index, _data_index, num_table_lines, txn);
+    auto res = txn->commit();
+    if (res.ok()) {
+        if (num_increase_rows < 0) {
+            _num_delete_lines -= num_increase_rows;
+        }
+        _num_table_lines = num_table_lines;
+    } else {
+        txn->rollback();
+        DB_FATAL("commit fail, region_id:%ld, applied_index: %ld, term:%ld, batch_count:%d, err:%s",
+                _region_id, index, _batch_apply_term, batch_count, res.ToString().c_str());
+    }
+    _done_applied_index = _applied_index;
+    apply_batch_size << batch_count;
+    int64_t dml_cost = cost.get_time();
+    Store::get_instance()->dml_time_cost << dml_cost;
+    if (dml_cost > FLAGS_print_time_us) {
+        DB_NOTICE("time_cost:%ld, region_id: %ld, table_lines:%ld, "
+                   "increase_lines:%ld, applied_index:%ld, batch_count:%d",
+                   dml_cost, _region_id, _num_table_lines.load(),
+                   num_increase_rows, index, batch_count);
+    }
+}
+
 void Region::apply_txn_request(const pb::StoreReq& request, braft::Closure* done, int64_t index, int64_t term) {
     uint64_t txn_id = request.txn_infos_size() > 0 ? request.txn_infos(0).txn_id():0;
     if (txn_id == 0) {
@@ -4359,6 +4762,8 @@ void Region::on_shutdown() {
 
 void Region::on_leader_start(int64_t term) {
     DB_WARNING("leader start at term:%ld, region_id: %ld", term, _region_id);
+    _active_time_cost.reset();
+    wake_up();
     _not_leader_alarm.set_leader_start();
     _region_info.set_leader(butil::endpoint2str(get_leader()).c_str());
     if (!_is_binlog_region) {
@@ -4375,6 +4780,7 @@ void Region::on_leader_start(int64_t term) {
 void Region::on_leader_stop() {
     DB_WARNING("leader stop at term, region_id: %ld", _region_id);
     _is_leader.store(false);
+    wake_up();
     _not_leader_alarm.reset();
     //只读事务清理
     _txn_pool.on_leader_stop_rollback();
@@ -4384,9 +4790,19 @@ void Region::on_leader_stop(const butil::Status& status) {
     DB_WARNING("leader stop, region_id: %ld, error_code:%d, error_des:%s",
                 _region_id, status.error_code(), status.error_cstr());
     _is_leader.store(false);
+    wake_up();
     _txn_pool.on_leader_stop_rollback();
 }
 
+void Region::on_start_following(const braft::LeaderChangeContext& ctx) {
+    _active_time_cost.reset();
+    wake_up();
+}
+
+void Region::on_stop_following(const braft::LeaderChangeContext& ctx) {
+    wake_up();
+}
+
 void Region::on_error(const ::braft::Error& e) {
     DB_FATAL("raft node meet error, is_learner:%d, region_id: %ld, error_type:%d, error_desc:%s",
                 is_learner(), _region_id, e.type(), e.status().error_cstr());
@@ -4442,14 +4858,24 @@ void Region::on_snapshot_save(braft::SnapshotWriter* writer, braft::Closure* don
     if (get_version() == 0) {
         wait_async_apply_log_queue_empty();
     }
-    if (writer->add_file(SNAPSHOT_META_FILE) != 0 
-            || writer->add_file(SNAPSHOT_DATA_FILE) != 0) {
+    // 大region数据按key范围拆成多个chunk文件，单个chunk失败只需重读该chunk
+    int chunk_num = _is_binlog_region ? 1 : snapshot_data_chunk_num(get_approx_size());
+    if (writer->add_file(SNAPSHOT_META_FILE) != 0) {
         done->status().set_error(EINVAL, "Fail to add snapshot");
         DB_WARNING("Error while adding extra_fs to writer, region_id: %ld", _region_id);
         return;
     }
-    DB_WARNING("region_id: %ld snapshot save complete, _snapshot_index:%ld _applied_index:%ld time_cost: %ld",
-                _region_id, _snapshot_index, _applied_index, time_cost.get_time());
+    for (int i = 0; i < chunk_num; ++i) {
+        std::string data_file = chunk_num > 1 ? snapshot_data_chunk_file(i, chunk_num) : SNAPSHOT_DATA_FILE;
+        if (writer->add_file(data_file) != 0) {
+            done->status().set_error(EINVAL, "Fail to add snapshot");
+            DB_WARNING("Error while adding extra_fs to writer, region_id: %ld", _region_id);
+            return;
+        }
+    }
+    DB_WARNING("region_id: %ld snapshot save complete, _snapshot_index:%ld _applied_index:%ld "
+                "chunk_num: %d time_cost: %ld",
+                _region_id, _snapshot_index, _applied_index, chunk_num, time_cost.get_time());
     reset_snapshot_status();
 }
 
@@ -4603,6 +5029,19 @@ void Region::on_snapshot_load_for_restart(braft::SnapshotReader* reader,
                 prepared_log_entrys.size(), time_cost.get_time());
 }
 
+// 数据快照可能拆成多个chunk，任一chunk有数据即可
+static bool has_snapshot_data_sst(const std::string& dir) {
+    typedef boost::filesystem::directory_iterator dir_iter;
+    dir_iter end;
+    for (dir_iter iter(dir); iter != end; ++iter) {
+        std::string file_name = iter->path().filename().string();
+        if (boost::istarts_with(file_name, SNAPSHOT_DATA_FILE)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 int Region::on_snapshot_load(braft::SnapshotReader* reader) {
     reset_timecost();
     TimeCost time_cost;
@@ -4611,7 +5050,6 @@ int Region::on_snapshot_load(braft::SnapshotReader* reader) {
         _meta_writer->clear_doing_snapshot(_region_id);
         DB_WARNING("region_id: %ld on snapshot load over", _region_id);
     });
-    std::string data_sst_file = reader->get_path() + SNAPSHOT_DATA_FILE_WITH_SLASH;
     std::string meta_sst_file = reader->get_path() + SNAPSHOT_META_FILE_WITH_SLASH;
     boost::filesystem::path snapshot_meta_file = meta_sst_file;
     std::map<int64_t, std::string> prepared_log_entrys; 
@@ -4660,11 +5098,10 @@ int Region::on_snapshot_load(braft::SnapshotReader* reader) {
                 return -1;
             }
             _meta_writer->read_applied_index(_region_id, &_applied_index, &_data_index);
-            boost::filesystem::path snapshot_first_data_file = data_sst_file + "0";
             //如果新的_data_index和old_data_index一样，则不需要清理数据，而且leader也不会发送数据
             //如果存在data_sst并且是重启过程，则清理后走重启故障恢复
             if (_data_index > old_data_index || 
-                (_restart && boost::filesystem::exists(snapshot_first_data_file))) {
+                (_restart && has_snapshot_data_sst(reader->get_path()))) {
                 //删除preapred 但没有committed的事务
                 _txn_pool.clear();
                 RegionControl::remove_data(_region_id);
@@ -6105,6 +6542,10 @@ int Region::replay_applied_txn_for_recovery(
                 txn->add_need_rollback_seq(seq_id);
             }
             txn->set_primary_region_id(txn_info.primary_region_id());
+            if (txn_info.async_commit()) {
+                txn->set_async_commit(true);
+                txn->mutable_secondary_region_ids()->CopyFrom(txn_info.secondary_region_ids());
+            }
             pb::CachePlan* pb_cache_plan = txn->add_cache_plans();
             pb_cache_plan->CopyFrom(begin_plan);
 
@@ -6795,6 +7236,27 @@ void Region::complete_split() {
 }
 
 void Region::print_log_entry(const int64_t start_index, const int64_t end_index) {
+    if (SegmentLogManager::get_instance()->has_region(_region_id)) {
+        for (int64_t log_index = start_index; log_index <= end_index && log_index < start_index + 100; ++log_index) {
+            int64_t term = 0;
+            int type = 0;
+            std::string value;
+            if (SegmentLogManager::get_instance()->read_entry(_region_id, log_index, term, type, value) != 0) {
+                break;
+            }
+            if ((braft::EntryType)type != braft::ENTRY_TYPE_DATA) {
+                continue;
+            }
+            pb::StoreReq store_req;
+            if (!store_req.ParseFromString(value)) {
+                DB_FATAL("Fail to parse request fail, region_id: %ld", _region_id);
+                continue;
+            }
+            DB_WARNING("region: %ld, log_index: %ld, term: %ld, req: %s",
+                    _region_id, log_index, term, store_req.ShortDebugString().c_str());
+        }
+        return;
+    }
     MutTableKey log_data_key;
     log_data_key.append_i64(_region_id).append_u8(MyRaftLogStorage::LOG_DATA_IDENTIFY).append_i64(start_index);
     rocksdb::ReadOptions read_options;
@@ -6838,35 +7300,22 @@ int Region::get_log_entry_for_split(const int64_t split_start_index,
     batch_request.set_region_id(_split_param.new_region_id);
     batch_request.set_resend_start_pos(0);
     butil::IOBuf attachment_data;
-    MutTableKey log_data_key;
-    log_data_key.append_i64(_region_id).append_u8(MyRaftLogStorage::LOG_DATA_IDENTIFY).append_i64(split_start_index);
-    rocksdb::ReadOptions read_options;
-    read_options.prefix_same_as_start = true;
-    read_options.total_order_seek = false;
-    read_options.fill_cache = false;
-    std::unique_ptr<rocksdb::Iterator> iter(_rocksdb->new_iterator(read_options, RocksWrapper::RAFT_LOG_CF));
-    iter->Seek(log_data_key.data());
-    // 小batch发送
-    for (int i = 0; iter->Valid() && i < 10000; iter->Next(), i++) {
-        TableKey key(iter->key());
-        int64_t log_index = key.extract_i64(sizeof(int64_t) + 1);
+    auto append_log_entry = [&](int64_t log_index, int64_t term, int type,
+                                const rocksdb::Slice& value_slice) -> int {
         if (log_index != start_index) {
             DB_FATAL("log index not continueous, start_index:%ld, log_index:%ld, region_id: %ld", 
                     start_index, log_index, _region_id);
             return -1;
         }
-        rocksdb::Slice value_slice(iter->value());
-        LogHead head(iter->value());
-        value_slice.remove_prefix(MyRaftLogStorage::LOG_HEAD_SIZE); 
-        if (head.term != expected_term) {
+        if (term != expected_term) {
             DB_FATAL("term not equal to expect_term, term:%ld, expect_term:%ld, region_id: %ld", 
-                      head.term, expected_term, _region_id);
+                      term, expected_term, _region_id);
             return -1;
         }
-        if ((braft::EntryType)head.type != braft::ENTRY_TYPE_DATA) {
+        if ((braft::EntryType)type != braft::ENTRY_TYPE_DATA) {
             ++start_index;
-            DB_WARNING("log entry is not data, log_index:%ld, region_id: %ld, type: %d", log_index, _region_id, (braft::EntryType)head.type);
-            continue;
+            DB_WARNING("log entry is not data, log_index:%ld, region_id: %ld, type: %d", log_index, _region_id, (braft::EntryType)type);
+            return 0;
         }
         // TODO 后续上线可以不序列化反序列化
         pb::StoreReq store_req;
@@ -6897,6 +7346,50 @@ int Region::get_log_entry_for_split(const int64_t split_start_index,
             attachment_data.clear();
         }
         ++start_index;
+        return 0;
+    };
+    bool has_more = false;
+    if (SegmentLogManager::get_instance()->has_region(_region_id)) {
+        SegmentLogManager* manager = SegmentLogManager::get_instance();
+        int64_t first_log_index = 0;
+        int64_t last_log_index = 0;
+        manager->get_log_index(_region_id, first_log_index, last_log_index);
+        int64_t log_index = split_start_index;
+        // 小batch发送
+        for (int i = 0; log_index <= last_log_index && i < 10000; ++log_index, i++) {
+            int64_t term = 0;
+            int type = 0;
+            std::string value;
+            if (manager->read_entry(_region_id, log_index, term, type, value) != 0) {
+                DB_FATAL("read segment log fail, log_index:%ld, region_id: %ld", log_index, _region_id);
+                return -1;
+            }
+            if (append_log_entry(log_index, term, type, value) != 0) {
+                return -1;
+            }
+        }
+        has_more = log_index <= last_log_index;
+    } else {
+        MutTableKey log_data_key;
+        log_data_key.append_i64(_region_id).append_u8(MyRaftLogStorage::LOG_DATA_IDENTIFY).append_i64(split_start_index);
+        rocksdb::ReadOptions read_options;
+        read_options.prefix_same_as_start = true;
+        read_options.total_order_seek = false;
+        read_options.fill_cache = false;
+        std::unique_ptr<rocksdb::Iterator> iter(_rocksdb->new_iterator(read_options, RocksWrapper::RAFT_LOG_CF));
+        iter->Seek(log_data_key.data());
+        // 小batch发送
+        for (int i = 0; iter->Valid() && i < 10000; iter->Next(), i++) {
+            TableKey key(iter->key());
+            int64_t log_index = key.extract_i64(sizeof(int64_t) + 1);
+            rocksdb::Slice value_slice(iter->value());
+            LogHead head(iter->value());
+            value_slice.remove_prefix(MyRaftLogStorage::LOG_HEAD_SIZE); 
+            if (append_log_entry(log_index, head.term, head.type, value_slice) != 0) {
+                return -1;
+            }
+        }
+        has_more = iter->Valid();
     }
     if (batch_request.request_lens_size() > 0) {
         requests.emplace_back(batch_request);
@@ -6909,7 +7402,7 @@ int Region::get_log_entry_for_split(const int64_t split_start_index,
             cost.get_time(), _region_id, split_start_index, split_end_index,
             ori_apply_index, _applied_index, _real_writing_cond.count());
     // ture还有数据，false没数据了
-    return iter->Valid() ? 1 : 0;
+    return has_more ? 1 : 0;
 }
 
 void Region::adjust_num_table_lines() {
@@ -7071,6 +7564,19 @@ int Region::get_split_key(std::string& split_key, int64_t& split_key_term) {
     return 0;
 } 
 
+int Region::get_load_split_key(std::string& split_key, int64_t& split_key_term) {
+    if (!_load_stat->get_load_split_key(get_start_key(), get_end_key(), split_key)) {
+        return -1;
+    }
+    // 拿到term,之后开始分裂会校验term
+    braft::NodeStatus s;
+    _node.get_status(&s);
+    split_key_term = s.term;
+    DB_WARNING("table_id:%ld, load split_key:%s, region_id: %ld", get_global_index_id(),
+            rocksdb::Slice(split_key).ToString(true).c_str(), _region_id);
+    return 0;
+}
+
 int Region::add_reverse_index(int64_t table_id, const std::set<int64_t>& index_ids) {
     if (_is_global_index || table_id != get_table_id()) {
         return 0;
@@ -7572,6 +8078,49 @@ void Region::check_peer_latency() {
     }
 }
 
+// leader定期提交带closed ts的空日志，副本apply后即包含leader在该时间前提交的所有写
+// 休眠的region不发布，其副本上的陈旧读会失败并回退到leader
+void Region::publish_closed_ts() {
+    if (_shutdown || !_init_success || !is_leader() || _hibernated.load()
+            || _is_binlog_region || get_version() == 0 || is_splitting()) {
+        return;
+    }
+    pb::StoreReq request;
+    request.set_op_type(pb::OP_NONE);
+    request.set_region_id(_region_id);
+    request.set_region_version(get_version());
+    request.set_closed_ts_us(butil::gettimeofday_us());
+    butil::IOBuf data;
+    butil::IOBufAsZeroCopyOutputStream wrapper(&data);
+    if (!request.SerializeToZeroCopyStream(&wrapper)) {
+        DB_FATAL("Fail to serialize closed ts request, region_id: %ld", _region_id);
+        return;
+    }
+    InternalDMLClosure* c = new InternalDMLClosure;
+    c->cost.reset();
+    c->op_type = pb::OP_NONE;
+    c->region = this;
+    braft::Task task;
+    task.data = &data;
+    task.done = c;
+    _real_writing_cond.increase();
+    _node.apply(task);
+}
+
+bool Region::can_stale_read(int64_t max_staleness_us) {
+    static bvar::Adder<int64_t> stale_read_count("stale_read_count");
+    static bvar::Adder<int64_t> stale_read_reject_count("stale_read_reject_count");
+    int64_t closed_ts_us = _closed_ts_us.load();
+    // 按最大时钟偏差放宽，保证不会读到比要求更旧的数据
+    if (closed_ts_us <= 0 || butil::gettimeofday_us() + FLAGS_closed_ts_max_clock_skew_us
+            - closed_ts_us > max_staleness_us) {
+        stale_read_reject_count << 1;
+        return false;
+    }
+    stale_read_count << 1;
+    return true;
+}
+
 void Region::get_read_index(const baikaldb::pb::GetAppliedIndex* request, pb::StoreRes* response) {
     if (_shutdown 
         || !_init_success
@@ -7591,6 +8140,11 @@ void Region::get_read_index(const baikaldb::pb::GetAppliedIndex* request, pb::St
         }
         response->mutable_region_raft_stat()->set_applied_index(status.last_index);
     }
+    if (is_leader()) {
+        // follower读，先唤醒再判断lease
+        _active_time_cost.reset();
+        wake_up();
+    }
     if (!is_leader() || (braft::FLAGS_raft_enable_leader_lease && !_node.is_leader_lease_valid())) {
         response->set_errcode(pb::NOT_LEADER);
         response->set_leader(butil::endpoint2str(get_leader()).c_str());
@@ -20,6 +20,7 @@
 #include "region.h"
 #include "mut_table_key.h"
 #include "my_raft_log_storage.h"
+#include "segment_log_storage.h"
 #include "closure.h"
 #include "raft_control.h"
 
@@ -118,6 +119,10 @@ int RegionControl::remove_log_entry(int64_t drop_region_id) {
     auto rocksdb = RocksWrapper::get_instance();
     // sleep会，等待异步日志刷盘
     bthread_usleep(1000 * 1000);
+    if (SegmentLogManager::get_instance()->remove_region(drop_region_id) != 0) {
+        DB_WARNING("remove segment log fail, region_id: %ld", drop_region_id);
+        return -1;
+    }
     auto status = rocksdb->remove_range(options,
                                     rocksdb->get_raft_log_handle(),
                                     start_key.data(),
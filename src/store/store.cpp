@@ -27,6 +27,7 @@
 #include "closure.h"
 #include "my_raft_log_storage.h"
 #include "log_entry_reader.h"
+#include "segment_log_storage.h"
 #include "rocksdb/cache.h"
 #include "rocksdb/db.h"
 #include "rocksdb/utilities/write_batch_with_index.h"
@@ -41,6 +42,7 @@ DECLARE_int64(store_heart_beat_interval_us);
 DECLARE_int32(balance_periodicity);
 DECLARE_string(stable_uri);
 DECLARE_string(snapshot_uri);
+DECLARE_string(segment_log_path);
 DEFINE_int64(reverse_merge_interval_us, 2 * 1000 * 1000,  "reverse_merge_interval(2 s)");
 DEFINE_int64(ttl_remove_interval_s, 24 * 3600,  "ttl_remove_interval_s(24h)");
 DEFINE_string(ttl_remove_interval_period, "",  "ttl_remove_interval_period hour(0-23)");
@@ -73,6 +75,9 @@ DEFINE_bool(use_approximate_size, true,
              "use_approximate_size");
 DEFINE_bool(use_approximate_size_to_split, false, 
              "if approximate_size > 512M, then split");
+DEFINE_bool(enable_load_split, false, "split hot region at sampled key by qps");
+DEFINE_int64(load_split_qps, 10000, "region read + write qps to trigger load split");
+DEFINE_int64(load_split_min_lines, 10000, "min region lines for load split");
 DEFINE_int64(gen_tso_interval_us, 500 * 1000LL, "gen_tso_interval_us, default(500ms)");
 DEFINE_int64(gen_tso_count, 100, "gen_tso_count, default(500)");
 DEFINE_int64(rocks_cf_flush_remove_range_times, 10, "rocks_cf_flush_remove_range_times, default(10)");
@@ -82,6 +87,8 @@ DEFINE_string(container_id, "", "container_id for zoombie instance");
 DEFINE_int32(rocksdb_perf_level, rocksdb::kDisable, "rocksdb_perf_level");
 DEFINE_bool(stop_ttl_data, false, "stop ttl data");
 DEFINE_int64(check_peer_delay_min, 1, "check peer delay min");
+DEFINE_int64(plan_fragment_cache_size, 1000, "max num of decoded plan fragments cached");
+DEFINE_int64(closed_ts_interval_ms, 0, "leader publish closed ts for stale read every N ms, 0 means disable");
 DECLARE_bool(store_rocks_hang_check);
 DECLARE_int32(store_rocks_hang_check_timeout_s);
 DECLARE_int32(store_rocks_hang_cnt_limit);
@@ -105,6 +112,7 @@ int Store::init_before_listen(std::vector<std::int64_t>& init_region_ids) {
         DB_FATAL("tso server interact init fail");
         return -1;
     }
+    _plan_fragment_cache.init(FLAGS_plan_fragment_cache_size);
 
     int ret = get_physical_room(_address, _physical_room);
     if (ret < 0) {
@@ -151,6 +159,12 @@ int Store::init_before_listen(std::vector<std::int64_t>& init_region_ids) {
     
     LogEntryReader* reader = LogEntryReader::get_instance();
     reader->init(_rocksdb, _rocksdb->get_raft_log_handle());
+    if (SegmentLogManager::is_segment_log_uri(FLAGS_raftlog_uri)) {
+        if (SegmentLogManager::get_instance()->init(FLAGS_segment_log_path) != 0) {
+            DB_FATAL("segment log init fail, path:%s", FLAGS_segment_log_path.c_str());
+            return -1;
+        }
+    }
 
     pb::StoreHeartBeatRequest request;
     pb::StoreHeartBeatResponse response;
@@ -282,6 +296,7 @@ int Store::init_after_listen(const std::vector<int64_t>& init_region_ids) {
     _binlog_timeout_check_bth.run([this]() {binlog_timeout_check_thread();});
     _binlog_fake_bth.run([this]() {binlog_fake_thread();});
     _region_peer_delay_bth.run([this]() {check_region_peer_delay();});
+    _closed_ts_bth.run([this]() {closed_ts_thread();});
     _has_prepared_tran = true;
     prepared_txns.clear();
     doing_snapshot_regions.clear();
@@ -533,6 +548,44 @@ void Store::async_apply_log_entry(google::protobuf::RpcController* controller,
     region->async_apply_log_entry(controller, request, response, done_guard.release());
 }
 
+static void run_and_delete_request(google::protobuf::Closure* done, pb::StoreReq* request) {
+    done->Run();
+    delete request;
+}
+
+int Store::merge_plan_fragment(brpc::Controller* cntl, const pb::StoreReq& request, pb::StoreReq* merged) {
+    std::shared_ptr<pb::StoreReq> fragment;
+    // 同一查询发往本store多个region的请求共享一份解析结果
+    if (_plan_fragment_cache.find(request.plan_fragment_sign(), &fragment) != 0) {
+        fragment.reset(new pb::StoreReq);
+        butil::IOBufAsZeroCopyInputStream wrapper(cntl->request_attachment());
+        if (!fragment->ParsePartialFromZeroCopyStream(&wrapper)) {
+            return -1;
+        }
+        _plan_fragment_cache.add(request.plan_fragment_sign(), fragment);
+    }
+    merged->CopyFrom(*fragment);
+    merged->MergeFrom(request);
+    merged->clear_plan_fragment_sign();
+    if (request.region_indexes_size() > 0 || request.has_region_learner_index()) {
+        for (auto& pb_node : *merged->mutable_plan()->mutable_nodes()) {
+            if (pb_node.node_type() != pb::SCAN_NODE) {
+                continue;
+            }
+            auto scan_pb = pb_node.mutable_derive_node()->mutable_scan_node();
+            scan_pb->mutable_indexes()->CopyFrom(request.region_indexes());
+            if (request.region_learner_index().empty()) {
+                scan_pb->clear_learner_index();
+            } else {
+                scan_pb->set_learner_index(request.region_learner_index());
+            }
+        }
+        merged->clear_region_indexes();
+        merged->clear_region_learner_index();
+    }
+    return 0;
+}
+
 void Store::query(google::protobuf::RpcController* controller,
                   const pb::StoreReq* request,
                   pb::StoreRes* response,
@@ -568,6 +621,20 @@ void Store::query(google::protobuf::RpcController* controller,
                 request->region_id(), log_id, remote_side);
         return;
     }
+    if (request->plan_fragment_sign() != 0) {
+        pb::StoreReq* merged_request = new pb::StoreReq;
+        if (merge_plan_fragment(cntl, *request, merged_request) != 0) {
+            delete merged_request;
+            response->set_errcode(pb::INPUT_PARAM_ERROR);
+            response->set_errmsg("parse plan fragment fail");
+            DB_WARNING("region_id: %ld parse plan fragment fail, logid:%lu, remote_side: %s",
+                    request->region_id(), log_id, remote_side);
+            return;
+        }
+        request = merged_request;
+        // 请求处理完成后释放合并出的request
+        done_guard.reset(google::protobuf::NewCallback(run_and_delete_request, done_guard.release(), merged_request));
+    }
     region->query(controller,
                   request,
                   response,
@@ -717,6 +784,7 @@ void Store::get_applied_index(google::protobuf::RpcController* controller,
     }
     response->set_region_status(region->region_status());
     response->set_applied_index(region->get_log_index());
+    response->set_data_index(region->get_data_index());
     response->mutable_region_raft_stat()->set_applied_index(region->get_log_index());
     response->mutable_region_raft_stat()->set_snapshot_data_size(region->snapshot_data_size());
     response->mutable_region_raft_stat()->set_snapshot_meta_size(region->snapshot_meta_size());
@@ -1238,60 +1306,25 @@ int64_t Store::get_tso() {
         return (tso_physical << tso::logical_bits) + tso_logical + FLAGS_gen_tso_count - (tso_count--);
     }
 
-    pb::TsoRequest request;
-    pb::TsoResponse response;
-    request.set_op_type(pb::OP_GEN_TSO);
-    request.set_count(FLAGS_gen_tso_count);
-
-    //发送请求，收到响应
-    if (_tso_server_interact.send_request("tso_service", request, response) == 0) {
-        //处理响应
-        if (response.errcode() != pb::SUCCESS) {
-            DB_FATAL("store get tso fail request:%s, response:%s", 
-                       request.ShortDebugString().c_str(), 
-                       response.ShortDebugString().c_str());            
-            return -1;
-        }
-        DB_WARNING("store get tso request:%s, response:%s", 
-                   request.ShortDebugString().c_str(), response.ShortDebugString().c_str());
-    } else {
-        DB_WARNING("store get tso request:%s, response:%s", 
-                   request.ShortDebugString().c_str(), response.ShortDebugString().c_str());
+    int64_t timestamp = _tso_client.get_tso(FLAGS_gen_tso_count);
+    if (timestamp < 0) {
+        DB_FATAL("store get tso fail, count:%ld", FLAGS_gen_tso_count);
         return -1;
     }
-
     gen_tso_time.reset();
     tso_count = FLAGS_gen_tso_count;
-    tso_physical = response.start_timestamp().physical();
-    tso_logical  = response.start_timestamp().logical();
+    tso_physical = timestamp >> tso::logical_bits;
+    tso_logical  = timestamp & (tso::max_logical - 1);
     return (tso_physical << tso::logical_bits) + tso_logical + FLAGS_gen_tso_count - (tso_count--);
 }
 
 int64_t Store::get_last_commit_ts() {
-    pb::TsoRequest request;
-    pb::TsoResponse response;
-    request.set_op_type(pb::OP_GEN_TSO);
-    request.set_count(1);
-
-    //发送请求，收到响应
-    if (_tso_server_interact.send_request("tso_service", request, response) == 0) {
-        //处理响应
-        if (response.errcode() != pb::SUCCESS) {
-            DB_FATAL("store get tso fail request:%s, response:%s", 
-                       request.ShortDebugString().c_str(), 
-                       response.ShortDebugString().c_str());            
-            return -1;
-        }
-        DB_WARNING("store get tso request:%s, response:%s", 
-                   request.ShortDebugString().c_str(), response.ShortDebugString().c_str());
-    } else {
-        DB_WARNING("store get tso request:%s, response:%s", 
-                   request.ShortDebugString().c_str(), response.ShortDebugString().c_str());
+    int64_t timestamp = _tso_client.get_tso(1);
+    if (timestamp < 0) {
+        DB_FATAL("store get last commit ts fail");
         return -1;
     }
     gen_tso_time.reset();
-    auto&  tso = response.start_timestamp();
-    int64_t timestamp = (tso.physical() << tso::logical_bits) + tso.logical();
     return timestamp;
 }
 
@@ -1449,6 +1482,22 @@ void Store::check_region_peer_delay() {
     }
 }
 
+// 每个leader region每个周期提交一条空日志，开启前需评估日志量
+void Store::closed_ts_thread() {
+    while (!_shutdown) {
+        if (FLAGS_closed_ts_interval_ms <= 0) {
+            bthread_usleep_fast_shutdown(1000 * 1000LL, _shutdown);
+            continue;
+        }
+        traverse_region_map([](const SmartRegion& region) {
+            if (region->is_leader()) {
+                region->publish_closed_ts();
+            }
+        });
+        bthread_usleep_fast_shutdown(FLAGS_closed_ts_interval_ms * 1000LL, _shutdown);
+    }
+}
+
 void Store::whether_split_thread() {
     static int64_t count = 0;
     (void)count;
@@ -1468,6 +1517,8 @@ void Store::whether_split_thread() {
             if (ptr_region == NULL) {
                 continue;
             }
+            //空闲region休眠
+            ptr_region->check_hibernate();
             if (ptr_region->is_binlog_region() || ptr_region->is_learner()) {
                 continue;
             }
@@ -1533,6 +1584,17 @@ void Store::whether_split_thread() {
                         process_split_request(ptr_region->get_global_index_id(), region_ids[i], false, split_key, split_key_term);
                         continue;
                     }
+                } else if (FLAGS_enable_load_split
+                    // 尾部顺序写入的热点分裂也无法打散，只对非尾部region按负载分裂
+                    && !ptr_region->is_tail()
+                    && ptr_region->get_num_table_lines() >= FLAGS_load_split_min_lines
+                    && ptr_region->get_load_qps() >= FLAGS_load_split_qps) {
+                    if (0 == ptr_region->get_load_split_key(split_key, split_key_term)) {
+                        DB_WARNING("start split by load qps:%ld region_id: %ld num_table_lines:%ld",
+                                ptr_region->get_load_qps(), region_ids[i], ptr_region->get_num_table_lines());
+                        process_split_request(ptr_region->get_global_index_id(), region_ids[i], false, split_key, split_key_term);
+                        continue;
+                    }
                 }
             }
             
@@ -1827,6 +1889,11 @@ void Store::construct_heart_beat_request(pb::StoreHeartBeatRequest& request) {
     traverse_copy_region_map([&request, need_peer_balance](const SmartRegion& region) {
         region->construct_heart_beat_request(request, need_peer_balance);
     });
+    int64_t leader_load = 0;
+    for (auto& leader_region : request.leader_regions()) {
+        leader_load += RegionLoadStat::load_score(leader_region.load());
+    }
+    instance_info->set_leader_load(leader_load);
 
 }
 
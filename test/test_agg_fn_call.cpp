@@ -0,0 +1,402 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "agg_fn_call.h"
+#include "arrow_column_batch.h"
+#include "mem_row_descriptor.h"
+#include "mem_row.h"
+#include "row_batch.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+
+// tuple 0为扫描出的行，tuple 1为聚合结果
+static const int32_t ROW_TUPLE = 0;
+static const int32_t AGG_TUPLE = 1;
+static const int32_t SLOT_INT32 = 1;
+static const int32_t SLOT_UINT64 = 2;
+static const int32_t SLOT_DOUBLE = 3;
+
+struct AggDef {
+    const char* name;
+    int32_t slot_id;    // count_star为0
+    pb::PrimitiveType slot_type;
+};
+
+static const std::vector<AggDef> agg_defs = {
+    {"count_star", 0, pb::INVALID_TYPE},
+    {"count", SLOT_INT32, pb::INT32},
+    {"sum", SLOT_INT32, pb::INT32},
+    {"min", SLOT_INT32, pb::INT32},
+    {"max", SLOT_INT32, pb::INT32},
+    {"count", SLOT_UINT64, pb::UINT64},
+    {"sum", SLOT_UINT64, pb::UINT64},
+    {"min", SLOT_UINT64, pb::UINT64},
+    {"max", SLOT_UINT64, pb::UINT64},
+    {"sum", SLOT_DOUBLE, pb::DOUBLE},
+    {"min", SLOT_DOUBLE, pb::DOUBLE},
+    {"max", SLOT_DOUBLE, pb::DOUBLE},
+};
+
+class AggContext {
+public:
+    ~AggContext() {
+        for (auto agg : aggs) {
+            agg->close();
+            delete agg;
+        }
+    }
+    int init(const std::vector<AggDef>& defs) {
+        pb::TupleDescriptor row_tuple;
+        row_tuple.set_tuple_id(ROW_TUPLE);
+        for (auto type : {pb::INT32, pb::UINT64, pb::DOUBLE}) {
+            pb::SlotDescriptor* slot = row_tuple.add_slots();
+            slot->set_slot_id(row_tuple.slots_size());
+            slot->set_slot_type(type);
+            slot->set_tuple_id(ROW_TUPLE);
+        }
+        pb::TupleDescriptor agg_tuple;
+        agg_tuple.set_tuple_id(AGG_TUPLE);
+        for (auto& def : defs) {
+            int32_t agg_slot_id = agg_tuple.slots_size() + 1;
+            int32_t intermediate_slot_id = agg_slot_id;
+            // avg的中间结果(sum, count)单独一个slot
+            if (strcmp(def.name, "avg") == 0) {
+                intermediate_slot_id = agg_slot_id + 1;
+            }
+            pb::Expr expr;
+            pb::ExprNode* node = expr.add_nodes();
+            node->set_node_type(pb::AGG_EXPR);
+            node->set_col_type(pb::INVALID_TYPE);
+            node->set_num_children(def.slot_id > 0 ? 1 : 0);
+            node->mutable_fn()->set_name(def.name);
+            node->mutable_fn()->set_fn_op(0);
+            node->mutable_derive_node()->set_tuple_id(AGG_TUPLE);
+            node->mutable_derive_node()->set_slot_id(agg_slot_id);
+            node->mutable_derive_node()->set_intermediate_slot_id(intermediate_slot_id);
+            if (def.slot_id > 0) {
+                pb::ExprNode* slot_ref = expr.add_nodes();
+                slot_ref->set_node_type(pb::SLOT_REF);
+                slot_ref->set_col_type(def.slot_type);
+                slot_ref->set_num_children(0);
+                slot_ref->mutable_derive_node()->set_tuple_id(ROW_TUPLE);
+                slot_ref->mutable_derive_node()->set_slot_id(def.slot_id);
+            }
+            ExprNode* agg = nullptr;
+            if (ExprNode::create_tree(expr, &agg) != 0) {
+                return -1;
+            }
+            aggs.push_back(static_cast<AggFnCall*>(agg));
+            pb::SlotDescriptor* slot = agg_tuple.add_slots();
+            slot->set_slot_id(agg_slot_id);
+            slot->set_tuple_id(AGG_TUPLE);
+            if (intermediate_slot_id != agg_slot_id) {
+                pb::SlotDescriptor* intermediate_slot = agg_tuple.add_slots();
+                intermediate_slot->set_slot_id(intermediate_slot_id);
+                intermediate_slot->set_tuple_id(AGG_TUPLE);
+                intermediate_slot->set_slot_type(pb::STRING);
+            }
+            slot_ids.push_back(agg_slot_id);
+            // 与planner一致，slot类型由type_inferer填充
+            if (aggs.back()->type_inferer(&agg_tuple) != 0 || aggs.back()->open() != 0) {
+                return -1;
+            }
+        }
+        std::vector<pb::TupleDescriptor> tuples = {row_tuple, agg_tuple};
+        if (desc.init(tuples) != 0) {
+            return -1;
+        }
+        for (auto agg : aggs) {
+            if (agg->agg_type() == AggFnCall::COUNT_STAR) {
+                column_idx.push_back(-1);
+                continue;
+            }
+            ExprNode* slot_ref = agg->children(0);
+            column_idx.push_back(column_batch.add_column(
+                    slot_ref->tuple_id(), slot_ref->slot_id(), slot_ref->col_type()));
+        }
+        return 0;
+    }
+
+    std::unique_ptr<MemRow> new_agg_row() {
+        std::unique_ptr<MemRow> row = desc.fetch_mem_row();
+        int64_t used_size = 0;
+        AggFnCall::initialize_all(aggs, "", row.get(), used_size, false);
+        return row;
+    }
+
+    void update_by_row(RowBatch& batch, MemRow* dst) {
+        int64_t used_size = 0;
+        for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+            AggFnCall::update_all(aggs, "", batch.get_row().get(), dst, used_size);
+        }
+    }
+
+    int update_by_column(RowBatch& batch, MemRow* dst) {
+        if (column_batch.build(batch) != 0) {
+            return -1;
+        }
+        for (size_t i = 0; i < aggs.size(); i++) {
+            const arrow::Array* column = nullptr;
+            if (column_idx[i] >= 0) {
+                column = column_batch.column(column_idx[i]);
+            }
+            if (aggs[i]->update_by_column(column, column_batch.num_rows(), dst) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    MemRowDescriptor desc;
+    std::vector<AggFnCall*> aggs;
+    std::vector<int32_t> slot_ids;  // 各聚合的结果slot
+    ArrowColumnBatch column_batch;
+    std::vector<int> column_idx;
+};
+
+static ExprValue int32_value(int32_t val) {
+    ExprValue value(pb::INT32);
+    value._u.int32_val = val;
+    return value;
+}
+static ExprValue uint64_value(uint64_t val) {
+    ExprValue value(pb::UINT64);
+    value._u.uint64_val = val;
+    return value;
+}
+static ExprValue double_value(double val) {
+    ExprValue value(pb::DOUBLE);
+    value._u.double_val = val;
+    return value;
+}
+
+// null_step > 0时行号为null_step倍数的行整行为NULL，null_step == 1即全NULL
+static void fill_batch(AggContext& ctx, RowBatch& batch, int num_rows, int64_t base, int null_step) {
+    for (int i = 0; i < num_rows; i++) {
+        std::unique_ptr<MemRow> row = ctx.desc.fetch_mem_row();
+        if (null_step <= 0 || i % null_step != 0) {
+            int64_t val = base + i * 7 % 13;
+            // 一批的和超出int32范围
+            row->set_value(ROW_TUPLE, SLOT_INT32, int32_value(2000000000 - val));
+            // 超出int64范围的无符号值
+            row->set_value(ROW_TUPLE, SLOT_UINT64, uint64_value((1ULL << 63) + val));
+            row->set_value(ROW_TUPLE, SLOT_DOUBLE, double_value(val * 0.5 - 3));
+        }
+        batch.move_row(std::move(row));
+    }
+}
+
+static void expect_same_result(AggContext& ctx, MemRow* by_row, MemRow* by_column) {
+    for (size_t i = 0; i < ctx.aggs.size(); i++) {
+        ExprValue row_value = by_row->get_value(AGG_TUPLE, ctx.slot_ids[i]);
+        ExprValue column_value = by_column->get_value(AGG_TUPLE, ctx.slot_ids[i]);
+        EXPECT_EQ(row_value.type, column_value.type) << "agg: " << i;
+        EXPECT_EQ(row_value.get_string(), column_value.get_string()) << "agg: " << i;
+    }
+}
+
+TEST(test_agg_fn_call, update_by_column) {
+    AggContext ctx;
+    ASSERT_EQ(0, ctx.init(agg_defs));
+    std::unique_ptr<MemRow> by_row = ctx.new_agg_row();
+    std::unique_ptr<MemRow> by_column = ctx.new_agg_row();
+
+    // 全NULL的批次：count为0，sum/min/max仍为NULL
+    RowBatch null_batch;
+    fill_batch(ctx, null_batch, 10, 0, 1);
+    ctx.update_by_row(null_batch, by_row.get());
+    ASSERT_EQ(0, ctx.update_by_column(null_batch, by_column.get()));
+    expect_same_result(ctx, by_row.get(), by_column.get());
+    EXPECT_EQ(10, by_column->get_value(AGG_TUPLE, 1).get_numberic<int64_t>());
+    EXPECT_EQ(0, by_column->get_value(AGG_TUPLE, 2).get_numberic<int64_t>());
+    EXPECT_TRUE(by_column->get_value(AGG_TUPLE, 3).is_null());
+    EXPECT_TRUE(by_column->get_value(AGG_TUPLE, 4).is_null());
+
+    // 带NULL的批次
+    RowBatch batch1;
+    fill_batch(ctx, batch1, 100, 100, 7);
+    ctx.update_by_row(batch1, by_row.get());
+    ASSERT_EQ(0, ctx.update_by_column(batch1, by_column.get()));
+    expect_same_result(ctx, by_row.get(), by_column.get());
+    // sum结果类型与逐行一致，且不在int32上截断
+    ExprValue sum = by_column->get_value(AGG_TUPLE, 3);
+    EXPECT_EQ(pb::INT64, sum.type);
+    EXPECT_GT(sum.get_numberic<int64_t>(), (int64_t)INT32_MAX);
+    // uint64列按无符号比较
+    ExprValue min_uint = by_column->get_value(AGG_TUPLE, 8);
+    EXPECT_EQ(pb::UINT64, min_uint.type);
+    EXPECT_EQ((1ULL << 63) + 100, min_uint.get_numberic<uint64_t>());
+
+    // 已有中间结果：批次的值低于、高于、落在已有最值范围内
+    for (int64_t base : {90, 110, 100}) {
+        RowBatch batch;
+        fill_batch(ctx, batch, 5, base, 0);
+        ctx.update_by_row(batch, by_row.get());
+        ASSERT_EQ(0, ctx.update_by_column(batch, by_column.get()));
+        expect_same_result(ctx, by_row.get(), by_column.get());
+    }
+
+    // 全NULL批次不改变已有中间结果
+    ctx.update_by_row(null_batch, by_row.get());
+    ASSERT_EQ(0, ctx.update_by_column(null_batch, by_column.get()));
+    expect_same_result(ctx, by_row.get(), by_column.get());
+}
+
+typedef std::map<std::string, std::unique_ptr<MemRow>> GroupRows;
+
+static std::string group_key(MemRow* row) {
+    ExprValue value = row->get_value(ROW_TUPLE, SLOT_INT32);
+    return value.is_null() ? "NULL" : value.get_string();
+}
+
+// 同AggNode::process_row_batch，store上按group预聚合后finalize输出
+static void partial_agg(AggContext& ctx, RowBatch& batch, std::vector<std::unique_ptr<MemRow>>& output) {
+    GroupRows groups;
+    int64_t used_size = 0;
+    for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+        std::unique_ptr<MemRow>& row = batch.get_row();
+        std::string key = group_key(row.get());
+        std::unique_ptr<MemRow>& agg_row = groups[key];
+        MemRow* cur_row = row.get();
+        if (agg_row == nullptr) {
+            agg_row = std::move(row);
+            AggFnCall::initialize_all(ctx.aggs, key, agg_row.get(), used_size, false);
+        }
+        AggFnCall::update_all(ctx.aggs, key, cur_row, agg_row.get(), used_size);
+    }
+    for (auto& pair : groups) {
+        AggFnCall::finalize_all(ctx.aggs, pair.first, pair.second.get());
+        output.push_back(std::move(pair.second));
+    }
+}
+
+// 同AggNode::get_next_bypass，每行单独作为一个预聚合结果输出
+static void bypass_agg(AggContext& ctx, RowBatch& batch, std::vector<std::unique_ptr<MemRow>>& output) {
+    static const std::string empty_key;
+    int64_t used_size = 0;
+    for (batch.reset(); !batch.is_traverse_over(); batch.next()) {
+        std::unique_ptr<MemRow>& row = batch.get_row();
+        AggFnCall::initialize_all(ctx.aggs, empty_key, row.get(), used_size, false);
+        AggFnCall::update_all(ctx.aggs, empty_key, row.get(), row.get(), used_size);
+        AggFnCall::finalize_all(ctx.aggs, empty_key, row.get());
+        output.push_back(std::move(row));
+    }
+}
+
+// 同merger上的AggNode，按group合并各store的预聚合结果
+static void merge_agg(AggContext& ctx, std::vector<std::unique_ptr<MemRow>>& input, GroupRows& groups) {
+    int64_t used_size = 0;
+    for (auto& row : input) {
+        std::string key = group_key(row.get());
+        std::unique_ptr<MemRow>& agg_row = groups[key];
+        MemRow* cur_row = row.get();
+        if (agg_row == nullptr) {
+            agg_row = std::move(row);
+            AggFnCall::initialize_all(ctx.aggs, key, agg_row.get(), used_size, false);
+        }
+        AggFnCall::merge_all(ctx.aggs, key, cur_row, agg_row.get(), used_size);
+    }
+    for (auto& pair : groups) {
+        AggFnCall::finalize_all(ctx.aggs, pair.first, pair.second.get());
+    }
+}
+
+TEST(test_agg_fn_call, bypass_merge) {
+    const std::vector<AggDef> defs = {
+        {"count_star", 0, pb::INVALID_TYPE},
+        {"count", SLOT_DOUBLE, pb::DOUBLE},
+        {"sum", SLOT_INT32, pb::INT32},
+        {"avg", SLOT_DOUBLE, pb::DOUBLE},
+        {"min", SLOT_DOUBLE, pb::DOUBLE},
+        {"max", SLOT_UINT64, pb::UINT64},
+    };
+    AggContext ctx;
+    ASSERT_EQ(0, ctx.init(defs));
+    // 两个store，第二个store预聚合一批后切换为透传
+    struct StoreBatch {
+        int num_rows;
+        int64_t base;
+        int null_step;
+        bool bypass;
+    };
+    const std::vector<StoreBatch> batches = {
+        {200, 0, 5, false},     // store1
+        {100, 3, 0, false},     // store2
+        {300, 6, 11, true},     // store2
+    };
+    std::vector<std::unique_ptr<MemRow>> normal_rows;
+    std::vector<std::unique_ptr<MemRow>> bypass_rows;
+    for (auto& store_batch : batches) {
+        RowBatch normal_batch;
+        fill_batch(ctx, normal_batch, store_batch.num_rows, store_batch.base, store_batch.null_step);
+        partial_agg(ctx, normal_batch, normal_rows);
+        RowBatch bypass_batch;
+        fill_batch(ctx, bypass_batch, store_batch.num_rows, store_batch.base, store_batch.null_step);
+        if (store_batch.bypass) {
+            bypass_agg(ctx, bypass_batch, bypass_rows);
+        } else {
+            partial_agg(ctx, bypass_batch, bypass_rows);
+        }
+    }
+    EXPECT_LT(normal_rows.size(), bypass_rows.size());
+
+    GroupRows normal_result;
+    GroupRows bypass_result;
+    merge_agg(ctx, normal_rows, normal_result);
+    merge_agg(ctx, bypass_rows, bypass_result);
+    // 19个分组加上全NULL的分组
+    ASSERT_EQ(20u, normal_result.size());
+    ASSERT_EQ(normal_result.size(), bypass_result.size());
+    for (auto& pair : normal_result) {
+        auto iter = bypass_result.find(pair.first);
+        ASSERT_TRUE(iter != bypass_result.end()) << "group: " << pair.first;
+        expect_same_result(ctx, pair.second.get(), iter->second.get());
+    }
+    // 全NULL分组：count(*)计入，其余为0或NULL
+    MemRow* null_group = bypass_result["NULL"].get();
+    EXPECT_EQ(40 + 28, null_group->get_value(AGG_TUPLE, ctx.slot_ids[0]).get_numberic<int64_t>());
+    EXPECT_EQ(0, null_group->get_value(AGG_TUPLE, ctx.slot_ids[1]).get_numberic<int64_t>());
+    for (size_t i = 2; i < ctx.slot_ids.size(); i++) {
+        EXPECT_TRUE(null_group->get_value(AGG_TUPLE, ctx.slot_ids[i]).is_null()) << "agg: " << i;
+    }
+    // 同一分组内各列的值相同：sum = count * 分组值，avg = min
+    for (auto& pair : bypass_result) {
+        if (pair.first == "NULL") {
+            continue;
+        }
+        MemRow* row = pair.second.get();
+        int64_t count = row->get_value(AGG_TUPLE, ctx.slot_ids[1]).get_numberic<int64_t>();
+        int64_t sum = row->get_value(AGG_TUPLE, ctx.slot_ids[2]).get_numberic<int64_t>();
+        EXPECT_GT(count, 0);
+        EXPECT_EQ(count * row->get_value(ROW_TUPLE, SLOT_INT32).get_numberic<int64_t>(), sum);
+        ExprValue avg = row->get_value(AGG_TUPLE, ctx.slot_ids[3]);
+        EXPECT_EQ(pb::DOUBLE, avg.type);
+        EXPECT_EQ(row->get_value(AGG_TUPLE, ctx.slot_ids[4]).get_numberic<double>(),
+                avg.get_numberic<double>());
+    }
+}
+
+} // namespace baikaldb
@@ -0,0 +1,147 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "group_insert.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int32(group_insert_max_statements);
+
+struct JoinResult {
+    GroupInsert::Request request;
+    std::vector<GroupInsert::Request*> group;
+    int ret = 0;
+};
+
+// 模拟多个语句同时写同一region，leader用result通知follower
+static void run_group(int64_t region_id, std::vector<JoinResult>& results,
+        GroupInsert::Result result, MysqlErrCode error_code, const std::string& error_msg) {
+    std::atomic<int> leader_count = {0};
+    ConcurrencyBthread join_bth(results.size());
+    for (auto& join_result : results) {
+        JoinResult* r = &join_result;
+        join_bth.run([r, region_id, result, error_code, error_msg, &leader_count]() {
+            r->ret = GroupInsert::get_instance()->join(region_id, &r->request, r->group);
+            if (r->ret == 0 && !r->group.empty()) {
+                leader_count++;
+                GroupInsert::get_instance()->finish(r->group, &r->request, result,
+                        error_code, error_msg);
+            }
+        });
+    }
+    join_bth.join();
+    EXPECT_EQ(1, leader_count.load());
+}
+
+TEST(test_group_insert, join_finish) {
+    FLAGS_group_insert_window_us = 200 * 1000;
+    std::vector<JoinResult> results(8);
+    run_group(1, results, GroupInsert::DONE, ER_ERROR_FIRST, "");
+    int leader_idx = -1;
+    for (size_t i = 0; i < results.size(); i++) {
+        EXPECT_EQ(0, results[i].ret);
+        if (!results[i].group.empty()) {
+            leader_idx = i;
+        }
+    }
+    ASSERT_GE(leader_idx, 0);
+    // leader取回本组全部请求，包括自身
+    auto& group = results[leader_idx].group;
+    EXPECT_EQ(results.size(), group.size());
+    for (auto& join_result : results) {
+        EXPECT_EQ(1, std::count(group.begin(), group.end(), &join_result.request));
+    }
+    // leader自身不被通知，follower都收到DONE
+    for (size_t i = 0; i < results.size(); i++) {
+        if ((int)i == leader_idx) {
+            EXPECT_EQ(GroupInsert::NONE, results[i].request.result);
+        } else {
+            EXPECT_EQ(GroupInsert::DONE, results[i].request.result);
+        }
+    }
+
+    // 上一组结束后，同region的新请求成为新的leader
+    std::vector<JoinResult> single(1);
+    run_group(1, single, GroupInsert::DONE, ER_ERROR_FIRST, "");
+    ASSERT_EQ(1u, single[0].group.size());
+    EXPECT_EQ(&single[0].request, single[0].group[0]);
+}
+
+TEST(test_group_insert, leader_failed) {
+    FLAGS_group_insert_window_us = 200 * 1000;
+    // 合并请求超时等可能已写入的失败，follower直接拿到leader的错误
+    std::vector<JoinResult> results(4);
+    run_group(2, results, GroupInsert::FAILED, ER_LOCK_WAIT_TIMEOUT, "timeout");
+    for (auto& join_result : results) {
+        if (join_result.group.empty()) {
+            EXPECT_EQ(GroupInsert::FAILED, join_result.request.result);
+            EXPECT_EQ(ER_LOCK_WAIT_TIMEOUT, join_result.request.error_code);
+            EXPECT_EQ("timeout", join_result.request.error_msg);
+        }
+    }
+    // 主键冲突时各自重试
+    std::vector<JoinResult> dup_results(4);
+    run_group(2, dup_results, GroupInsert::FALLBACK, ER_ERROR_FIRST, "");
+    for (auto& join_result : dup_results) {
+        if (join_result.group.empty()) {
+            EXPECT_EQ(GroupInsert::FALLBACK, join_result.request.result);
+        }
+    }
+}
+
+TEST(test_group_insert, max_statements) {
+    FLAGS_group_insert_window_us = 200 * 1000;
+    int32_t old_max_statements = FLAGS_group_insert_max_statements;
+    FLAGS_group_insert_max_statements = 3;
+    std::vector<JoinResult> results(6);
+    std::atomic<int> leader_count = {0};
+    std::atomic<int> alone_count = {0};
+    ConcurrencyBthread join_bth(results.size());
+    for (auto& join_result : results) {
+        JoinResult* r = &join_result;
+        join_bth.run([r, &leader_count, &alone_count]() {
+            r->ret = GroupInsert::get_instance()->join(3, &r->request, r->group);
+            if (r->ret < 0) {
+                alone_count++;
+            } else if (!r->group.empty()) {
+                leader_count++;
+                GroupInsert::get_instance()->finish(r->group, &r->request, GroupInsert::DONE);
+            }
+        });
+    }
+    join_bth.join();
+    // 等待数达到上限后的请求单独执行
+    EXPECT_EQ(1, leader_count.load());
+    EXPECT_EQ(3, alone_count.load());
+    FLAGS_group_insert_max_statements = old_max_statements;
+}
+
+TEST(test_group_insert, fail_result) {
+    // store明确返回主键冲突时合并请求未写入，可以单独重试
+    EXPECT_EQ(GroupInsert::FALLBACK, GroupInsert::fail_result(ER_DUP_ENTRY));
+    // 超时、切主、网络错误等，合并请求可能已写入
+    EXPECT_EQ(GroupInsert::FAILED, GroupInsert::fail_result(ER_ERROR_FIRST));
+    EXPECT_EQ(GroupInsert::FAILED, GroupInsert::fail_result(ER_EXEC_PLAN_FAILED));
+    EXPECT_EQ(GroupInsert::FAILED, GroupInsert::fail_result(ER_LOCK_WAIT_TIMEOUT));
+}
+
+} // namespace baikaldb
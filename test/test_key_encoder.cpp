@@ -18,6 +18,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <cstring>
+#include <vector>
 #include "key_encoder.h"
 
 int main(int argc, char* argv[])
@@ -150,4 +152,49 @@ TEST(test_encode_decode, case_f64) {
         EXPECT_EQ(val1, KeyEncoder::decode_f64(KeyEncoder::encode_f64(val1)));
     }
 }
+TEST(test_encode_decode, case_batch) {
+    // 覆盖simd整块和尾部逐个处理
+    std::vector<int64_t> i64 = {0, -1, 1, INT64_MIN, INT64_MAX, 123456789, -987654321};
+    std::vector<char> buf(i64.size() * sizeof(int64_t));
+    KeyEncoder::encode_i64_batch(i64.data(), i64.size(), buf.data());
+    for (size_t i = 0; i < i64.size(); ++i) {
+        uint64_t encode = KeyEncoder::to_endian_u64(KeyEncoder::encode_i64(i64[i]));
+        EXPECT_EQ(0, memcmp(&encode, buf.data() + i * sizeof(int64_t), sizeof(int64_t)));
+    }
+    std::vector<int64_t> i64_out(i64.size());
+    KeyEncoder::decode_i64_batch(buf.data(), i64.size(), i64_out.data());
+    EXPECT_EQ(i64, i64_out);
+
+    std::vector<uint64_t> u64 = {0, 1, UINT64_MAX, 0x1234567890123456UL, 42};
+    buf.resize(u64.size() * sizeof(uint64_t));
+    KeyEncoder::encode_u64_batch(u64.data(), u64.size(), buf.data());
+    for (size_t i = 0; i < u64.size(); ++i) {
+        uint64_t encode = KeyEncoder::to_endian_u64(u64[i]);
+        EXPECT_EQ(0, memcmp(&encode, buf.data() + i * sizeof(uint64_t), sizeof(uint64_t)));
+    }
+    std::vector<uint64_t> u64_out(u64.size());
+    KeyEncoder::decode_u64_batch(buf.data(), u64.size(), u64_out.data());
+    EXPECT_EQ(u64, u64_out);
+
+    std::vector<int32_t> i32 = {0, -1, 1, INT_MIN, INT_MAX, 5, -7, 9, 11};
+    buf.resize(i32.size() * sizeof(int32_t));
+    KeyEncoder::encode_i32_batch(i32.data(), i32.size(), buf.data());
+    for (size_t i = 0; i < i32.size(); ++i) {
+        uint32_t encode = KeyEncoder::to_endian_u32(KeyEncoder::encode_i32(i32[i]));
+        EXPECT_EQ(0, memcmp(&encode, buf.data() + i * sizeof(int32_t), sizeof(int32_t)));
+    }
+    std::vector<int32_t> i32_out(i32.size());
+    KeyEncoder::decode_i32_batch(buf.data(), i32.size(), i32_out.data());
+    EXPECT_EQ(i32, i32_out);
+
+    std::vector<uint32_t> u32 = {0, 1, UINT_MAX, 0x12345678, 7, 8};
+    buf.resize(u32.size() * sizeof(uint32_t));
+    KeyEncoder::encode_u32_batch(u32.data(), u32.size(), buf.data());
+    std::vector<uint32_t> u32_out(u32.size());
+    KeyEncoder::decode_u32_batch(buf.data(), u32.size(), u32_out.data());
+    EXPECT_EQ(u32, u32_out);
+    // 编码后字节序与数值序一致
+    EXPECT_LT(memcmp(buf.data() + 4 * sizeof(uint32_t), buf.data() + 5 * sizeof(uint32_t),
+            sizeof(uint32_t)), 0);
+}
 }  // namespace baikal
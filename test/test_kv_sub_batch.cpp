@@ -0,0 +1,222 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "mut_table_key.h"
+#include "region.h"
+#include "rocks_wrapper.h"
+#include "transaction_pool.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+
+static const int64_t REGION_ID = 1;
+
+static std::string kv_key(int i) {
+    MutTableKey key;
+    key.append_i64(REGION_ID).append_i64(REGION_ID).append_i32(i);
+    return key.data();
+}
+
+static pb::StoreReq make_kv_batch(int seq_id, int num_ops, int64_t num_increase_rows) {
+    pb::StoreReq req;
+    req.set_op_type(pb::OP_KV_BATCH);
+    req.set_region_id(REGION_ID);
+    req.set_region_version(1);
+    req.set_num_increase_rows(num_increase_rows);
+    pb::TransactionInfo* txn_info = req.add_txn_infos();
+    txn_info->set_txn_id(1);
+    txn_info->set_seq_id(seq_id);
+    for (int i = 0; i < num_ops; ++i) {
+        pb::KvOp* kv_op = req.add_kv_ops();
+        // 偶数put，奇数delete前面put过的key
+        if (i % 2 == 0 || i < 2) {
+            kv_op->set_op_type(pb::OP_PUT_KV);
+            kv_op->set_key(kv_key(i));
+            kv_op->set_value("value_" + std::to_string(i));
+        } else {
+            kv_op->set_op_type(pb::OP_DELETE_KV);
+            kv_op->set_key(kv_key(i - 1));
+        }
+        kv_op->set_is_primary_key(true);
+    }
+    return req;
+}
+
+// 与Region::apply_kv_in_txn的follower分支一致
+static int apply_kv_batch(SmartTransaction txn, const pb::StoreReq& req) {
+    int seq_id = req.txn_infos(0).seq_id();
+    bool kv_batch_continue = req.kv_batch_continue();
+    if (kv_batch_continue) {
+        if (txn->seq_id() != seq_id || txn->kv_batch_incomplete_seq() != seq_id) {
+            return -1;
+        }
+    } else {
+        txn->set_seq_id(seq_id);
+        txn->set_save_point();
+    }
+    for (auto& kv_op : req.kv_ops()) {
+        int ret = 0;
+        if (kv_op.op_type() == pb::OP_PUT_KV) {
+            ret = txn->put_kv(kv_op.key(), kv_op.value(), kv_op.ttl_timestamp_us());
+        } else {
+            ret = txn->delete_kv(kv_op.key());
+        }
+        if (ret < 0) {
+            return -1;
+        }
+        txn->clear_current_req_point_seq();
+    }
+    txn->num_increase_rows += req.num_increase_rows();
+    if (kv_batch_continue) {
+        txn->append_kv_ops_to_cache(seq_id, req);
+    } else {
+        pb::CachePlan plan_item;
+        plan_item.set_op_type(req.op_type());
+        plan_item.set_seq_id(seq_id);
+        for (auto& kv_op : req.kv_ops()) {
+            plan_item.add_kv_ops()->CopyFrom(kv_op);
+        }
+        txn->push_cmd_to_cache(seq_id, plan_item);
+    }
+    txn->set_kv_batch_incomplete_seq(req.kv_batch_has_more() ? seq_id : 0);
+    return 0;
+}
+
+static std::vector<std::string> read_keys(int num_ops) {
+    auto rocksdb = RocksWrapper::get_instance();
+    std::vector<std::string> values;
+    for (int i = 0; i < num_ops; ++i) {
+        std::string value;
+        rocksdb::ReadOptions options;
+        auto status = rocksdb->get(options, rocksdb->get_data_handle(), kv_key(i), &value);
+        values.push_back(status.ok() ? value : "NOT_FOUND");
+    }
+    return values;
+}
+
+TEST(test_kv_sub_batch, split) {
+    pb::StoreReq req = make_kv_batch(2, 25, 7);
+    pb::StoreReq origin = req;
+    std::vector<pb::StoreReq> sub_reqs;
+    EXPECT_FALSE(Region::split_kv_sub_batches(&req, 0, sub_reqs));
+    EXPECT_FALSE(Region::split_kv_sub_batches(&req, 25, sub_reqs));
+    EXPECT_TRUE(sub_reqs.empty());
+    EXPECT_EQ(origin.ShortDebugString(), req.ShortDebugString());
+
+    ASSERT_TRUE(Region::split_kv_sub_batches(&req, 10, sub_reqs));
+    ASSERT_EQ(2u, sub_reqs.size());
+    EXPECT_EQ(10, sub_reqs[0].kv_ops_size());
+    EXPECT_EQ(10, sub_reqs[1].kv_ops_size());
+    EXPECT_EQ(5, req.kv_ops_size());
+    EXPECT_FALSE(sub_reqs[0].kv_batch_continue());
+    EXPECT_TRUE(sub_reqs[1].kv_batch_continue());
+    EXPECT_TRUE(req.kv_batch_continue());
+    EXPECT_TRUE(sub_reqs[0].kv_batch_has_more());
+    EXPECT_TRUE(sub_reqs[1].kv_batch_has_more());
+    EXPECT_FALSE(req.kv_batch_has_more());
+    // 行数变化只在最后一批
+    EXPECT_EQ(0, sub_reqs[0].num_increase_rows());
+    EXPECT_EQ(0, sub_reqs[1].num_increase_rows());
+    EXPECT_EQ(7, req.num_increase_rows());
+    // 按原顺序拼接
+    std::vector<const pb::KvOp*> kv_ops;
+    for (auto& sub_req : sub_reqs) {
+        EXPECT_EQ(origin.txn_infos(0).ShortDebugString(), sub_req.txn_infos(0).ShortDebugString());
+        for (auto& kv_op : sub_req.kv_ops()) {
+            kv_ops.push_back(&kv_op);
+        }
+    }
+    for (auto& kv_op : req.kv_ops()) {
+        kv_ops.push_back(&kv_op);
+    }
+    ASSERT_EQ(25u, kv_ops.size());
+    for (int i = 0; i < 25; ++i) {
+        EXPECT_EQ(origin.kv_ops(i).ShortDebugString(), kv_ops[i]->ShortDebugString());
+    }
+
+    // 整除时最后一批是完整的一批
+    pb::StoreReq req2 = make_kv_batch(2, 30, 0);
+    sub_reqs.clear();
+    ASSERT_TRUE(Region::split_kv_sub_batches(&req2, 10, sub_reqs));
+    EXPECT_EQ(2u, sub_reqs.size());
+    EXPECT_EQ(10, req2.kv_ops_size());
+}
+
+TEST(test_kv_sub_batch, apply) {
+    auto rocksdb = RocksWrapper::get_instance();
+    ASSERT_EQ(0, rocksdb->init("./rocks_db_kv_sub_batch"));
+    TransactionPool pool;
+    pool.init(REGION_ID, false, 0);
+    const int num_ops = 25;
+    const int seq_id = 2;
+
+    // 不拆分
+    SmartTransaction txn;
+    ASSERT_EQ(0, pool.begin_txn(1, txn, REGION_ID, 0, -1));
+    pb::StoreReq req = make_kv_batch(seq_id, num_ops, 7);
+    ASSERT_EQ(0, apply_kv_batch(txn, req));
+    std::string whole_cache = txn->cache_plan_map()[seq_id].ShortDebugString();
+    int64_t whole_rows = txn->num_increase_rows;
+    ASSERT_TRUE(txn->commit().ok());
+    pool.remove_txn(1, true);
+    std::vector<std::string> whole_values = read_keys(num_ops);
+    for (int i = 0; i < num_ops; ++i) {
+        ASSERT_TRUE(rocksdb->remove(rocksdb::WriteOptions(), rocksdb->get_data_handle(), kv_key(i)).ok());
+    }
+
+    // 拆分后逐批apply
+    ASSERT_EQ(0, pool.begin_txn(2, txn, REGION_ID, 0, -1));
+    req = make_kv_batch(seq_id, num_ops, 7);
+    std::vector<pb::StoreReq> sub_reqs;
+    ASSERT_TRUE(Region::split_kv_sub_batches(&req, 10, sub_reqs));
+    for (auto& sub_req : sub_reqs) {
+        ASSERT_EQ(0, apply_kv_batch(txn, sub_req));
+        EXPECT_EQ(seq_id, txn->kv_batch_incomplete_seq());
+    }
+    ASSERT_EQ(0, apply_kv_batch(txn, req));
+    EXPECT_EQ(0, txn->kv_batch_incomplete_seq());
+    EXPECT_EQ(whole_cache, txn->cache_plan_map()[seq_id].ShortDebugString());
+    EXPECT_EQ(whole_rows, txn->num_increase_rows);
+    ASSERT_TRUE(txn->commit().ok());
+    pool.remove_txn(2, true);
+    EXPECT_EQ(whole_values, read_keys(num_ops));
+
+    // 只apply了一部分就切主，回滚该seq_id后可以重新执行
+    ASSERT_EQ(0, pool.begin_txn(3, txn, REGION_ID, 0, -1));
+    req = make_kv_batch(seq_id + 1, num_ops, 7);
+    for (auto& kv_op : *req.mutable_kv_ops()) {
+        kv_op.set_value(kv_op.value() + "_new");
+    }
+    sub_reqs.clear();
+    ASSERT_TRUE(Region::split_kv_sub_batches(&req, 10, sub_reqs));
+    ASSERT_EQ(0, apply_kv_batch(txn, sub_reqs[0]));
+    txn->rollback_incomplete_kv_batch(seq_id + 1);
+    EXPECT_EQ(seq_id, txn->seq_id());
+    EXPECT_EQ(0, txn->kv_batch_incomplete_seq());
+    EXPECT_EQ(0u, txn->cache_plan_map().count(seq_id + 1));
+    // 中间批次不能接在回滚后的seq_id上
+    EXPECT_NE(0, apply_kv_batch(txn, sub_reqs[1]));
+    ASSERT_TRUE(txn->commit().ok());
+    pool.remove_txn(3, true);
+    EXPECT_EQ(whole_values, read_keys(num_ops));
+}
+
+} // namespace baikaldb
@@ -0,0 +1,345 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mysql_wrapper.h"
+#include "network_socket.h"
+#include "query_context.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    signal(SIGPIPE, SIG_IGN);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int32(mysql_compress_min_size);
+
+// sock持有fds[0](非阻塞，同baikaldb)，返回对端fds[1]
+static int make_socket(SmartSocket& sock, int buf_size) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return -1;
+    }
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buf_size, sizeof(buf_size));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &buf_size, sizeof(buf_size));
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    sock = std::make_shared<NetworkSocket>();
+    sock->fd = fds[0];
+    return fds[1];
+}
+
+static std::string read_all(int fd) {
+    std::string data;
+    char buf[4096];
+    int len = 0;
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        data.append(buf, len);
+    }
+    return data;
+}
+
+// 返回每个mysql包的序号
+static std::vector<int> packet_ids(const std::string& data) {
+    std::vector<int> ids;
+    size_t pos = 0;
+    while (pos + 4 <= data.size()) {
+        const uint8_t* header = (const uint8_t*)data.data() + pos;
+        size_t len = header[0] | header[1] << 8 | header[2] << 16;
+        ids.push_back(header[3]);
+        pos += 4 + len;
+    }
+    EXPECT_EQ(pos, data.size());
+    return ids;
+}
+
+static void append_rows(SmartSocket& sock, int num, size_t value_size) {
+    std::vector<std::string> row = {std::string(value_size, 'a')};
+    for (int i = 0; i < num; i++) {
+        row[0][0] = 'a' + i % 26;
+        MysqlWrapper::get_instance()->make_row_packet(sock->send_buf, row, ++sock->packet_id);
+    }
+}
+
+TEST(test_mysql_wrapper, stream_write) {
+    MysqlWrapper* wrapper = MysqlWrapper::get_instance();
+    SmartSocket sock;
+    int peer = make_socket(sock, 16 * 1024);
+    ASSERT_GE(peer, 0);
+    // 远大于socket缓冲区，必然出现部分写入和EAGAIN
+    append_rows(sock, 200, 10 * 1024);
+    std::string expect((const char*)sock->send_buf->_data, sock->send_buf->_size);
+    std::string received;
+    std::thread reader([peer, &received]() {
+        // 先不读，让写端等待可写
+        usleep(100 * 1000);
+        received = read_all(peer);
+    });
+    EXPECT_EQ(RET_SUCCESS, wrapper->stream_write(sock.get(), 5 * 1000 * 1000LL));
+    EXPECT_EQ(0u, sock->send_buf->_size);
+    EXPECT_EQ(0, sock->send_buf_offset);
+    EXPECT_EQ(sock->packet_id, sock->last_packet_id);
+    EXPECT_EQ(expect.size(), sock->query_ctx->stat_info.send_buf_size);
+    shutdown(sock->fd, SHUT_WR);
+    reader.join();
+    EXPECT_EQ(expect, received);
+    close(peer);
+}
+
+TEST(test_mysql_wrapper, stream_write_fail) {
+    MysqlWrapper* wrapper = MysqlWrapper::get_instance();
+    // 客户端不读，超时返回错误，执行线程不会一直挂起
+    SmartSocket sock;
+    int peer = make_socket(sock, 16 * 1024);
+    ASSERT_GE(peer, 0);
+    append_rows(sock, 100, 10 * 1024);
+    TimeCost cost;
+    EXPECT_EQ(RET_ERROR, wrapper->stream_write(sock.get(), 100 * 1000LL));
+    EXPECT_LT(cost.get_time(), 2 * 1000 * 1000LL);
+    // 未写完的部分不清空，也不计入发送量
+    EXPECT_GT(sock->send_buf->_size, 0u);
+    EXPECT_EQ(0u, sock->query_ctx->stat_info.send_buf_size);
+    close(peer);
+
+    // 客户端断开
+    SmartSocket sock2;
+    peer = make_socket(sock2, 16 * 1024);
+    ASSERT_GE(peer, 0);
+    close(peer);
+    append_rows(sock2, 1, 100);
+    EXPECT_EQ(RET_SHUTDOWN, wrapper->stream_write(sock2.get(), 100 * 1000LL));
+}
+
+TEST(test_mysql_wrapper, error_after_stream) {
+    MysqlWrapper* wrapper = MysqlWrapper::get_instance();
+    SmartSocket sock;
+    int peer = make_socket(sock, 1024 * 1024);
+    ASSERT_GE(peer, 0);
+    // 请求序号为0
+    sock->packet_id = 0;
+    sock->last_packet_id = 0;
+    append_rows(sock, 5, 100);
+    size_t streamed_size = sock->send_buf->_size;
+    ASSERT_EQ(RET_SUCCESS, wrapper->stream_write(sock.get(), 1000 * 1000LL));
+    EXPECT_EQ(5, sock->last_packet_id);
+    // 后续行未发送时出错，错误包接在已发送的包之后
+    append_rows(sock, 3, 100);
+    ASSERT_TRUE(wrapper->make_err_packet(sock, ER_NET_ERROR_ON_WRITE, "%s", "fail"));
+    EXPECT_EQ(6, sock->packet_id);
+    // 语句结束时累加剩余部分
+    sock->query_ctx->stat_info.send_buf_size += sock->send_buf->_size;
+    EXPECT_EQ(streamed_size + sock->send_buf->_size, sock->query_ctx->stat_info.send_buf_size);
+    ASSERT_EQ(RET_SUCCESS, wrapper->real_write(sock));
+    shutdown(sock->fd, SHUT_WR);
+    std::string received = read_all(peer);
+    EXPECT_EQ(std::vector<int>({1, 2, 3, 4, 5, 6}), packet_ids(received));
+    // 最后一个是错误包
+    EXPECT_EQ(0xff, (uint8_t)received[streamed_size + 4]);
+    close(peer);
+}
+
+// 通过压缩协议发送data，返回对端收到的原始压缩帧
+static std::string compress_frames(const std::string& data) {
+    SmartSocket sock;
+    int peer = make_socket(sock, 1024 * 1024);
+    EXPECT_GE(peer, 0);
+    MysqlWrapper::get_instance()->enable_compress(sock.get());
+    sock->send_buf->byte_array_append_len((const uint8_t*)data.data(), data.size());
+    std::string frames;
+    std::thread reader([peer, &frames]() {
+        frames = read_all(peer);
+    });
+    int ret = RET_WAIT_FOR_EVENT;
+    while (ret == RET_WAIT_FOR_EVENT) {
+        ret = MysqlWrapper::get_instance()->real_write(sock);
+        if (ret == RET_WAIT_FOR_EVENT) {
+            usleep(1000);
+        }
+    }
+    EXPECT_EQ(RET_SUCCESS, ret);
+    shutdown(sock->fd, SHUT_WR);
+    reader.join();
+    close(peer);
+    return frames;
+}
+
+// 返回每个压缩帧的(压缩后长度, 压缩前长度)
+static std::vector<std::pair<size_t, size_t>> frame_lens(const std::string& frames) {
+    std::vector<std::pair<size_t, size_t>> lens;
+    size_t pos = 0;
+    while (pos + COMPRESS_HEADER_LEN <= frames.size()) {
+        const uint8_t* header = (const uint8_t*)frames.data() + pos;
+        size_t payload_len = header[0] | header[1] << 8 | header[2] << 16;
+        size_t uncompress_len = header[4] | header[5] << 8 | header[6] << 16;
+        lens.emplace_back(payload_len, uncompress_len);
+        pos += COMPRESS_HEADER_LEN + payload_len;
+    }
+    EXPECT_EQ(pos, frames.size());
+    return lens;
+}
+
+// 接收端通过压缩协议读出want_len字节，返回real_read的最终结果
+static int uncompress_frames(SmartSocket& sock, int peer, const std::string& frames,
+        int want_len, std::string& data) {
+    MysqlWrapper::get_instance()->enable_compress(sock.get());
+    std::thread writer([peer, &frames]() {
+        size_t pos = 0;
+        while (pos < frames.size()) {
+            int len = write(peer, frames.data() + pos, frames.size() - pos);
+            if (len <= 0) {
+                break;
+            }
+            pos += len;
+        }
+    });
+    int ret = RET_WAIT_FOR_EVENT;
+    int read_len = 0;
+    while (read_len < want_len) {
+        int len = 0;
+        ret = MysqlWrapper::get_instance()->real_read(sock, want_len - read_len, &len);
+        read_len += len;
+        if (ret == RET_WAIT_FOR_EVENT) {
+            usleep(1000);
+        } else if (ret != RET_SUCCESS) {
+            break;
+        }
+    }
+    writer.join();
+    data.assign((const char*)sock->self_buf->_data, sock->self_buf->_size);
+    return ret;
+}
+
+TEST(test_mysql_wrapper, compress_round_trip) {
+    // 小于阈值原样发送，压缩前长度为0
+    std::string small(FLAGS_mysql_compress_min_size - 1, 's');
+    std::string frames = compress_frames(small);
+    auto lens = frame_lens(frames);
+    ASSERT_EQ(1u, lens.size());
+    EXPECT_EQ(small.size(), lens[0].first);
+    EXPECT_EQ(0u, lens[0].second);
+    SmartSocket sock;
+    int peer = make_socket(sock, 1024 * 1024);
+    std::string data;
+    EXPECT_EQ(RET_SUCCESS, uncompress_frames(sock, peer, frames, small.size(), data));
+    EXPECT_EQ(small, data);
+    close(peer);
+
+    // 大于阈值压缩发送
+    std::string large;
+    for (int i = 0; i < 10000; i++) {
+        large.append("row_" + std::to_string(i % 100));
+    }
+    frames = compress_frames(large);
+    lens = frame_lens(frames);
+    ASSERT_EQ(1u, lens.size());
+    EXPECT_LT(lens[0].first, large.size());
+    EXPECT_EQ(large.size(), lens[0].second);
+    SmartSocket sock2;
+    peer = make_socket(sock2, 1024 * 1024);
+    EXPECT_EQ(RET_SUCCESS, uncompress_frames(sock2, peer, frames, large.size(), data));
+    EXPECT_EQ(large, data);
+    close(peer);
+}
+
+TEST(test_mysql_wrapper, compress_max_packet) {
+    // 16MB的mysql包拆成多个0xffffff + 空包，压缩帧按COMPRESS_CHUNK_LEN切分
+    std::string packet;
+    packet.append("\xff\xff\xff\x01", 4);
+    for (uint32_t i = 0; i < PACKET_LEN_MAX; i++) {
+        packet.push_back('a' + i % 7);
+    }
+    packet.append("\x00\x00\x00\x02", 4);
+    std::string frames = compress_frames(packet);
+    auto lens = frame_lens(frames);
+    EXPECT_EQ((packet.size() + COMPRESS_CHUNK_LEN - 1) / COMPRESS_CHUNK_LEN, lens.size());
+    size_t total_len = 0;
+    for (auto& len : lens) {
+        EXPECT_LE(len.first, PACKET_LEN_MAX);
+        EXPECT_LE(len.second, COMPRESS_CHUNK_LEN);
+        total_len += len.second == 0 ? len.first : len.second;
+    }
+    EXPECT_EQ(packet.size(), total_len);
+    SmartSocket sock;
+    int peer = make_socket(sock, 1024 * 1024);
+    std::string data;
+    EXPECT_EQ(RET_SUCCESS, uncompress_frames(sock, peer, frames, packet.size(), data));
+    EXPECT_TRUE(packet == data);
+    close(peer);
+}
+
+TEST(test_mysql_wrapper, compress_partial_and_corrupt) {
+    std::string large(1000, 'c');
+    std::string frames = compress_frames(large);
+    ASSERT_GT(frames.size(), COMPRESS_HEADER_LEN);
+
+    // 帧头不完整时等待后续数据
+    SmartSocket sock;
+    int peer = make_socket(sock, 1024 * 1024);
+    MysqlWrapper::get_instance()->enable_compress(sock.get());
+    ASSERT_EQ(3, write(peer, frames.data(), 3));
+    int len = 0;
+    EXPECT_EQ(RET_WAIT_FOR_EVENT, MysqlWrapper::get_instance()->real_read(sock, large.size(), &len));
+    EXPECT_EQ(0, len);
+    // 帧体不完整
+    ASSERT_EQ(COMPRESS_HEADER_LEN, write(peer, frames.data() + 3, COMPRESS_HEADER_LEN));
+    EXPECT_EQ(RET_WAIT_FOR_EVENT, MysqlWrapper::get_instance()->real_read(sock, large.size(), &len));
+    EXPECT_EQ(0, len);
+    size_t written = 3 + COMPRESS_HEADER_LEN;
+    ASSERT_EQ((int)(frames.size() - written), write(peer, frames.data() + written, frames.size() - written));
+    EXPECT_EQ(RET_SUCCESS, MysqlWrapper::get_instance()->real_read(sock, large.size(), &len));
+    EXPECT_EQ((int)large.size(), len);
+    EXPECT_EQ(large, std::string((const char*)sock->self_buf->_data, sock->self_buf->_size));
+    close(peer);
+
+    // 损坏的压缩数据断开连接
+    std::string corrupt = frames;
+    for (size_t i = COMPRESS_HEADER_LEN; i < corrupt.size(); i++) {
+        corrupt[i] = ~corrupt[i];
+    }
+    SmartSocket sock2;
+    peer = make_socket(sock2, 1024 * 1024);
+    std::string data;
+    EXPECT_EQ(RET_SHUTDOWN, uncompress_frames(sock2, peer, corrupt, large.size(), data));
+    close(peer);
+}
+
+TEST(test_mysql_wrapper, compress_buffered_input) {
+    // 两个mysql包在同一个压缩帧中，读完第一个后剩余数据仍在缓冲区
+    std::string first("\x01\x00\x00\x00\x0e", 5);
+    std::string second("\x05\x00\x00\x00\x03", 5);
+    second.append("abcd");
+    std::string frames = compress_frames(first + second);
+    ASSERT_EQ(1u, frame_lens(frames).size());
+    SmartSocket sock;
+    int peer = make_socket(sock, 1024 * 1024);
+    std::string data;
+    EXPECT_EQ(RET_SUCCESS, uncompress_frames(sock, peer, frames, first.size(), data));
+    EXPECT_EQ(first, data);
+    EXPECT_TRUE(sock->has_buffered_input());
+    sock->self_buf->byte_array_clear();
+    int len = 0;
+    EXPECT_EQ(RET_SUCCESS, MysqlWrapper::get_instance()->real_read(sock, second.size(), &len));
+    EXPECT_EQ(second, std::string((const char*)sock->self_buf->_data, sock->self_buf->_size));
+    EXPECT_FALSE(sock->has_buffered_input());
+    close(peer);
+}
+
+} // namespace baikaldb
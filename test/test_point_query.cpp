@@ -0,0 +1,215 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <set>
+#include <string>
+#include "filter_node.h"
+#include "logical_planner.h"
+#include "network_socket.h"
+#include "physical_planner.h"
+#include "query_context.h"
+#include "rocksdb_scan_node.h"
+#include "schema_factory.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    baikaldb::SchemaFactory::get_instance()->init();
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_bool(prepare_point_query);
+
+static const int64_t TABLE_ID = 2001;
+static const int64_t DB_ID = 2;
+
+static void update_table() {
+    pb::SchemaInfo info;
+    info.set_namespace_name("test_namespace");
+    info.set_database("test_db");
+    info.set_table_name("test_point_query");
+    info.set_namespace_id(1);
+    info.set_database_id(DB_ID);
+    info.set_table_id(TABLE_ID);
+    info.set_version(1);
+    info.set_partition_num(1);
+    pb::FieldInfo* field = info.add_fields();
+    field->set_field_name("id");
+    field->set_field_id(1);
+    field->set_mysql_type(pb::INT64);
+    field = info.add_fields();
+    field->set_field_name("v");
+    field->set_field_id(2);
+    field->set_mysql_type(pb::STRING);
+    pb::IndexInfo* index = info.add_indexs();
+    index->set_index_type(pb::I_PRIMARY);
+    index->set_index_name("pk_index");
+    index->add_field_ids(1);
+    index->set_index_id(TABLE_ID);
+    SchemaFactory::get_instance()->update_table(info);
+}
+
+static std::string encode_id(int64_t id) {
+    SchemaFactory* factory = SchemaFactory::get_instance();
+    auto pri_info = factory->get_index_info_ptr(TABLE_ID);
+    SmartRecord record = factory->new_record(TABLE_ID);
+    ExprValue value(pb::INT64);
+    value._u.int64_val = id;
+    record->set_value(record->get_field_by_tag(1), value);
+    MutTableKey key;
+    EXPECT_EQ(0, record->encode_key(*pri_info, key, 1, false, false));
+    return key.data();
+}
+
+static void add_region(RegionVec& regions, int64_t region_id, int64_t version,
+        const std::string& start_key, const std::string& end_key) {
+    pb::RegionInfo* region = regions.Add();
+    region->set_region_id(region_id);
+    region->set_table_id(TABLE_ID);
+    region->set_table_name("test_point_query");
+    region->set_partition_id(0);
+    region->set_replica_num(1);
+    region->set_version(version);
+    region->set_conf_version(1);
+    region->set_start_key(start_key);
+    region->set_end_key(end_key);
+    region->add_peers("127.0.0.1:8010");
+    region->set_leader("127.0.0.1:8010");
+}
+
+static SmartSocket make_client() {
+    SmartSocket client = std::make_shared<NetworkSocket>();
+    client->user_info = std::make_shared<UserInfo>();
+    client->user_info->username = "test";
+    client->user_info->namespace_ = "test_namespace";
+    client->user_info->database[DB_ID] = pb::WRITE;
+    client->current_db = "test_db";
+    client->charset_name = "utf8";
+    return client;
+}
+
+static std::shared_ptr<QueryContext> make_ctx(SmartSocket& client, uint8_t mysql_cmd) {
+    auto ctx = std::make_shared<QueryContext>();
+    ctx->client_conn = client.get();
+    ctx->user_info = client->user_info;
+    ctx->cur_db = client->current_db;
+    ctx->charset = client->charset_name;
+    ctx->mysql_cmd = mysql_cmd;
+    ctx->get_runtime_state()->set_client_conn(client.get());
+    return ctx;
+}
+
+static std::shared_ptr<QueryContext> execute(SmartSocket& client, const std::string& stmt_name,
+        const pb::ExprNode& param) {
+    auto ctx = make_ctx(client, COM_STMT_EXECUTE);
+    ctx->prepare_stmt_name = stmt_name;
+    ctx->param_values.push_back(param);
+    EXPECT_EQ(0, LogicalPlanner::analyze(ctx.get()));
+    EXPECT_EQ(0, PhysicalPlanner::analyze(ctx.get()));
+    return ctx;
+}
+
+static pb::ExprNode int_param(int64_t id) {
+    pb::ExprNode param;
+    param.set_node_type(pb::INT_LITERAL);
+    param.set_col_type(pb::INT64);
+    param.set_num_children(0);
+    param.mutable_derive_node()->set_int_val(id);
+    return param;
+}
+
+static pb::ExprNode null_param() {
+    pb::ExprNode param;
+    param.set_node_type(pb::NULL_LITERAL);
+    param.set_col_type(pb::NULL_TYPE);
+    param.set_num_children(0);
+    return param;
+}
+
+// 返回本次执行路由到的region
+static std::set<int64_t> routed_regions(QueryContext* ctx) {
+    std::set<int64_t> region_ids;
+    RocksdbScanNode* scan_node = static_cast<RocksdbScanNode*>(ctx->root->get_node(pb::SCAN_NODE));
+    EXPECT_NE(nullptr, scan_node);
+    if (scan_node != nullptr) {
+        for (auto& pair : scan_node->main_scan_index()->region_infos) {
+            region_ids.insert(pair.first);
+        }
+    }
+    return region_ids;
+}
+
+TEST(test_point_query, prepared_params) {
+    bool old_prepare_point_query = FLAGS_prepare_point_query;
+    FLAGS_prepare_point_query = true;
+    update_table();
+    RegionVec regions;
+    add_region(regions, 1, 1, "", "");
+    SchemaFactory::get_instance()->update_regions_double_buffer_sync(regions);
+
+    SmartSocket client = make_client();
+    auto prepare_ctx = make_ctx(client, COM_STMT_PREPARE);
+    prepare_ctx->sql = "select id, v from test_point_query where id = ?";
+    ASSERT_EQ(0, LogicalPlanner::analyze(prepare_ctx.get()));
+    std::string stmt_name = prepare_ctx->prepare_stmt_name;
+    ASSERT_EQ(1u, client->prepared_plans.count(stmt_name));
+
+    // 第一次执行走完整规划，之后生成点查计划
+    auto ctx = execute(client, stmt_name, int_param(5));
+    ASSERT_NE(nullptr, ctx->point_query);
+    PointQueryPlan& point_query = *ctx->point_query;
+    EXPECT_TRUE(point_query.checked);
+    ASSERT_TRUE(point_query.valid);
+    EXPECT_EQ(std::set<int64_t>({1}), routed_regions(ctx.get()));
+
+    // 不同参数走点查，range和路由随参数变化，store仍保留原条件
+    for (int64_t id : {7, 200, 5}) {
+        ctx = execute(client, stmt_name, int_param(id));
+        EXPECT_TRUE(point_query.valid);
+        EXPECT_FALSE(ctx->return_empty);
+        EXPECT_EQ(encode_id(id), point_query.primary.ranges(0).left_key());
+        EXPECT_EQ(encode_id(id), point_query.primary.ranges(0).right_key());
+        EXPECT_EQ(1u, point_query.filter_node->pruned_conjuncts().size());
+        EXPECT_EQ(std::set<int64_t>({1}), routed_regions(ctx.get()));
+    }
+
+    // 参数为null时由完整规划返回空结果，下次执行重新生成点查计划
+    ctx = execute(client, stmt_name, null_param());
+    EXPECT_FALSE(point_query.valid);
+    EXPECT_FALSE(point_query.checked);
+    EXPECT_TRUE(ctx->return_empty);
+    ctx = execute(client, stmt_name, int_param(5));
+    EXPECT_TRUE(point_query.checked);
+    EXPECT_TRUE(point_query.valid);
+    EXPECT_FALSE(ctx->return_empty);
+
+    // 两次执行之间region分裂，点查按新的路由表找到region
+    regions.Clear();
+    add_region(regions, 1, 2, "", encode_id(100));
+    add_region(regions, 2, 1, encode_id(100), "");
+    SchemaFactory::get_instance()->update_regions_double_buffer_sync(regions);
+    ctx = execute(client, stmt_name, int_param(200));
+    EXPECT_TRUE(point_query.valid);
+    EXPECT_EQ(std::set<int64_t>({2}), routed_regions(ctx.get()));
+    ctx = execute(client, stmt_name, int_param(100));
+    EXPECT_EQ(std::set<int64_t>({2}), routed_regions(ctx.get()));
+    ctx = execute(client, stmt_name, int_param(5));
+    EXPECT_EQ(std::set<int64_t>({1}), routed_regions(ctx.get()));
+    EXPECT_EQ(point_query.scan_node, ctx->root->get_node(pb::SCAN_NODE));
+    FLAGS_prepare_point_query = old_prepare_point_query;
+}
+
+} // namespace baikaldb
@@ -66,4 +66,32 @@ TEST(test_covent_pattern, case_all) {
     EXPECT_EQ(false, *pred.like<LikePredicate::Binary>("aaaaaaaaaaaaaaaaaaaaaaaaaaa", "a%a%a%a%a%a%a%a%b"));
 }
 
+static bool literal_like(const std::string& target, const std::string& pattern) {
+    LikePredicate::LiteralMatcher matcher;
+    EXPECT_TRUE(matcher.compile(pattern, '\\'));
+    return matcher.match(target.data(), target.size());
+}
+
+TEST(test_literal_matcher, case_all) {
+    LikePredicate::LiteralMatcher matcher;
+    EXPECT_FALSE(matcher.compile("a_c", '\\'));
+    EXPECT_TRUE(matcher.compile("%error%", '\\'));
+    EXPECT_EQ(LikePredicate::LiteralMatcher::INFIX, matcher.type);
+    EXPECT_TRUE(matcher.compile("a%b%c", '\\'));
+    EXPECT_EQ(LikePredicate::LiteralMatcher::SEGMENTS, matcher.type);
+    EXPECT_EQ(true, literal_like("abc", "abc"));
+    EXPECT_EQ(false, literal_like("abcd", "abc"));
+    EXPECT_EQ(true, literal_like("abcd", "abc%"));
+    EXPECT_EQ(true, literal_like("xabc", "%abc"));
+    EXPECT_EQ(true, literal_like("an error here", "%error%"));
+    EXPECT_EQ(false, literal_like("err", "%error%"));
+    EXPECT_EQ(true, literal_like("test", "te%%st"));
+    EXPECT_EQ(true, literal_like("axxx", "a%x%x"));
+    EXPECT_EQ(false, literal_like("aba", "ab%ba"));
+    EXPECT_EQ(true, literal_like("", "%"));
+    EXPECT_EQ(true, literal_like("a%b", "a\\%b"));
+    EXPECT_EQ(false, literal_like("axb", "a\\%b"));
+    EXPECT_EQ(false, literal_like("aaaaaaaaaaaaaaaaaaaaaaaaaaa", "a%a%a%a%a%a%a%a%b"));
+}
+
 }  // namespace baikal
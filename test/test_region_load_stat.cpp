@@ -0,0 +1,108 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "region_load_stat.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+
+static std::string make_key(int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "key_%04d", i);
+    return buf;
+}
+
+TEST(test_region_load_stat, select_split_key) {
+    FLAGS_region_load_min_sample_keys = 8;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100; ++i) {
+        keys.emplace_back(make_key(99 - i));
+    }
+    std::string split_key;
+    EXPECT_TRUE(RegionLoadStat::select_split_key(keys, "", "", split_key));
+    EXPECT_EQ(make_key(50), split_key);
+
+    // 范围外的key不参与
+    keys.clear();
+    for (int i = 0; i < 100; ++i) {
+        keys.emplace_back(make_key(i));
+    }
+    EXPECT_TRUE(RegionLoadStat::select_split_key(keys, make_key(20), make_key(60), split_key));
+    EXPECT_EQ(make_key(40), split_key);
+
+    // 样本不足
+    keys.clear();
+    for (int i = 0; i < 4; ++i) {
+        keys.emplace_back(make_key(i));
+    }
+    EXPECT_FALSE(RegionLoadStat::select_split_key(keys, "", "", split_key));
+}
+
+TEST(test_region_load_stat, single_hot_key) {
+    FLAGS_region_load_min_sample_keys = 8;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 90; ++i) {
+        keys.emplace_back(make_key(10));
+    }
+    for (int i = 0; i < 10; ++i) {
+        keys.emplace_back(make_key(i + 20));
+    }
+    std::string split_key;
+    EXPECT_FALSE(RegionLoadStat::select_split_key(keys, "", "", split_key));
+
+    // 热点key占一半，在热点key之后分裂
+    keys.clear();
+    for (int i = 0; i < 50; ++i) {
+        keys.emplace_back(make_key(10));
+        keys.emplace_back(make_key(i + 20));
+    }
+    EXPECT_TRUE(RegionLoadStat::select_split_key(keys, "", "", split_key));
+    EXPECT_EQ(make_key(20), split_key);
+}
+
+TEST(test_region_load_stat, roll_window) {
+    FLAGS_region_load_key_sample_rate = 1;
+    FLAGS_region_load_bytes_sample_rate = 1;
+    RegionLoadStat stat;
+    pb::RegionLoad load;
+    load.set_read_qps(1);
+    for (int i = 0; i < 100; ++i) {
+        stat.add_read(load, 10);
+        stat.add_write(load, 20);
+        stat.sample_key(make_key(i));
+    }
+    bthread_usleep(100 * 1000);
+    pb::RegionLoad window_load;
+    stat.roll_window(&window_load);
+    EXPECT_GT(window_load.read_qps(), 0);
+    EXPECT_GT(window_load.write_qps(), 0);
+    EXPECT_GT(window_load.exec_time_us(), 0);
+    std::string split_key;
+    EXPECT_TRUE(stat.get_load_split_key("", "", split_key));
+    EXPECT_EQ(make_key(50), split_key);
+    // 新窗口无访问
+    stat.roll_window(&window_load);
+    EXPECT_EQ(0, window_load.read_qps());
+    EXPECT_FALSE(stat.get_load_split_key("", "", split_key));
+}
+
+} // namespace baikaldb
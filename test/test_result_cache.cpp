@@ -0,0 +1,202 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "result_cache.h"
+#include "schema_factory.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    baikaldb::SchemaFactory::get_instance()->init();
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int64(result_cache_max_memory_mb);
+DECLARE_int64(result_cache_max_item_size);
+
+static const int64_t TABLE_ID = 1001;
+
+static void update_table(int64_t version) {
+    pb::SchemaInfo info;
+    info.set_namespace_name("test_namespace");
+    info.set_database("test_db");
+    info.set_table_name("test_result_cache");
+    info.set_namespace_id(1);
+    info.set_database_id(1);
+    info.set_table_id(TABLE_ID);
+    info.set_version(version);
+    info.set_partition_num(1);
+    pb::FieldInfo* field = info.add_fields();
+    field->set_field_name("id");
+    field->set_field_id(1);
+    field->set_mysql_type(pb::INT64);
+    pb::IndexInfo* index = info.add_indexs();
+    index->set_index_type(pb::I_PRIMARY);
+    index->set_index_name("pk_index");
+    index->add_field_ids(1);
+    index->set_index_id(TABLE_ID);
+    SchemaFactory::get_instance()->update_table(info);
+}
+
+static SmartResultCacheItem make_item(const std::string& sql, size_t result_size, int64_t ttl_s) {
+    auto item = std::make_shared<ResultCacheItem>();
+    item->sql = sql;
+    item->key = ResultCache::make_key(1, "test_db", "utf8", "user", sql);
+    item->result.assign(result_size, 'x');
+    item->create_time_us = butil::gettimeofday_us();
+    item->expire_time_us = item->create_time_us + ttl_s * 1000000LL;
+    return item;
+}
+
+TEST(test_result_cache, key) {
+    std::string sql = "select count(*) from t";
+    uint64_t key = ResultCache::make_key(1, "db", "utf8", "user", sql);
+    EXPECT_EQ(key, ResultCache::make_key(1, "db", "utf8", "user", sql));
+    EXPECT_NE(key, ResultCache::make_key(2, "db", "utf8", "user", sql));
+    EXPECT_NE(key, ResultCache::make_key(1, "db2", "utf8", "user", sql));
+    EXPECT_NE(key, ResultCache::make_key(1, "db", "gbk", "user", sql));
+    // 不同用户不能共享结果
+    EXPECT_NE(key, ResultCache::make_key(1, "db", "utf8", "user2", sql));
+    EXPECT_NE(key, ResultCache::make_key(1, "db", "utf8", "user", sql + " where id = 1"));
+    // 字段分隔，避免拼接后相同
+    EXPECT_NE(ResultCache::make_key(1, "ab", "c", "user", sql),
+              ResultCache::make_key(1, "a", "bc", "user", sql));
+}
+
+TEST(test_result_cache, find) {
+    ResultCache* cache = ResultCache::get_instance();
+    cache->clear();
+    auto item = make_item("select 1 from t", 100, 60);
+    cache->add(item);
+    EXPECT_EQ(item, cache->find(item->key, item->sql));
+    // hash冲突时sql不同不能命中，且删除旧item
+    EXPECT_EQ(nullptr, cache->find(item->key, "select 2 from t"));
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+    EXPECT_EQ(nullptr, cache->find(item->key + 1, item->sql));
+    // 无region信息时不需要向store校验
+    cache->add(item);
+    EXPECT_TRUE(cache->check_region_versions(item));
+    EXPECT_EQ(item, cache->find(item->key, item->sql));
+}
+
+TEST(test_result_cache, budget) {
+    ResultCache* cache = ResultCache::get_instance();
+    cache->clear();
+    int64_t old_max_memory_mb = FLAGS_result_cache_max_memory_mb;
+    int64_t old_max_item_size = FLAGS_result_cache_max_item_size;
+    FLAGS_result_cache_max_memory_mb = 1;
+    FLAGS_result_cache_max_item_size = 4 * 1024 * 1024LL;
+    std::vector<SmartResultCacheItem> items;
+    for (int i = 0; i < 4; i++) {
+        items.emplace_back(make_item("select " + std::to_string(i) + " from t", 300 * 1024, 60));
+        cache->add(items.back());
+    }
+    // 1MB只能放下3个，淘汰最久未使用的
+    std::vector<std::vector<std::string>> rows;
+    cache->get_info(rows);
+    EXPECT_EQ(3u, rows.size());
+    EXPECT_EQ(nullptr, cache->find(items[0]->key, items[0]->sql));
+    // 访问后移到尾部，再加入时淘汰items[2]
+    EXPECT_EQ(items[1], cache->find(items[1]->key, items[1]->sql));
+    cache->add(make_item("select 4 from t", 300 * 1024, 60));
+    EXPECT_EQ(items[1], cache->find(items[1]->key, items[1]->sql));
+    EXPECT_EQ(nullptr, cache->find(items[2]->key, items[2]->sql));
+    EXPECT_EQ(items[3], cache->find(items[3]->key, items[3]->sql));
+    // 单个超过预算或超过单条上限的不缓存
+    auto big_item = make_item("select big from t", 2 * 1024 * 1024, 60);
+    cache->add(big_item);
+    EXPECT_EQ(nullptr, cache->find(big_item->key, big_item->sql));
+    FLAGS_result_cache_max_item_size = 100 * 1024;
+    auto item = make_item("select 5 from t", 200 * 1024, 60);
+    cache->add(item);
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+    // 重复加入同一key只占一份
+    FLAGS_result_cache_max_item_size = 4 * 1024 * 1024LL;
+    cache->clear();
+    for (int i = 0; i < 10; i++) {
+        cache->add(make_item("select same from t", 300 * 1024, 60));
+    }
+    rows.clear();
+    cache->get_info(rows);
+    EXPECT_EQ(1u, rows.size());
+    cache->clear();
+    FLAGS_result_cache_max_memory_mb = old_max_memory_mb;
+    FLAGS_result_cache_max_item_size = old_max_item_size;
+}
+
+TEST(test_result_cache, ttl) {
+    ResultCache* cache = ResultCache::get_instance();
+    cache->clear();
+    auto item = make_item("select ttl from t", 100, 1);
+    cache->add(item);
+    EXPECT_EQ(item, cache->find(item->key, item->sql));
+    item->expire_time_us = butil::gettimeofday_us() - 1;
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+    // 过期后已删除
+    item->expire_time_us = butil::gettimeofday_us() + 1000000LL;
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+}
+
+TEST(test_result_cache, invalidation) {
+    ResultCache* cache = ResultCache::get_instance();
+    cache->clear();
+    update_table(1);
+    std::set<int64_t> table_ids = {TABLE_ID};
+
+    // 本机写入
+    auto item = make_item("select write from t", 100, 60);
+    cache->get_table_versions(table_ids, item->table_versions);
+    EXPECT_EQ(1, item->table_versions[TABLE_ID].second);
+    cache->add(item);
+    EXPECT_EQ(item, cache->find(item->key, item->sql));
+    cache->table_write(TABLE_ID);
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+    // 写入后重新缓存的结果有效，其他表的写入不影响
+    item = make_item("select write from t", 100, 60);
+    cache->get_table_versions(table_ids, item->table_versions);
+    cache->add(item);
+    cache->table_write(TABLE_ID + 1);
+    EXPECT_EQ(item, cache->find(item->key, item->sql));
+
+    // schema版本变化
+    update_table(2);
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+    // 表不存在
+    item = make_item("select none from t", 100, 60);
+    cache->get_table_versions({TABLE_ID + 2}, item->table_versions);
+    cache->add(item);
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+
+    // region数据版本未知或region已不存在，不向store发请求直接失效
+    item = make_item("select region from t", 100, 60);
+    RegionDataVersion region_version;
+    region_version.table_id = TABLE_ID;
+    region_version.version = 1;
+    region_version.data_index = -1;
+    item->region_versions[1] = region_version;
+    cache->add(item);
+    EXPECT_EQ(item, cache->find(item->key, item->sql));
+    EXPECT_FALSE(cache->check_region_versions(item));
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+    item->region_versions[1].data_index = 10;
+    cache->add(item);
+    EXPECT_FALSE(cache->check_region_versions(item));
+    EXPECT_EQ(nullptr, cache->find(item->key, item->sql));
+    cache->clear();
+}
+
+} // namespace baikaldb
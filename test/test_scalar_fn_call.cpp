@@ -0,0 +1,192 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "expr_node.h"
+#include "literal.h"
+#include "scalar_fn_call.h"
+#include "fn_manager.h"
+#include "parser.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    baikaldb::FunctionManager::instance()->init();
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_bool(scalar_fn_typed_binary);
+
+static void add_fn(pb::Expr& expr, const std::string& name, int32_t fn_op, int num_children) {
+    pb::ExprNode* node = expr.add_nodes();
+    node->set_node_type(pb::FUNCTION_CALL);
+    node->set_col_type(pb::INVALID_TYPE);
+    node->set_num_children(num_children);
+    node->mutable_fn()->set_name(name);
+    node->mutable_fn()->set_fn_op(fn_op);
+}
+
+static void add_int(pb::Expr& expr, int64_t val) {
+    pb::ExprNode* node = expr.add_nodes();
+    node->set_node_type(pb::INT_LITERAL);
+    node->set_col_type(pb::INT64);
+    node->set_num_children(0);
+    node->mutable_derive_node()->set_int_val(val);
+}
+
+static void add_null(pb::Expr& expr) {
+    pb::ExprNode* node = expr.add_nodes();
+    node->set_node_type(pb::NULL_LITERAL);
+    node->set_col_type(pb::NULL_TYPE);
+    node->set_num_children(0);
+}
+
+static void add_place_holder(pb::Expr& expr, int id) {
+    pb::ExprNode* node = expr.add_nodes();
+    node->set_node_type(pb::PLACE_HOLDER_LITERAL);
+    node->set_col_type(pb::NULL_TYPE);
+    node->set_num_children(0);
+    node->mutable_derive_node()->set_int_val(id);
+}
+
+static ExprValue int_value(int64_t val) {
+    ExprValue value(pb::INT64);
+    value._u.int64_val = val;
+    return value;
+}
+
+// 模拟prepare复用计划时每次execute填入新参数
+static ExprValue exec_with_param(ExprNode* root, int64_t param) {
+    std::map<int, ExprNode*> placeholders;
+    root->find_place_holder(placeholders);
+    EXPECT_EQ(1u, placeholders.size());
+    static_cast<Literal*>(placeholders[0])->init(int_value(param));
+    EXPECT_EQ(0, root->type_inferer());
+    EXPECT_EQ(0, root->open());
+    ExprValue value = root->get_value(nullptr);
+    root->close();
+    return value;
+}
+
+TEST(test_const_pre_calc, place_holder) {
+    // ? + 2 * 3 => ? + 6
+    pb::Expr expr;
+    add_fn(expr, "add", parser::FT_ADD, 2);
+    add_place_holder(expr, 0);
+    add_fn(expr, "multiplies", parser::FT_MULTIPLIES, 2);
+    add_int(expr, 2);
+    add_int(expr, 3);
+    ExprNode* root = nullptr;
+    ASSERT_EQ(0, ExprNode::create_tree(expr, &root));
+    root->const_pre_calc();
+    // 含place holder的根节点不能被替换
+    EXPECT_EQ(pb::FUNCTION_CALL, root->node_type());
+    ASSERT_EQ(2u, root->children_size());
+    EXPECT_TRUE(root->children(0)->is_place_holder());
+    ASSERT_TRUE(root->children(1)->is_literal());
+    EXPECT_EQ(6, root->children(1)->get_value(nullptr).get_numberic<int64_t>());
+    EXPECT_FALSE(root->has_no_arg_function());
+    // 复用计划，place holder每次取新值
+    EXPECT_EQ(11, exec_with_param(root, 5).get_numberic<int64_t>());
+    EXPECT_EQ(16, exec_with_param(root, 10).get_numberic<int64_t>());
+    delete root;
+
+    // ? + (1 + now()) 中的无参函数不能提前计算
+    pb::Expr expr2;
+    add_fn(expr2, "add", parser::FT_ADD, 2);
+    add_place_holder(expr2, 0);
+    add_fn(expr2, "add", parser::FT_ADD, 2);
+    add_int(expr2, 1);
+    add_fn(expr2, "now", parser::FT_COMMON, 0);
+    root = nullptr;
+    ASSERT_EQ(0, ExprNode::create_tree(expr2, &root));
+    EXPECT_TRUE(root->has_no_arg_function());
+    root->const_pre_calc();
+    ASSERT_EQ(2u, root->children_size());
+    EXPECT_TRUE(root->children(0)->is_place_holder());
+    EXPECT_EQ(pb::FUNCTION_CALL, root->children(1)->node_type());
+    ASSERT_EQ(2u, root->children(1)->children_size());
+    EXPECT_EQ(pb::FUNCTION_CALL, root->children(1)->children(1)->node_type());
+    delete root;
+}
+
+struct BinaryFn {
+    const char* name;
+    int32_t fn_op;
+};
+
+static const std::vector<BinaryFn> binary_fns = {
+    {"add", parser::FT_ADD},
+    {"minus", parser::FT_MINUS},
+    {"multiplies", parser::FT_MULTIPLIES},
+    {"eq", parser::FT_EQ},
+    {"ne", parser::FT_NE},
+    {"gt", parser::FT_GT},
+    {"ge", parser::FT_GE},
+    {"lt", parser::FT_LT},
+    {"le", parser::FT_LE},
+};
+
+// left/right为nullptr表示NULL
+static ExprValue calc_binary(const BinaryFn& fn, const int64_t* left, const int64_t* right,
+                             bool typed) {
+    FLAGS_scalar_fn_typed_binary = typed;
+    pb::Expr expr;
+    add_fn(expr, fn.name, fn.fn_op, 2);
+    for (auto val : {left, right}) {
+        if (val == nullptr) {
+            add_null(expr);
+        } else {
+            add_int(expr, *val);
+        }
+    }
+    ExprNode* root = nullptr;
+    EXPECT_EQ(0, ExprNode::create_tree(expr, &root));
+    if (root == nullptr) {
+        return ExprValue::Null();
+    }
+    EXPECT_EQ(0, root->type_inferer());
+    EXPECT_EQ(0, root->open());
+    ExprValue value = root->get_value(nullptr);
+    root->close();
+    delete root;
+    FLAGS_scalar_fn_typed_binary = true;
+    return value;
+}
+
+TEST(test_scalar_fn_call, typed_binary) {
+    int64_t seven = 7;
+    int64_t three = -3;
+    for (auto& fn : binary_fns) {
+        // 任一操作数为NULL结果都是NULL，比较不能退化为false
+        EXPECT_TRUE(calc_binary(fn, nullptr, &three, true).is_null()) << fn.name;
+        EXPECT_TRUE(calc_binary(fn, &seven, nullptr, true).is_null()) << fn.name;
+        EXPECT_TRUE(calc_binary(fn, nullptr, nullptr, true).is_null()) << fn.name;
+        EXPECT_TRUE(calc_binary(fn, nullptr, &three, false).is_null()) << fn.name;
+        // 与通用路径结果一致
+        for (auto left : {&seven, &three}) {
+            for (auto right : {&seven, &three}) {
+                ExprValue typed = calc_binary(fn, left, right, true);
+                ExprValue common = calc_binary(fn, left, right, false);
+                EXPECT_EQ(common.type, typed.type) << fn.name;
+                EXPECT_EQ(common.get_string(), typed.get_string()) << fn.name;
+            }
+        }
+    }
+}
+
+} // namespace baikaldb
@@ -0,0 +1,257 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "segment_log_storage.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int64(segment_log_max_size);
+
+// 每次构造新实例相当于一次store重启
+class TestSegmentLogManager : public SegmentLogManager {
+public:
+    TestSegmentLogManager() {}
+};
+
+static std::string entry_data(int64_t region_id, int64_t index) {
+    return std::to_string(region_id) + "_" + std::to_string(index) + std::string(100, 'x');
+}
+
+static braft::LogEntry* make_entry(int64_t region_id, int64_t index, int64_t term) {
+    braft::LogEntry* entry = new braft::LogEntry;
+    entry->AddRef();
+    entry->type = braft::ENTRY_TYPE_DATA;
+    entry->id = braft::LogId(index, term);
+    entry->data.append(entry_data(region_id, index));
+    return entry;
+}
+
+static int append(SegmentLogManager& manager, int64_t region_id,
+                  int64_t begin, int64_t end, int64_t term) {
+    std::vector<braft::LogEntry*> entries;
+    for (int64_t index = begin; index <= end; ++index) {
+        entries.push_back(make_entry(region_id, index, term));
+    }
+    int ret = manager.append_entries(region_id, entries);
+    for (auto entry : entries) {
+        entry->Release();
+    }
+    return ret;
+}
+
+static void check_entry(SegmentLogManager& manager, int64_t region_id,
+                        int64_t index, int64_t term) {
+    int64_t read_term = 0;
+    int type = 0;
+    std::string data;
+    ASSERT_EQ(0, manager.read_entry(region_id, index, read_term, type, data));
+    EXPECT_EQ(term, read_term);
+    EXPECT_EQ(braft::ENTRY_TYPE_DATA, type);
+    EXPECT_EQ(entry_data(region_id, index), data);
+}
+
+static void check_log_index(SegmentLogManager& manager, int64_t region_id,
+                            int64_t first_log_index, int64_t last_log_index) {
+    int64_t first = 0;
+    int64_t last = 0;
+    manager.get_log_index(region_id, first, last);
+    EXPECT_EQ(first_log_index, first);
+    EXPECT_EQ(last_log_index, last);
+}
+
+static std::vector<std::string> list_segments(const std::string& path) {
+    std::vector<std::string> segments;
+    boost::filesystem::directory_iterator end_iter;
+    for (boost::filesystem::directory_iterator iter(path); iter != end_iter; ++iter) {
+        std::string name = iter->path().filename().string();
+        if (name.compare(0, strlen("segment_"), "segment_") == 0) {
+            segments.push_back(iter->path().string());
+        }
+    }
+    std::sort(segments.begin(), segments.end(), [](const std::string& l, const std::string& r) {
+        return l.size() < r.size() || (l.size() == r.size() && l < r);
+    });
+    return segments;
+}
+
+TEST(test_segment_log_storage, storage) {
+    // 每个segment只能放几条日志，保证truncate跨越segment边界
+    FLAGS_segment_log_max_size = 1024;
+    const std::string path = "./segment_log_storage_test";
+    boost::filesystem::remove_all(path);
+    ASSERT_EQ(0, SegmentLogManager::get_instance()->init(path));
+
+    SegmentLogStorage segment_log_storage;
+    braft::LogStorage* storage = segment_log_storage.new_instance("segmentlog://segment_log?id=1");
+    ASSERT_TRUE(storage != nullptr);
+    braft::ConfigurationManager configuration_manager;
+    ASSERT_EQ(0, storage->init(&configuration_manager));
+    EXPECT_EQ(1, storage->first_log_index());
+    EXPECT_EQ(0, storage->last_log_index());
+
+    braft::LogEntry* conf_entry = new braft::LogEntry;
+    conf_entry->AddRef();
+    conf_entry->type = braft::ENTRY_TYPE_CONFIGURATION;
+    conf_entry->id = braft::LogId(1, 1);
+    conf_entry->peers = new std::vector<braft::PeerId>;
+    conf_entry->peers->push_back(braft::PeerId("127.0.0.1:8010:0"));
+    conf_entry->peers->push_back(braft::PeerId("127.0.0.1:8011:0"));
+    conf_entry->peers->push_back(braft::PeerId("127.0.0.1:8012:0"));
+    ASSERT_EQ(0, storage->append_entry(conf_entry));
+    conf_entry->Release();
+
+    std::vector<braft::LogEntry*> entries;
+    for (int64_t index = 2; index <= 40; ++index) {
+        entries.push_back(make_entry(1, index, 1));
+    }
+    EXPECT_EQ(39, storage->append_entries(entries, nullptr));
+    for (auto entry : entries) {
+        entry->Release();
+    }
+    EXPECT_EQ(1, storage->first_log_index());
+    EXPECT_EQ(40, storage->last_log_index());
+    EXPECT_GT(list_segments(path).size(), 2u);
+
+    braft::LogEntry* read_entry = storage->get_entry(1);
+    ASSERT_TRUE(read_entry != nullptr);
+    EXPECT_EQ(braft::ENTRY_TYPE_CONFIGURATION, read_entry->type);
+    ASSERT_TRUE(read_entry->peers != nullptr);
+    EXPECT_EQ(3u, read_entry->peers->size());
+    EXPECT_EQ("127.0.0.1:8011:0", (*read_entry->peers)[1].to_string());
+    read_entry->Release();
+    for (int64_t index = 2; index <= 40; ++index) {
+        read_entry = storage->get_entry(index);
+        ASSERT_TRUE(read_entry != nullptr);
+        EXPECT_EQ(index, read_entry->id.index);
+        EXPECT_EQ(entry_data(1, index), read_entry->data.to_string());
+        read_entry->Release();
+    }
+    EXPECT_EQ(1, storage->get_term(20));
+    EXPECT_EQ(0, storage->get_term(41));
+    EXPECT_TRUE(storage->get_entry(41) == nullptr);
+
+    // 前缀截断后，不再被任何region引用的segment被删除
+    size_t segment_num = list_segments(path).size();
+    EXPECT_EQ(0, storage->truncate_prefix(25));
+    EXPECT_EQ(25, storage->first_log_index());
+    EXPECT_EQ(40, storage->last_log_index());
+    EXPECT_TRUE(storage->get_entry(24) == nullptr);
+    EXPECT_EQ(0, storage->get_term(24));
+    read_entry = storage->get_entry(25);
+    ASSERT_TRUE(read_entry != nullptr);
+    EXPECT_EQ(entry_data(1, 25), read_entry->data.to_string());
+    read_entry->Release();
+    EXPECT_LT(list_segments(path).size(), segment_num);
+
+    // 后缀截断后从截断点继续追加新term
+    EXPECT_EQ(0, storage->truncate_suffix(30));
+    EXPECT_EQ(30, storage->last_log_index());
+    EXPECT_EQ(0, storage->get_term(31));
+    braft::LogEntry* entry = make_entry(1, 31, 2);
+    EXPECT_EQ(0, storage->append_entry(entry));
+    entry->Release();
+    EXPECT_EQ(31, storage->last_log_index());
+    EXPECT_EQ(2, storage->get_term(31));
+    EXPECT_EQ(1, storage->get_term(30));
+
+    // 追加不连续的日志失败
+    entry = make_entry(1, 33, 2);
+    EXPECT_NE(0, storage->append_entry(entry));
+    entry->Release();
+    EXPECT_EQ(31, storage->last_log_index());
+
+    EXPECT_EQ(0, storage->reset(100));
+    EXPECT_EQ(100, storage->first_log_index());
+    EXPECT_EQ(99, storage->last_log_index());
+    EXPECT_TRUE(storage->get_entry(31) == nullptr);
+    entry = make_entry(1, 100, 3);
+    EXPECT_EQ(0, storage->append_entry(entry));
+    entry->Release();
+    EXPECT_EQ(3, storage->get_term(100));
+    delete storage;
+}
+
+TEST(test_segment_log_storage, recovery) {
+    FLAGS_segment_log_max_size = 1024;
+    const std::string path = "./segment_log_recovery_test";
+    boost::filesystem::remove_all(path);
+    {
+        TestSegmentLogManager manager;
+        ASSERT_EQ(0, manager.init(path));
+        // 两个region交错写入同一组segment
+        for (int64_t index = 1; index <= 20; index += 5) {
+            ASSERT_EQ(0, append(manager, 1, index, index + 4, 1));
+            if (index <= 10) {
+                ASSERT_EQ(0, append(manager, 2, index, index + 4, 1));
+            }
+        }
+        ASSERT_EQ(0, manager.truncate_prefix(1, 5));
+        ASSERT_EQ(0, manager.truncate_suffix(2, 8));
+        ASSERT_EQ(0, append(manager, 2, 9, 12, 2));
+        check_log_index(manager, 1, 5, 20);
+        check_log_index(manager, 2, 1, 12);
+    }
+    {
+        TestSegmentLogManager manager;
+        ASSERT_EQ(0, manager.init(path));
+        check_log_index(manager, 1, 5, 20);
+        check_log_index(manager, 2, 1, 12);
+        for (int64_t index = 5; index <= 20; ++index) {
+            check_entry(manager, 1, index, 1);
+        }
+        check_entry(manager, 2, 8, 1);
+        check_entry(manager, 2, 9, 2);
+        EXPECT_EQ(2, manager.get_term(2, 12));
+        ASSERT_EQ(0, append(manager, 1, 21, 22, 1));
+    }
+    // 模拟最后一条记录只写了一部分
+    std::vector<std::string> segments = list_segments(path);
+    ASSERT_FALSE(segments.empty());
+    uintmax_t size = boost::filesystem::file_size(segments.back());
+    boost::filesystem::resize_file(segments.back(), size - 10);
+    {
+        TestSegmentLogManager manager;
+        ASSERT_EQ(0, manager.init(path));
+        check_log_index(manager, 1, 5, 21);
+        check_log_index(manager, 2, 1, 12);
+        check_entry(manager, 1, 21, 1);
+        ASSERT_EQ(0, append(manager, 1, 22, 22, 2));
+        check_entry(manager, 1, 22, 2);
+    }
+    // 截断残缺尾部后追加的日志可以正常恢复
+    {
+        TestSegmentLogManager manager;
+        ASSERT_EQ(0, manager.init(path));
+        check_log_index(manager, 1, 5, 22);
+        check_entry(manager, 1, 22, 2);
+        ASSERT_EQ(0, manager.remove_region(2));
+    }
+    {
+        TestSegmentLogManager manager;
+        ASSERT_EQ(0, manager.init(path));
+        EXPECT_FALSE(manager.has_region(2));
+        check_log_index(manager, 1, 5, 22);
+    }
+}
+
+} // namespace baikaldb
@@ -0,0 +1,78 @@
+// Copyright (c) 2018-present Baidu, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include "rocksdb_file_system_adaptor.h"
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace baikaldb {
+DECLARE_int32(snapshot_max_chunk_num);
+DECLARE_int64(snapshot_chunk_size);
+
+TEST(test_snapshot_chunk, chunk_file) {
+    for (int num : {2, 3, 16}) {
+        for (int idx = 0; idx < num; idx++) {
+            int chunk_idx = -1;
+            int chunk_num = -1;
+            std::string path = "/snapshot_00001/" + snapshot_data_chunk_file(idx, num);
+            ASSERT_TRUE(parse_snapshot_data_chunk(path, &chunk_idx, &chunk_num)) << path;
+            EXPECT_EQ(idx, chunk_idx);
+            EXPECT_EQ(num, chunk_num);
+        }
+    }
+    int chunk_idx = 0;
+    int chunk_num = 1;
+    // 不拆分时沿用老文件名
+    EXPECT_FALSE(parse_snapshot_data_chunk("/snapshot_00001" + SNAPSHOT_DATA_FILE_WITH_SLASH,
+            &chunk_idx, &chunk_num));
+    EXPECT_FALSE(parse_snapshot_data_chunk("/snapshot_00001" + SNAPSHOT_META_FILE_WITH_SLASH,
+            &chunk_idx, &chunk_num));
+    // 写sst时追加的文件序号、非法的idx/num
+    EXPECT_FALSE(parse_snapshot_data_chunk(SNAPSHOT_DATA_FILE + "0", &chunk_idx, &chunk_num));
+    EXPECT_FALSE(parse_snapshot_data_chunk(SNAPSHOT_DATA_FILE + "_1_2_0", &chunk_idx, &chunk_num));
+    EXPECT_FALSE(parse_snapshot_data_chunk(SNAPSHOT_DATA_FILE + "_2_2", &chunk_idx, &chunk_num));
+    EXPECT_FALSE(parse_snapshot_data_chunk(SNAPSHOT_DATA_FILE + "_0_0", &chunk_idx, &chunk_num));
+    EXPECT_FALSE(parse_snapshot_data_chunk(SNAPSHOT_DATA_FILE + "_-1_2", &chunk_idx, &chunk_num));
+    EXPECT_FALSE(parse_snapshot_data_chunk(SNAPSHOT_DATA_FILE + "_1", &chunk_idx, &chunk_num));
+    EXPECT_EQ(0, chunk_idx);
+    EXPECT_EQ(1, chunk_num);
+}
+
+TEST(test_snapshot_chunk, chunk_num) {
+    int32_t old_max_chunk_num = FLAGS_snapshot_max_chunk_num;
+    int64_t old_chunk_size = FLAGS_snapshot_chunk_size;
+    FLAGS_snapshot_chunk_size = 100;
+    FLAGS_snapshot_max_chunk_num = 1;
+    EXPECT_EQ(1, snapshot_data_chunk_num(10000));
+    FLAGS_snapshot_max_chunk_num = 4;
+    EXPECT_EQ(1, snapshot_data_chunk_num(0));
+    EXPECT_EQ(1, snapshot_data_chunk_num(99));
+    EXPECT_EQ(2, snapshot_data_chunk_num(100));
+    EXPECT_EQ(3, snapshot_data_chunk_num(299));
+    EXPECT_EQ(4, snapshot_data_chunk_num(300));
+    EXPECT_EQ(4, snapshot_data_chunk_num(10000));
+    // region大小未知时按最大chunk数拆分
+    EXPECT_EQ(4, snapshot_data_chunk_num(UINT64_MAX));
+    FLAGS_snapshot_chunk_size = 0;
+    EXPECT_EQ(1, snapshot_data_chunk_num(10000));
+    FLAGS_snapshot_max_chunk_num = old_max_chunk_num;
+    FLAGS_snapshot_chunk_size = old_chunk_size;
+}
+
+} // namespace baikaldb